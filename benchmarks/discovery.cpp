@@ -0,0 +1,172 @@
+// Measures how long it takes every agent to find the publisher of a tag on the
+// far side of the network, and how much is sent while they do, for ring, grid
+// and random topologies.  The agents are Managers in this process connected
+// through in-process pipes, so the time is spent in discovery rather than in
+// the kernel.
+//
+// Usage: discovery_benchmark [ring|grid|random|all] [agents...]
+
+#include "skywing_core/job.hpp"
+#include "skywing_core/manager.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace skywing;
+using namespace std::chrono_literals;
+
+namespace {
+constexpr std::uint16_t base_port = 42000;
+
+using IntTag = PublishTag<std::int64_t>;
+
+// For each agent, the lower numbered agents it connects to
+using Topology = std::vector<std::vector<std::size_t>>;
+
+Topology make_topology(const std::string& name, const std::size_t num_agents)
+{
+  Topology connect_to(num_agents);
+  const auto add_edge = [&](const std::size_t a, const std::size_t b) {
+    if (a == b) { return; }
+    auto& edges = connect_to[std::max(a, b)];
+    const auto lower = std::min(a, b);
+    if (std::find(edges.cbegin(), edges.cend(), lower) == edges.cend()) { edges.push_back(lower); }
+  };
+  if (name == "grid") {
+    const auto width = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(num_agents))));
+    for (std::size_t i = 0; i < num_agents; ++i) {
+      if ((i + 1) % width != 0 && i + 1 < num_agents) { add_edge(i, i + 1); }
+      if (i + width < num_agents) { add_edge(i, i + width); }
+    }
+    return connect_to;
+  }
+  // A ring keeps the random topology connected
+  for (std::size_t i = 0; i < num_agents; ++i) {
+    add_edge(i, (i + 1) % num_agents);
+  }
+  if (name == "random") {
+    std::mt19937 rng{12345};
+    std::uniform_int_distribution<std::size_t> pick{0, num_agents - 1};
+    for (std::size_t i = 0; i < num_agents; ++i) {
+      add_edge(i, pick(rng));
+      add_edge(i, pick(rng));
+    }
+  }
+  return connect_to;
+}
+
+struct Result {
+  std::chrono::steady_clock::duration converged;
+  internal::SendStatistics sent;
+};
+
+Result run_discovery(const Topology& connect_to)
+{
+  const auto num_agents = connect_to.size();
+  std::vector<std::size_t> degree(num_agents, 0);
+  for (std::size_t i = 0; i < num_agents; ++i) {
+    degree[i] += connect_to[i].size();
+    for (const auto lower : connect_to[i]) {
+      ++degree[lower];
+    }
+  }
+
+  std::vector<std::unique_ptr<Manager>> managers;
+  for (std::size_t i = 0; i < num_agents; ++i) {
+    managers.push_back(std::make_unique<Manager>(
+      static_cast<std::uint16_t>(base_port + i), "agent " + std::to_string(i)));
+    managers.back()->use_in_process_connections();
+    // Let queries reach across the whole network
+    managers.back()->set_discovery_ttl(static_cast<std::uint16_t>(std::min<std::size_t>(num_agents, 65535)));
+  }
+
+  std::atomic<std::size_t> num_connected{0};
+  std::atomic<std::size_t> num_found{0};
+  std::atomic<bool> started{false};
+  std::chrono::steady_clock::time_point start;
+  std::vector<std::chrono::steady_clock::duration> found_after(num_agents);
+  std::vector<internal::SendStatistics> sent_before(num_agents);
+  std::vector<internal::SendStatistics> sent_after(num_agents);
+  for (std::size_t i = 0; i < num_agents; ++i) {
+    managers[i]->submit_job("job", [&, i](Job& job, ManagerHandle handle) {
+      for (const auto lower : connect_to[i]) {
+        while (!handle.connect_to_server("127.0.0.1", static_cast<std::uint16_t>(base_port + lower)).get()) {
+          // empty
+        }
+      }
+      while (static_cast<std::size_t>(handle.number_of_neighbors()) != degree[i]) {
+        std::this_thread::sleep_for(1ms);
+      }
+      const IntTag produced{"tag " + std::to_string(i)};
+      job.declare_publication_intent(produced);
+      // Start timing once the whole network is up
+      sent_before[i] = managers[i]->send_statistics();
+      if (++num_connected == num_agents) {
+        start = std::chrono::steady_clock::now();
+        started = true;
+      }
+      while (!started) {
+        std::this_thread::sleep_for(1ms);
+      }
+      // The agent half way around is about as far away as it gets
+      job.subscribe(IntTag{"tag " + std::to_string((i + num_agents / 2) % num_agents)}).wait();
+      found_after[i] = std::chrono::steady_clock::now() - start;
+      sent_after[i] = managers[i]->send_statistics();
+      // Keep answering queries until everyone is done
+      ++num_found;
+      while (num_found != num_agents) {
+        std::this_thread::sleep_for(1ms);
+      }
+    });
+  }
+  std::vector<std::thread> threads;
+  for (auto& manager : managers) {
+    threads.emplace_back([&manager]() { manager->run(); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  Result result{*std::max_element(found_after.cbegin(), found_after.cend()), {}};
+  for (std::size_t i = 0; i < num_agents; ++i) {
+    result.sent.messages_sent += sent_after[i].messages_sent - sent_before[i].messages_sent;
+    result.sent.bytes_sent += sent_after[i].bytes_sent - sent_before[i].bytes_sent;
+  }
+  return result;
+}
+} // namespace
+
+int main(const int argc, char** const argv)
+{
+  const std::string which = argc > 1 ? argv[1] : "all";
+  std::vector<std::size_t> sizes;
+  for (int i = 2; i < argc; ++i) {
+    sizes.push_back(static_cast<std::size_t>(std::strtoull(argv[i], nullptr, 10)));
+  }
+  if (sizes.empty()) { sizes = {10, 100, 1000}; }
+  const std::vector<std::string> topologies
+    = which == "all" ? std::vector<std::string>{"ring", "grid", "random"} : std::vector<std::string>{which};
+
+  for (const auto& topology : topologies) {
+    for (const auto num_agents : sizes) {
+      if (num_agents < 2) { continue; }
+      const auto result = run_discovery(make_topology(topology, num_agents));
+      const auto millis = std::chrono::duration<double, std::milli>(result.converged).count();
+      std::cout << topology << ", " << num_agents << " agents: converged in " << millis << " ms, "
+                << result.sent.messages_sent << " messages ("
+                << static_cast<double>(result.sent.messages_sent) / static_cast<double>(num_agents)
+                << " per agent), " << result.sent.bytes_sent << " bytes\n";
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,190 @@
+// Measures how the event loop does at the two things the Manager uses it for:
+// reading small messages from a few neighbors out of many idle ones, and
+// sending large messages through send queues.  The connections are real TCP
+// connections over loopback, read and written the way the Manager does, so
+// with the io_uring event loop the I/O goes through the ring.  Build once with
+// each value of the event_loop meson option to compare the backends.
+//
+// Usage: event_loop_benchmark [connections] [active per round] [rounds] [port]
+
+#include "skywing_core/internal/devices/event_loop.hpp"
+#include "skywing_core/internal/devices/receive_buffer.hpp"
+#include "skywing_core/internal/devices/send_queue.hpp"
+#include "skywing_core/internal/devices/socket_communicator.hpp"
+#include "skywing_core/internal/utility/network_conv.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#ifndef SKYWING_EVENT_LOOP
+#define SKYWING_EVENT_LOOP "default"
+#endif
+
+using namespace skywing;
+using namespace skywing::internal;
+using namespace std::chrono_literals;
+
+namespace {
+// The size of the bodies of the messages sent in bulk, which are sent in pieces
+constexpr std::size_t bulk_message_size = 1024 * 1024;
+
+std::size_t parse_arg(const int argc, char** const argv, const int index, const std::size_t default_value)
+{
+  return argc > index ? static_cast<std::size_t>(std::strtoull(argv[index], nullptr, 10)) : default_value;
+}
+
+void report(const char* const what, const std::size_t rounds, const std::chrono::steady_clock::duration elapsed)
+{
+  const auto micros = std::chrono::duration<double, std::micro>(elapsed).count();
+  std::cout << "  " << what << ": " << micros / static_cast<double>(rounds) << " us per round, "
+            << static_cast<double>(rounds) / (micros / 1e6) << " rounds/s\n";
+}
+
+SharedMessage make_frame(const std::size_t size)
+{
+  const auto prefix = to_network_bytes(static_cast<NetworkSizeType>(size));
+  auto bytes = std::vector<std::byte>(prefix.size() + size, std::byte{1});
+  std::copy(prefix.cbegin(), prefix.cend(), bytes.begin());
+  return std::make_shared<const std::vector<std::byte>>(std::move(bytes));
+}
+
+// A connection as the Manager sees it, and the peer at the other end, which
+// isn't on the loop and is read and written directly
+struct Neighbor {
+  SocketCommunicator local;
+  SocketCommunicator peer;
+  ReceiveBuffer local_received{};
+  ReceiveBuffer peer_received{};
+  SendQueue send_queue{64 * 1024 * 1024, 0};
+};
+} // namespace
+
+int main(const int argc, char** const argv)
+{
+  const auto num_connections = parse_arg(argc, argv, 1, 200);
+  const auto active_per_round = std::min(parse_arg(argc, argv, 2, 16), num_connections);
+  const auto num_rounds = parse_arg(argc, argv, 3, 5000);
+  const auto port = static_cast<std::uint16_t>(parse_arg(argc, argv, 4, 40090));
+  std::cout << "event loop " << SKYWING_EVENT_LOOP << ": " << num_connections << " connections, "
+            << active_per_round << " active per round, " << num_rounds << " rounds\n";
+
+  EventLoop loop;
+  SocketCommunicator server;
+  if (server.set_to_listen(port) != ConnectionError::no_error) {
+    std::cerr << "Couldn't listen on port " << port << '\n';
+    return 1;
+  }
+  loop.add(server.native_handle());
+  std::vector<std::unique_ptr<Neighbor>> neighbors;
+  std::unordered_map<int, Neighbor*> by_handle;
+  // Connections are accepted the same way the Manager does, when the loop
+  // says so, one at a time to stay within the listen queue
+  for (std::size_t i = 0; i < num_connections; ++i) {
+    SocketCommunicator peer;
+    if (peer.connect_to_server("127.0.0.1", port) != ConnectionError::no_error) {
+      std::cerr << "Couldn't connect\n";
+      return 1;
+    }
+    std::optional<SocketCommunicator> accepted;
+    while (!accepted) {
+      (void)loop.wait(1000ms);
+      accepted = server.accept();
+    }
+    neighbors.push_back(std::make_unique<Neighbor>(Neighbor{std::move(*accepted), std::move(peer)}));
+    loop.add(neighbors.back()->local.native_handle());
+    by_handle[neighbors.back()->local.native_handle()] = neighbors.back().get();
+  }
+
+  std::mt19937 rng{12345};
+  std::uniform_int_distribution<std::size_t> pick{0, num_connections - 1};
+  std::vector<std::size_t> active;
+  const auto pick_active = [&]() {
+    active.clear();
+    while (active.size() < active_per_round) {
+      const auto index = pick(rng);
+      if (std::find(active.cbegin(), active.cend(), index) == active.cend()) { active.push_back(index); }
+    }
+  };
+
+  // A few neighbors send a small message, and the loop waits until it has all of them
+  const auto small = make_frame(64);
+  auto start = std::chrono::steady_clock::now();
+  std::size_t waits = 0;
+  for (std::size_t round = 0; round < num_rounds; ++round) {
+    pick_active();
+    for (const auto index : active) {
+      (void)neighbors[index]->peer.send_message(small->data(), small->size());
+    }
+    std::size_t seen = 0;
+    while (seen < active.size()) {
+      for (const auto& ready : loop.wait(1000ms)) {
+        const auto iter = by_handle.find(ready.handle);
+        if (iter == by_handle.end() || !ready.readable) { continue; }
+        auto& neighbor = *iter->second;
+        (void)neighbor.local_received.fill(neighbor.local);
+        while (neighbor.local_received.next_frame()) {
+          ++seen;
+        }
+      }
+      ++waits;
+    }
+  }
+  report("small messages received", num_rounds, std::chrono::steady_clock::now() - start);
+  std::cout << "  " << static_cast<double>(waits) / static_cast<double>(num_rounds) << " waits per round\n";
+
+  // A few neighbors are each sent a large message, which goes out as the
+  // sockets have room, until the peers have all of them
+  const auto bulk = make_frame(bulk_message_size);
+  const auto bulk_rounds = std::max<std::size_t>(num_rounds / 50, 1);
+  SendStatistics stats;
+  start = std::chrono::steady_clock::now();
+  for (std::size_t round = 0; round < bulk_rounds; ++round) {
+    pick_active();
+    for (const auto index : active) {
+      auto& neighbor = *neighbors[index];
+      neighbor.send_queue.push(bulk);
+      if (neighbor.send_queue.flush(neighbor.local, stats) == ConnectionError::would_block) {
+        loop.set_want_write(neighbor.local.native_handle(), true);
+      }
+    }
+    std::size_t seen = 0;
+    while (seen < active.size()) {
+      for (const auto& ready : loop.wait(0ms)) {
+        const auto iter = by_handle.find(ready.handle);
+        if (iter == by_handle.end() || !ready.writable) { continue; }
+        auto& neighbor = *iter->second;
+        if (neighbor.send_queue.flush(neighbor.local, stats) != ConnectionError::would_block) {
+          loop.set_want_write(ready.handle, false);
+        }
+      }
+      for (const auto index : active) {
+        auto& neighbor = *neighbors[index];
+        while (neighbor.peer_received.fill(neighbor.peer) == ConnectionError::no_error) {
+          while (neighbor.peer_received.next_frame()) {
+            ++seen;
+          }
+        }
+      }
+    }
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  report("large messages sent", bulk_rounds, elapsed);
+  const auto seconds = std::chrono::duration<double>(elapsed).count();
+  std::cout << "  " << static_cast<double>(bulk_rounds * active_per_round * bulk_message_size) / seconds / 1e6
+            << " MB/s, " << static_cast<double>(stats.bytes_sent) / static_cast<double>(stats.send_calls)
+            << " bytes per send call\n";
+
+  for (const auto& neighbor : neighbors) {
+    loop.remove(neighbor->local.native_handle());
+  }
+  loop.remove(server.native_handle());
+  return 0;
+}
@@ -1,10 +1,11 @@
 #include "skywing_core/basic_manager_config.hpp"
 
-#include "skywing_core/manager.hpp"
+#include "skywing_core/internal/devices/socket_communicator.hpp"
 
 // #include <charconv>
 #include <cstdint>
 #include <cstdlib>
+#include <istream>
 #include <limits>
 
 namespace skywing {
@@ -49,7 +50,10 @@ std::optional<BuildManagerInfo> read_manager_config(std::istream& in) noexcept
   // Machines to connect to
   std::string line;
   while (std::getline(in, line)) {
-    if (!line.empty()) { to_ret.to_connect_to.push_back(std::move(line)); }
+    if (line.empty()) { continue; }
+    auto address = internal::split_address(line);
+    if (address.first.empty()) { return {}; }
+    to_ret.to_connect_to.push_back(std::move(address));
   }
   return to_ret;
 }
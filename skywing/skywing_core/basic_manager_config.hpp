@@ -1,14 +1,16 @@
-#error This header is not yet supported
-
 #ifndef SKYNET_BASIC_MANAGER_CONFIG_HPP
-  #define SKYNET_BASIC_MANAGER_CONFIG_HPP
+#define SKYNET_BASIC_MANAGER_CONFIG_HPP
+
+#include "skywing_core/types.hpp"
 
-  #include <iosfwd>
-  #include <optional>
-  #include <vector>
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace skywing {
-class Manager;
 struct BuildManagerInfo;
 
 /** \brief EXTREMELY simple Manager setup config files.
@@ -18,13 +20,12 @@ struct BuildManagerInfo;
  * machine name
  * machine port
  * heartbeat interval in milliseconds
- * address to connect to 1
- * address to connect to 2
+ * address:port to connect to 1
+ * address:port to connect to 2
  * ...
  * ```
- * The manager must be passed in by reference as it is non-movable.
  *
- * \returns True if reading is successful, false otherwise.
+ * \returns The information read, or nothing if the file is malformed.
  */
 std::optional<BuildManagerInfo> read_manager_config(std::istream& in) noexcept;
 
@@ -36,7 +37,7 @@ std::optional<BuildManagerInfo> read_manager_config(std::istream& in) noexcept;
  */
 struct BuildManagerInfo {
   std::string name;
-  std::vector<std::string> to_connect_to;
+  std::vector<AddrPortPair> to_connect_to;
   std::uint32_t heartbeat_interval_in_ms;
   std::uint16_t port;
 
@@ -3,9 +3,15 @@
 
 #include "message_format.capnp.h"
 
+#include "generated/endian.hpp"
+
+#include <capnp/any.h>
+
 #include <cstddef>
 #include <cstring>
 #include <optional>
+#include <string>
+#include <type_traits>
 #include <vector>
 namespace skywing::internal::detail {
 // For recursing below, I feel like there's a better way of doing this, but I can't think of it.
@@ -14,19 +20,46 @@ struct IsVector : std::false_type {};
 template<typename T>
 struct IsVector<std::vector<T>> : std::true_type {};
 
-// Changing from Cap'n Proto's list of things to a vector of things is a common
-// operation; provide a function to do it
+// Cap'n Proto stores lists of numbers as little endian arrays, so on little
+// endian machines they can be copied in one go
+template<typename T>
+inline constexpr bool is_bulk_copyable
+  = machine_is_little_endian && std::is_arithmetic_v<T> && !std::is_same_v<T, bool>;
+
+// Fills a vector from Cap'n Proto's list of things, reusing the vector's memory
 template<typename To, typename From>
-std::vector<To> list_to_vector(const From& values) noexcept
+void list_into_vector(const From& values, std::vector<To>& out) noexcept
 {
-  std::vector<To> to_ret;
-  to_ret.reserve(values.size());
+  if constexpr (is_bulk_copyable<To>) {
+    // Lists can be encoded with a larger element size than expected; those
+    // have to be read one at a time
+    const auto raw = capnp::AnyList::Reader{values}.getRawBytes();
+    if (raw.size() == values.size() * sizeof(To)) {
+      out.resize(values.size());
+      if (!out.empty()) { std::memcpy(out.data(), raw.begin(), raw.size()); }
+      return;
+    }
+  }
+  out.clear();
+  out.reserve(values.size());
   for (std::size_t i = 0; i < values.size(); ++i) {
-    if constexpr (IsVector<To>::value) { to_ret.push_back(list_to_vector<typename To::value_type>(values[i])); }
+    if constexpr (IsVector<To>::value) {
+      out.emplace_back();
+      list_into_vector(values[i], out.back());
+    }
     else {
-      to_ret.push_back(values[i]);
+      out.push_back(values[i]);
     }
   }
+}
+
+// Changing from Cap'n Proto's list of things to a vector of things is a common
+// operation; provide a function to do it
+template<typename To, typename From>
+std::vector<To> list_to_vector(const From& values) noexcept
+{
+  std::vector<To> to_ret;
+  list_into_vector(values, to_ret);
   return to_ret;
 }
 
@@ -43,6 +76,10 @@ struct PublishValueHandler;
       if (!r.is##capn_suffix()) { return {}; }                                                                       \
       return r.get##capn_suffix();                                                                                   \
     }                                                                                                                \
+    static void get_into(const cpnpro::PublishValue::Reader& r, cpp_type& out) noexcept                              \
+    {                                                                                                                \
+      out = r.get##capn_suffix();                                                                                    \
+    }                                                                                                                \
     static void set(cpnpro::PublishValue::Builder& b, const cpp_type& value) noexcept { b.set##capn_suffix(value); } \
   };                                                                                                                 \
   template<>                                                                                                         \
@@ -52,6 +89,10 @@ struct PublishValueHandler;
       if (!r.isR##capn_suffix()) { return {}; }                                                                      \
       return list_to_vector<cpp_type>(r.getR##capn_suffix());                                                        \
     }                                                                                                                \
+    static void get_into(const cpnpro::PublishValue::Reader& r, std::vector<cpp_type>& out) noexcept                 \
+    {                                                                                                                \
+      list_into_vector(r.getR##capn_suffix(), out);                                                                  \
+    }                                                                                                                \
     static void set(cpnpro::PublishValue::Builder& b, const std::vector<cpp_type>& values) noexcept                  \
     {                                                                                                                \
       auto serialized_data = b.initR##capn_suffix(values.size());                                                    \
@@ -83,6 +124,11 @@ struct PublishValueHandler<std::string> {
     if (!r.isStr()) { return {}; }
     return r.getStr();
   }
+  static void get_into(const cpnpro::PublishValue::Reader& r, std::string& out) noexcept
+  {
+    const auto text = r.getStr();
+    out.assign(text.begin(), text.end());
+  }
   static void set(cpnpro::PublishValue::Builder& b, const std::string& value) noexcept { b.setStr(value); }
 };
 
@@ -94,6 +140,11 @@ struct PublishValueHandler<std::vector<std::string>> {
     return list_to_vector<std::string>(r.getRStr());
   }
 
+  static void get_into(const cpnpro::PublishValue::Reader& r, std::vector<std::string>& out) noexcept
+  {
+    list_into_vector(r.getRStr(), out);
+  }
+
   static void set(cpnpro::PublishValue::Builder& b, const std::vector<std::string>& values) noexcept
   {
     auto serialized_data = b.initRStr(values.size());
@@ -114,6 +165,12 @@ struct PublishValueHandler<std::vector<std::byte>> {
       reinterpret_cast<const std::byte*>(bytes.begin()), reinterpret_cast<const std::byte*>(bytes.end())};
   }
 
+  static void get_into(const cpnpro::PublishValue::Reader& r, std::vector<std::byte>& out) noexcept
+  {
+    const auto bytes = r.getBytes();
+    out.assign(reinterpret_cast<const std::byte*>(bytes.begin()), reinterpret_cast<const std::byte*>(bytes.end()));
+  }
+
   static void set(cpnpro::PublishValue::Builder& b, const std::vector<std::byte>& values) noexcept
   {
     auto serialized_data = b.initBytes(values.size());
@@ -0,0 +1,50 @@
+#ifndef SKYNET_SRC_SOCKET_RING_HPP
+#define SKYNET_SRC_SOCKET_RING_HPP
+
+// With the io_uring event loop, sockets registered with an EventLoop have
+// their I/O done by requests on the loop's ring instead of by direct calls.
+// SocketCommunicator goes through these to find out; the other event loops
+// never take a socket, so every call returns nothing and the caller makes the
+// direct call itself.
+
+#include "skywing_core/internal/devices/transport.hpp"
+
+#include <cstddef>
+#include <optional>
+#include <variant>
+
+namespace skywing::internal {
+/** \brief Hands out bytes the ring has already received for the socket
+ *
+ * Same results as SocketCommunicator::read_some.
+ */
+std::optional<std::variant<std::size_t, ConnectionError>>
+  ring_read_some(int handle, std::byte* buffer, std::size_t size) noexcept;
+
+/** \brief Copies as much of the buffers as there is room for into the
+ * socket's send buffer, to go out with the next submission
+ *
+ * Same results as SocketCommunicator::send_gathered.
+ */
+std::optional<std::variant<std::size_t, ConnectionError>>
+  ring_send_gathered(int handle, const SendBuffer* buffers, std::size_t count) noexcept;
+
+/** \brief Takes a connection the ring has accepted on a listening socket
+ *
+ * Returns the new handle, or -1 with errno set like accept does.
+ */
+std::optional<int> ring_accept(int handle) noexcept;
+
+/** \brief Returns how a connection the ring is watching is getting on
+ */
+std::optional<ConnectionError> ring_connection_status(int handle) noexcept;
+
+/** \brief Takes the socket off its ring before the handle is closed
+ *
+ * Requests that are reading are cancelled, and ones that are sending are left
+ * to finish.  Does nothing if the socket isn't on a ring.
+ */
+void ring_release(int handle) noexcept;
+} // namespace skywing::internal
+
+#endif // SKYNET_SRC_SOCKET_RING_HPP
@@ -3,6 +3,9 @@
 #include "publish_value_handler.hpp"
 #include "skywing_core/internal/utility/logging.hpp"
 
+#include <cstdint>
+#include <cstring>
+
 namespace skywing::internal {
 namespace detail {
 /** \brief Class that supresses Cap'n Proto's exceptions so that they
@@ -31,12 +34,73 @@ private:
   bool failed_ = false;
 };
 
-// Short name entirely for the one function below
-// (type alias templates can't be local)
-template<typename T>
-using pvh = PublishValueHandler<T>;
+// Passed to the callable in with_publish_value_type to name a type
 template<typename T>
-using pvh_v = PublishValueHandler<std::vector<T>>;
+struct TypeTag {
+  using Type = T;
+};
+
+// Calls f with a TypeTag for the C++ type that a published value holds, or
+// returns an empty value if the type isn't recognized
+template<typename F>
+auto with_publish_value_type(const cpnpro::PublishValue::Reader& reader, F&& f) -> decltype(f(TypeTag<double>{}))
+{
+  // This is gross and I hate it, but...
+  using vals = cpnpro::PublishValue::Which;
+  switch (reader.which()) {
+  case vals::D:
+    return f(TypeTag<double>{});
+  case vals::R_D:
+    return f(TypeTag<std::vector<double>>{});
+  case vals::F:
+    return f(TypeTag<float>{});
+  case vals::R_F:
+    return f(TypeTag<std::vector<float>>{});
+  case vals::STR:
+    return f(TypeTag<std::string>{});
+  case vals::R_STR:
+    return f(TypeTag<std::vector<std::string>>{});
+  case vals::I8:
+    return f(TypeTag<std::int8_t>{});
+  case vals::I16:
+    return f(TypeTag<std::int16_t>{});
+  case vals::I32:
+    return f(TypeTag<std::int32_t>{});
+  case vals::I64:
+    return f(TypeTag<std::int64_t>{});
+  case vals::U8:
+    return f(TypeTag<std::uint8_t>{});
+  case vals::U16:
+    return f(TypeTag<std::uint16_t>{});
+  case vals::U32:
+    return f(TypeTag<std::uint32_t>{});
+  case vals::U64:
+    return f(TypeTag<std::uint64_t>{});
+  case vals::R_I8:
+    return f(TypeTag<std::vector<std::int8_t>>{});
+  case vals::R_I16:
+    return f(TypeTag<std::vector<std::int16_t>>{});
+  case vals::R_I32:
+    return f(TypeTag<std::vector<std::int32_t>>{});
+  case vals::R_I64:
+    return f(TypeTag<std::vector<std::int64_t>>{});
+  case vals::R_U8:
+    return f(TypeTag<std::vector<std::uint8_t>>{});
+  case vals::R_U16:
+    return f(TypeTag<std::vector<std::uint16_t>>{});
+  case vals::R_U32:
+    return f(TypeTag<std::vector<std::uint32_t>>{});
+  case vals::R_U64:
+    return f(TypeTag<std::vector<std::uint64_t>>{});
+  case vals::BYTES:
+    return f(TypeTag<std::vector<std::byte>>{});
+  case vals::BOOL:
+    return f(TypeTag<bool>{});
+  case vals::R_BOOL:
+    return f(TypeTag<std::vector<bool>>{});
+  }
+  return {};
+}
 } // namespace detail
 
 /////////////////////////////////////////////////////
@@ -46,62 +110,10 @@ using pvh_v = PublishValueHandler<std::vector<T>>;
 std::optional<std::vector<PublishValueVariant>> PublishData::value() const noexcept
 {
   using namespace detail;
-  const auto decode_value = [](cpnpro::PublishValue::Reader reader) -> std::optional<PublishValueVariant> {
-    // This is gross and I hate it, but...
-    using vals = cpnpro::PublishValue::Which;
-    switch (reader.which()) {
-    case vals::D:
-      return pvh<double>::get(reader);
-    case vals::R_D:
-      return pvh_v<double>::get(reader);
-    case vals::F:
-      return pvh<float>::get(reader);
-    case vals::R_F:
-      return pvh_v<float>::get(reader);
-    case vals::STR:
-      return pvh<std::string>::get(reader);
-    case vals::R_STR:
-      return pvh_v<std::string>::get(reader);
-    case vals::I8:
-      return pvh<std::int8_t>::get(reader);
-    case vals::I16:
-      return pvh<std::int16_t>::get(reader);
-    case vals::I32:
-      return pvh<std::int32_t>::get(reader);
-    case vals::I64:
-      return pvh<std::int64_t>::get(reader);
-    case vals::U8:
-      return pvh<std::uint8_t>::get(reader);
-    case vals::U16:
-      return pvh<std::uint16_t>::get(reader);
-    case vals::U32:
-      return pvh<std::uint32_t>::get(reader);
-    case vals::U64:
-      return pvh<std::uint64_t>::get(reader);
-    case vals::R_I8:
-      return pvh_v<std::int8_t>::get(reader);
-    case vals::R_I16:
-      return pvh_v<std::int16_t>::get(reader);
-    case vals::R_I32:
-      return pvh_v<std::int32_t>::get(reader);
-    case vals::R_I64:
-      return pvh_v<std::int64_t>::get(reader);
-    case vals::R_U8:
-      return pvh_v<std::uint8_t>::get(reader);
-    case vals::R_U16:
-      return pvh_v<std::uint16_t>::get(reader);
-    case vals::R_U32:
-      return pvh_v<std::uint32_t>::get(reader);
-    case vals::R_U64:
-      return pvh_v<std::uint64_t>::get(reader);
-    case vals::BYTES:
-      return pvh_v<std::byte>::get(reader);
-    case vals::BOOL:
-      return pvh<bool>::get(reader);
-    case vals::R_BOOL:
-      return pvh_v<bool>::get(reader);
-    }
-    return std::nullopt;
+  const auto decode_value = [](cpnpro::PublishValue::Reader reader) {
+    return with_publish_value_type(reader, [&](auto tag) -> std::optional<PublishValueVariant> {
+      return PublishValueHandler<typename decltype(tag)::Type>::get(reader);
+    });
   };
   const auto& value = r.getValue();
   std::vector<PublishValueVariant> to_ret(value.size());
@@ -114,10 +126,63 @@ std::optional<std::vector<PublishValueVariant>> PublishData::value() const noexc
   return to_ret;
 }
 
+bool PublishData::holds_types(const gsl::span<const std::uint8_t> expected) const noexcept
+{
+  using namespace detail;
+  ExceptionSuppressor suppressor;
+  const auto value = r.getValue();
+  if (value.size() != static_cast<std::size_t>(expected.size())) { return false; }
+  for (std::size_t i = 0; i < value.size(); ++i) {
+    const auto type_index = with_publish_value_type(value[i], [](auto tag) -> std::optional<std::uint8_t> {
+      return static_cast<std::uint8_t>(index_of<typename decltype(tag)::Type, PublishValueTypeList>);
+    });
+    if (type_index != expected[i]) { return false; }
+  }
+  return !suppressor.failed();
+}
+
+template<typename T>
+void PublishData::read_element(const std::size_t index, T& out) const noexcept
+{
+  detail::ExceptionSuppressor suppressor;
+  detail::PublishValueHandler<T>::get_into(r.getValue()[index], out);
+}
+
+// read_element is used from templates in the header, so it has to exist for every publishable type
+#define SKYNET_INSTANTIATE_READ_ELEMENT(cpp_type)                                                    \
+  template void PublishData::read_element<cpp_type>(std::size_t, cpp_type&) const noexcept;         \
+  template void PublishData::read_element<std::vector<cpp_type>>(std::size_t, std::vector<cpp_type>&) \
+    const noexcept
+
+SKYNET_INSTANTIATE_READ_ELEMENT(float);
+SKYNET_INSTANTIATE_READ_ELEMENT(double);
+SKYNET_INSTANTIATE_READ_ELEMENT(std::int8_t);
+SKYNET_INSTANTIATE_READ_ELEMENT(std::int16_t);
+SKYNET_INSTANTIATE_READ_ELEMENT(std::int32_t);
+SKYNET_INSTANTIATE_READ_ELEMENT(std::int64_t);
+SKYNET_INSTANTIATE_READ_ELEMENT(std::uint8_t);
+SKYNET_INSTANTIATE_READ_ELEMENT(std::uint16_t);
+SKYNET_INSTANTIATE_READ_ELEMENT(std::uint32_t);
+SKYNET_INSTANTIATE_READ_ELEMENT(std::uint64_t);
+SKYNET_INSTANTIATE_READ_ELEMENT(std::string);
+SKYNET_INSTANTIATE_READ_ELEMENT(bool);
+template void PublishData::read_element<std::vector<std::byte>>(std::size_t, std::vector<std::byte>&) const noexcept;
+
+#undef SKYNET_INSTANTIATE_READ_ELEMENT
+
 VersionID PublishData::version() const noexcept { return r.getVersion(); }
 TagID PublishData::tag_id() const noexcept { return r.getTagID(); }
+TagNumber PublishData::tag_number() const noexcept { return r.getTagNumber(); }
 PublishData::PublishData(cpnpro::PublishData::Reader reader) noexcept : r{std::move(reader)} {}
 
+/////////////////////////////////////////////////////
+// TagBinding
+/////////////////////////////////////////////////////
+
+TagNumber TagBinding::tag_number() const noexcept { return r.getTagNumber(); }
+TagID TagBinding::tag_id() const noexcept { return r.getTagID(); }
+TagBinding::TagBinding(cpnpro::TagBinding::Reader reader) noexcept : r{std::move(reader)} {}
+
 /////////////////////////////////////////////////////
 // Greeting
 /////////////////////////////////////////////////////
@@ -128,21 +193,36 @@ std::vector<MachineID> Greeting::neighbors() const noexcept
   return detail::list_to_vector<MachineID>(r.getNeighbors());
 }
 std::uint16_t Greeting::port() const noexcept { return r.getPort(); }
+std::string Greeting::host_id() const noexcept { return r.getHostID(); }
 Greeting::Greeting(cpnpro::Greeting::Reader reader) noexcept : r{std::move(reader)} {}
 
 /////////////////////////////////////////////////////
-// NewNeighbor
+// SharedMemoryOffer
 /////////////////////////////////////////////////////
 
-MachineID NewNeighbor::neighbor_id() const noexcept { return r.getNeighborID(); }
-NewNeighbor::NewNeighbor(cpnpro::NewNeighbor::Reader reader) noexcept : r{std::move(reader)} {}
+std::string SharedMemoryOffer::segment_name() const noexcept { return r.getSegmentName(); }
+SharedMemoryOffer::SharedMemoryOffer(cpnpro::SharedMemoryOffer::Reader reader) noexcept : r{std::move(reader)} {}
 
 /////////////////////////////////////////////////////
-// RemoveNeighbor
+// SharedMemorySwitch
 /////////////////////////////////////////////////////
 
-MachineID RemoveNeighbor::neighbor_id() const noexcept { return r.getNeighborID(); }
-RemoveNeighbor::RemoveNeighbor(cpnpro::RemoveNeighbor::Reader reader) noexcept : r{std::move(reader)} {}
+bool SharedMemorySwitch::accepted() const noexcept { return r.getAccepted(); }
+SharedMemorySwitch::SharedMemorySwitch(cpnpro::SharedMemorySwitch::Reader reader) noexcept : r{std::move(reader)} {}
+
+/////////////////////////////////////////////////////
+// NeighborUpdate
+/////////////////////////////////////////////////////
+
+std::vector<MachineID> NeighborUpdate::added() const noexcept
+{
+  return detail::list_to_vector<MachineID>(r.getAdded());
+}
+std::vector<MachineID> NeighborUpdate::removed() const noexcept
+{
+  return detail::list_to_vector<MachineID>(r.getRemoved());
+}
+NeighborUpdate::NeighborUpdate(cpnpro::NeighborUpdate::Reader reader) noexcept : r{std::move(reader)} {}
 
 /////////////////////////////////////////////////////
 // ReportPublishers
@@ -161,6 +241,10 @@ std::vector<TagID> ReportPublishers::locally_produced_tags() const noexcept
 {
   return detail::list_to_vector<TagID>(r.getLocallyProducedTags());
 }
+std::uint64_t ReportPublishers::epoch() const noexcept { return r.getEpoch(); }
+std::uint64_t ReportPublishers::base_version() const noexcept { return r.getBaseVersion(); }
+std::uint64_t ReportPublishers::version() const noexcept { return r.getVersion(); }
+std::uint64_t ReportPublishers::query_id() const noexcept { return r.getQueryID(); }
 
 ReportPublishers::ReportPublishers(cpnpro::ReportPublishers::Reader reader) noexcept : r{std::move(reader)} {}
 
@@ -174,6 +258,10 @@ std::vector<std::uint8_t> GetPublishers::publishers_needed() const noexcept
   return detail::list_to_vector<std::uint8_t>(r.getPublishersNeeded());
 }
 bool GetPublishers::ignore_cache() const noexcept { return r.getIgnoreCache(); }
+std::uint64_t GetPublishers::known_epoch() const noexcept { return r.getKnownEpoch(); }
+std::uint64_t GetPublishers::known_version() const noexcept { return r.getKnownVersion(); }
+std::uint64_t GetPublishers::query_id() const noexcept { return r.getQueryID(); }
+std::uint16_t GetPublishers::ttl() const noexcept { return r.getTtl(); }
 GetPublishers::GetPublishers(cpnpro::GetPublishers::Reader reader) noexcept : r{std::move(reader)} {}
 
 /////////////////////////////////////////////////////
@@ -222,16 +310,25 @@ MessageHandler::MessageHandler() noexcept : impl_{std::make_unique<Impl>()} {}
 MessageHandler::MessageHandler(MessageHandler&&) noexcept = default;
 MessageHandler& MessageHandler::operator=(MessageHandler&&) noexcept = default;
 
-std::optional<MessageHandler> MessageHandler::try_to_create(const std::vector<std::byte>& data) noexcept
+std::optional<MessageHandler> MessageHandler::try_to_create(const gsl::span<const std::byte> data) noexcept
 {
   detail::ExceptionSuppressor suppressor;
-  // Read the message from the passed bytes
+  const auto num_bytes = static_cast<std::size_t>(data.size());
+  if (num_bytes % sizeof(capnp::word) != 0) {
+    SKYNET_WARN_LOG("Message of {} bytes passed to MessageHandler::try_to_create isn't made of whole words.", num_bytes);
+    return {};
+  }
   MessageHandler to_ret;
-  kj::Array<const kj::byte> buffer{
-    reinterpret_cast<const kj::byte*>(data.data()), data.size(), to_ret.impl_->null_disposer};
-  kj::ArrayInputStream in_s{buffer};
-  capnp::readMessageCopy(in_s, to_ret.impl_->message);
-  to_ret.impl_->root = to_ret.impl_->message.getRoot<cpnpro::StatusMessage>();
+  auto& impl = *to_ret.impl_;
+  // Read the message from the passed bytes directly if possible
+  const capnp::word* words = reinterpret_cast<const capnp::word*>(data.data());
+  if (reinterpret_cast<std::uintptr_t>(data.data()) % alignof(capnp::word) != 0) {
+    impl.aligned_copy = kj::heapArray<capnp::word>(num_bytes / sizeof(capnp::word));
+    std::memcpy(impl.aligned_copy.begin(), data.data(), num_bytes);
+    words = impl.aligned_copy.begin();
+  }
+  impl.message.emplace(kj::arrayPtr(words, num_bytes / sizeof(capnp::word)));
+  impl.root = impl.message->getRoot<cpnpro::StatusMessage>();
   if (suppressor.failed()) {
     SKYNET_WARN_LOG("Failed to decode message in MessageHandler::try_to_create.");
     return {};
@@ -253,10 +350,10 @@ auto MessageHandler::extract_message() const noexcept -> std::optional<MessageVa
       return Greeting{impl_->root.getGreeting()};
     case vals::GOODBYE:
       return Goodbye{/* impl_->root.getGoodbye() */};
-    case vals::NEW_NEIGHBOR:
-      return NewNeighbor{impl_->root.getNewNeighbor()};
-    case vals::REMOVE_NEIGHBOR:
-      return RemoveNeighbor{impl_->root.getRemoveNeighbor()};
+    case vals::UNUSED2:
+    case vals::UNUSED3:
+      // Nothing sends these any more
+      return {};
     case vals::HEARTBEAT:
       return Heartbeat{/* impl_->root.getHeartbeat() */};
     case vals::REPORT_PUBLISHERS:
@@ -273,6 +370,14 @@ auto MessageHandler::extract_message() const noexcept -> std::optional<MessageVa
       return PublishData{impl_->root.getPublishData()};
     case vals::SUBSCRIPTION_NOTICE:
       return SubscriptionNotice{impl_->root.getSubscriptionNotice()};
+    case vals::TAG_BINDING:
+      return TagBinding{impl_->root.getTagBinding()};
+    case vals::SHARED_MEMORY_OFFER:
+      return SharedMemoryOffer{impl_->root.getSharedMemoryOffer()};
+    case vals::SHARED_MEMORY_SWITCH:
+      return SharedMemorySwitch{impl_->root.getSharedMemorySwitch()};
+    case vals::NEIGHBOR_UPDATE:
+      return NeighborUpdate{impl_->root.getNeighborUpdate()};
     }
     return {};
   }();
@@ -8,15 +8,20 @@
 
 #include <capnp/serialize.h>
 
+#include "skywing_core/internal/tag_interner.hpp"
 #include "skywing_core/internal/utility/overload_set.hpp"
 #include "skywing_core/types.hpp"
 
+#include "gsl/span"
+
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <iterator>
 #include <memory>
 #include <optional>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -27,10 +32,56 @@ namespace skywing::internal {
 class PublishData {
 public:
   VersionID version() const noexcept;
+
+  /** \brief Returns the tag's text, which is empty if tag_number() is used instead
+   */
   TagID tag_id() const noexcept;
+
+  /** \brief Returns the number bound to the tag, or no_tag_number if tag_id() is set
+   */
+  TagNumber tag_number() const noexcept;
   std::optional<std::vector<PublishValueVariant>> value() const noexcept;
 
+  /** \brief Returns true if the value is made up of exactly the types Ts...
+   */
+  template<typename... Ts>
+  bool holds_types() const noexcept
+  {
+    static constexpr std::array<std::uint8_t, sizeof...(Ts)> expected{
+      static_cast<std::uint8_t>(index_of<Ts, PublishValueTypeList>)...};
+    return holds_types(gsl::span<const std::uint8_t>{expected});
+  }
+
+  /** \brief Decodes the value straight into storage for the types Ts...
+   *
+   * Unlike value() this doesn't go through PublishValueVariant, and reuses
+   * any memory already held by out.
+   *
+   * \pre holds_types<Ts...>() is true
+   */
+  template<typename... Ts>
+  void read_value_into(ValueOrTuple<Ts...>& out) const noexcept
+  {
+    if constexpr (sizeof...(Ts) == 1) { read_element(0, out); }
+    else {
+      read_elements(out, std::index_sequence_for<Ts...>{});
+    }
+  }
+
 private:
+  // Checks the value's types against indices into PublishValueTypeList
+  bool holds_types(gsl::span<const std::uint8_t> expected) const noexcept;
+
+  // Reads a single element of the value; instantiated for every type in PublishValueTypeList
+  template<typename T>
+  void read_element(std::size_t index, T& out) const noexcept;
+
+  template<typename Tuple, std::size_t... Is>
+  void read_elements(Tuple& out, std::index_sequence<Is...>) const noexcept
+  {
+    (read_element(Is, std::get<Is>(out)), ...);
+  }
+
   cpnpro::PublishData::Reader r;
 
   friend class MessageHandler;
@@ -39,6 +90,20 @@ private:
   explicit PublishData(cpnpro::PublishData::Reader reader) noexcept;
 };
 
+/** \brief Class representing the binding of a tag to a number for a connection
+ */
+class TagBinding {
+public:
+  TagNumber tag_number() const noexcept;
+  TagID tag_id() const noexcept;
+
+private:
+  cpnpro::TagBinding::Reader r;
+
+  friend class MessageHandler;
+  explicit TagBinding(cpnpro::TagBinding::Reader reader) noexcept;
+};
+
 /** \brief Class representing a greeting message
  */
 class Greeting {
@@ -47,6 +112,11 @@ public:
   std::vector<MachineID> neighbors() const noexcept;
   std::uint16_t port() const noexcept;
 
+  /** \brief Returns the sender's host_identity(), which is empty if it doesn't
+   * support shared memory
+   */
+  std::string host_id() const noexcept;
+
 private:
   cpnpro::Greeting::Reader r;
 
@@ -54,36 +124,51 @@ private:
   explicit Greeting(cpnpro::Greeting::Reader reader) noexcept;
 };
 
-/** \brief Class representing a goodbye message
+/** \brief Class representing an offer to talk through shared memory
  */
-class Goodbye {
-  // Intentionally empty
+class SharedMemoryOffer {
+public:
+  std::string segment_name() const noexcept;
+
+private:
+  cpnpro::SharedMemoryOffer::Reader r;
+
+  friend class MessageHandler;
+  explicit SharedMemoryOffer(cpnpro::SharedMemoryOffer::Reader reader) noexcept;
 };
 
-/** \brief Class representing a new neighbor message
+/** \brief Class representing the answer to a SharedMemoryOffer, which when
+ * accepted also marks the end of the sender's data on the socket
  */
-class NewNeighbor {
+class SharedMemorySwitch {
 public:
-  MachineID neighbor_id() const noexcept;
+  bool accepted() const noexcept;
 
 private:
-  cpnpro::NewNeighbor::Reader r;
+  cpnpro::SharedMemorySwitch::Reader r;
 
   friend class MessageHandler;
-  explicit NewNeighbor(cpnpro::NewNeighbor::Reader reader) noexcept;
+  explicit SharedMemorySwitch(cpnpro::SharedMemorySwitch::Reader reader) noexcept;
+};
+
+/** \brief Class representing a goodbye message
+ */
+class Goodbye {
+  // Intentionally empty
 };
 
-/** \brief Class representing a remove neighbor message
+/** \brief Class representing a batch of changes to the sender's neighbors
  */
-class RemoveNeighbor {
+class NeighborUpdate {
 public:
-  MachineID neighbor_id() const noexcept;
+  std::vector<MachineID> added() const noexcept;
+  std::vector<MachineID> removed() const noexcept;
 
 private:
-  cpnpro::RemoveNeighbor::Reader r;
+  cpnpro::NeighborUpdate::Reader r;
 
   friend class MessageHandler;
-  explicit RemoveNeighbor(cpnpro::RemoveNeighbor::Reader reader) noexcept;
+  explicit NeighborUpdate(cpnpro::NeighborUpdate::Reader reader) noexcept;
 };
 
 /** \brief Class representing a heartbeat
@@ -100,6 +185,10 @@ public:
   std::vector<std::vector<std::string>> addresses() const noexcept;
   std::vector<std::vector<MachineID>> machines() const noexcept;
   std::vector<TagID> locally_produced_tags() const noexcept;
+  std::uint64_t epoch() const noexcept;
+  std::uint64_t base_version() const noexcept;
+  std::uint64_t version() const noexcept;
+  std::uint64_t query_id() const noexcept;
 
 private:
   cpnpro::ReportPublishers::Reader r;
@@ -115,6 +204,10 @@ public:
   std::vector<TagID> tags() const noexcept;
   std::vector<std::uint8_t> publishers_needed() const noexcept;
   bool ignore_cache() const noexcept;
+  std::uint64_t known_epoch() const noexcept;
+  std::uint64_t known_version() const noexcept;
+  std::uint64_t query_id() const noexcept;
+  std::uint16_t ttl() const noexcept;
 
 private:
   cpnpro::GetPublishers::Reader r;
@@ -185,8 +278,12 @@ private:
 class MessageHandler {
 public:
   /** \brief Construct a message handler from a raw set of bytes
+   *
+   * Word aligned bytes are read in place rather than copied, so they must
+   * stay valid and unchanged for as long as the handler and anything read
+   * from it are in use.  Unaligned bytes are copied.
    */
-  static std::optional<MessageHandler> try_to_create(const std::vector<std::byte>& data) noexcept;
+  static std::optional<MessageHandler> try_to_create(gsl::span<const std::byte> data) noexcept;
 
   // Moveable only
   MessageHandler() noexcept;
@@ -213,8 +310,7 @@ private:
   using MessageVariant = std::variant<
     Greeting,
     Goodbye,
-    NewNeighbor,
-    RemoveNeighbor,
+    NeighborUpdate,
     Heartbeat,
     ReportPublishers,
     GetPublishers,
@@ -222,18 +318,22 @@ private:
     SubmitReduceValue,
     ReportReduceDisconnection,
     SubscriptionNotice,
-    PublishData>;
+    PublishData,
+    TagBinding,
+    SharedMemoryOffer,
+    SharedMemorySwitch>;
 
   // Process the stored message and return its internal type
   std::optional<MessageVariant> extract_message() const noexcept;
 
-  // capnp::MallocMessageBuilder isn't copyable or movable, but needs to be
+  // capnp::FlatArrayMessageReader isn't copyable or movable, but needs to be
   // contained in this structure; use PIMPL to solve this
   // Impl needs to be defined here since this object is being returned as
   // an optional, which requires it to be complete
   struct Impl {
-    kj::NullArrayDisposer null_disposer;
-    capnp::MallocMessageBuilder message;
+    // Only used if the bytes passed in weren't word aligned
+    kj::Array<capnp::word> aligned_copy;
+    std::optional<capnp::FlatArrayMessageReader> message;
     cpnpro::StatusMessage::Reader root;
   };
   std::unique_ptr<Impl> impl_;
@@ -0,0 +1,115 @@
+#include "skywing_core/internal/devices/address_resolver.hpp"
+
+#include "skywing_core/internal/utility/logging.hpp"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <cstring>
+#include <optional>
+#include <utility>
+
+namespace skywing::internal {
+namespace {
+std::optional<std::string> to_string(const in_addr& address) noexcept
+{
+  char buffer[INET_ADDRSTRLEN];
+  if (inet_ntop(AF_INET, &address, buffer, sizeof(buffer)) == nullptr) { return {}; }
+  return std::string{buffer};
+}
+
+// Converts hosts that don't need a lookup
+std::optional<std::string> convert_numeric(const std::string& host) noexcept
+{
+  if (host == "localhost") { return std::string{"127.0.0.1"}; }
+  in_addr address;
+  if (inet_pton(AF_INET, host.c_str(), &address) != 1) { return {}; }
+  return to_string(address);
+}
+
+std::optional<std::string> look_up(const std::string& host) noexcept
+{
+  addrinfo hints;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_protocol = IPPROTO_IP;
+  addrinfo* result;
+  const int err = getaddrinfo(host.c_str(), nullptr, &hints, &result);
+  if (err != 0) {
+    SKYNET_WARN_LOG("Couldn't resolve \"{}\": {}", host, gai_strerror(err));
+    return {};
+  }
+  auto to_ret = to_string(reinterpret_cast<const sockaddr_in*>(result->ai_addr)->sin_addr);
+  freeaddrinfo(result);
+  return to_ret;
+}
+} // namespace
+
+AddressResolver::AddressResolver(std::function<void()> on_lookup_done) noexcept
+  : on_lookup_done_{std::move(on_lookup_done)}
+{}
+
+AddressResolver::~AddressResolver()
+{
+  {
+    std::lock_guard lock{mutex_};
+    stopping_ = true;
+  }
+  lookup_cv_.notify_one();
+  if (thread_.joinable()) { thread_.join(); }
+}
+
+AddressResolver::Result AddressResolver::resolve(const std::string& host) noexcept
+{
+  if (auto numeric = convert_numeric(host)) { return Result{Status::resolved, std::move(*numeric)}; }
+  {
+    std::lock_guard lock{mutex_};
+    const auto [iter, inserted] = cache_.try_emplace(host, Entry{Result{Status::pending, {}}, {}});
+    auto& entry = iter->second;
+    if (!inserted) {
+      const bool can_retry = entry.result.status == Status::failed
+                          && std::chrono::steady_clock::now() - entry.failed_at >= failed_lookup_retry_interval;
+      if (!can_retry) { return entry.result; }
+      entry.result.status = Status::pending;
+    }
+    to_look_up_.push_back(host);
+    if (!thread_.joinable()) { thread_ = std::thread{[this]() { run(); }}; }
+  }
+  lookup_cv_.notify_one();
+  return Result{Status::pending, {}};
+}
+
+AddressResolver::Result AddressResolver::find(const std::string& host) const noexcept
+{
+  if (auto numeric = convert_numeric(host)) { return Result{Status::resolved, std::move(*numeric)}; }
+  std::lock_guard lock{mutex_};
+  const auto iter = cache_.find(host);
+  return iter == cache_.cend() ? Result{Status::pending, {}} : iter->second.result;
+}
+
+void AddressResolver::run() noexcept
+{
+  std::unique_lock lock{mutex_};
+  while (true) {
+    lookup_cv_.wait(lock, [&]() { return stopping_ || !to_look_up_.empty(); });
+    if (stopping_) { return; }
+    const auto host = std::move(to_look_up_.front());
+    to_look_up_.pop_front();
+    lock.unlock();
+    auto address = look_up(host);
+    lock.lock();
+    auto& entry = cache_[host];
+    if (address) { entry.result = Result{Status::resolved, std::move(*address)}; }
+    else {
+      entry.result = Result{Status::failed, {}};
+      entry.failed_at = std::chrono::steady_clock::now();
+    }
+    lock.unlock();
+    on_lookup_done_();
+    lock.lock();
+  }
+}
+} // namespace skywing::internal
@@ -0,0 +1,84 @@
+#ifndef SKYNET_INTERNAL_DEVICES_ADDRESS_RESOLVER_HPP
+#define SKYNET_INTERNAL_DEVICES_ADDRESS_RESOLVER_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace skywing::internal {
+// How long a failed lookup is remembered before resolving the host tries again
+inline constexpr std::chrono::seconds failed_lookup_retry_interval{5};
+
+/** \brief Turns host names into canonical IPv4 addresses without blocking
+ *
+ * Numeric addresses and "localhost" are converted right away.  Anything else
+ * is looked up on a helper thread, started on the first lookup, and the
+ * result is cached by host so each name is only looked up once.  The callback
+ * given on construction is called from the helper thread after each lookup
+ * finishes so the owner knows to ask again.
+ */
+class AddressResolver {
+public:
+  enum class Status {
+    /// A lookup is in progress
+    pending,
+
+    /// The address is known
+    resolved,
+
+    /// The host couldn't be resolved
+    failed
+  }; // enum class Status
+
+  struct Result {
+    Status status;
+
+    // The canonical address if resolved
+    std::string address;
+  }; // struct Result
+
+  explicit AddressResolver(std::function<void()> on_lookup_done) noexcept;
+
+  /** \brief Waits for a lookup in progress to finish before returning
+   */
+  ~AddressResolver();
+
+  AddressResolver(const AddressResolver&) = delete;
+  AddressResolver& operator=(const AddressResolver&) = delete;
+
+  /** \brief Returns what is known about a host, starting a lookup if nothing
+   * is or a failed one is old enough to retry
+   */
+  Result resolve(const std::string& host) noexcept;
+
+  /** \brief Returns what is known about a host without starting a lookup; a
+   * host that was never looked up is reported as pending
+   */
+  Result find(const std::string& host) const noexcept;
+
+private:
+  struct Entry {
+    Result result;
+    std::chrono::steady_clock::time_point failed_at;
+  };
+
+  // Body of the helper thread
+  void run() noexcept;
+
+  std::function<void()> on_lookup_done_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable lookup_cv_;
+  std::unordered_map<std::string, Entry> cache_;
+  std::deque<std::string> to_look_up_;
+  bool stopping_ = false;
+  std::thread thread_;
+}; // class AddressResolver
+} // namespace skywing::internal
+
+#endif // SKYNET_INTERNAL_DEVICES_ADDRESS_RESOLVER_HPP
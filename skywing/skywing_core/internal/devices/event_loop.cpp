@@ -0,0 +1,85 @@
+#include "skywing_core/internal/devices/event_loop.hpp"
+
+#include <algorithm>
+
+// The parts of EventLoop that don't depend on the platform
+
+namespace skywing::internal {
+void EventLoop::notify_readable(const int handle) noexcept
+{
+  {
+    std::lock_guard lock{in_process_mutex_};
+    const auto iter = in_process_handles_.find(handle);
+    if (iter == in_process_handles_.end() || iter->second.notified) { return; }
+    iter->second.notified = true;
+    notified_.push_back(handle);
+  }
+  wake();
+}
+
+bool EventLoop::add_in_process(const int handle, const bool want_write) noexcept
+{
+  {
+    std::lock_guard lock{in_process_mutex_};
+    if (!in_process_handles_.try_emplace(handle, InProcessHandle{want_write, true}).second) { return false; }
+    notified_.push_back(handle);
+    num_want_write_ += want_write ? 1 : 0;
+  }
+  wake();
+  return true;
+}
+
+bool EventLoop::set_in_process_want_write(const int handle, const bool want_write) noexcept
+{
+  {
+    std::lock_guard lock{in_process_mutex_};
+    const auto iter = in_process_handles_.find(handle);
+    if (iter == in_process_handles_.end()) { return false; }
+    if (iter->second.want_write == want_write) { return true; }
+    iter->second.want_write = want_write;
+    if (want_write) { ++num_want_write_; }
+    else {
+      --num_want_write_;
+    }
+  }
+  if (want_write) { wake(); }
+  return true;
+}
+
+void EventLoop::remove_in_process(const int handle) noexcept
+{
+  std::lock_guard lock{in_process_mutex_};
+  const auto iter = in_process_handles_.find(handle);
+  if (iter == in_process_handles_.end()) { return; }
+  num_want_write_ -= iter->second.want_write ? 1 : 0;
+  // Left in notified_ and skipped when collected
+  in_process_handles_.erase(iter);
+}
+
+bool EventLoop::in_process_ready() noexcept
+{
+  std::lock_guard lock{in_process_mutex_};
+  return !notified_.empty() || num_want_write_ != 0;
+}
+
+void EventLoop::collect_in_process_ready() noexcept
+{
+  std::lock_guard lock{in_process_mutex_};
+  for (const int handle : notified_) {
+    const auto iter = in_process_handles_.find(handle);
+    if (iter == in_process_handles_.end() || !iter->second.notified) { continue; }
+    iter->second.notified = false;
+    ready_.push_back(ReadyHandle{handle, true, iter->second.want_write, false});
+  }
+  notified_.clear();
+  if (num_want_write_ == 0) { return; }
+  for (auto& [handle, info] : in_process_handles_) {
+    // Ones that were also notified were reported above
+    if (info.want_write && std::find_if(ready_.cbegin(), ready_.cend(), [&](const ReadyHandle& ready) {
+                             return ready.handle == handle;
+                           }) == ready_.cend()) {
+      ready_.push_back(ReadyHandle{handle, false, true, false});
+    }
+  }
+}
+} // namespace skywing::internal
@@ -0,0 +1,133 @@
+#ifndef SKYNET_INTERNAL_DEVICES_EVENT_LOOP_HPP
+#define SKYNET_INTERNAL_DEVICES_EVENT_LOOP_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace skywing::internal {
+/** \brief A file descriptor that was reported as ready by EventLoop::wait
+ */
+struct ReadyHandle {
+  int handle;
+  bool readable;
+  bool writable;
+  // Error or hang-up was reported; the owner should try to read to find out why
+  bool error;
+}; // struct ReadyHandle
+
+/** \brief Readiness-based wait over a set of sockets
+ *
+ * Wraps epoll on Linux and poll on macOS.  Besides the registered sockets the
+ * loop can be woken from any thread with wake() and has an optional periodic
+ * timer, so that the owner only runs when there is actually something to do.
+ *
+ * Negative handles aren't handed to the OS.  They stand for in-process
+ * connections, which are reported as readable when notify_readable is called
+ * for them and as writable whenever writability is wanted.
+ *
+ * Registration functions may be called from any thread, including while
+ * another thread is blocked in wait().  Only one thread may call wait().
+ */
+class EventLoop {
+public:
+  EventLoop() noexcept;
+  ~EventLoop();
+
+  EventLoop(const EventLoop&) = delete;
+  EventLoop& operator=(const EventLoop&) = delete;
+  EventLoop(EventLoop&&) = delete;
+  EventLoop& operator=(EventLoop&&) = delete;
+
+  /** \brief Starts watching a handle for readability, and writability if requested
+   *
+   * Returns false if the handle could not be registered
+   */
+  bool add(int handle, bool want_write = false) noexcept;
+
+  /** \brief Changes if a registered handle is watched for writability
+   */
+  bool set_want_write(int handle, bool want_write) noexcept;
+
+  /** \brief Stops watching a handle; does nothing if it was not registered
+   *
+   * Must be called before the handle is closed.
+   */
+  void remove(int handle) noexcept;
+
+  /** \brief Interrupts a call to wait(), or the next call if none is in progress
+   *
+   * Repeated calls before the loop wakes are coalesced into one.
+   */
+  void wake() noexcept;
+
+  /** \brief Reports a registered negative handle as readable in the next
+   * wait(), waking it; may be called from any thread
+   *
+   * Does nothing if the handle isn't registered.  A handle is also reported
+   * once when it is first added, in case it was notified before that.
+   */
+  void notify_readable(int handle) noexcept;
+
+  /** \brief Sets up a timer that fires every interval; a zero interval disables it
+   */
+  void set_periodic_timer(std::chrono::milliseconds interval) noexcept;
+
+  /** \brief Blocks until a handle is ready, the loop is woken, the timer fires,
+   * or the timeout passes; a negative timeout waits indefinitely
+   *
+   * Returns the handles that are ready, which stay valid until the next call.
+   */
+  const std::vector<ReadyHandle>& wait(std::chrono::milliseconds timeout) noexcept;
+
+  /** \brief Returns true if the periodic timer fired during the last wait()
+   */
+  bool timer_fired() const noexcept { return timer_fired_; }
+
+  /** \brief Returns true if wake() was called before or during the last wait()
+   */
+  bool was_woken() const noexcept { return was_woken_; }
+
+private:
+  struct InProcessHandle {
+    bool want_write;
+    bool notified;
+  };
+
+  // Registration for negative handles, shared by the platform implementations
+  bool add_in_process(int handle, bool want_write) noexcept;
+  bool set_in_process_want_write(int handle, bool want_write) noexcept;
+  void remove_in_process(int handle) noexcept;
+
+  // Returns true if an in-process handle is ready, so wait() mustn't block
+  bool in_process_ready() noexcept;
+
+  // Adds the ready in-process handles to ready_ and clears their notifications
+  void collect_in_process_ready() noexcept;
+
+  // Platform specific state
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+
+  // The handles reported from the last wait
+  std::vector<ReadyHandle> ready_;
+
+  // Set when a wake is pending so that repeated wakes don't each make a syscall
+  std::atomic<bool> wake_pending_{false};
+
+  std::mutex in_process_mutex_;
+  std::unordered_map<int, InProcessHandle> in_process_handles_;
+  // Handles notified since the last wait, in order
+  std::vector<int> notified_;
+  std::size_t num_want_write_ = 0;
+
+  bool timer_fired_ = false;
+  bool was_woken_ = false;
+}; // class EventLoop
+} // namespace skywing::internal
+
+#endif // SKYNET_INTERNAL_DEVICES_EVENT_LOOP_HPP
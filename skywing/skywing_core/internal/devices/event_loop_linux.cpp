@@ -0,0 +1,167 @@
+#include "skywing_core/internal/devices/event_loop.hpp"
+
+#include "skywing_core/internal/utility/logging.hpp"
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace skywing::internal {
+namespace {
+// Maximum number of events retrieved by a single epoll_wait call
+constexpr int max_events_per_wait = 256;
+
+epoll_event make_event(const int handle, const bool want_write) noexcept
+{
+  epoll_event ev;
+  std::memset(&ev, 0, sizeof(ev));
+  ev.events = want_write ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+  ev.data.fd = handle;
+  return ev;
+}
+
+// Reads the 8-byte counter that eventfd and timerfd use, ignoring the value
+void drain_counter(const int handle) noexcept
+{
+  std::uint64_t count;
+  while (read(handle, &count, sizeof(count)) == sizeof(count)) {
+    // empty
+  }
+}
+} // namespace
+
+struct EventLoop::Impl {
+  int epoll_handle;
+  int wake_handle;
+  int timer_handle;
+  std::vector<epoll_event> events;
+};
+
+EventLoop::EventLoop() noexcept
+  : impl_{std::make_unique<Impl>(Impl{
+    epoll_create1(EPOLL_CLOEXEC),
+    eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC),
+    timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC),
+    std::vector<epoll_event>(max_events_per_wait)})}
+{
+  if (impl_->epoll_handle < 0 || impl_->wake_handle < 0 || impl_->timer_handle < 0) {
+    std::perror("EventLoop::EventLoop - create");
+    std::exit(4);
+  }
+  for (const int handle : {impl_->wake_handle, impl_->timer_handle}) {
+    auto ev = make_event(handle, false);
+    if (epoll_ctl(impl_->epoll_handle, EPOLL_CTL_ADD, handle, &ev) < 0) {
+      std::perror("EventLoop::EventLoop - epoll_ctl");
+      std::exit(4);
+    }
+  }
+}
+
+EventLoop::~EventLoop()
+{
+  close(impl_->timer_handle);
+  close(impl_->wake_handle);
+  close(impl_->epoll_handle);
+}
+
+bool EventLoop::add(const int handle, const bool want_write) noexcept
+{
+  if (handle < 0) { return add_in_process(handle, want_write); }
+  auto ev = make_event(handle, want_write);
+  if (epoll_ctl(impl_->epoll_handle, EPOLL_CTL_ADD, handle, &ev) < 0) {
+    SKYNET_DEBUG_LOG("EventLoop::add for handle {} failed: {}", handle, strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+bool EventLoop::set_want_write(const int handle, const bool want_write) noexcept
+{
+  if (handle < 0) { return set_in_process_want_write(handle, want_write); }
+  auto ev = make_event(handle, want_write);
+  if (epoll_ctl(impl_->epoll_handle, EPOLL_CTL_MOD, handle, &ev) < 0) {
+    SKYNET_DEBUG_LOG("EventLoop::set_want_write for handle {} failed: {}", handle, strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+void EventLoop::remove(const int handle) noexcept
+{
+  if (handle < 0) {
+    remove_in_process(handle);
+    return;
+  }
+  // Pre-2.6.9 kernels require a non-null event even though it is ignored
+  epoll_event ev;
+  std::memset(&ev, 0, sizeof(ev));
+  // Errors are ignored; the handle may never have been registered
+  (void)epoll_ctl(impl_->epoll_handle, EPOLL_CTL_DEL, handle, &ev);
+}
+
+void EventLoop::wake() noexcept
+{
+  if (wake_pending_.exchange(true, std::memory_order_acq_rel)) { return; }
+  const std::uint64_t one = 1;
+  // The only possible failure is the counter overflowing, in which case the loop
+  // will be woken anyway
+  (void)write(impl_->wake_handle, &one, sizeof(one));
+}
+
+void EventLoop::set_periodic_timer(const std::chrono::milliseconds interval) noexcept
+{
+  using namespace std::chrono;
+  itimerspec spec;
+  std::memset(&spec, 0, sizeof(spec));
+  const auto secs = duration_cast<seconds>(interval);
+  spec.it_interval.tv_sec = secs.count();
+  spec.it_interval.tv_nsec = duration_cast<nanoseconds>(interval - secs).count();
+  spec.it_value = spec.it_interval;
+  if (timerfd_settime(impl_->timer_handle, 0, &spec, nullptr) < 0) {
+    SKYNET_WARN_LOG("EventLoop::set_periodic_timer failed: {}", strerror(errno));
+  }
+}
+
+const std::vector<ReadyHandle>& EventLoop::wait(const std::chrono::milliseconds timeout) noexcept
+{
+  ready_.clear();
+  timer_fired_ = false;
+  was_woken_ = false;
+  const auto wait_for = in_process_ready() ? std::chrono::milliseconds{0} : timeout;
+  const int timeout_ms = wait_for.count() < 0 ? -1 : static_cast<int>(wait_for.count());
+  const int num_events
+    = epoll_wait(impl_->epoll_handle, impl_->events.data(), static_cast<int>(impl_->events.size()), timeout_ms);
+  collect_in_process_ready();
+  if (num_events < 0) {
+    if (errno != EINTR) { SKYNET_WARN_LOG("EventLoop::wait failed: {}", strerror(errno)); }
+    return ready_;
+  }
+  for (int i = 0; i < num_events; ++i) {
+    const auto& ev = impl_->events[i];
+    if (ev.data.fd == impl_->wake_handle) {
+      // Clear the flag before draining so a wake that races with this is never lost
+      wake_pending_.store(false, std::memory_order_release);
+      drain_counter(impl_->wake_handle);
+      was_woken_ = true;
+    }
+    else if (ev.data.fd == impl_->timer_handle) {
+      drain_counter(impl_->timer_handle);
+      timer_fired_ = true;
+    }
+    else {
+      ready_.push_back(ReadyHandle{
+        ev.data.fd,
+        (ev.events & EPOLLIN) != 0,
+        (ev.events & EPOLLOUT) != 0,
+        (ev.events & (EPOLLERR | EPOLLHUP)) != 0});
+    }
+  }
+  return ready_;
+}
+} // namespace skywing::internal
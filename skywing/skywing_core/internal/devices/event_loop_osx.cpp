@@ -0,0 +1,157 @@
+#include "skywing_core/internal/devices/event_loop.hpp"
+
+#include "skywing_core/internal/utility/logging.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+// macOS has no epoll/eventfd/timerfd, so this uses poll with a self-pipe for
+// wake-ups and computes the timer deadline by hand.  The set of handles is
+// rebuilt on every wait, which is fine for the neighbor counts seen in practice.
+
+namespace skywing::internal {
+namespace {
+void set_non_blocking(const int handle) noexcept
+{
+  const auto flags = fcntl(handle, F_GETFL, 0) | O_NONBLOCK;
+  fcntl(handle, F_SETFL, flags);
+}
+} // namespace
+
+struct EventLoop::Impl {
+  // [0] is read from in wait, [1] is written to by wake
+  int wake_pipe[2];
+  // Registered handles and if they want writability
+  std::mutex registry_mutex;
+  std::unordered_map<int, bool> registry;
+  // Timer information; a zero interval means no timer
+  std::chrono::milliseconds timer_interval{0};
+  std::chrono::steady_clock::time_point next_timer_fire;
+  std::vector<pollfd> poll_handles;
+};
+
+EventLoop::EventLoop() noexcept : impl_{std::make_unique<Impl>()}
+{
+  if (pipe(impl_->wake_pipe) < 0) {
+    std::perror("EventLoop::EventLoop - pipe");
+    std::exit(4);
+  }
+  set_non_blocking(impl_->wake_pipe[0]);
+  set_non_blocking(impl_->wake_pipe[1]);
+}
+
+EventLoop::~EventLoop()
+{
+  close(impl_->wake_pipe[0]);
+  close(impl_->wake_pipe[1]);
+}
+
+bool EventLoop::add(const int handle, const bool want_write) noexcept
+{
+  if (handle < 0) { return add_in_process(handle, want_write); }
+  {
+    std::lock_guard lock{impl_->registry_mutex};
+    if (!impl_->registry.try_emplace(handle, want_write).second) { return false; }
+  }
+  // poll works off of a snapshot so make sure a blocked wait picks this up
+  wake();
+  return true;
+}
+
+bool EventLoop::set_want_write(const int handle, const bool want_write) noexcept
+{
+  if (handle < 0) { return set_in_process_want_write(handle, want_write); }
+  {
+    std::lock_guard lock{impl_->registry_mutex};
+    const auto iter = impl_->registry.find(handle);
+    if (iter == impl_->registry.end()) { return false; }
+    iter->second = want_write;
+  }
+  wake();
+  return true;
+}
+
+void EventLoop::remove(const int handle) noexcept
+{
+  if (handle < 0) {
+    remove_in_process(handle);
+    return;
+  }
+  std::lock_guard lock{impl_->registry_mutex};
+  impl_->registry.erase(handle);
+}
+
+void EventLoop::wake() noexcept
+{
+  if (wake_pending_.exchange(true, std::memory_order_acq_rel)) { return; }
+  const char byte = 0;
+  // A full pipe means a wake-up is already pending
+  (void)write(impl_->wake_pipe[1], &byte, 1);
+}
+
+void EventLoop::set_periodic_timer(const std::chrono::milliseconds interval) noexcept
+{
+  impl_->timer_interval = interval;
+  impl_->next_timer_fire = std::chrono::steady_clock::now() + interval;
+}
+
+const std::vector<ReadyHandle>& EventLoop::wait(const std::chrono::milliseconds timeout) noexcept
+{
+  using namespace std::chrono;
+  ready_.clear();
+  timer_fired_ = false;
+  was_woken_ = false;
+  auto& handles = impl_->poll_handles;
+  handles.clear();
+  handles.push_back(pollfd{impl_->wake_pipe[0], POLLIN, 0});
+  {
+    std::lock_guard lock{impl_->registry_mutex};
+    for (const auto& [handle, want_write] : impl_->registry) {
+      handles.push_back(pollfd{handle, static_cast<short>(POLLIN | (want_write ? POLLOUT : 0)), 0});
+    }
+  }
+  // Shorten the timeout so the timer deadline isn't missed
+  auto wait_for = in_process_ready() ? milliseconds{0} : timeout;
+  const bool has_timer = impl_->timer_interval.count() > 0;
+  if (has_timer) {
+    const auto until_timer
+      = duration_cast<milliseconds>(impl_->next_timer_fire - steady_clock::now()) + milliseconds{1};
+    if (wait_for.count() < 0 || until_timer < wait_for) { wait_for = std::max(until_timer, milliseconds{0}); }
+  }
+  const int timeout_ms = wait_for.count() < 0 ? -1 : static_cast<int>(wait_for.count());
+  const int num_ready = poll(handles.data(), static_cast<nfds_t>(handles.size()), timeout_ms);
+  collect_in_process_ready();
+  if (has_timer && steady_clock::now() >= impl_->next_timer_fire) {
+    timer_fired_ = true;
+    impl_->next_timer_fire = steady_clock::now() + impl_->timer_interval;
+  }
+  if (num_ready < 0) {
+    if (errno != EINTR) { SKYNET_WARN_LOG("EventLoop::wait failed: {}", strerror(errno)); }
+    return ready_;
+  }
+  if (handles[0].revents != 0) {
+    // Clear the flag before draining so a wake that races with this is never lost
+    wake_pending_.store(false, std::memory_order_release);
+    char buffer[64];
+    while (read(impl_->wake_pipe[0], buffer, sizeof(buffer)) > 0) {
+      // empty
+    }
+    was_woken_ = true;
+  }
+  for (std::size_t i = 1; i < handles.size(); ++i) {
+    const auto& h = handles[i];
+    if (h.revents == 0) { continue; }
+    ready_.push_back(ReadyHandle{
+      h.fd, (h.revents & POLLIN) != 0, (h.revents & POLLOUT) != 0, (h.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0});
+  }
+  return ready_;
+}
+} // namespace skywing::internal
@@ -0,0 +1,969 @@
+#include "skywing_core/internal/devices/event_loop.hpp"
+
+#include "socket_ring.hpp"
+
+#include "generated/socket_no_sigpipe.hpp"
+#include "skywing_core/internal/utility/logging.hpp"
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+// io_uring version of the Linux event loop, chosen with the event_loop meson
+// option.  Sockets registered with the loop don't just have their readiness
+// waited on: their receives, sends and accepts, and the wait for a connection
+// to finish, are all requests on the ring.  SocketCommunicator goes through
+// socket_ring.hpp to hand out what has been received and to queue what is
+// sent, and the requests made during a pass over the neighbors go to the
+// kernel together in the io_uring_enter call that waits.
+//
+// The kernel uses a request's memory until its completion arrives, so each
+// socket has its own receive and send buffers that never move, and the ring
+// keeps the socket alive until all of its requests have completed, even if
+// it was released and its handle closed before then.  The ring is driven
+// directly so liburing isn't needed.
+
+namespace skywing::internal {
+namespace {
+constexpr unsigned submission_entries = 256;
+constexpr unsigned completion_entries = 4096;
+
+// Needed for mapping both rings at once, not losing completions when the
+// completion ring is full, and waiting with a timeout
+constexpr unsigned required_features = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+
+// The size of each socket's buffers for the kernel to receive into and send from
+constexpr std::size_t ring_receive_size = 64 * 1024;
+constexpr std::size_t ring_send_size = 256 * 1024;
+
+// How long closing the loop gives sends that are still going out
+constexpr std::chrono::milliseconds send_drain_timeout{1000};
+
+// What a request is for is kept in the low bits of its user data, and the
+// address of the socket it's for, if any, in the rest
+enum class RequestKind : std::uint64_t {
+  wake_read,
+  timer_read,
+  cancel,
+  receive,
+  // Waits for readability ahead of a receive after one found nothing
+  receive_poll,
+  send,
+  // Waits for writability ahead of a send after one found no room
+  send_poll,
+  accept,
+  connect_poll
+};
+constexpr std::uint64_t request_kind_mask = 0xf;
+
+enum class SocketState { connecting, connected, listening, failed };
+
+int io_uring_setup(const unsigned entries, io_uring_params* const params) noexcept
+{
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(
+  const int ring,
+  const unsigned to_submit,
+  const unsigned min_complete,
+  const unsigned flags,
+  const void* const arg,
+  const std::size_t arg_size) noexcept
+{
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring, to_submit, min_complete, flags, arg, arg_size));
+}
+
+// The ring indices are shared with the kernel
+unsigned load_acquire(const unsigned* const value) noexcept { return __atomic_load_n(value, __ATOMIC_ACQUIRE); }
+
+void store_release(unsigned* const value, const unsigned to_store) noexcept
+{
+  __atomic_store_n(value, to_store, __ATOMIC_RELEASE);
+}
+
+struct Ring;
+
+// A socket registered with a loop, and the memory its requests use; it has to
+// be at least 16 byte aligned to leave room for the request kind
+struct alignas(16) RingSocket : std::enable_shared_from_this<RingSocket> {
+  RingSocket(const int handle_in, Ring& ring_in, const SocketState state_in) noexcept
+    : handle{handle_in},
+      ring{ring_in},
+      state{state_in},
+      received{std::make_unique<std::byte[]>(state_in == SocketState::listening ? 0 : ring_receive_size)},
+      staged{std::make_unique<std::byte[]>(state_in == SocketState::listening ? 0 : ring_send_size)}
+  {}
+
+  const int handle;
+  Ring& ring;
+
+  // Guards everything below
+  std::mutex mutex;
+
+  SocketState state;
+  bool want_write = false;
+
+  // Set once the socket is taken off the loop; after that it only stays
+  // around until its requests are done, and makes no new ones as the handle
+  // may have been closed
+  bool released = false;
+
+  // Requests in the kernel, and which ones
+  unsigned requests = 0;
+  bool receiving = false;
+  bool sending = false;
+  bool accepting = false;
+  bool watching_connect = false;
+
+  // Received bytes that haven't been handed out are [received_begin, received_end)
+  std::unique_ptr<std::byte[]> received;
+  std::size_t received_begin = 0;
+  std::size_t received_end = 0;
+
+  // Set once the peer closes the connection or a receive fails
+  ConnectionError receive_error = ConnectionError::no_error;
+
+  // [send_begin, send_end) is with the kernel and [send_end, staged_end)
+  // goes out once it's done
+  std::unique_ptr<std::byte[]> staged;
+  std::size_t send_begin = 0;
+  std::size_t send_end = 0;
+  std::size_t staged_end = 0;
+  bool send_failed = false;
+
+  std::deque<int> accepted;
+  // An errno value from a failed accept that hasn't been handed out
+  int accept_error = 0;
+
+  // The wait the socket was last reported in, and where
+  std::uint64_t reported_in = 0;
+  std::size_t ready_index = 0;
+};
+
+// Sockets are looked up by handle, since that's all SocketCommunicator has;
+// handles are unique across the process, whichever loop they're on
+struct SocketRegistry {
+  std::shared_mutex mutex;
+  std::unordered_map<int, std::shared_ptr<RingSocket>> sockets;
+};
+
+SocketRegistry& registry() noexcept
+{
+  static SocketRegistry instance;
+  return instance;
+}
+
+std::shared_ptr<RingSocket> find_socket(const int handle) noexcept
+{
+  auto& reg = registry();
+  std::shared_lock lock{reg.mutex};
+  const auto iter = reg.sockets.find(handle);
+  return iter == reg.sockets.end() ? nullptr : iter->second;
+}
+
+// What a socket would be reported as right now
+ReadyHandle readiness(const RingSocket& socket) noexcept
+{
+  const bool error = socket.state == SocketState::failed || socket.send_failed
+                  || socket.receive_error == ConnectionError::unrecoverable;
+  const bool readable = socket.received_begin != socket.received_end
+                     || socket.receive_error != ConnectionError::no_error || !socket.accepted.empty()
+                     || socket.accept_error != 0;
+  const bool writable = socket.want_write && socket.state == SocketState::connected && !socket.send_failed
+                     && socket.staged_end < ring_send_size;
+  return ReadyHandle{socket.handle, readable, writable, error};
+}
+
+struct Ring {
+  int ring_handle = -1;
+  int wake_handle = -1;
+  int timer_handle = -1;
+
+  void* ring_mapping = MAP_FAILED;
+  std::size_t ring_mapping_size = 0;
+  io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+  std::size_t sqes_size = 0;
+
+  unsigned* sq_head;
+  unsigned* sq_tail;
+  unsigned* sq_array;
+  unsigned sq_mask;
+  unsigned sq_entries;
+
+  unsigned* cq_head;
+  unsigned* cq_tail;
+  io_uring_cqe* cqes;
+  unsigned cq_mask;
+
+  // Guards the submission ring and everything below; a socket's mutex is
+  // always taken before this one
+  std::mutex mutex;
+
+  // Every socket that is registered or still has requests in the kernel
+  std::unordered_map<RingSocket*, std::shared_ptr<RingSocket>> sockets;
+
+  // Sockets to look at at the start of the next wait because they may be
+  // ready without anything completing
+  std::vector<std::shared_ptr<RingSocket>> recheck;
+
+  // Requests in the kernel, not counting cancellations
+  std::size_t requests = 0;
+
+  // Set once the loop is being destroyed, after which nothing is re-armed
+  bool closing = false;
+
+  // Set while a wait may be blocked in the kernel, so anything queued then
+  // has to wake it up to be submitted
+  std::atomic<bool> waiting{false};
+
+  // Where the wake-up and timer counters are read to
+  std::uint64_t wake_count = 0;
+  std::uint64_t timer_count = 0;
+
+  // Only used by the waiting thread: the wait number, and the sockets
+  // reported in the last wait
+  std::uint64_t pass = 0;
+  std::vector<std::shared_ptr<RingSocket>> reported;
+  std::vector<std::shared_ptr<RingSocket>> checking;
+
+  // Hands everything queued so far to the kernel without waiting
+  void submit() noexcept
+  {
+    const unsigned pending = *sq_tail - load_acquire(sq_head);
+    if (pending != 0 && io_uring_enter(ring_handle, pending, 0, 0, nullptr, 0) < 0) {
+      SKYNET_WARN_LOG("EventLoop submit failed: {}", strerror(errno));
+    }
+  }
+
+  // Makes sure the next count entries can be queued without a submission in
+  // between, which would break up linked requests
+  void reserve(const unsigned count) noexcept
+  {
+    if (sq_entries - (*sq_tail - load_acquire(sq_head)) < count) { submit(); }
+  }
+
+  // Fills in and queues an entry; it goes to the kernel with the next enter
+  template<typename Fill>
+  void queue(const RequestKind kind, RingSocket* const socket, Fill&& fill) noexcept
+  {
+    reserve(1);
+    const unsigned index = *sq_tail & sq_mask;
+    auto& sqe = sqes[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.user_data = reinterpret_cast<std::uint64_t>(socket) | static_cast<std::uint64_t>(kind);
+    fill(sqe);
+    sq_array[index] = index;
+    store_release(sq_tail, *sq_tail + 1);
+    if (kind == RequestKind::cancel) { return; }
+    ++requests;
+    if (socket) { ++socket->requests; }
+  }
+
+  // The rest all need both the socket's mutex and this one to be held
+
+  void queue_counter_read(const RequestKind kind, const int handle, std::uint64_t& count) noexcept
+  {
+    queue(kind, nullptr, [&](io_uring_sqe& sqe) {
+      sqe.opcode = IORING_OP_READ;
+      sqe.fd = handle;
+      sqe.addr = reinterpret_cast<std::uint64_t>(&count);
+      sqe.len = sizeof(count);
+    });
+  }
+
+  // Waits for events before the request queued after it is started
+  void queue_poll_first(RingSocket& socket, const RequestKind kind, const unsigned events) noexcept
+  {
+    reserve(2);
+    queue(kind, &socket, [&](io_uring_sqe& sqe) {
+      sqe.opcode = IORING_OP_POLL_ADD;
+      sqe.fd = socket.handle;
+      sqe.flags = IOSQE_IO_LINK;
+      sqe.poll32_events = events;
+    });
+  }
+
+  void queue_receive(RingSocket& socket, const bool poll_first) noexcept
+  {
+    if (socket.receiving || socket.released || closing) { return; }
+    if (poll_first) { queue_poll_first(socket, RequestKind::receive_poll, POLLIN); }
+    queue(RequestKind::receive, &socket, [&](io_uring_sqe& sqe) {
+      sqe.opcode = IORING_OP_RECV;
+      sqe.fd = socket.handle;
+      sqe.addr = reinterpret_cast<std::uint64_t>(socket.received.get());
+      sqe.len = static_cast<std::uint32_t>(ring_receive_size);
+    });
+    socket.receiving = true;
+  }
+
+  // Sends everything staged that isn't sent yet
+  void queue_send(RingSocket& socket, const bool poll_first) noexcept
+  {
+    if (socket.released || closing) { return; }
+    if (poll_first) { queue_poll_first(socket, RequestKind::send_poll, POLLOUT); }
+    socket.send_end = socket.staged_end;
+    queue(RequestKind::send, &socket, [&](io_uring_sqe& sqe) {
+      sqe.opcode = IORING_OP_SEND;
+      sqe.fd = socket.handle;
+      sqe.addr = reinterpret_cast<std::uint64_t>(socket.staged.get() + socket.send_begin);
+      sqe.len = static_cast<std::uint32_t>(socket.send_end - socket.send_begin);
+      sqe.msg_flags = SKYNET_NO_SIGPIPE;
+    });
+    socket.sending = true;
+  }
+
+  void queue_accept(RingSocket& socket, const bool poll_first) noexcept
+  {
+    if (socket.accepting || socket.released || closing) { return; }
+    if (poll_first) { queue_poll_first(socket, RequestKind::receive_poll, POLLIN); }
+    queue(RequestKind::accept, &socket, [&](io_uring_sqe& sqe) {
+      sqe.opcode = IORING_OP_ACCEPT;
+      sqe.fd = socket.handle;
+      sqe.accept_flags = SOCK_NONBLOCK;
+    });
+    socket.accepting = true;
+  }
+
+  // A connection has finished, one way or the other, once it's writable or has an error
+  void queue_connect_poll(RingSocket& socket) noexcept
+  {
+    queue(RequestKind::connect_poll, &socket, [&](io_uring_sqe& sqe) {
+      sqe.opcode = IORING_OP_POLL_ADD;
+      sqe.fd = socket.handle;
+      sqe.poll32_events = POLLOUT;
+    });
+    socket.watching_connect = true;
+  }
+
+  void queue_cancel(RingSocket* const socket, const RequestKind kind) noexcept
+  {
+    queue(RequestKind::cancel, nullptr, [&](io_uring_sqe& sqe) {
+      sqe.opcode = IORING_OP_ASYNC_CANCEL;
+      sqe.fd = -1;
+      sqe.addr = reinterpret_cast<std::uint64_t>(socket) | static_cast<std::uint64_t>(kind);
+    });
+  }
+
+  // Cancels the requests that could otherwise wait forever; sends are left
+  // to finish unless include_sends is set
+  void cancel_requests(RingSocket& socket, const bool include_sends) noexcept
+  {
+    if (socket.receiving) {
+      queue_cancel(&socket, RequestKind::receive_poll);
+      queue_cancel(&socket, RequestKind::receive);
+    }
+    if (socket.accepting) {
+      queue_cancel(&socket, RequestKind::receive_poll);
+      queue_cancel(&socket, RequestKind::accept);
+    }
+    if (socket.watching_connect) { queue_cancel(&socket, RequestKind::connect_poll); }
+    if (include_sends && socket.sending) {
+      queue_cancel(&socket, RequestKind::send_poll);
+      queue_cancel(&socket, RequestKind::send);
+    }
+  }
+
+  // Wakes a blocked wait so that what was just queued is submitted
+  void queued_from_outside() noexcept
+  {
+    if (!waiting.load()) { return; }
+    const std::uint64_t one = 1;
+    (void)write(wake_handle, &one, sizeof(one));
+  }
+
+  // Updates a socket for one of its requests completing, re-arming it as
+  // needed; the socket's mutex must be held
+  void complete(RingSocket& socket, const RequestKind kind, const int result) noexcept
+  {
+    std::lock_guard lock{mutex};
+    --socket.requests;
+    --requests;
+    const bool keep_going = !socket.released && !closing;
+    const bool try_again = result == -EAGAIN || result == -EINTR;
+    switch (kind) {
+    case RequestKind::receive:
+      socket.receiving = false;
+      if (result > 0) {
+        socket.received_begin = 0;
+        socket.received_end = static_cast<std::size_t>(result);
+      }
+      else if (result == 0) {
+        socket.receive_error = ConnectionError::closed;
+      }
+      else if (try_again) {
+        queue_receive(socket, true);
+      }
+      else if (keep_going) {
+        SKYNET_DEBUG_LOG("Receive on handle {} failed: {}", socket.handle, strerror(-result));
+        socket.receive_error = ConnectionError::unrecoverable;
+      }
+      break;
+
+    case RequestKind::send:
+      if (result > 0) {
+        socket.send_begin += static_cast<std::size_t>(result);
+        if (socket.send_begin == socket.staged_end) {
+          socket.send_begin = socket.send_end = socket.staged_end = 0;
+          socket.sending = false;
+        }
+        else if (keep_going) {
+          // The rest of a short send, and anything staged since
+          queue_send(socket, false);
+        }
+        else {
+          socket.sending = false;
+        }
+      }
+      else if (try_again && keep_going) {
+        queue_send(socket, true);
+      }
+      else {
+        if (keep_going) { SKYNET_DEBUG_LOG("Send on handle {} failed: {}", socket.handle, strerror(-result)); }
+        socket.sending = false;
+        socket.send_failed = true;
+      }
+      break;
+
+    case RequestKind::accept:
+      socket.accepting = false;
+      if (result >= 0) {
+        if (keep_going) { socket.accepted.push_back(result); }
+        else {
+          close(result);
+        }
+      }
+      else if (!try_again && result != -ECANCELED && result != -ECONNABORTED) {
+        socket.accept_error = -result;
+      }
+      // A failure is handed out before trying again, so it can't spin
+      if (socket.accept_error == 0) { queue_accept(socket, try_again); }
+      break;
+
+    case RequestKind::connect_poll: {
+      socket.watching_connect = false;
+      if (!keep_going) { break; }
+      int error = 0;
+      socklen_t len = sizeof(error);
+      if (
+        result < 0 || (result & (POLLERR | POLLHUP)) != 0
+        || getsockopt(socket.handle, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0) {
+        socket.state = SocketState::failed;
+      }
+      else {
+        socket.state = SocketState::connected;
+        queue_receive(socket, false);
+      }
+    } break;
+
+    // These only hold back the request linked after them, which reports for both
+    case RequestKind::receive_poll:
+    case RequestKind::send_poll:
+    // These aren't for a socket
+    case RequestKind::wake_read:
+    case RequestKind::timer_read:
+    case RequestKind::cancel:
+      break;
+    }
+  }
+};
+
+// Takes a socket off its loop; whatever is queued for it is submitted right
+// away, since once the handle is closed the number could be reused
+void release(const std::shared_ptr<RingSocket>& socket) noexcept
+{
+  auto& ring = socket->ring;
+  {
+    auto& reg = registry();
+    std::unique_lock lock{reg.mutex};
+    const auto iter = reg.sockets.find(socket->handle);
+    if (iter != reg.sockets.end() && iter->second == socket) { reg.sockets.erase(iter); }
+  }
+  std::lock_guard lock{socket->mutex};
+  if (socket->released) { return; }
+  socket->released = true;
+  for (const int handle : socket->accepted) {
+    close(handle);
+  }
+  socket->accepted.clear();
+  std::lock_guard ring_lock{ring.mutex};
+  ring.cancel_requests(*socket, false);
+  ring.submit();
+  // The caller's reference keeps it alive until the locks are released
+  if (socket->requests == 0) { ring.sockets.erase(socket.get()); }
+}
+} // namespace
+
+struct EventLoop::Impl {
+  Ring ring;
+};
+
+EventLoop::EventLoop() noexcept : impl_{std::make_unique<Impl>()}
+{
+  auto& ring = impl_->ring;
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = completion_entries;
+  ring.ring_handle = io_uring_setup(submission_entries, &params);
+  // The counters are read by requests on the ring, which would just fail
+  // instead of waiting if these were non-blocking
+  ring.wake_handle = eventfd(0, EFD_CLOEXEC);
+  ring.timer_handle = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+  if (ring.ring_handle < 0 || ring.wake_handle < 0 || ring.timer_handle < 0) {
+    std::perror("EventLoop::EventLoop - create");
+    std::exit(4);
+  }
+  if ((params.features & required_features) != required_features) {
+    SKYNET_ERROR_LOG("EventLoop::EventLoop - io_uring is missing required features; the kernel is too old");
+    std::exit(4);
+  }
+  ring.ring_mapping_size = std::max(
+    params.sq_off.array + params.sq_entries * sizeof(unsigned),
+    params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+  ring.ring_mapping = mmap(
+    nullptr, ring.ring_mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.ring_handle,
+    IORING_OFF_SQ_RING);
+  ring.sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+  ring.sqes = static_cast<io_uring_sqe*>(mmap(
+    nullptr, ring.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.ring_handle, IORING_OFF_SQES));
+  if (ring.ring_mapping == MAP_FAILED || ring.sqes == MAP_FAILED) {
+    std::perror("EventLoop::EventLoop - mmap");
+    std::exit(4);
+  }
+  const auto bytes = static_cast<std::byte*>(ring.ring_mapping);
+  const auto field = [&](const std::uint32_t offset) { return reinterpret_cast<unsigned*>(bytes + offset); };
+  ring.sq_head = field(params.sq_off.head);
+  ring.sq_tail = field(params.sq_off.tail);
+  ring.sq_array = field(params.sq_off.array);
+  ring.sq_mask = *field(params.sq_off.ring_mask);
+  ring.sq_entries = *field(params.sq_off.ring_entries);
+  ring.cq_head = field(params.cq_off.head);
+  ring.cq_tail = field(params.cq_off.tail);
+  ring.cqes = reinterpret_cast<io_uring_cqe*>(bytes + params.cq_off.cqes);
+  ring.cq_mask = *field(params.cq_off.ring_mask);
+  std::lock_guard lock{ring.mutex};
+  ring.queue_counter_read(RequestKind::wake_read, ring.wake_handle, ring.wake_count);
+  ring.queue_counter_read(RequestKind::timer_read, ring.timer_handle, ring.timer_count);
+}
+
+EventLoop::~EventLoop()
+{
+  using namespace std::chrono;
+  auto& ring = impl_->ring;
+  std::vector<std::shared_ptr<RingSocket>> sockets;
+  {
+    std::lock_guard lock{ring.mutex};
+    for (const auto& entry : ring.sockets) {
+      sockets.push_back(entry.second);
+    }
+  }
+  // Anything still registered is let go of as if its owner had done it
+  for (const auto& socket : sockets) {
+    release(socket);
+  }
+  {
+    std::lock_guard lock{ring.mutex};
+    ring.closing = true;
+    ring.queue_cancel(nullptr, RequestKind::wake_read);
+    ring.queue_cancel(nullptr, RequestKind::timer_read);
+  }
+  // The kernel may still be using the buffers, so wait for everything to
+  // finish, cancelling sends that take too long
+  const auto deadline = steady_clock::now() + send_drain_timeout;
+  bool sends_cancelled = false;
+  while (true) {
+    unsigned to_submit;
+    {
+      std::lock_guard lock{ring.mutex};
+      if (ring.requests == 0) { break; }
+      if (!sends_cancelled && steady_clock::now() >= deadline) {
+        sends_cancelled = true;
+        for (const auto& socket : sockets) {
+          std::lock_guard socket_lock{socket->mutex};
+          // Nothing else can lock these now, so the order doesn't matter
+          ring.cancel_requests(*socket, true);
+        }
+      }
+      to_submit = *ring.sq_tail - load_acquire(ring.sq_head);
+    }
+    __kernel_timespec time_spec;
+    time_spec.tv_sec = 0;
+    time_spec.tv_nsec = duration_cast<nanoseconds>(milliseconds{10}).count();
+    io_uring_getevents_arg arg;
+    std::memset(&arg, 0, sizeof(arg));
+    arg.ts = reinterpret_cast<std::uint64_t>(&time_spec);
+    (void)io_uring_enter(
+      ring.ring_handle, to_submit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    unsigned head = *ring.cq_head;
+    const unsigned tail = load_acquire(ring.cq_tail);
+    for (; head != tail; ++head) {
+      const auto cqe = ring.cqes[head & ring.cq_mask];
+      const auto kind = static_cast<RequestKind>(cqe.user_data & request_kind_mask);
+      const auto socket = reinterpret_cast<RingSocket*>(cqe.user_data & ~request_kind_mask);
+      if (socket) {
+        std::lock_guard lock{socket->mutex};
+        ring.complete(*socket, kind, cqe.res);
+      }
+      else if (kind != RequestKind::cancel) {
+        std::lock_guard lock{ring.mutex};
+        --ring.requests;
+      }
+    }
+    store_release(ring.cq_head, head);
+  }
+  munmap(ring.sqes, ring.sqes_size);
+  munmap(ring.ring_mapping, ring.ring_mapping_size);
+  close(ring.ring_handle);
+  close(ring.timer_handle);
+  close(ring.wake_handle);
+}
+
+bool EventLoop::add(const int handle, const bool want_write) noexcept
+{
+  if (handle < 0) { return add_in_process(handle, want_write); }
+  auto& ring = impl_->ring;
+  // Work out what the socket is doing so the right request is made for it
+  int listening = 0;
+  socklen_t len = sizeof(listening);
+  if (getsockopt(handle, SOL_SOCKET, SO_ACCEPTCONN, &listening, &len) < 0) {
+    SKYNET_DEBUG_LOG("EventLoop::add for handle {} failed: {}", handle, strerror(errno));
+    return false;
+  }
+  sockaddr_storage peer;
+  socklen_t peer_len = sizeof(peer);
+  const auto state = listening != 0 ? SocketState::listening
+                   : getpeername(handle, reinterpret_cast<sockaddr*>(&peer), &peer_len) == 0
+                     ? SocketState::connected
+                     : SocketState::connecting;
+  const auto socket = std::make_shared<RingSocket>(handle, ring, state);
+  {
+    auto& reg = registry();
+    std::unique_lock lock{reg.mutex};
+    if (!reg.sockets.try_emplace(handle, socket).second) {
+      SKYNET_DEBUG_LOG("EventLoop::add for handle {} failed: already registered", handle);
+      return false;
+    }
+  }
+  {
+    std::lock_guard lock{socket->mutex};
+    socket->want_write = want_write;
+    std::lock_guard ring_lock{ring.mutex};
+    ring.sockets.try_emplace(socket.get(), socket);
+    switch (state) {
+    case SocketState::listening:
+      ring.queue_accept(*socket, false);
+      break;
+    case SocketState::connected:
+      ring.queue_receive(*socket, false);
+      break;
+    case SocketState::connecting:
+      ring.queue_connect_poll(*socket);
+      break;
+    case SocketState::failed:
+      break;
+    }
+    // It may be writable straight away
+    if (want_write) { ring.recheck.push_back(socket); }
+  }
+  ring.queued_from_outside();
+  return true;
+}
+
+bool EventLoop::set_want_write(const int handle, const bool want_write) noexcept
+{
+  if (handle < 0) { return set_in_process_want_write(handle, want_write); }
+  auto& ring = impl_->ring;
+  const auto socket = find_socket(handle);
+  if (!socket || &socket->ring != &ring) {
+    SKYNET_DEBUG_LOG("EventLoop::set_want_write for handle {} failed: not registered", handle);
+    return false;
+  }
+  {
+    std::lock_guard lock{socket->mutex};
+    if (socket->want_write == want_write) { return true; }
+    socket->want_write = want_write;
+  }
+  // Nothing in the kernel changes, only what the next wait reports
+  if (want_write) {
+    {
+      std::lock_guard lock{ring.mutex};
+      ring.recheck.push_back(socket);
+    }
+    ring.queued_from_outside();
+  }
+  return true;
+}
+
+void EventLoop::remove(const int handle) noexcept
+{
+  if (handle < 0) {
+    remove_in_process(handle);
+    return;
+  }
+  const auto socket = find_socket(handle);
+  if (socket && &socket->ring == &impl_->ring) { release(socket); }
+}
+
+void EventLoop::wake() noexcept
+{
+  if (wake_pending_.exchange(true, std::memory_order_acq_rel)) { return; }
+  const std::uint64_t one = 1;
+  // The only possible failure is the counter overflowing, in which case the loop
+  // will be woken anyway
+  (void)write(impl_->ring.wake_handle, &one, sizeof(one));
+}
+
+void EventLoop::set_periodic_timer(const std::chrono::milliseconds interval) noexcept
+{
+  using namespace std::chrono;
+  itimerspec spec;
+  std::memset(&spec, 0, sizeof(spec));
+  const auto secs = duration_cast<seconds>(interval);
+  spec.it_interval.tv_sec = secs.count();
+  spec.it_interval.tv_nsec = duration_cast<nanoseconds>(interval - secs).count();
+  spec.it_value = spec.it_interval;
+  if (timerfd_settime(impl_->ring.timer_handle, 0, &spec, nullptr) < 0) {
+    SKYNET_WARN_LOG("EventLoop::set_periodic_timer failed: {}", strerror(errno));
+  }
+}
+
+const std::vector<ReadyHandle>& EventLoop::wait(const std::chrono::milliseconds timeout) noexcept
+{
+  using namespace std::chrono;
+  auto& ring = impl_->ring;
+  ready_.clear();
+  timer_fired_ = false;
+  was_woken_ = false;
+  ++ring.pass;
+  // Adds a socket to ready_ if there's anything to report, or updates its
+  // entry if it's already there; its mutex must be held
+  const auto report = [&](RingSocket& socket) {
+    if (socket.released) { return; }
+    const auto ready = readiness(socket);
+    if (!ready.readable && !ready.writable && !ready.error) { return; }
+    if (socket.reported_in == ring.pass) {
+      ready_[socket.ready_index] = ready;
+      return;
+    }
+    socket.reported_in = ring.pass;
+    socket.ready_index = ready_.size();
+    ready_.push_back(ready);
+    ring.reported.push_back(socket.shared_from_this());
+  };
+
+  // Whatever was ready last time and hasn't been dealt with is still ready,
+  // like level-triggered epoll, without anything having to complete
+  {
+    std::lock_guard lock{ring.mutex};
+    ring.checking.swap(ring.recheck);
+  }
+  ring.checking.insert(ring.checking.end(), ring.reported.begin(), ring.reported.end());
+  ring.reported.clear();
+  for (const auto& socket : ring.checking) {
+    std::lock_guard lock{socket->mutex};
+    report(*socket);
+  }
+  ring.checking.clear();
+
+  const bool block = ready_.empty() && !in_process_ready();
+  const auto deadline = steady_clock::now() + timeout;
+  // Completions that don't make anything ready, like a send finishing,
+  // don't end the wait
+  while (true) {
+    unsigned to_submit;
+    ring.waiting.store(block);
+    {
+      std::lock_guard lock{ring.mutex};
+      to_submit = *ring.sq_tail - load_acquire(ring.sq_head);
+    }
+    int result;
+    if (block && timeout.count() < 0) {
+      result = io_uring_enter(ring.ring_handle, to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+    }
+    else {
+      const auto remaining = block ? std::max(deadline - steady_clock::now(), steady_clock::duration{0})
+                                   : steady_clock::duration{0};
+      if (remaining.count() > 0) {
+        const auto secs = duration_cast<seconds>(remaining);
+        __kernel_timespec time_spec;
+        time_spec.tv_sec = secs.count();
+        time_spec.tv_nsec = duration_cast<nanoseconds>(remaining - secs).count();
+        io_uring_getevents_arg arg;
+        std::memset(&arg, 0, sizeof(arg));
+        arg.ts = reinterpret_cast<std::uint64_t>(&time_spec);
+        result = io_uring_enter(
+          ring.ring_handle, to_submit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+      }
+      else {
+        result = io_uring_enter(ring.ring_handle, to_submit, 0, IORING_ENTER_GETEVENTS, nullptr, 0);
+      }
+    }
+    ring.waiting.store(false);
+    const bool interrupted = result < 0 && errno == EINTR;
+    if (result < 0 && errno != EINTR && errno != ETIME) {
+      SKYNET_WARN_LOG("EventLoop::wait failed: {}", strerror(errno));
+    }
+    unsigned head = *ring.cq_head;
+    const unsigned tail = load_acquire(ring.cq_tail);
+    for (; head != tail; ++head) {
+      const auto cqe = ring.cqes[head & ring.cq_mask];
+      const auto kind = static_cast<RequestKind>(cqe.user_data & request_kind_mask);
+      const auto socket = reinterpret_cast<RingSocket*>(cqe.user_data & ~request_kind_mask);
+      if (socket) {
+        bool finished;
+        // Keep it alive until the mutex is unlocked, in case this was the last request of a released socket
+        const auto keep = socket->shared_from_this();
+        {
+          std::lock_guard lock{socket->mutex};
+          ring.complete(*socket, kind, cqe.res);
+          report(*socket);
+          finished = socket->released && socket->requests == 0;
+        }
+        if (finished) {
+          std::lock_guard lock{ring.mutex};
+          ring.sockets.erase(socket);
+        }
+        continue;
+      }
+      if (kind == RequestKind::cancel) { continue; }
+      std::lock_guard lock{ring.mutex};
+      --ring.requests;
+      if (kind == RequestKind::wake_read) {
+        // Clear the flag before re-arming so a wake that races with this is never lost
+        wake_pending_.store(false, std::memory_order_release);
+        was_woken_ = true;
+        ring.queue_counter_read(RequestKind::wake_read, ring.wake_handle, ring.wake_count);
+      }
+      else if (kind == RequestKind::timer_read) {
+        timer_fired_ = cqe.res > 0;
+        ring.queue_counter_read(RequestKind::timer_read, ring.timer_handle, ring.timer_count);
+      }
+    }
+    store_release(ring.cq_head, head);
+    if (
+      !block || interrupted || !ready_.empty() || was_woken_ || timer_fired_ || in_process_ready()
+      || (timeout.count() >= 0 && steady_clock::now() >= deadline)) {
+      break;
+    }
+  }
+  collect_in_process_ready();
+  return ready_;
+}
+
+std::optional<std::variant<std::size_t, ConnectionError>>
+  ring_read_some(const int handle, std::byte* const buffer, const std::size_t size) noexcept
+{
+  const auto socket = find_socket(handle);
+  if (!socket) { return {}; }
+  std::lock_guard lock{socket->mutex};
+  if (socket->received_begin != socket->received_end) {
+    const auto amount = std::min(size, socket->received_end - socket->received_begin);
+    std::memcpy(buffer, socket->received.get() + socket->received_begin, amount);
+    socket->received_begin += amount;
+    // The buffer can only be received into again once it's all handed out
+    if (socket->received_begin == socket->received_end) {
+      socket->received_begin = socket->received_end = 0;
+      {
+        std::lock_guard ring_lock{socket->ring.mutex};
+        socket->ring.queue_receive(*socket, false);
+      }
+      socket->ring.queued_from_outside();
+    }
+    return amount;
+  }
+  if (socket->receive_error != ConnectionError::no_error) { return socket->receive_error; }
+  if (socket->state == SocketState::failed || socket->send_failed) { return ConnectionError::unrecoverable; }
+  return ConnectionError::would_block;
+}
+
+std::optional<std::variant<std::size_t, ConnectionError>>
+  ring_send_gathered(const int handle, const SendBuffer* const buffers, const std::size_t count) noexcept
+{
+  const auto socket = find_socket(handle);
+  if (!socket) { return {}; }
+  std::lock_guard lock{socket->mutex};
+  if (socket->state == SocketState::failed || socket->send_failed) { return ConnectionError::unrecoverable; }
+  if (socket->state != SocketState::connected) { return ConnectionError::would_block; }
+  // Appended behind what the kernel is sending; it isn't touched until that's done
+  std::size_t copied = 0;
+  std::size_t wanted = 0;
+  for (std::size_t i = 0; i < std::min(count, max_gathered_send_buffers); ++i) {
+    const auto amount = std::min(buffers[i].size, ring_send_size - socket->staged_end);
+    std::memcpy(socket->staged.get() + socket->staged_end, buffers[i].data, amount);
+    socket->staged_end += amount;
+    copied += amount;
+    wanted += buffers[i].size;
+  }
+  if (copied == 0 && wanted != 0) { return ConnectionError::would_block; }
+  if (!socket->sending && copied != 0) {
+    {
+      std::lock_guard ring_lock{socket->ring.mutex};
+      socket->ring.queue_send(*socket, false);
+    }
+    socket->ring.queued_from_outside();
+  }
+  return copied;
+}
+
+std::optional<int> ring_accept(const int handle) noexcept
+{
+  const auto socket = find_socket(handle);
+  if (!socket) { return {}; }
+  std::lock_guard lock{socket->mutex};
+  if (!socket->accepted.empty()) {
+    const int accepted = socket->accepted.front();
+    socket->accepted.pop_front();
+    return accepted;
+  }
+  if (socket->accept_error != 0) {
+    errno = socket->accept_error;
+    socket->accept_error = 0;
+    {
+      std::lock_guard ring_lock{socket->ring.mutex};
+      socket->ring.queue_accept(*socket, false);
+    }
+    socket->ring.queued_from_outside();
+    return -1;
+  }
+  errno = EAGAIN;
+  return -1;
+}
+
+std::optional<ConnectionError> ring_connection_status(const int handle) noexcept
+{
+  const auto socket = find_socket(handle);
+  if (!socket) { return {}; }
+  std::lock_guard lock{socket->mutex};
+  switch (socket->state) {
+  case SocketState::connecting:
+    return ConnectionError::connection_in_progress;
+  case SocketState::failed:
+    return ConnectionError::unrecoverable;
+  case SocketState::connected:
+  case SocketState::listening:
+    break;
+  }
+  return ConnectionError::no_error;
+}
+
+void ring_release(const int handle) noexcept
+{
+  if (const auto socket = find_socket(handle)) { release(socket); }
+}
+} // namespace skywing::internal
@@ -0,0 +1,177 @@
+#include "skywing_core/internal/devices/in_process_pipe.hpp"
+
+#include "skywing_core/internal/devices/event_loop.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace skywing::internal {
+struct InProcessChannel {
+  struct Side {
+    // Messages sent to this side
+    MpscQueue<SharedMessage> inbound;
+    std::shared_ptr<InProcessWaker> waker;
+    int handle;
+    AddrPortPair address;
+    // Set once this side's end is destroyed, after its last send
+    std::atomic<bool> closed{false};
+  };
+
+  std::array<Side, 2> sides;
+};
+
+InProcessWaker::InProcessWaker(EventLoop& loop) noexcept : loop_{&loop} {}
+
+void InProcessWaker::notify(const int handle) noexcept
+{
+  std::lock_guard lock{mutex_};
+  if (loop_ != nullptr) { loop_->notify_readable(handle); }
+}
+
+void InProcessWaker::disable() noexcept
+{
+  std::lock_guard lock{mutex_};
+  loop_ = nullptr;
+}
+
+InProcessPipeEnd::InProcessPipeEnd(std::shared_ptr<InProcessChannel> channel, const int side) noexcept
+  : channel_{std::move(channel)}, side_{side}
+{}
+
+InProcessPipeEnd::~InProcessPipeEnd()
+{
+  channel_->sides[side_].closed.store(true, std::memory_order_release);
+  // Let the peer find out by reading
+  const auto& peer = channel_->sides[1 - side_];
+  peer.waker->notify(peer.handle);
+}
+
+std::variant<std::size_t, ConnectionError>
+  InProcessPipeEnd::send_gathered(const SendBuffer* const buffers, std::size_t count) noexcept
+{
+  count = std::min(count, max_gathered_send_buffers);
+  std::size_t total_size = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    total_size += buffers[i].size;
+  }
+  std::vector<std::byte> message;
+  message.reserve(total_size);
+  for (std::size_t i = 0; i < count; ++i) {
+    message.insert(message.end(), buffers[i].data, buffers[i].data + buffers[i].size);
+  }
+  if (!send_shared(std::make_shared<const std::vector<std::byte>>(std::move(message)))) {
+    return ConnectionError::unrecoverable;
+  }
+  return total_size;
+}
+
+bool InProcessPipeEnd::send_shared(const SharedMessage& message) noexcept
+{
+  auto& peer = channel_->sides[1 - side_];
+  if (peer.closed.load(std::memory_order_acquire)) { return false; }
+  peer.inbound.push(message);
+  peer.waker->notify(peer.handle);
+  return true;
+}
+
+std::variant<std::size_t, ConnectionError>
+  InProcessPipeEnd::read_some(std::byte* const buffer, const std::size_t size) noexcept
+{
+  auto& self = channel_->sides[side_];
+  // Checked first, since everything the peer sent before closing is then
+  // guaranteed to be visible below
+  const bool peer_closed = channel_->sides[1 - side_].closed.load(std::memory_order_acquire);
+  std::size_t copied = 0;
+  while (copied < size) {
+    if (!front_) {
+      auto next = self.inbound.pop();
+      if (!next) { break; }
+      front_ = std::move(*next);
+      front_offset_ = 0;
+    }
+    const auto amount = std::min(size - copied, front_->size() - front_offset_);
+    std::memcpy(buffer + copied, front_->data() + front_offset_, amount);
+    copied += amount;
+    front_offset_ += amount;
+    if (front_offset_ == front_->size()) { front_.reset(); }
+  }
+  if (copied == 0) { return peer_closed ? ConnectionError::closed : ConnectionError::would_block; }
+  // Readiness is only reported when something is sent, so ask to be called
+  // again if the buffer filled up before everything was read
+  if (copied == size) { self.waker->notify(self.handle); }
+  return copied;
+}
+
+int InProcessPipeEnd::handle() const noexcept { return channel_->sides[side_].handle; }
+
+const AddrPortPair& InProcessPipeEnd::host_address() const noexcept { return channel_->sides[side_].address; }
+
+const AddrPortPair& InProcessPipeEnd::peer_address() const noexcept { return channel_->sides[1 - side_].address; }
+
+InProcessListener::InProcessListener(std::shared_ptr<InProcessWaker> waker, const int handle) noexcept
+  : waker_{std::move(waker)}, handle_{handle}
+{}
+
+std::unique_ptr<InProcessPipeEnd> InProcessListener::accept() noexcept
+{
+  auto next = incoming_.pop();
+  return next ? std::move(*next) : nullptr;
+}
+
+InProcessRegistry& InProcessRegistry::instance() noexcept
+{
+  static InProcessRegistry registry;
+  return registry;
+}
+
+std::shared_ptr<InProcessListener>
+  InProcessRegistry::listen(const std::uint16_t port, std::shared_ptr<InProcessWaker> waker) noexcept
+{
+  std::lock_guard lock{mutex_};
+  const auto [iter, inserted] = listeners_.try_emplace(port);
+  if (!inserted) { return nullptr; }
+  iter->second.reset(new InProcessListener{std::move(waker), make_in_process_handle()});
+  return iter->second;
+}
+
+void InProcessRegistry::stop_listening(const std::uint16_t port) noexcept
+{
+  std::lock_guard lock{mutex_};
+  listeners_.erase(port);
+}
+
+std::unique_ptr<InProcessPipeEnd>
+  InProcessRegistry::connect(const AddrPortPair& address, std::shared_ptr<InProcessWaker> waker) noexcept
+{
+  // A Manager on another host could be listening on the same port
+  if (address.first.rfind("127.", 0) != 0 && address.first != "localhost") { return nullptr; }
+  std::lock_guard lock{mutex_};
+  const auto iter = listeners_.find(address.second);
+  if (iter == listeners_.cend()) { return nullptr; }
+  auto& listener = *iter->second;
+  auto channel = std::make_shared<InProcessChannel>();
+  auto& connecting = channel->sides[0];
+  connecting.waker = std::move(waker);
+  connecting.handle = make_in_process_handle();
+  // There's no real port, so the accepting side makes the address unique
+  connecting.address = AddrPortPair{"127.0.0.1", 0};
+  auto& accepted = channel->sides[1];
+  accepted.waker = listener.waker_;
+  accepted.handle = make_in_process_handle();
+  accepted.address = address;
+  listener.incoming_.push(std::unique_ptr<InProcessPipeEnd>{new InProcessPipeEnd{channel, 1}});
+  listener.waker_->notify(listener.handle_);
+  return std::unique_ptr<InProcessPipeEnd>{new InProcessPipeEnd{std::move(channel), 0}};
+}
+
+int make_in_process_handle() noexcept
+{
+  // -1 is used as the invalid handle
+  static std::atomic<int> next_handle{-2};
+  return next_handle.fetch_sub(1, std::memory_order_relaxed);
+}
+} // namespace skywing::internal
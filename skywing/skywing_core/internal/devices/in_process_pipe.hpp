@@ -0,0 +1,165 @@
+#ifndef SKYNET_INTERNAL_DEVICES_IN_PROCESS_PIPE_HPP
+#define SKYNET_INTERNAL_DEVICES_IN_PROCESS_PIPE_HPP
+
+#include "skywing_core/internal/devices/transport.hpp"
+#include "skywing_core/internal/utility/mpsc_queue.hpp"
+#include "skywing_core/types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace skywing::internal {
+class EventLoop;
+
+/** \brief Reports in-process connections as readable to the EventLoop of the
+ * Manager that owns them
+ *
+ * Peers hold on to this and may outlive the loop, so the owner disables it
+ * before the loop is destroyed.
+ */
+class InProcessWaker {
+public:
+  explicit InProcessWaker(EventLoop& loop) noexcept;
+
+  /** \brief Marks the handle as readable in the loop, unless disabled; may be
+   * called from any thread
+   */
+  void notify(int handle) noexcept;
+
+  /** \brief Stops all further notifications
+   */
+  void disable() noexcept;
+
+private:
+  std::mutex mutex_;
+  EventLoop* loop_;
+}; // class InProcessWaker
+
+// Both directions of a connection, shared by its two ends
+struct InProcessChannel;
+
+/** \brief One end of a connection between two Managers in the same process
+ *
+ * Each direction is a lock-free queue of messages.  Whole messages handed to
+ * send_shared are queued without copying; anything else is copied into a new
+ * message.  Sends never fail for lack of room, so the sender's queue never
+ * fills up and the receiver is relied on to keep up.
+ *
+ * The handle is negative so it can't clash with a socket, and is made ready in
+ * the owner's EventLoop whenever the peer sends something or goes away.
+ */
+class InProcessPipeEnd final : public Transport {
+public:
+  ~InProcessPipeEnd() override;
+
+  InProcessPipeEnd(const InProcessPipeEnd&) = delete;
+  InProcessPipeEnd& operator=(const InProcessPipeEnd&) = delete;
+
+  std::variant<std::size_t, ConnectionError>
+    send_gathered(const SendBuffer* buffers, std::size_t count) noexcept override;
+
+  bool send_shared(const SharedMessage& message) noexcept override;
+
+  /** \brief Copies out as many queued bytes as fit; reports ConnectionError::closed
+   * once the peer is gone and everything it sent has been read
+   */
+  std::variant<std::size_t, ConnectionError> read_some(std::byte* buffer, std::size_t size) noexcept override;
+
+  /** \brief Returns the handle to register with the owner's EventLoop
+   */
+  int handle() const noexcept;
+
+  /** \brief Returns the address this end is known by to the peer
+   */
+  const AddrPortPair& host_address() const noexcept;
+
+  /** \brief Returns the address of the peer
+   */
+  const AddrPortPair& peer_address() const noexcept;
+
+private:
+  friend class InProcessRegistry;
+
+  InProcessPipeEnd(std::shared_ptr<InProcessChannel> channel, int side) noexcept;
+
+  std::shared_ptr<InProcessChannel> channel_;
+
+  // 0 for the end that connected and 1 for the end that was accepted
+  int side_;
+
+  // Message currently being read and how much of it has been read
+  SharedMessage front_;
+  std::size_t front_offset_ = 0;
+}; // class InProcessPipeEnd
+
+/** \brief Connections waiting to be accepted by a Manager
+ */
+class InProcessListener {
+public:
+  /** \brief Returns the handle that is made ready when a connection is waiting
+   */
+  int handle() const noexcept { return handle_; }
+
+  /** \brief Returns the next waiting connection, or nullptr if there are none
+   *
+   * Only the Manager that is listening may call this.
+   */
+  std::unique_ptr<InProcessPipeEnd> accept() noexcept;
+
+private:
+  friend class InProcessRegistry;
+
+  InProcessListener(std::shared_ptr<InProcessWaker> waker, int handle) noexcept;
+
+  std::shared_ptr<InProcessWaker> waker_;
+  int handle_;
+  MpscQueue<std::unique_ptr<InProcessPipeEnd>> incoming_;
+}; // class InProcessListener
+
+/** \brief The Managers in this process that accept in-process connections,
+ * by the port they listen on
+ */
+class InProcessRegistry {
+public:
+  static InProcessRegistry& instance() noexcept;
+
+  /** \brief Starts accepting in-process connections to a port
+   *
+   * Returns nullptr if something in this process already listens on it.
+   *
+   * \param port The port the Manager listens on
+   * \param waker Used to report the listener and the accepted connections as ready
+   */
+  std::shared_ptr<InProcessListener> listen(std::uint16_t port, std::shared_ptr<InProcessWaker> waker) noexcept;
+
+  /** \brief Stops accepting connections; any that haven't been accepted are closed
+   */
+  void stop_listening(std::uint16_t port) noexcept;
+
+  /** \brief Connects to a Manager in this process
+   *
+   * Returns nullptr if the address isn't a loopback address or nothing in
+   * this process listens on the port, in which case a socket has to be used.
+   *
+   * \param address The address to connect to
+   * \param waker Used to report the returned end as ready
+   */
+  std::unique_ptr<InProcessPipeEnd> connect(const AddrPortPair& address, std::shared_ptr<InProcessWaker> waker) noexcept;
+
+private:
+  InProcessRegistry() = default;
+
+  std::mutex mutex_;
+  std::unordered_map<std::uint16_t, std::shared_ptr<InProcessListener>> listeners_;
+}; // class InProcessRegistry
+
+/** \brief Returns a handle that is unique within the process and never a
+ * valid OS handle, for registering something that isn't one with an EventLoop
+ */
+int make_in_process_handle() noexcept;
+} // namespace skywing::internal
+
+#endif // SKYNET_INTERNAL_DEVICES_IN_PROCESS_PIPE_HPP
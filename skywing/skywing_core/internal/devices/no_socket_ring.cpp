@@ -0,0 +1,37 @@
+#include "socket_ring.hpp"
+
+// Event loops that only wait for readiness leave all of the I/O to the caller
+
+namespace skywing::internal {
+std::optional<std::variant<std::size_t, ConnectionError>>
+  ring_read_some(const int handle, std::byte* const buffer, const std::size_t size) noexcept
+{
+  (void)handle;
+  (void)buffer;
+  (void)size;
+  return {};
+}
+
+std::optional<std::variant<std::size_t, ConnectionError>>
+  ring_send_gathered(const int handle, const SendBuffer* const buffers, const std::size_t count) noexcept
+{
+  (void)handle;
+  (void)buffers;
+  (void)count;
+  return {};
+}
+
+std::optional<int> ring_accept(const int handle) noexcept
+{
+  (void)handle;
+  return {};
+}
+
+std::optional<ConnectionError> ring_connection_status(const int handle) noexcept
+{
+  (void)handle;
+  return {};
+}
+
+void ring_release(const int handle) noexcept { (void)handle; }
+} // namespace skywing::internal
@@ -0,0 +1,123 @@
+#include "skywing_core/internal/devices/receive_buffer.hpp"
+
+#include "skywing_core/internal/utility/network_conv.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+
+namespace skywing::internal {
+namespace {
+constexpr std::size_t size_prefix_bytes = sizeof(NetworkSizeType);
+
+// Below this much free space the buffer is grown before reading so that
+// reads don't degrade into tiny pieces
+constexpr std::size_t min_read_size = 4 * 1024;
+
+// Where unread bytes are moved to so that the first frame's body is aligned
+constexpr std::size_t aligned_start
+  = (frame_body_alignment - size_prefix_bytes % frame_body_alignment) % frame_body_alignment;
+
+static_assert(
+  __STDCPP_DEFAULT_NEW_ALIGNMENT__ % frame_body_alignment == 0, "Allocated buffers must start out aligned");
+} // namespace
+
+ReceiveBuffer::ReceiveBuffer(const std::size_t initial_capacity) noexcept
+  : data_(aligned_start + std::max(initial_capacity, min_read_size)), begin_{aligned_start}, end_{aligned_start}
+{}
+
+ConnectionError ReceiveBuffer::fill(Transport& conn) noexcept
+{
+  make_room();
+  const auto read_or_error = conn.read_some(data_.data() + end_, data_.size() - end_);
+  if (const auto err = std::get_if<ConnectionError>(&read_or_error)) { return *err; }
+  end_ += *std::get_if<std::size_t>(&read_or_error);
+  return ConnectionError::no_error;
+}
+
+std::optional<gsl::span<const std::byte>> ReceiveBuffer::next_frame() noexcept
+{
+  const auto frame = peek_frame();
+  if (frame) { pop_frame(); }
+  return frame;
+}
+
+std::optional<gsl::span<const std::byte>> ReceiveBuffer::peek_frame() noexcept
+{
+  while (!reassembled_) {
+    const auto prefix = first_prefix();
+    if (!prefix) { return {}; }
+    const std::size_t frame_size = *prefix & frame_length_mask;
+    if (end_ - begin_ - size_prefix_bytes < frame_size) { return {}; }
+    const auto frame_start = data_.data() + begin_ + size_prefix_bytes;
+    if ((*prefix & frame_fragment_flag) == 0) {
+      return gsl::span<const std::byte>(frame_start, frame_start + frame_size);
+    }
+    // A piece of a split message, which isn't handed out on its own; only
+    // handed out frames and prefixes are in between it and the pieces before
+    // it, so it can be moved down over them
+    if (!assembling_) {
+      assembling_ = true;
+      assembled_begin_ = (begin_ + size_prefix_bytes) / frame_body_alignment * frame_body_alignment;
+      assembled_size_ = 0;
+    }
+    std::memmove(data_.data() + assembled_begin_ + assembled_size_, frame_start, frame_size);
+    assembled_size_ += frame_size;
+    reassembled_ = (*prefix & frame_last_fragment_flag) != 0;
+    begin_ += size_prefix_bytes + frame_size;
+  }
+  const auto assembled = data_.data() + assembled_begin_;
+  return gsl::span<const std::byte>(assembled, assembled + assembled_size_);
+}
+
+void ReceiveBuffer::pop_frame() noexcept
+{
+  if (reassembled_) {
+    assembling_ = false;
+    assembled_size_ = 0;
+    reassembled_ = false;
+    return;
+  }
+  const auto prefix = first_prefix();
+  assert(prefix && (*prefix & frame_fragment_flag) == 0);
+  begin_ += size_prefix_bytes + static_cast<std::size_t>(*prefix & frame_length_mask);
+}
+
+void ReceiveBuffer::clear() noexcept
+{
+  begin_ = end_ = aligned_start;
+  assembling_ = false;
+  assembled_size_ = 0;
+  reassembled_ = false;
+}
+
+std::size_t ReceiveBuffer::bytes_buffered() const noexcept { return end_ - begin_ + assembled_size_; }
+
+std::optional<NetworkSizeType> ReceiveBuffer::first_prefix() const noexcept
+{
+  if (end_ - begin_ < size_prefix_bytes) { return {}; }
+  std::array<std::byte, size_prefix_bytes> size_bytes;
+  std::memcpy(size_bytes.data(), data_.data() + begin_, size_prefix_bytes);
+  return from_network_bytes(size_bytes);
+}
+
+void ReceiveBuffer::make_room() noexcept
+{
+  // Frames handed out are no longer needed, so the unread bytes can always be
+  // moved; while a split message is being put back together they go right
+  // after it, and the pieces already moved stay where they are
+  const auto start = assembling_ ? assembled_begin_ + assembled_size_ : aligned_start;
+  if (begin_ != start) {
+    std::memmove(data_.data() + start, data_.data() + begin_, end_ - begin_);
+    end_ = start + (end_ - begin_);
+    begin_ = start;
+  }
+  // Make sure the whole of a large frame fits once its size is known
+  std::size_t wanted = end_ + min_read_size;
+  if (const auto prefix = first_prefix()) {
+    wanted = std::max(wanted, begin_ + size_prefix_bytes + static_cast<std::size_t>(*prefix & frame_length_mask));
+  }
+  if (wanted > data_.size()) { data_.resize(std::max(wanted, data_.size() * 2)); }
+}
+} // namespace skywing::internal
@@ -0,0 +1,105 @@
+#ifndef SKYNET_INTERNAL_DEVICES_RECEIVE_BUFFER_HPP
+#define SKYNET_INTERNAL_DEVICES_RECEIVE_BUFFER_HPP
+
+#include "skywing_core/internal/devices/transport.hpp"
+#include "skywing_core/types.hpp"
+
+#include "gsl/span"
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace skywing::internal {
+// The initial size of a connection's receive buffer
+inline constexpr std::size_t default_receive_buffer_size = 64 * 1024;
+
+// The alignment the body of a frame is given when possible; Cap'n Proto
+// messages are made of 8 byte words
+inline constexpr std::size_t frame_body_alignment = 8;
+
+/** \brief Inbound bytes for a connection that haven't been turned into messages yet
+ *
+ * Each call to fill reads whatever the socket has available with a single
+ * call, and next_frame hands out complete length-prefixed frames until only a
+ * partial one is left.  The partial frame is kept for the next fill.  The
+ * storage is reused between messages and only grows when a frame doesn't fit.
+ *
+ * Unread bytes are always moved so that the body of the first frame is
+ * aligned to frame_body_alignment, which means any frame that takes more than
+ * one read to arrive (in particular every large frame) can be decoded in place.
+ *
+ * Messages that were sent in pieces are put back together in the same
+ * storage as the pieces arrive, by moving each piece's body up against the
+ * ones before it over the prefixes in between, and handed out once the last
+ * one has.  The reassembled body is aligned the same way, so it can also be
+ * decoded in place.  Anything sent in between the pieces is handed out first.
+ */
+class ReceiveBuffer {
+public:
+  /** \brief Creates an empty buffer with the given initial capacity
+   */
+  explicit ReceiveBuffer(std::size_t initial_capacity = default_receive_buffer_size) noexcept;
+
+  /** \brief Reads as much as is available from the connection in one call
+   *
+   * Returns ConnectionError::no_error if anything was read,
+   * ConnectionError::would_block if there was nothing to read, or the error
+   * that occurred.
+   */
+  ConnectionError fill(Transport& conn) noexcept;
+
+  /** \brief Returns the body of the next complete frame, if there is one
+   *
+   * The returned bytes are only valid until the next call to fill,
+   * next_frame or peek_frame.
+   */
+  std::optional<gsl::span<const std::byte>> next_frame() noexcept;
+
+  /** \brief Returns the body of the next complete frame without consuming it
+   *
+   * The returned bytes are only valid until the next call to fill or
+   * pop_frame, or to next_frame or peek_frame after pop_frame.
+   */
+  std::optional<gsl::span<const std::byte>> peek_frame() noexcept;
+
+  /** \brief Consumes the frame returned by peek_frame
+   *
+   * \pre peek_frame() returned a frame
+   */
+  void pop_frame() noexcept;
+
+  /** \brief Discards everything received but not yet handed out
+   */
+  void clear() noexcept;
+
+  /** \brief Returns the number of bytes received but not yet handed out
+   */
+  std::size_t bytes_buffered() const noexcept;
+
+private:
+  // Makes sure there's room to read into, moving unread bytes to the front
+  void make_room() noexcept;
+
+  // Returns the length prefix of the first unread frame, if it has arrived
+  std::optional<NetworkSizeType> first_prefix() const noexcept;
+
+  std::vector<std::byte> data_;
+
+  // Unread bytes are in [begin_, end_)
+  std::size_t begin_;
+  std::size_t end_;
+
+  // The bodies of the pieces of a split message received so far are in
+  // [assembled_begin_, assembled_begin_ + assembled_size_), which is always
+  // before begin_
+  bool assembling_ = false;
+  std::size_t assembled_begin_ = 0;
+  std::size_t assembled_size_ = 0;
+
+  // Whether the split message is whole and hasn't been handed out
+  bool reassembled_ = false;
+}; // class ReceiveBuffer
+} // namespace skywing::internal
+
+#endif // SKYNET_INTERNAL_DEVICES_RECEIVE_BUFFER_HPP
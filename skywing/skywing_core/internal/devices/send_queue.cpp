@@ -0,0 +1,227 @@
+#include "skywing_core/internal/devices/send_queue.hpp"
+
+#include "skywing_core/internal/utility/network_conv.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace skywing::internal {
+namespace {
+constexpr std::size_t size_prefix_bytes = sizeof(NetworkSizeType);
+
+// Returns true if a message is sent in pieces
+bool is_split(const std::vector<std::byte>& message, const MessagePriority priority) noexcept
+{
+  return priority == MessagePriority::data && message.size() > size_prefix_bytes + max_fragment_size;
+}
+
+// The number of bytes that go on the wire for a message
+std::size_t wire_size(const std::vector<std::byte>& message, const MessagePriority priority) noexcept
+{
+  if (!is_split(message, priority)) { return message.size(); }
+  // The message's own prefix is replaced by one for each piece
+  const auto body_size = message.size() - size_prefix_bytes;
+  const auto num_pieces = (body_size + max_fragment_size - 1) / max_fragment_size;
+  return body_size + num_pieces * size_prefix_bytes;
+}
+} // namespace
+
+SendQueue::SendQueue(const std::size_t high_watermark, const std::size_t low_watermark) noexcept
+  : high_watermark_{high_watermark}, low_watermark_{low_watermark}
+{
+  assert(low_watermark <= high_watermark);
+}
+
+void SendQueue::push(SharedMessage message, const MessagePriority priority) noexcept
+{
+  assert(message);
+  if (message->empty()) { return; }
+  bytes_queued_ += wire_size(*message, priority);
+  (priority == MessagePriority::control ? control_ : data_).push_back(std::move(message));
+  update_congestion();
+}
+
+bool SendQueue::push_latest(SharedMessage message, const std::uint64_t key) noexcept
+{
+  assert(message);
+  if (message->empty()) { return false; }
+  const auto new_number = data_front_number_ + data_.size();
+  const auto [iter, inserted] = latest_by_key_.try_emplace(key, new_number);
+  if (!inserted) {
+    const auto old_number = iter->second;
+    // Only replace a message that is still queued and hasn't started going out
+    const bool queued = old_number >= data_front_number_;
+    if (queued && (old_number != data_front_number_ || data_body_offset_ == 0)) {
+      auto& old_message = data_[old_number - data_front_number_];
+      bytes_queued_ -= wire_size(*old_message, MessagePriority::data);
+      bytes_queued_ += wire_size(*message, MessagePriority::data);
+      old_message = std::move(message);
+      update_congestion();
+      return true;
+    }
+    iter->second = new_number;
+  }
+  push(std::move(message), MessagePriority::data);
+  return false;
+}
+
+ConnectionError SendQueue::flush(Transport& conn, SendStatistics& stats) noexcept
+{
+  while (partial_ || !control_.empty() || !data_.empty()) {
+    // Transports that can take whole messages don't need them copied or split
+    if (!partial_) {
+      const bool take_control = !control_.empty();
+      auto& queue = take_control ? control_ : data_;
+      if ((take_control || data_body_offset_ == 0) && conn.send_shared(queue.front())) {
+        const auto size = queue.front()->size();
+        ++stats.send_calls;
+        ++stats.messages_sent;
+        stats.bytes_sent += size;
+        bytes_queued_ -= wire_size(*queue.front(), take_control ? MessagePriority::control : MessagePriority::data);
+        if (take_control) { control_.pop_front(); }
+        else {
+          pop_data();
+        }
+        continue;
+      }
+    }
+    // Anything partly sent has to be finished first, then control goes ahead of data
+    frames_.clear();
+    gather_buffers_.clear();
+    const auto add_frame = [&](const Frame& frame, const std::size_t offset) {
+      if (gather_buffers_.size() + (frame.has_prefix ? 2 : 1) > max_gathered_send_buffers) { return false; }
+      frames_.push_back(frame);
+      const auto& added = frames_.back();
+      std::size_t skip = offset;
+      if (added.has_prefix) {
+        if (skip < added.prefix.size()) {
+          gather_buffers_.push_back(SendBuffer{added.prefix.data() + skip, added.prefix.size() - skip});
+          skip = 0;
+        }
+        else {
+          skip -= added.prefix.size();
+        }
+      }
+      gather_buffers_.push_back(
+        SendBuffer{added.message->data() + added.begin + skip, added.end - added.begin - skip});
+      return true;
+    };
+    // The frames are copied into frames_, so make sure it doesn't move them
+    frames_.reserve(max_gathered_send_buffers);
+    bool room = true;
+    if (partial_) { room = add_frame(*partial_, partial_offset_); }
+    for (std::size_t i = 0; room && i < control_.size(); ++i) {
+      room = add_frame(
+        Frame{control_[i].get(), 0, control_[i]->size(), {}, false, MessagePriority::control, true}, 0);
+    }
+    for (std::size_t i = 0, body_offset = data_body_offset_; room && i < data_.size();) {
+      const auto frame = next_data_frame(i, body_offset);
+      room = add_frame(frame, 0);
+      if (frame.ends_message) {
+        ++i;
+        body_offset = 0;
+      }
+      else {
+        body_offset = frame.end - size_prefix_bytes;
+      }
+    }
+    const auto sent_or_error = conn.send_gathered(gather_buffers_.data(), gather_buffers_.size());
+    ++stats.send_calls;
+    if (const auto err = std::get_if<ConnectionError>(&sent_or_error)) {
+      update_congestion();
+      return *err;
+    }
+    const auto sent = *std::get_if<std::size_t>(&sent_or_error);
+    stats.bytes_sent += sent;
+    bytes_queued_ -= sent;
+    // Drop everything that was completely sent
+    auto remaining = sent;
+    for (std::size_t i = 0; i < frames_.size(); ++i) {
+      const auto& frame = frames_[i];
+      const auto frame_left = frame.size() - (i == 0 && partial_ ? partial_offset_ : 0);
+      if (remaining < frame_left) {
+        // Short write; the socket buffer is full so there's no point in trying again
+        if (i == 0 && partial_) { partial_offset_ += remaining; }
+        else {
+          // The frame's message has to stay around until the rest goes out
+          partial_message_ = frame.priority == MessagePriority::control ? control_.front() : data_.front();
+          partial_ = frame;
+          partial_offset_ = remaining;
+          consume(frame);
+        }
+        update_congestion();
+        return ConnectionError::would_block;
+      }
+      remaining -= frame_left;
+      if (i == 0 && partial_) {
+        partial_.reset();
+        partial_message_.reset();
+        partial_offset_ = 0;
+      }
+      else {
+        consume(frame);
+      }
+      stats.messages_sent += frame.ends_message;
+    }
+  }
+  update_congestion();
+  return ConnectionError::no_error;
+}
+
+bool SendQueue::empty() const noexcept { return !partial_ && control_.empty() && data_.empty(); }
+
+std::size_t SendQueue::bytes_queued() const noexcept { return bytes_queued_; }
+
+bool SendQueue::is_congested() const noexcept { return congested_; }
+
+void SendQueue::set_watermarks(const std::size_t high_watermark, const std::size_t low_watermark) noexcept
+{
+  assert(low_watermark <= high_watermark);
+  high_watermark_ = high_watermark;
+  low_watermark_ = low_watermark;
+  update_congestion();
+}
+
+void SendQueue::update_congestion() noexcept
+{
+  if (bytes_queued_ >= high_watermark_) { congested_ = true; }
+  else if (bytes_queued_ <= low_watermark_) {
+    congested_ = false;
+  }
+}
+
+auto SendQueue::next_data_frame(const std::size_t index, const std::size_t body_offset) const noexcept -> Frame
+{
+  const auto& message = *data_[index];
+  if (!is_split(message, MessagePriority::data)) {
+    return Frame{&message, 0, message.size(), {}, false, MessagePriority::data, true};
+  }
+  const auto begin = size_prefix_bytes + body_offset;
+  const auto end = std::min(begin + max_fragment_size, message.size());
+  const bool last = end == message.size();
+  const auto prefix = static_cast<NetworkSizeType>(
+    (end - begin) | frame_fragment_flag | (last ? frame_last_fragment_flag : 0));
+  return Frame{&message, begin, end, to_network_bytes(prefix), true, MessagePriority::data, last};
+}
+
+void SendQueue::consume(const Frame& frame) noexcept
+{
+  if (frame.priority == MessagePriority::control) {
+    control_.pop_front();
+    return;
+  }
+  if (frame.ends_message) {
+    pop_data();
+    data_body_offset_ = 0;
+  }
+  else {
+    data_body_offset_ = frame.end - size_prefix_bytes;
+  }
+}
+
+void SendQueue::pop_data() noexcept
+{
+  data_.pop_front();
+  ++data_front_number_;
+}
+} // namespace skywing::internal
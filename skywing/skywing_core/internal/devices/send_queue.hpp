@@ -0,0 +1,180 @@
+#ifndef SKYNET_INTERNAL_DEVICES_SEND_QUEUE_HPP
+#define SKYNET_INTERNAL_DEVICES_SEND_QUEUE_HPP
+
+#include "skywing_core/internal/devices/transport.hpp"
+#include "skywing_core/types.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace skywing::internal {
+/** \brief Running totals of what has been handed to sockets
+ */
+struct SendStatistics {
+  // Messages that have been completely sent
+  std::uint64_t messages_sent = 0;
+
+  // Calls made to the OS to send data, including ones that sent nothing
+  std::uint64_t send_calls = 0;
+
+  std::uint64_t bytes_sent = 0;
+
+  SendStatistics& operator+=(const SendStatistics& other) noexcept
+  {
+    messages_sent += other.messages_sent;
+    send_calls += other.send_calls;
+    bytes_sent += other.bytes_sent;
+    return *this;
+  }
+
+  /** \brief Returns the average number of messages completed per call to the OS
+   */
+  double messages_per_send_call() const noexcept
+  {
+    return send_calls == 0 ? 0.0 : static_cast<double>(messages_sent) / static_cast<double>(send_calls);
+  }
+}; // struct SendStatistics
+
+/** \brief Which of a connection's queues a message waits in
+ */
+enum class MessagePriority {
+  /// Small messages that keep the connection working, such as heartbeats
+  /// and discovery; sent ahead of any data that is waiting
+  control,
+
+  /// Everything else, including anything that has to stay in order with data
+  data
+}; // enum class MessagePriority
+
+/** \brief Outbound bytes for a connection that haven't been accepted by the socket yet
+ *
+ * Messages are kept in two queues by priority, and each queue is sent in
+ * order.  Control messages go out before data, and data messages with a body
+ * larger than max_fragment_size are split into pieces so that a control
+ * message never waits behind more than the piece that is partly sent.  Short
+ * writes resume where they left off.
+ *
+ * Nothing is ever dropped; instead the queue reports that it is congested once
+ * the number of bytes held reaches the high watermark, and keeps reporting it
+ * until enough has been sent to get back down to the low watermark.
+ */
+class SendQueue {
+public:
+  /** \brief Creates an empty queue with the given watermarks, in bytes
+   *
+   * \pre low_watermark <= high_watermark
+   */
+  SendQueue(std::size_t high_watermark, std::size_t low_watermark) noexcept;
+
+  /** \brief Adds a message to the end of the queue for its priority
+   */
+  void push(SharedMessage message, MessagePriority priority = MessagePriority::data) noexcept;
+
+  /** \brief Adds a data message that makes any earlier one with the same key
+   * obsolete
+   *
+   * If the last data message pushed with the key is still waiting and none of
+   * it has been sent, which only happens when the connection isn't keeping up,
+   * it is replaced in place by the new message.  Otherwise the message is
+   * added to the end like push does.  Returns true if a message was replaced.
+   */
+  bool push_latest(SharedMessage message, std::uint64_t key) noexcept;
+
+  /** \brief Sends as much of the queue as the connection will accept
+   *
+   * Queued frames are gathered so that a single call to the OS sends up to
+   * max_gathered_send_buffers pieces of memory, unless the transport takes
+   * whole messages through send_shared, in which case nothing is split.  Returns ConnectionError::no_error if
+   * the queue is now empty, ConnectionError::would_block if data remains, or
+   * the error that occurred.
+   *
+   * \param conn The connection to send on
+   * \param stats Totals to add what was sent to
+   */
+  ConnectionError flush(Transport& conn, SendStatistics& stats) noexcept;
+
+  /** \brief Returns true if there is nothing waiting to be sent
+   */
+  bool empty() const noexcept;
+
+  /** \brief Returns the number of bytes waiting to be sent
+   */
+  std::size_t bytes_queued() const noexcept;
+
+  /** \brief Returns true if the queue has hit the high watermark and hasn't
+   * drained back to the low watermark
+   */
+  bool is_congested() const noexcept;
+
+  /** \brief Changes the watermarks, updating the congestion state
+   */
+  void set_watermarks(std::size_t high_watermark, std::size_t low_watermark) noexcept;
+
+private:
+  // One frame on the wire: bytes [begin, end) of a message, after a prefix of
+  // its own if the message is being sent in pieces
+  struct Frame {
+    const std::vector<std::byte>* message;
+    std::size_t begin;
+    std::size_t end;
+    std::array<std::byte, sizeof(NetworkSizeType)> prefix;
+    bool has_prefix;
+
+    // Where the frame came from, so it can be removed once sent
+    MessagePriority priority;
+    bool ends_message;
+
+    std::size_t size() const noexcept { return (has_prefix ? prefix.size() : 0) + end - begin; }
+  };
+
+  // Update congested_ after the queue size changes
+  void update_congestion() noexcept;
+
+  // Returns the next frame of the front data message
+  Frame next_data_frame(std::size_t index, std::size_t body_offset) const noexcept;
+
+  // Removes what a frame was made from once it's no longer needed
+  void consume(const Frame& frame) noexcept;
+
+  // Removes the front data message
+  void pop_data() noexcept;
+
+  std::deque<SharedMessage> control_;
+  std::deque<SharedMessage> data_;
+
+  // Each data message is numbered in the order it was pushed; this is the
+  // number of the front one
+  std::uint64_t data_front_number_ = 0;
+
+  // The number of the last data message pushed with each key by push_latest
+  std::unordered_map<std::uint64_t, std::uint64_t> latest_by_key_;
+
+  // How much of the front data message's body has been put in frames
+  std::size_t data_body_offset_ = 0;
+
+  // A frame the connection only took part of, which has to be finished before
+  // anything else is sent; partial_message_ keeps the message alive
+  std::optional<Frame> partial_;
+  SharedMessage partial_message_;
+  std::size_t partial_offset_ = 0;
+
+  // Scratch space for building gathered sends
+  std::vector<Frame> frames_;
+  std::vector<SendBuffer> gather_buffers_;
+
+  // Total unsent bytes across all messages, including the prefixes of pieces
+  std::size_t bytes_queued_ = 0;
+
+  std::size_t high_watermark_;
+  std::size_t low_watermark_;
+  bool congested_ = false;
+}; // class SendQueue
+} // namespace skywing::internal
+
+#endif // SKYNET_INTERNAL_DEVICES_SEND_QUEUE_HPP
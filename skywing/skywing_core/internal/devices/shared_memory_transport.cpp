@@ -0,0 +1,266 @@
+#include "skywing_core/internal/devices/shared_memory_transport.hpp"
+
+#include "skywing_core/internal/utility/logging.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <utility>
+
+namespace skywing::internal {
+namespace {
+// Identifies a segment as one made by create, and the layout version
+constexpr std::uint64_t segment_magic = 0x534b59574e4d0001;
+
+constexpr std::size_t cache_line_size = 64;
+
+struct SegmentHeader {
+  std::uint64_t magic;
+  std::uint64_t ring_size;
+};
+
+constexpr std::size_t round_up(const std::size_t value, const std::size_t multiple) noexcept
+{
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+std::size_t round_up_to_power_of_2(const std::size_t value) noexcept
+{
+  std::size_t to_ret = cache_line_size;
+  while (to_ret < value) {
+    to_ret *= 2;
+  }
+  return to_ret;
+}
+
+std::string make_segment_name() noexcept
+{
+  static std::atomic<std::uint32_t> counter{0};
+  // Kept short since some systems limit names to 31 characters
+  return "/skywing-" + std::to_string(getpid()) + "-" + std::to_string(counter.fetch_add(1));
+}
+} // namespace
+
+struct SharedMemoryRingControl {
+  // Total bytes ever written and read; the ring holds [read_pos, write_pos)
+  alignas(cache_line_size) std::atomic<std::uint64_t> write_pos{0};
+  alignas(cache_line_size) std::atomic<std::uint64_t> read_pos{0};
+
+  // Set by the reader when it finds the ring empty and the writer when it
+  // finds it full; the other side clears it and wakes them
+  alignas(cache_line_size) std::atomic<std::uint32_t> reader_waiting{0};
+  std::atomic<std::uint32_t> writer_waiting{0};
+};
+
+namespace {
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "Shared memory requires address-free atomics");
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "Shared memory requires address-free atomics");
+
+// The segment is a header, the controls for both rings, then the data for both
+constexpr std::size_t control_offset = round_up(sizeof(SegmentHeader), cache_line_size);
+constexpr std::size_t control_size = round_up(sizeof(SharedMemoryRingControl), cache_line_size);
+constexpr std::size_t data_offset = control_offset + 2 * control_size;
+
+constexpr std::size_t segment_size(const std::size_t ring_size) noexcept { return data_offset + 2 * ring_size; }
+} // namespace
+
+const std::string& host_identity() noexcept
+{
+  static const std::string identity = []() {
+    std::array<char, 256> hostname{};
+    if (gethostname(hostname.data(), hostname.size() - 1) != 0) { return std::string{}; }
+    std::string to_ret{hostname.data()};
+    // Containers can share a hostname without sharing memory, and the boot id
+    // at least tells different kernels apart; an offer that still can't be
+    // opened is simply declined
+    std::ifstream boot_id_file{"/proc/sys/kernel/random/boot_id"};
+    std::string boot_id;
+    if (std::getline(boot_id_file, boot_id)) { to_ret += "/" + boot_id; }
+    return to_ret;
+  }();
+  return identity;
+}
+
+std::unique_ptr<SharedMemoryTransport> SharedMemoryTransport::create(const std::size_t ring_size) noexcept
+{
+  const auto rounded_size = round_up_to_power_of_2(ring_size);
+  const auto size = segment_size(rounded_size);
+  auto name = make_segment_name();
+  const int handle = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (handle < 0) {
+    SKYNET_DEBUG_LOG("SharedMemoryTransport::create shm_open for \"{}\" failed: {}", name, std::strerror(errno));
+    return nullptr;
+  }
+  void* mapping = MAP_FAILED;
+  if (ftruncate(handle, static_cast<off_t>(size)) == 0) {
+    mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, handle, 0);
+  }
+  const int err = errno;
+  (void)err;
+  close(handle);
+  if (mapping == MAP_FAILED) {
+    SKYNET_DEBUG_LOG("SharedMemoryTransport::create mapping \"{}\" failed: {}", name, std::strerror(err));
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+  auto bytes = static_cast<std::byte*>(mapping);
+  new (bytes + control_offset) SharedMemoryRingControl{};
+  new (bytes + control_offset + control_size) SharedMemoryRingControl{};
+  new (bytes) SegmentHeader{segment_magic, rounded_size};
+  return std::unique_ptr<SharedMemoryTransport>{new SharedMemoryTransport{std::move(name), mapping, size, true}};
+}
+
+std::unique_ptr<SharedMemoryTransport> SharedMemoryTransport::open(const std::string& name) noexcept
+{
+  const int handle = shm_open(name.c_str(), O_RDWR, 0);
+  if (handle < 0) {
+    SKYNET_DEBUG_LOG("SharedMemoryTransport::open shm_open for \"{}\" failed: {}", name, std::strerror(errno));
+    return nullptr;
+  }
+  struct stat info;
+  void* mapping = MAP_FAILED;
+  std::size_t size = 0;
+  if (fstat(handle, &info) == 0 && static_cast<std::size_t>(info.st_size) > data_offset) {
+    size = static_cast<std::size_t>(info.st_size);
+    mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, handle, 0);
+  }
+  close(handle);
+  shm_unlink(name.c_str());
+  if (mapping == MAP_FAILED) {
+    SKYNET_DEBUG_LOG("SharedMemoryTransport::open mapping \"{}\" failed", name);
+    return nullptr;
+  }
+  const auto header = static_cast<const SegmentHeader*>(mapping);
+  if (header->magic != segment_magic || segment_size(header->ring_size) != size) {
+    SKYNET_DEBUG_LOG("SharedMemoryTransport::open \"{}\" is not a valid segment", name);
+    munmap(mapping, size);
+    return nullptr;
+  }
+  auto to_ret = std::unique_ptr<SharedMemoryTransport>{new SharedMemoryTransport{name, mapping, size, false}};
+  to_ret->unlinked_ = true;
+  return to_ret;
+}
+
+SharedMemoryTransport::SharedMemoryTransport(
+  std::string name, void* const mapping, const std::size_t mapping_size, const bool is_creator) noexcept
+  : name_{std::move(name)}, mapping_{mapping}, mapping_size_{mapping_size}, unlinked_{false}
+{
+  const auto bytes = static_cast<std::byte*>(mapping);
+  const auto ring_size = static_cast<const SegmentHeader*>(mapping)->ring_size;
+  // The creator writes to the first ring and the peer to the second
+  const auto control_at = [&](const std::size_t offset) {
+    return reinterpret_cast<SharedMemoryRingControl*>(bytes + offset);
+  };
+  const Ring first{control_at(control_offset), bytes + data_offset, ring_size};
+  const Ring second{control_at(control_offset + control_size), bytes + data_offset + ring_size, ring_size};
+  out_ = is_creator ? first : second;
+  in_ = is_creator ? second : first;
+}
+
+SharedMemoryTransport::~SharedMemoryTransport()
+{
+  munmap(mapping_, mapping_size_);
+  unlink();
+}
+
+void SharedMemoryTransport::unlink() noexcept
+{
+  if (unlinked_) { return; }
+  shm_unlink(name_.c_str());
+  unlinked_ = true;
+}
+
+std::variant<std::size_t, ConnectionError>
+  SharedMemoryTransport::send_gathered(const SendBuffer* const buffers, std::size_t count) noexcept
+{
+  count = std::min(count, max_gathered_send_buffers);
+  auto& control = *out_.control;
+  const auto mask = out_.size - 1;
+  std::size_t sent = 0;
+  std::size_t buffer_index = 0;
+  std::size_t buffer_offset = 0;
+  while (buffer_index < count) {
+    const std::uint64_t write_pos = control.write_pos.load(std::memory_order_relaxed);
+    const std::uint64_t read_pos = control.read_pos.load(std::memory_order_acquire);
+    std::size_t room = out_.size - static_cast<std::size_t>(write_pos - read_pos);
+    if (room == 0) {
+      // Ask to be woken once there's room, then look again in case the reader
+      // made some in between
+      control.writer_waiting.store(1, std::memory_order_seq_cst);
+      if (control.read_pos.load(std::memory_order_seq_cst) + out_.size == write_pos) { break; }
+      control.writer_waiting.store(0, std::memory_order_relaxed);
+      continue;
+    }
+    std::size_t written = 0;
+    while (room != 0 && buffer_index < count) {
+      const auto& buffer = buffers[buffer_index];
+      const auto amount = std::min(room, buffer.size - buffer_offset);
+      const auto ring_offset = static_cast<std::size_t>(write_pos + written) & mask;
+      const auto before_wrap = std::min(amount, out_.size - ring_offset);
+      std::memcpy(out_.data + ring_offset, buffer.data + buffer_offset, before_wrap);
+      std::memcpy(out_.data, buffer.data + buffer_offset + before_wrap, amount - before_wrap);
+      written += amount;
+      room -= amount;
+      buffer_offset += amount;
+      if (buffer_offset == buffer.size) {
+        ++buffer_index;
+        buffer_offset = 0;
+      }
+    }
+    control.write_pos.store(write_pos + written, std::memory_order_seq_cst);
+    sent += written;
+  }
+  if (sent == 0) { return ConnectionError::would_block; }
+  if (
+    control.reader_waiting.load(std::memory_order_seq_cst) != 0
+    && control.reader_waiting.exchange(0, std::memory_order_seq_cst) != 0) {
+    wake_up_needed_ = true;
+  }
+  return sent;
+}
+
+std::variant<std::size_t, ConnectionError>
+  SharedMemoryTransport::read_some(std::byte* const buffer, const std::size_t size) noexcept
+{
+  auto& control = *in_.control;
+  const std::uint64_t read_pos = control.read_pos.load(std::memory_order_relaxed);
+  std::uint64_t write_pos = control.write_pos.load(std::memory_order_acquire);
+  if (write_pos == read_pos) {
+    // Same as above, but waiting for data
+    control.reader_waiting.store(1, std::memory_order_seq_cst);
+    write_pos = control.write_pos.load(std::memory_order_seq_cst);
+    if (write_pos == read_pos) { return ConnectionError::would_block; }
+    control.reader_waiting.store(0, std::memory_order_relaxed);
+  }
+  const auto amount = std::min(size, static_cast<std::size_t>(write_pos - read_pos));
+  const auto ring_offset = static_cast<std::size_t>(read_pos) & (in_.size - 1);
+  const auto before_wrap = std::min(amount, in_.size - ring_offset);
+  std::memcpy(buffer, in_.data + ring_offset, before_wrap);
+  std::memcpy(buffer + before_wrap, in_.data, amount - before_wrap);
+  control.read_pos.store(read_pos + amount, std::memory_order_seq_cst);
+  if (
+    control.writer_waiting.load(std::memory_order_seq_cst) != 0
+    && control.writer_waiting.exchange(0, std::memory_order_seq_cst) != 0) {
+    wake_up_needed_ = true;
+  }
+  return amount;
+}
+
+bool SharedMemoryTransport::take_wake_up_needed() noexcept { return std::exchange(wake_up_needed_, false); }
+
+bool SharedMemoryTransport::has_input() const noexcept
+{
+  return in_.control->write_pos.load(std::memory_order_acquire)
+      != in_.control->read_pos.load(std::memory_order_relaxed);
+}
+} // namespace skywing::internal
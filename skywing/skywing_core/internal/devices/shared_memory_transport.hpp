@@ -0,0 +1,112 @@
+#ifndef SKYNET_INTERNAL_DEVICES_SHARED_MEMORY_TRANSPORT_HPP
+#define SKYNET_INTERNAL_DEVICES_SHARED_MEMORY_TRANSPORT_HPP
+
+#include "skywing_core/internal/devices/transport.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace skywing::internal {
+// The number of bytes each direction of a shared memory connection can hold
+inline constexpr std::size_t default_shared_memory_ring_size = 1024 * 1024;
+
+/** \brief Returns a string that is the same for every process on this host
+ * and different between hosts, or an empty string if it can't be determined
+ */
+const std::string& host_identity() noexcept;
+
+// Positions and wake-up flags for one direction, which live in the segment
+struct SharedMemoryRingControl;
+
+/** \brief A pair of single-producer single-consumer byte rings in a shared
+ * memory segment, one for each direction
+ *
+ * Bytes are copied straight into memory the peer has mapped, so nothing goes
+ * through the kernel while both sides are busy.  Neither side blocks, so the
+ * owner has to wake the peer when it goes idle: after a send or read, if
+ * take_wake_up_needed() returns true the peer is waiting for data or for room
+ * and must be woken through some other channel (the Manager writes a byte to
+ * the socket the connection was negotiated on).
+ *
+ * The peer closing is not detected here; that's left to the other channel.
+ */
+class SharedMemoryTransport final : public Transport {
+public:
+  /** \brief Creates and maps a new segment with a unique name
+   *
+   * Returns nullptr if shared memory is unavailable.  The name stays in the
+   * system until unlink is called or this is destroyed, so the peer has to
+   * open it before then.
+   *
+   * \param ring_size The bytes each direction holds, rounded up to a power of 2
+   */
+  static std::unique_ptr<SharedMemoryTransport> create(std::size_t ring_size = default_shared_memory_ring_size) noexcept;
+
+  /** \brief Maps a segment made by create in another process
+   *
+   * Returns nullptr if it couldn't be opened or isn't a valid segment.  The
+   * name is removed once it's mapped since nothing else needs it.
+   */
+  static std::unique_ptr<SharedMemoryTransport> open(const std::string& name) noexcept;
+
+  ~SharedMemoryTransport() override;
+
+  SharedMemoryTransport(const SharedMemoryTransport&) = delete;
+  SharedMemoryTransport& operator=(const SharedMemoryTransport&) = delete;
+
+  /** \brief Returns the name the peer opens the segment with
+   */
+  const std::string& name() const noexcept { return name_; }
+
+  /** \brief Removes the segment's name; mappings stay valid
+   */
+  void unlink() noexcept;
+
+  std::variant<std::size_t, ConnectionError>
+    send_gathered(const SendBuffer* buffers, std::size_t count) noexcept override;
+
+  std::variant<std::size_t, ConnectionError> read_some(std::byte* buffer, std::size_t size) noexcept override;
+
+  /** \brief Returns true if a send or read since the last call found the peer
+   * waiting, and clears it
+   */
+  bool take_wake_up_needed() noexcept;
+
+  /** \brief Returns true if there are bytes from the peer waiting to be read
+   */
+  bool has_input() const noexcept;
+
+  /** \brief Switches between the socket and shared memory for each direction;
+   * tracked here for the owner's convenience
+   */
+  bool is_sending() const noexcept { return sending_; }
+  bool is_receiving() const noexcept { return receiving_; }
+  void start_sending() noexcept { sending_ = true; }
+  void start_receiving() noexcept { receiving_ = true; }
+
+private:
+  struct Ring {
+    SharedMemoryRingControl* control;
+    std::byte* data;
+    std::size_t size;
+  };
+
+  SharedMemoryTransport(std::string name, void* mapping, std::size_t mapping_size, bool is_creator) noexcept;
+
+  std::string name_;
+  void* mapping_;
+  std::size_t mapping_size_;
+
+  // The rings this side writes to and reads from
+  Ring out_;
+  Ring in_;
+
+  bool unlinked_;
+  bool wake_up_needed_ = false;
+  bool sending_ = false;
+  bool receiving_ = false;
+}; // class SharedMemoryTransport
+} // namespace skywing::internal
+
+#endif // SKYNET_INTERNAL_DEVICES_SHARED_MEMORY_TRANSPORT_HPP
@@ -1,5 +1,6 @@
 #include "skywing_core/internal/devices/socket_communicator.hpp"
 
+#include "socket_ring.hpp"
 #include "socket_wrappers.hpp"
 
 #include "generated/socket_no_sigpipe.hpp"
@@ -13,8 +14,11 @@
 #include <poll.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <array>
 #include <cstdio>
 #include <cstring>
 
@@ -38,8 +42,8 @@ addrinfo_ptr resolve_addr(const char* const address, const std::uint16_t port) n
   const auto port_str = std::to_string(port);
   const auto resaddr = getaddrinfo(address, port_str.c_str(), &hints, &result);
   if (resaddr != 0) {
-    std::perror("resolve_addr - resaddr");
-    std::exit(4);
+    SKYNET_WARN_LOG("Couldn't resolve \"{}\": {}", address, gai_strerror(resaddr));
+    return nullptr;
   }
   return {result, {}};
 }
@@ -57,8 +61,10 @@ int init_connection(const int sockfd, const char* const address, const std::uint
   serv_addr.sin_port = htons(port);
   if (inet_pton(AF_INET, address, &serv_addr.sin_addr) <= 0)
   {
-    SKYNET_ERROR_LOG("Invalid address {}", address);
-    std::exit(4);
+    // Names have to be resolved before getting here
+    SKYNET_WARN_LOG("Invalid address {}", address);
+    errno = EINVAL;
+    return -1;
   }
   return connect(sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr));
 }
@@ -73,7 +79,12 @@ SocketCommunicator::SocketCommunicator() noexcept : handle_{create_non_blocking(
   }
 }
 
-SocketCommunicator::SocketCommunicator(SocketCommunicator&& other) noexcept : handle_{other.handle_}
+SocketCommunicator::SocketCommunicator(std::unique_ptr<InProcessPipeEnd> pipe) noexcept
+  : handle_{pipe->handle()}, pipe_{std::move(pipe)}
+{}
+
+SocketCommunicator::SocketCommunicator(SocketCommunicator&& other) noexcept
+  : handle_{other.handle_}, pipe_{std::move(other.pipe_)}
 {
   other.handle_ = invalid_handle;
 }
@@ -83,13 +94,18 @@ SocketCommunicator& SocketCommunicator::operator=(SocketCommunicator&& other) no
   // Do this in a roundabout way to handle self-assignment
   const auto new_handle = other.handle_;
   other.handle_ = invalid_handle;
+  auto new_pipe = std::move(other.pipe_);
   handle_ = new_handle;
+  pipe_ = std::move(new_pipe);
   return *this;
 }
 
 SocketCommunicator::~SocketCommunicator()
 {
-  if (handle_ != invalid_handle) { close(handle_); }
+  if (handle_ != invalid_handle && !pipe_) {
+    ring_release(handle_);
+    close(handle_);
+  }
 }
 
 std::optional<SocketCommunicator> SocketCommunicator::accept() noexcept
@@ -98,7 +114,10 @@ std::optional<SocketCommunicator> SocketCommunicator::accept() noexcept
   // len can't be const as accept takes a non-const pointer
   socklen_t len = sizeof(client_address_struct);
 
-  const int raw_handle = accept_make_non_blocking(handle_, reinterpret_cast<sockaddr*>(&client_address_struct), &len);
+  const auto ring_handle = ring_accept(handle_);
+  const int raw_handle = ring_handle
+                         ? *ring_handle
+                         : accept_make_non_blocking(handle_, reinterpret_cast<sockaddr*>(&client_address_struct), &len);
   if (raw_handle == invalid_handle) {
     // No connection to be made
     if (errno == EAGAIN || errno == EWOULDBLOCK) { return {}; }
@@ -184,6 +203,8 @@ ConnectionError SocketCommunicator::connect_non_blocking(const std::string_view
 
 ConnectionError SocketCommunicator::connection_progress_status() noexcept
 {
+  if (pipe_) { return ConnectionError::no_error; }
+  if (const auto status = ring_connection_status(handle_)) { return *status; }
   pollfd to_poll;
   to_poll.fd = handle_;
   to_poll.events = POLLOUT | POLLIN;
@@ -204,6 +225,17 @@ ConnectionError SocketCommunicator::connection_progress_status() noexcept
 
 ConnectionError SocketCommunicator::send_message(const std::byte* const message, const std::size_t size) noexcept
 {
+  if (pipe_) {
+    const SendBuffer buffer{message, size};
+    const auto sent_or_error = pipe_->send_gathered(&buffer, 1);
+    if (const auto err = std::get_if<ConnectionError>(&sent_or_error)) { return *err; }
+    return ConnectionError::no_error;
+  }
+  const SendBuffer buffer{message, size};
+  if (const auto sent_or_error = ring_send_gathered(handle_, &buffer, 1)) {
+    if (const auto err = std::get_if<ConnectionError>(&*sent_or_error)) { return *err; }
+    return ConnectionError::no_error;
+  }
   if (send(handle_, message, size, SKYNET_NO_SIGPIPE) < 0) {
     SKYNET_DEBUG_LOG("send_message threw error: {}", strerror(errno));
     if (errno == EAGAIN || errno == EWOULDBLOCK) { return ConnectionError::would_block; }
@@ -214,8 +246,60 @@ ConnectionError SocketCommunicator::send_message(const std::byte* const message,
   return ConnectionError::no_error;
 }
 
+std::variant<std::size_t, ConnectionError>
+  SocketCommunicator::send_some(const std::byte* const message, const std::size_t size) noexcept
+{
+  if (pipe_) {
+    const SendBuffer buffer{message, size};
+    return pipe_->send_gathered(&buffer, 1);
+  }
+  const SendBuffer buffer{message, size};
+  if (auto sent_or_error = ring_send_gathered(handle_, &buffer, 1)) { return *sent_or_error; }
+  const auto sent = send(handle_, message, size, SKYNET_NO_SIGPIPE);
+  if (sent < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) { return ConnectionError::would_block; }
+    SKYNET_DEBUG_LOG("send_some threw error: {}", strerror(errno));
+    return ConnectionError::unrecoverable;
+  }
+  return static_cast<std::size_t>(sent);
+}
+
+std::variant<std::size_t, ConnectionError>
+  SocketCommunicator::send_gathered(const SendBuffer* const buffers, const std::size_t count) noexcept
+{
+  if (pipe_) { return pipe_->send_gathered(buffers, count); }
+  if (auto sent_or_error = ring_send_gathered(handle_, buffers, count)) { return *sent_or_error; }
+  std::array<iovec, max_gathered_send_buffers> iovecs;
+  const auto num_buffers = std::min(count, max_gathered_send_buffers);
+  for (std::size_t i = 0; i < num_buffers; ++i) {
+    // iovec isn't const-correct, but sendmsg never writes to the buffers
+    iovecs[i].iov_base = const_cast<std::byte*>(buffers[i].data);
+    iovecs[i].iov_len = buffers[i].size;
+  }
+  msghdr header;
+  std::memset(&header, 0, sizeof(header));
+  header.msg_iov = iovecs.data();
+  header.msg_iovlen = static_cast<decltype(header.msg_iovlen)>(num_buffers);
+  const auto sent = sendmsg(handle_, &header, SKYNET_NO_SIGPIPE);
+  if (sent < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) { return ConnectionError::would_block; }
+    SKYNET_DEBUG_LOG("send_gathered threw error: {}", strerror(errno));
+    return ConnectionError::unrecoverable;
+  }
+  return static_cast<std::size_t>(sent);
+}
+
 ConnectionError SocketCommunicator::read_message(std::byte* const buffer, const std::size_t size) noexcept
 {
+  if (pipe_) {
+    const auto read_or_error = pipe_->read_some(buffer, size);
+    if (const auto err = std::get_if<ConnectionError>(&read_or_error)) { return *err; }
+    return ConnectionError::no_error;
+  }
+  if (const auto read_or_error = ring_read_some(handle_, buffer, size)) {
+    if (const auto err = std::get_if<ConnectionError>(&*read_or_error)) { return *err; }
+    return ConnectionError::no_error;
+  }
   const auto read_bytes = read(handle_, reinterpret_cast<char*>(buffer), size);
   if (read_bytes < 0) {
     if (errno == EAGAIN || errno == EWOULDBLOCK) { return ConnectionError::would_block; }
@@ -226,8 +310,29 @@ ConnectionError SocketCommunicator::read_message(std::byte* const buffer, const
   return read_bytes == 0 ? ConnectionError::closed : ConnectionError::no_error;
 }
 
+std::variant<std::size_t, ConnectionError>
+  SocketCommunicator::read_some(std::byte* const buffer, const std::size_t size) noexcept
+{
+  if (pipe_) { return pipe_->read_some(buffer, size); }
+  if (auto read_or_error = ring_read_some(handle_, buffer, size)) { return *read_or_error; }
+  const auto read_bytes = read(handle_, reinterpret_cast<char*>(buffer), size);
+  if (read_bytes < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) { return ConnectionError::would_block; }
+    SKYNET_DEBUG_LOG("read_some threw error: {}", strerror(errno));
+    return ConnectionError::unrecoverable;
+  }
+  if (read_bytes == 0) { return ConnectionError::closed; }
+  return static_cast<std::size_t>(read_bytes);
+}
+
+bool SocketCommunicator::send_shared(const SharedMessage& message) noexcept
+{
+  return pipe_ && pipe_->send_shared(message);
+}
+
 AddrPortPair SocketCommunicator::ip_address_and_port() const noexcept
 {
+  if (pipe_) { return pipe_->peer_address(); }
   sockaddr_in client_address;
   socklen_t len = sizeof(client_address);
   int err = getpeername(handle_, (struct sockaddr*)&client_address, &len);
@@ -239,6 +344,7 @@ AddrPortPair SocketCommunicator::ip_address_and_port() const noexcept
 
 AddrPortPair SocketCommunicator::host_ip_address_and_port() const noexcept
 {
+  if (pipe_) { return pipe_->host_address(); }
   sockaddr_in host_address;
   socklen_t len = sizeof(host_address);
   getsockname(handle_, (struct sockaddr*)&host_address, &len);
@@ -247,38 +353,6 @@ AddrPortPair SocketCommunicator::host_ip_address_and_port() const noexcept
 
 SocketCommunicator::SocketCommunicator(WithRawHandle, const int handle) noexcept : handle_{handle} {}
 
-std::vector<std::byte> read_chunked(SocketCommunicator& conn, const std::size_t num_bytes) noexcept
-{
-  // Size of memory to allocate/read each step
-  constexpr std::size_t read_step_size = 0x0'1000;
-  constexpr std::size_t allocate_step_size = read_step_size * 16;
-  // How often memory needs to be resized
-  constexpr std::size_t resize_every_n_steps = allocate_step_size / read_step_size;
-  // Ensure that the allocate size is evenly divisible by the read size
-  static_assert(allocate_step_size % read_step_size == 0);
-  static_assert(allocate_step_size >= read_step_size);
-  // To prevent overallocation of memory, don't allocate a ton of memory to start
-  std::vector<std::byte> read_bytes;
-  // The final bytes to read in the end
-  const int final_read_size = num_bytes % read_step_size;
-  // Read memory in 4KiB chunks
-  const int num_iters = num_bytes / read_step_size + (final_read_size == 0 ? 0 : 1);
-  for (int i = 0; i < num_iters; ++i) {
-    if (i % resize_every_n_steps == 0) {
-      // Allocate more memory
-      const std::size_t mem_left_to_read = num_bytes - read_bytes.size();
-      const std::size_t additional_size = mem_left_to_read > allocate_step_size ? allocate_step_size : mem_left_to_read;
-      read_bytes.resize(read_bytes.size() + additional_size);
-    }
-    const std::size_t num_bytes_to_read = (i == num_iters - 1 ? final_read_size : read_step_size);
-    // Allocate more memory if needed
-    if (conn.read_message(&read_bytes[i * read_step_size], num_bytes_to_read) != ConnectionError::no_error) {
-      return {};
-    }
-  }
-  return read_bytes;
-}
-
 AddrPortPair split_address(const std::string_view address) noexcept
 {
   // Split the address by the colon
@@ -296,14 +370,6 @@ AddrPortPair split_address(const std::string_view address) noexcept
   return {address_str, port};
 }
 
-std::variant<NetworkSizeType, ConnectionError> read_network_size(SocketCommunicator& conn) noexcept
-{
-  std::array<std::byte, sizeof(NetworkSizeType)> size_buffer;
-  const auto err = conn.read_message(size_buffer.data(), size_buffer.size());
-  if (err == ConnectionError::no_error) { return from_network_bytes(size_buffer); }
-  return err;
-}
-
 std::string to_ip_port(const AddrPortPair& addr) noexcept
 {
   const auto& [name, port] = to_canonical(addr);
@@ -313,6 +379,7 @@ std::string to_ip_port(const AddrPortPair& addr) noexcept
 AddrPortPair to_canonical(const AddrPortPair& addr) noexcept
 {
   const auto result = resolve_addr(addr.first.c_str(), addr.second);
+  if (!result) { return {}; }
   sockaddr_in* info = reinterpret_cast<sockaddr_in*>(result->ai_addr);
   const std::string to_ret = std::to_string((info->sin_addr.s_addr & 0x000000FF) >> 0) + '.'
                            + std::to_string((info->sin_addr.s_addr & 0x0000FF00) >> 8) + '.'
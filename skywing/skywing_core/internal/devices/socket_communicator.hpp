@@ -1,6 +1,8 @@
 #ifndef SKYNET_INTERNAL_DEVICES_SOCKET_COMMUNICATOR_HPP
 #define SKYNET_INTERNAL_DEVICES_SOCKET_COMMUNICATOR_HPP
 
+#include "skywing_core/internal/devices/in_process_pipe.hpp"
+#include "skywing_core/internal/devices/transport.hpp"
 #include "skywing_core/internal/utility/network_conv.hpp"
 #include "skywing_core/types.hpp"
 
@@ -9,35 +11,25 @@
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <variant>
 #include <vector>
 
 namespace skywing::internal {
-/** \brief Enum returned from communication functions for connection status
- */
-enum class [[nodiscard]] ConnectionError{/// The call has fully succeeded, no more work needs to be done
-                                         no_error,
-
-                                         /// The call would block
-                                         would_block,
-
-                                         /// Non-blocking connected has been initiated
-                                         connection_in_progress = would_block,
-
-                                         /// An error occurred with communication that has left the connection
-                                         /// in an unusable state
-                                         unrecoverable,
-
-                                         /// The connection has closed
-                                         closed}; // enum class ConnectionError
-
 /** \brief Socket based communicator
+ *
+ * Can instead wrap one end of an in-process connection, in which case no
+ * socket is created and everything goes through the pipe.
  */
-class SocketCommunicator {
+class SocketCommunicator : public Transport {
 public:
   /** \brief Create a new socket-based communicator
    */
   SocketCommunicator() noexcept;
 
+  /** \brief Wraps an in-process connection, which is already connected
+   */
+  explicit SocketCommunicator(std::unique_ptr<InProcessPipeEnd> pipe) noexcept;
+
   // Can not be copied
   SocketCommunicator(const SocketCommunicator&) = delete;
   SocketCommunicator& operator=(const SocketCommunicator&) = delete;
@@ -47,7 +39,7 @@ public:
   SocketCommunicator& operator=(SocketCommunicator&&) noexcept;
 
   // Destructor
-  ~SocketCommunicator();
+  ~SocketCommunicator() override;
 
   /** \brief Accepts an incoming connection if one is pending
    */
@@ -88,6 +80,28 @@ public:
    */
   ConnectionError send_message(const std::byte* message, std::size_t size) noexcept;
 
+  /** \brief Sends as much of a message as the socket will currently accept
+   *
+   * Returns the number of bytes sent or the error that occurred; a full socket
+   * buffer is reported as ConnectionError::would_block.
+   *
+   * \param message The message to send
+   * \param size The size of the message
+   */
+  std::variant<std::size_t, ConnectionError> send_some(const std::byte* message, std::size_t size) noexcept;
+
+  /** \brief Sends as much of several buffers as the socket will accept with one call
+   *
+   * The buffers are sent in order as if they were one contiguous message.  At
+   * most max_gathered_send_buffers are used; any after that are ignored.
+   * Returns the same as send_some.
+   *
+   * \param buffers The buffers to send
+   * \param count The number of buffers
+   */
+  std::variant<std::size_t, ConnectionError>
+    send_gathered(const SendBuffer* buffers, std::size_t count) noexcept override;
+
   /** \brief Recieve a message from the socket if one is available
    *
    * If there is no message to read (ConnectionError::would_block is returned)
@@ -98,6 +112,22 @@ public:
    */
   ConnectionError read_message(std::byte* buffer, std::size_t size) noexcept;
 
+  /** \brief Reads whatever is available from the socket, up to a maximum size
+   *
+   * Returns the number of bytes read or the error that occurred; nothing being
+   * available is reported as ConnectionError::would_block and the peer closing
+   * the connection as ConnectionError::closed.
+   *
+   * \param buffer The buffer to write to
+   * \param size The size of the buffer
+   */
+  std::variant<std::size_t, ConnectionError> read_some(std::byte* buffer, std::size_t size) noexcept override;
+
+  /** \brief Hands a whole message to an in-process connection without copying;
+   * always returns false for sockets
+   */
+  bool send_shared(const SharedMessage& message) noexcept override;
+
   /** \brief Returns the IP address and port of the socket's peer
    */
   AddrPortPair ip_address_and_port() const noexcept;
@@ -106,6 +136,14 @@ public:
    */
   AddrPortPair host_ip_address_and_port() const noexcept;
 
+  /** \brief Returns the underlying OS handle, for registering with an EventLoop
+   */
+  int native_handle() const noexcept { return handle_; }
+
+  /** \brief Returns true if this wraps an in-process connection
+   */
+  bool is_in_process() const noexcept { return pipe_ != nullptr; }
+
 private:
   // Tag for using the raw handle constructor
   struct WithRawHandle {};
@@ -113,30 +151,26 @@ private:
   // Construct a socket using a pre-exising handle
   SocketCommunicator(WithRawHandle, const int handle) noexcept;
 
-  // The handle to the raw socket
+  // The handle to the raw socket, or the pipe's handle
   int handle_;
-}; // class SocketCommunicator
 
-/** \brief Read a message in chunks from a SocketCommunicator.
- */
-std::vector<std::byte> read_chunked(SocketCommunicator& conn, std::size_t num_bytes) noexcept;
+  // Set if this is an in-process connection
+  std::unique_ptr<InProcessPipeEnd> pipe_;
+}; // class SocketCommunicator
 
 /** \brief Splits an "ip:port" address into its parts
  * The string is empty if the input was invalid
  */
 AddrPortPair split_address(const std::string_view address) noexcept;
 
-/** \brief Attempts to read a network size from a connection
- *
- * Returns either the network size or the error that occurred
- */
-std::variant<NetworkSizeType, ConnectionError> read_network_size(SocketCommunicator& conn) noexcept;
-
 /** \brief Returns an "IP:Port" string from a given address
  */
 std::string to_ip_port(const AddrPortPair& addr) noexcept;
 
 /** \brief Converts an AddrPortPair to the canonical representation
+ *
+ * Blocks while the name is looked up; the Manager uses AddressResolver
+ * instead.  The address is empty if it couldn't be resolved.
  */
 AddrPortPair to_canonical(const AddrPortPair& addr) noexcept;
 } // namespace skywing::internal
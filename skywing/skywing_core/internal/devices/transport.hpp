@@ -0,0 +1,97 @@
+#ifndef SKYNET_INTERNAL_DEVICES_TRANSPORT_HPP
+#define SKYNET_INTERNAL_DEVICES_TRANSPORT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <variant>
+#include <vector>
+
+namespace skywing::internal {
+/** \brief Enum returned from communication functions for connection status
+ */
+enum class [[nodiscard]] ConnectionError{/// The call has fully succeeded, no more work needs to be done
+                                         no_error,
+
+                                         /// The call would block
+                                         would_block,
+
+                                         /// Non-blocking connected has been initiated
+                                         connection_in_progress = would_block,
+
+                                         /// An error occurred with communication that has left the connection
+                                         /// in an unusable state
+                                         unrecoverable,
+
+                                         /// The connection has closed
+                                         closed}; // enum class ConnectionError
+
+/** \brief A finished message that can be queued on several connections without copying
+ */
+using SharedMessage = std::shared_ptr<const std::vector<std::byte>>;
+
+/** \brief A piece of memory to be sent as part of a gathered send
+ */
+struct SendBuffer {
+  const std::byte* data;
+  std::size_t size;
+}; // struct SendBuffer
+
+// The most buffers that a single gathered send will hand to the OS
+inline constexpr std::size_t max_gathered_send_buffers = 64;
+
+// The top two bits of a frame's length prefix mark pieces of a message that
+// was split up so that other messages could be sent in between; the pieces of
+// a message are sent in order, and the last one has both bits set
+inline constexpr std::uint32_t frame_fragment_flag = 0x8000'0000u;
+inline constexpr std::uint32_t frame_last_fragment_flag = 0x4000'0000u;
+inline constexpr std::uint32_t frame_length_mask = 0x3fff'ffffu;
+
+// Data messages with a longer body than this are sent in pieces of this size
+inline constexpr std::size_t max_fragment_size = 64 * 1024;
+
+/** \brief An ordered, reliable stream of bytes between two managers
+ *
+ * Messages are framed by SendQueue and ReceiveBuffer, so a transport only has
+ * to move bytes.  Neither call may block; running out of room or data is
+ * reported as ConnectionError::would_block.
+ */
+class Transport {
+public:
+  virtual ~Transport() = default;
+
+  /** \brief Sends as much of several buffers as can be accepted right now
+   *
+   * The buffers are sent in order as if they were one contiguous message.
+   * Returns the number of bytes sent or the error that occurred.
+   */
+  virtual std::variant<std::size_t, ConnectionError>
+    send_gathered(const SendBuffer* buffers, std::size_t count) noexcept = 0;
+
+  /** \brief Reads whatever is available, up to a maximum size
+   *
+   * Returns the number of bytes read or the error that occurred.
+   */
+  virtual std::variant<std::size_t, ConnectionError> read_some(std::byte* buffer, std::size_t size) noexcept = 0;
+
+  /** \brief Hands over a whole message without copying it, if the transport
+   * can take ownership of it; returns false if it wasn't sent
+   *
+   * The default never sends, and the caller falls back to send_gathered.
+   */
+  virtual bool send_shared(const SharedMessage& message) noexcept
+  {
+    (void)message;
+    return false;
+  }
+
+protected:
+  Transport() = default;
+  Transport(const Transport&) = default;
+  Transport(Transport&&) = default;
+  Transport& operator=(const Transport&) = default;
+  Transport& operator=(Transport&&) = default;
+}; // class Transport
+} // namespace skywing::internal
+
+#endif // SKYNET_INTERNAL_DEVICES_TRANSPORT_HPP
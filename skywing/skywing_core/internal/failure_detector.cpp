@@ -0,0 +1,71 @@
+#include "skywing_core/internal/failure_detector.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace skywing::internal {
+namespace {
+double to_ms(const std::chrono::steady_clock::duration d) noexcept
+{
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+} // namespace
+
+PhiAccrualFailureDetector::PhiAccrualFailureDetector(
+  const std::chrono::milliseconds expected_interval,
+  const std::chrono::milliseconds acceptable_pause,
+  const std::chrono::milliseconds min_std_deviation,
+  const std::chrono::steady_clock::time_point now) noexcept
+  : acceptable_pause_ms_{to_ms(acceptable_pause)}, min_std_deviation_ms_{to_ms(min_std_deviation)}, last_heartbeat_{now}
+{
+  // Seed with a spread around the expected interval so there's something to
+  // go on before the first real arrival
+  const double expected = to_ms(expected_interval);
+  add_sample(expected * 0.75);
+  add_sample(expected * 1.25);
+}
+
+void PhiAccrualFailureDetector::heartbeat(const std::chrono::steady_clock::time_point now) noexcept
+{
+  if (now <= last_heartbeat_) { return; }
+  add_sample(to_ms(now - last_heartbeat_));
+  last_heartbeat_ = now;
+}
+
+double PhiAccrualFailureDetector::phi(const std::chrono::steady_clock::time_point now) const noexcept
+{
+  const double count = static_cast<double>(num_samples_);
+  const double mean = sum_ / count;
+  const double variance = std::max(sum_of_squares_ / count - mean * mean, 0.0);
+  const double std_deviation = std::max(std::sqrt(variance), min_std_deviation_ms_);
+  const double elapsed = now > last_heartbeat_ ? to_ms(now - last_heartbeat_) : 0.0;
+  // Logistic approximation of the normal distribution's tail, which doesn't
+  // underflow as quickly as computing it directly
+  const double y = (elapsed - (mean + acceptable_pause_ms_)) / std_deviation;
+  const double e = std::exp(-y * (1.5976 + 0.070566 * y * y));
+  if (y > 0) { return -std::log10(e / (1.0 + e)); }
+  return -std::log10(1.0 - 1.0 / (1.0 + e));
+}
+
+bool PhiAccrualFailureDetector::is_suspected(
+  const std::chrono::steady_clock::time_point now, const double threshold) const noexcept
+{
+  return phi(now) > threshold;
+}
+
+void PhiAccrualFailureDetector::add_sample(const double gap_ms) noexcept
+{
+  if (num_samples_ == max_samples) {
+    const double oldest = samples_[next_sample_];
+    sum_ -= oldest;
+    sum_of_squares_ -= oldest * oldest;
+  }
+  else {
+    ++num_samples_;
+  }
+  samples_[next_sample_] = gap_ms;
+  next_sample_ = (next_sample_ + 1) % max_samples;
+  sum_ += gap_ms;
+  sum_of_squares_ += gap_ms * gap_ms;
+}
+} // namespace skywing::internal
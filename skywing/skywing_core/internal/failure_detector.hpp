@@ -0,0 +1,73 @@
+#ifndef SKYNET_INTERNAL_FAILURE_DETECTOR_HPP
+#define SKYNET_INTERNAL_FAILURE_DETECTOR_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+namespace skywing::internal {
+// How suspicious a silence has to be before a neighbor is considered failed;
+// a phi of 8 means that the chance of the neighbor still being alive is
+// about 1 in 10^8 given the gaps seen so far
+inline constexpr double default_phi_threshold = 8.0;
+
+/** \brief Phi accrual failure detector
+ *
+ * Keeps the gaps between recent arrivals from a neighbor and, instead of a
+ * fixed timeout, reports how unlikely the current silence is given them as
+ * phi = -log10(chance of a gap at least this long).  A neighbor that sends
+ * constantly is suspected soon after it stops, while one that only sends
+ * heartbeats is given longer.
+ *
+ * Gaps are treated as normally distributed.  The acceptable pause is added to
+ * the mean so that a neighbor going from busy to idle, and only sending
+ * heartbeats from then on, isn't suspected, and the standard deviation is
+ * kept from going below a minimum so perfectly regular arrivals don't make
+ * the detector hair-triggered.
+ */
+class PhiAccrualFailureDetector {
+public:
+  /** \brief Creates a detector that starts out expecting arrivals about
+   * every expected_interval, counting the first from now
+   */
+  PhiAccrualFailureDetector(
+    std::chrono::milliseconds expected_interval,
+    std::chrono::milliseconds acceptable_pause,
+    std::chrono::milliseconds min_std_deviation,
+    std::chrono::steady_clock::time_point now) noexcept;
+
+  /** \brief Records that something arrived from the neighbor
+   */
+  void heartbeat(std::chrono::steady_clock::time_point now) noexcept;
+
+  /** \brief Returns how suspicious the time since the last arrival is
+   */
+  double phi(std::chrono::steady_clock::time_point now) const noexcept;
+
+  /** \brief Returns true if phi is over the threshold
+   */
+  bool is_suspected(std::chrono::steady_clock::time_point now, double threshold = default_phi_threshold) const noexcept;
+
+  /** \brief The time of the last arrival
+   */
+  std::chrono::steady_clock::time_point last_heartbeat() const noexcept { return last_heartbeat_; }
+
+private:
+  static constexpr std::size_t max_samples = 100;
+
+  void add_sample(double gap_ms) noexcept;
+
+  // The most recent gaps, in milliseconds, used as a ring
+  std::array<double, max_samples> samples_{};
+  std::size_t num_samples_ = 0;
+  std::size_t next_sample_ = 0;
+  double sum_ = 0.0;
+  double sum_of_squares_ = 0.0;
+
+  double acceptable_pause_ms_;
+  double min_std_deviation_ms_;
+  std::chrono::steady_clock::time_point last_heartbeat_;
+}; // class PhiAccrualFailureDetector
+} // namespace skywing::internal
+
+#endif // SKYNET_INTERNAL_FAILURE_DETECTOR_HPP
@@ -2,6 +2,8 @@
 
 #include "skywing_core/manager.hpp"
 
+#include <utility>
+
 namespace skywing::internal {
 ManagerSubscribeIsDone::ManagerSubscribeIsDone(Manager& manager, const std::vector<TagID>& tags) noexcept
   : manager_{&manager}, tags_{tags}
@@ -50,26 +52,45 @@ bool ManagerGetConnectionSuccess::operator()() const noexcept
   return Manager::WaiterAccessor::conn_get_success(*manager_, address_);
 }
 
+ManagerConnectionGroupIsDone::ManagerConnectionGroupIsDone(std::shared_ptr<const ConnectionGroup> group) noexcept
+  : group_{std::move(group)}
+{}
+
+bool ManagerConnectionGroupIsDone::operator()() const noexcept
+{
+  return group_->status != ConnectionGroup::Status::connecting;
+}
+
+ManagerConnectionGroupSuccess::ManagerConnectionGroupSuccess(std::shared_ptr<const ConnectionGroup> group) noexcept
+  : group_{std::move(group)}
+{}
+
+bool ManagerConnectionGroupSuccess::operator()() const noexcept
+{
+  return group_->status == ConnectionGroup::Status::connected;
+}
+
 ManagerIPSubscribeComplete::ManagerIPSubscribeComplete(
-  Manager& manager, const AddrPortPair& address, const std::vector<TagID>& tags, bool is_self_sub) noexcept
-  : manager_{&manager}, address_{address}, tags_{tags}, is_self_sub_{is_self_sub}
+  Manager& manager, const AddrPortPair& address, const std::vector<TagID>& tags) noexcept
+  : manager_{&manager}, address_{address}, tags_{tags}
 {}
 
 bool ManagerIPSubscribeComplete::operator()() const noexcept
 {
-  if (is_self_sub_) { return true; }
+  // Subscribing to this Manager finishes right away
+  if (Manager::WaiterAccessor::is_own_address(*manager_, address_)) { return true; }
   // Wait first to see if the connection has finished processing
   return Manager::WaiterAccessor::conn_is_complete(*manager_, address_);
 }
 
 ManagerIPSubscribeSuccess::ManagerIPSubscribeSuccess(
-  Manager& manager, const AddrPortPair& address, const std::vector<TagID>& tags, bool is_self_sub) noexcept
-  : manager_{&manager}, address_{address}, tags_{tags}, is_self_sub_{is_self_sub}
+  Manager& manager, const AddrPortPair& address, const std::vector<TagID>& tags) noexcept
+  : manager_{&manager}, address_{address}, tags_{tags}
 {}
 
 bool ManagerIPSubscribeSuccess::operator()() const noexcept
 {
-  return is_self_sub_
+  return Manager::WaiterAccessor::is_own_address(*manager_, address_)
       || (Manager::WaiterAccessor::conn_get_success(*manager_, address_)
       && Manager::WaiterAccessor::subscribe_is_done(*manager_, tags_));
 }
@@ -6,6 +6,7 @@
 
 #include "skywing_core/types.hpp"
 
+#include <memory>
 #include <vector>
 
 namespace skywing {
@@ -13,6 +14,7 @@ class Manager;
 
 namespace internal {
 class ReduceGroupBase;
+struct ConnectionGroup;
 
 class ManagerSubscribeIsDone {
 public:
@@ -64,28 +66,44 @@ private:
   AddrPortPair address_;
 }; // class ManagerGetConnectionSuccess
 
+class ManagerConnectionGroupIsDone {
+public:
+  explicit ManagerConnectionGroupIsDone(std::shared_ptr<const ConnectionGroup> group) noexcept;
+  bool operator()() const noexcept;
+
+private:
+  std::shared_ptr<const ConnectionGroup> group_;
+}; // class ManagerConnectionGroupIsDone
+
+class ManagerConnectionGroupSuccess {
+public:
+  explicit ManagerConnectionGroupSuccess(std::shared_ptr<const ConnectionGroup> group) noexcept;
+  bool operator()() const noexcept;
+
+private:
+  std::shared_ptr<const ConnectionGroup> group_;
+}; // class ManagerConnectionGroupSuccess
+
 class ManagerIPSubscribeComplete {
 public:
-  ManagerIPSubscribeComplete(Manager& manager, const AddrPortPair& address, const std::vector<TagID>& tags, bool is_self_sub) noexcept;
+  ManagerIPSubscribeComplete(Manager& manager, const AddrPortPair& address, const std::vector<TagID>& tags) noexcept;
   bool operator()() const noexcept;
 
 private:
   Manager* manager_;
   AddrPortPair address_;
   std::vector<TagID> tags_;
-  bool is_self_sub_;
 };
 
 class ManagerIPSubscribeSuccess {
 public:
-  ManagerIPSubscribeSuccess(Manager& manager, const AddrPortPair& address, const std::vector<TagID>& tags, bool is_self_sub) noexcept;
+  ManagerIPSubscribeSuccess(Manager& manager, const AddrPortPair& address, const std::vector<TagID>& tags) noexcept;
   bool operator()() const noexcept;
 
 private:
   Manager* manager_;
   AddrPortPair address_;
   std::vector<TagID> tags_;
-  bool is_self_sub_;
 };
 } // namespace internal
 } // namespace skywing
@@ -38,14 +38,8 @@ std::vector<std::byte> finalize_message(capnp::MallocMessageBuilder& builder) no
   return buffer_data;
 }
 
-void set_publish_data(
-  cpnpro::PublishData::Builder to_set,
-  const VersionID version,
-  const TagID& tag_id,
-  gsl::span<const PublishValueVariant> value) noexcept
+void set_publish_value(cpnpro::PublishData::Builder to_set, gsl::span<const PublishValueVariant> value) noexcept
 {
-  to_set.setVersion(version);
-  to_set.setTagID(tag_id);
   auto publish_value = to_set.initValue(value.size());
   for (int i = 0; i < value.size(); ++i) {
     std::visit(
@@ -58,6 +52,17 @@ void set_publish_data(
   }
 }
 
+void set_publish_data(
+  cpnpro::PublishData::Builder to_set,
+  const VersionID version,
+  const TagID& tag_id,
+  gsl::span<const PublishValueVariant> value) noexcept
+{
+  to_set.setVersion(version);
+  to_set.setTagID(tag_id);
+  set_publish_value(to_set, value);
+}
+
 template<typename InitFunc, typename MessageType, typename VecValueType>
 void set_vector(const InitFunc& init_func, MessageType msg, const std::vector<VecValueType>& values) noexcept
 {
@@ -78,37 +83,72 @@ std::vector<std::byte>
   return finalize_message(builder);
 }
 
-std::vector<std::byte>
-  make_greeting(const MachineID& from, const std::vector<MachineID>& neighbors, const std::uint16_t port) noexcept
+std::vector<std::byte> make_publish(
+  const VersionID version, const TagNumber tag_number, gsl::span<const PublishValueVariant> value) noexcept
+{
+  assert(tag_number != no_tag_number);
+  capnp::MallocMessageBuilder builder;
+  auto message = builder.initRoot<cpnpro::StatusMessage>().initPublishData();
+  message.setVersion(version);
+  message.setTagNumber(tag_number);
+  set_publish_value(message, value);
+  return finalize_message(builder);
+}
+
+std::vector<std::byte> make_tag_binding(const TagNumber tag_number, const TagID& tag_id) noexcept
+{
+  capnp::MallocMessageBuilder builder;
+  auto message = builder.initRoot<cpnpro::StatusMessage>().initTagBinding();
+  message.setTagNumber(tag_number);
+  message.setTagID(tag_id);
+  return finalize_message(builder);
+}
+
+std::vector<std::byte> make_greeting(
+  const MachineID& from,
+  const std::vector<MachineID>& neighbors,
+  const std::uint16_t port,
+  const std::string& host_id) noexcept
 {
   capnp::MallocMessageBuilder builder;
   auto message = builder.initRoot<cpnpro::StatusMessage>().initGreeting();
   message.setFrom(from);
   set_vector(&decltype(message)::initNeighbors, message, neighbors);
   message.setPort(port);
+  message.setHostID(host_id);
   return finalize_message(builder);
 }
 
-std::vector<std::byte> make_goodbye() noexcept
+std::vector<std::byte> make_shared_memory_offer(const std::string& segment_name) noexcept
 {
   capnp::MallocMessageBuilder builder;
-  builder.initRoot<cpnpro::StatusMessage>().setGoodbye();
+  auto message = builder.initRoot<cpnpro::StatusMessage>().initSharedMemoryOffer();
+  message.setSegmentName(segment_name);
+  return finalize_message(builder);
+}
+
+std::vector<std::byte> make_shared_memory_switch(const bool accepted) noexcept
+{
+  capnp::MallocMessageBuilder builder;
+  auto message = builder.initRoot<cpnpro::StatusMessage>().initSharedMemorySwitch();
+  message.setAccepted(accepted);
   return finalize_message(builder);
 }
 
-std::vector<std::byte> make_new_neighbor(const MachineID& neighbor) noexcept
+std::vector<std::byte> make_goodbye() noexcept
 {
   capnp::MallocMessageBuilder builder;
-  auto message = builder.initRoot<cpnpro::StatusMessage>().initNewNeighbor();
-  message.setNeighborID(neighbor);
+  builder.initRoot<cpnpro::StatusMessage>().setGoodbye();
   return finalize_message(builder);
 }
 
-std::vector<std::byte> make_remove_neighbor(const MachineID& neighbor) noexcept
+std::vector<std::byte>
+  make_neighbor_update(const std::vector<MachineID>& added, const std::vector<MachineID>& removed) noexcept
 {
   capnp::MallocMessageBuilder builder;
-  auto message = builder.initRoot<cpnpro::StatusMessage>().initRemoveNeighbor();
-  message.setNeighborID(neighbor);
+  auto message = builder.initRoot<cpnpro::StatusMessage>().initNeighborUpdate();
+  set_vector(&decltype(message)::initAdded, message, added);
+  set_vector(&decltype(message)::initRemoved, message, removed);
   return finalize_message(builder);
 }
 
@@ -123,7 +163,9 @@ std::vector<std::byte> make_report_publishers(
   const std::vector<TagID>& tags,
   const std::vector<std::vector<std::string>>& addresses,
   const std::vector<std::vector<MachineID>>& machines,
-  const std::vector<TagID>& locally_produced_tags) noexcept
+  const std::vector<TagID>& locally_produced_tags,
+  const PublisherTableVersion& table_version,
+  const std::uint64_t query_id) noexcept
 {
   const auto set_nested_vector = [&](auto builder, const auto& set_to) noexcept {
     for (std::size_t i = 0; i < tags.size(); ++i) {
@@ -145,11 +187,21 @@ std::vector<std::byte> make_report_publishers(
     msg_local_tags.set(i, locally_produced_tags[i]);
   }
   set_vector(&MType::initLocallyProducedTags, message, locally_produced_tags);
+  message.setEpoch(table_version.epoch);
+  message.setBaseVersion(table_version.base_version);
+  message.setVersion(table_version.version);
+  message.setQueryID(query_id);
   return finalize_message(builder);
 }
 
 std::vector<std::byte> make_get_publishers(
-  const std::vector<TagID>& tags, const std::vector<std::uint8_t>& publishers_needed, const bool ignore_cache) noexcept
+  const std::vector<TagID>& tags,
+  const std::vector<std::uint8_t>& publishers_needed,
+  const bool ignore_cache,
+  const std::uint64_t known_epoch,
+  const std::uint64_t known_version,
+  const std::uint64_t query_id,
+  const std::uint16_t ttl) noexcept
 {
   assert(tags.size() == publishers_needed.size());
   capnp::MallocMessageBuilder builder;
@@ -157,6 +209,10 @@ std::vector<std::byte> make_get_publishers(
   set_vector(&decltype(message)::initTags, message, tags);
   set_vector(&decltype(message)::initPublishersNeeded, message, publishers_needed);
   message.setIgnoreCache(ignore_cache);
+  message.setKnownEpoch(known_epoch);
+  message.setKnownVersion(known_version);
+  message.setQueryID(query_id);
+  message.setTtl(ttl);
   return finalize_message(builder);
 }
 
@@ -1,11 +1,13 @@
 #ifndef SKYNET_INTERNAL_MESSAGE_CREATORS_HPP
 #define SKYNET_INTERNAL_MESSAGE_CREATORS_HPP
 
+#include "skywing_core/internal/tag_interner.hpp"
 #include "skywing_core/types.hpp"
 
 #include "gsl/span"
 
 #include <cstddef>
+#include <string>
 #include <vector>
 
 namespace skywing::internal {
@@ -14,28 +16,62 @@ namespace skywing::internal {
 std::vector<std::byte>
   make_publish(const VersionID version, const TagID& tag_id, gsl::span<const PublishValueVariant> value) noexcept;
 
+/** \brief Create data for a publish that refers to the tag by number
+ *
+ * The receiver must have been sent a binding for the number beforehand.
+ */
+std::vector<std::byte> make_publish(
+  const VersionID version, TagNumber tag_number, gsl::span<const PublishValueVariant> value) noexcept;
+
+/** \brief Create data for binding a tag to a number
+ */
+std::vector<std::byte> make_tag_binding(TagNumber tag_number, const TagID& tag_id) noexcept;
+
 /** \brief Create data for a greeting
  */
-std::vector<std::byte>
-  make_greeting(const MachineID& from, const std::vector<MachineID>& neighbors, std::uint16_t port) noexcept;
+std::vector<std::byte> make_greeting(
+  const MachineID& from,
+  const std::vector<MachineID>& neighbors,
+  std::uint16_t port,
+  const std::string& host_id) noexcept;
 
-/** \brief Create data for a goodbyte
+/** \brief Create data for offering a shared memory segment to a peer on the same host
  */
-std::vector<std::byte> make_goodbye() noexcept;
+std::vector<std::byte> make_shared_memory_offer(const std::string& segment_name) noexcept;
+
+/** \brief Create data for answering a shared memory offer
+ */
+std::vector<std::byte> make_shared_memory_switch(bool accepted) noexcept;
 
-/** \brief Create data for a new neighbor notification
+/** \brief Create data for a goodbyte
  */
-std::vector<std::byte> make_new_neighbor(const MachineID& neighbor) noexcept;
+std::vector<std::byte> make_goodbye() noexcept;
 
-/** \brief Create data for a removed neighbor notification
+/** \brief Create data for a batch of changes to the sender's neighbors
  */
-std::vector<std::byte> make_remove_neighbor(const MachineID& neighbor) noexcept;
+std::vector<std::byte>
+  make_neighbor_update(const std::vector<MachineID>& added, const std::vector<MachineID>& removed) noexcept;
 
 /** \brief Create data for a heartbeat
  */
 std::vector<std::byte> make_heartbeat() noexcept;
 
+/** \brief Where a report of publishers fits in the sender's publisher table
+ */
+struct PublisherTableVersion {
+  // Tells runs of the sender apart
+  std::uint64_t epoch;
+
+  // The version the report is the changes since, zero for the whole table
+  std::uint64_t base_version;
+
+  // The version of the table the report brings the receiver up to
+  std::uint64_t version;
+};
+
 /** \brief Create data for returning information on tag publishers
+ *
+ * query_id is the request for publishers this answers, zero if none.
  *
  * TODO: This can be made more efficient by directly iterating over the map
  * and just grabbing the information from there; not sure how to make it
@@ -45,12 +81,24 @@ std::vector<std::byte> make_report_publishers(
   const std::vector<TagID>& tags,
   const std::vector<std::vector<std::string>>& addresses,
   const std::vector<std::vector<MachineID>>& machines,
-  const std::vector<TagID>& locally_produced_tags) noexcept;
+  const std::vector<TagID>& locally_produced_tags,
+  const PublisherTableVersion& table_version,
+  std::uint64_t query_id) noexcept;
 
 /** \brief Create data for a request for producers of a tag
+ *
+ * known_epoch and known_version are how much of the receiver's publisher
+ * table the sender already has, zero if none.  query_id identifies the
+ * request everywhere it's forwarded, and ttl is how many more hops it may go.
  */
 std::vector<std::byte> make_get_publishers(
-  const std::vector<TagID>& tags, const std::vector<std::uint8_t>& publishers_needed, bool ignore_cache) noexcept;
+  const std::vector<TagID>& tags,
+  const std::vector<std::uint8_t>& publishers_needed,
+  bool ignore_cache,
+  std::uint64_t known_epoch,
+  std::uint64_t known_version,
+  std::uint64_t query_id,
+  std::uint16_t ttl) noexcept;
 
 /** \brief Create a message to join a reduce group
  */
@@ -1,6 +1,7 @@
 #ifndef SKYNET_INTERNAL_TAG_BUFFER_HPP
 #define SKYNET_INTERNAL_TAG_BUFFER_HPP
 
+#include "skywing_core/internal/capn_proto_wrapper.hpp"
 #include "skywing_core/internal/utility/type_list.hpp"
 #include "skywing_core/types.hpp"
 
@@ -131,11 +132,23 @@ public:
   /** \brief Adds data if the version is newer
    */
   void add(gsl::span<PublishValueVariant> value, const VersionID version) noexcept { return do_add(value, version); }
-  void add(gsl::span<const PublishValueVariant> value, const VersionID version) noexcept
+
+  /** \brief Copies a value published by a job on the same manager into the
+   * buffer if the version is newer
+   *
+   * Returns false without changing anything if the value has the wrong types.
+   */
+  bool add(gsl::span<const PublishValueVariant> value, const VersionID version) noexcept
   {
     return do_add(value, version);
   }
 
+  /** \brief Decodes a received value directly into the buffer if the version is newer
+   *
+   * Returns false without changing anything if the value has the wrong types.
+   */
+  bool add(const PublishData& data, const VersionID version) noexcept { return do_add(data, version); }
+
   /** \brief Resets the tag buffer to the default state
    */
   void reset() noexcept { do_reset(); }
@@ -146,7 +159,8 @@ private:
   virtual bool do_has_data() const noexcept = 0;
   virtual void* do_get() noexcept = 0;
   virtual void do_add(gsl::span<PublishValueVariant> value, const VersionID version) noexcept = 0;
-  virtual void do_add(gsl::span<const PublishValueVariant> value, const VersionID version) noexcept = 0;
+  virtual bool do_add(gsl::span<const PublishValueVariant> value, const VersionID version) noexcept = 0;
+  virtual bool do_add(const PublishData& data, const VersionID version) noexcept = 0;
   virtual void do_reset() noexcept = 0;
 }; // DiscardOldVersionTagBufferBase
 
@@ -173,12 +187,24 @@ private:
     }
   }
 
-  void do_add(gsl::span<const PublishValueVariant> value, const VersionID version) noexcept override
+  bool do_add(gsl::span<const PublishValueVariant> value, const VersionID version) noexcept override
   {
+    if (!detail::span_is_valid<Ts...>(value, std::index_sequence_for<Ts...>{})) { return false; }
     if (version > this->stored_version_ || this->stored_version_ == tag_no_data) {
       this->stored_version_ = version;
       value_ = detail::make_value<Ts...>(value, std::index_sequence_for<Ts...>{});
     }
+    return true;
+  }
+
+  bool do_add(const PublishData& data, const VersionID version) noexcept override
+  {
+    if (!data.holds_types<Ts...>()) { return false; }
+    if (version > this->stored_version_ || this->stored_version_ == tag_no_data) {
+      this->stored_version_ = version;
+      data.read_value_into<Ts...>(value_);
+    }
+    return true;
   }
 
   void do_reset() noexcept override
@@ -0,0 +1,61 @@
+#ifndef SKYNET_INTERNAL_TAG_INTERNER_HPP
+#define SKYNET_INTERNAL_TAG_INTERNER_HPP
+
+#include "skywing_core/internal/utility/mutex_guarded.hpp"
+#include "skywing_core/types.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+
+namespace skywing::internal {
+/** \brief Number that stands in for a tag on the wire once it has been bound
+ */
+using TagNumber = std::uint32_t;
+
+/** \brief The number used when the tag is sent as text instead
+ */
+inline constexpr TagNumber no_tag_number = 0;
+
+/** \brief Hands out a number for each tag that is sent
+ *
+ * Numbers are never reused, so a number always refers to the same tag for
+ * the lifetime of the Manager that sent it.  This lets one encoded message
+ * be shared between every connection; each connection only has to make sure
+ * the binding was sent before the first message that uses it.
+ *
+ * Safe to use from multiple threads; jobs look up numbers once per tag and
+ * cache them.  The Manager also numbers the tags its jobs subscribe to, so
+ * that received data can be routed by number.
+ */
+class TagInterner {
+public:
+  /** \brief Returns the number for the tag, assigning one if it's new
+   */
+  TagNumber intern(const TagID& tag) noexcept
+  {
+    auto [numbers, lock] = numbers_.get();
+    (void)lock;
+    const auto [iter, inserted] = numbers.try_emplace(tag, next_number_);
+    if (inserted) { ++next_number_; }
+    return iter->second;
+  }
+
+  /** \brief Returns the number for the tag, or no_tag_number if it hasn't
+   * been given one
+   */
+  TagNumber find(const TagID& tag) const noexcept
+  {
+    auto [numbers, lock] = numbers_.get();
+    (void)lock;
+    const auto iter = numbers.find(tag);
+    return iter == numbers.cend() ? no_tag_number : iter->second;
+  }
+
+private:
+  MutexGuarded<std::unordered_map<TagID, TagNumber>> numbers_;
+  // Guarded by the same mutex as numbers_
+  TagNumber next_number_ = no_tag_number + 1;
+}; // class TagInterner
+} // namespace skywing::internal
+
+#endif // SKYNET_INTERNAL_TAG_INTERNER_HPP
@@ -0,0 +1,72 @@
+#ifndef SKYNET_INTERNAL_UTILITY_MPSC_QUEUE_HPP
+#define SKYNET_INTERNAL_UTILITY_MPSC_QUEUE_HPP
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace skywing::internal {
+/** \brief Unbounded lock-free queue with any number of producers and one consumer
+ *
+ * Producers never block each other or the consumer; a push is an allocation
+ * and an atomic exchange.  The consumer may briefly see the queue as empty
+ * while a push is in progress, so producers should signal the consumer after
+ * pushing rather than relying on it to spin.
+ */
+template<typename T>
+class MpscQueue {
+public:
+  MpscQueue() noexcept : head_{new Node{}}, tail_{head_.load(std::memory_order_relaxed)} {}
+
+  ~MpscQueue()
+  {
+    while (pop()) {
+      // empty
+    }
+    delete tail_;
+  }
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+  MpscQueue(MpscQueue&&) = delete;
+  MpscQueue& operator=(MpscQueue&&) = delete;
+
+  /** \brief Adds a value to the end of the queue; may be called from any thread
+   */
+  void push(T value) noexcept
+  {
+    Node* const node = new Node{};
+    node->value.emplace(std::move(value));
+    Node* const prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  /** \brief Removes the value at the front of the queue; only the consumer may call this
+   */
+  std::optional<T> pop() noexcept
+  {
+    Node* const next = tail_->next.load(std::memory_order_acquire);
+    if (next == nullptr) { return std::nullopt; }
+    // next becomes the new placeholder node, so its value is moved out
+    T to_ret = std::move(*next->value);
+    next->value.reset();
+    delete tail_;
+    tail_ = next;
+    return to_ret;
+  }
+
+private:
+  struct Node {
+    std::atomic<Node*> next{nullptr};
+    std::optional<T> value;
+  };
+
+  // Most recently pushed node, shared by the producers
+  std::atomic<Node*> head_;
+
+  // Placeholder node in front of the next value, only touched by the consumer
+  Node* tail_;
+}; // class MpscQueue
+} // namespace skywing::internal
+
+#endif // SKYNET_INTERNAL_UTILITY_MPSC_QUEUE_HPP
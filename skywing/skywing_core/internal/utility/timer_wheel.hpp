@@ -0,0 +1,225 @@
+#ifndef SKYNET_INTERNAL_UTILITY_TIMER_WHEEL_HPP
+#define SKYNET_INTERNAL_UTILITY_TIMER_WHEEL_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace skywing::internal {
+// The default resolution of a TimerWheel
+inline constexpr std::chrono::milliseconds default_timer_wheel_tick{10};
+
+/** \brief Hierarchical timer wheel keyed by an identifier
+ *
+ * Each key has at most one deadline.  Deadlines are rounded up to the tick
+ * they fall in, so a timer never expires early but may expire up to a tick
+ * late.  Scheduling and cancelling are constant time, and advancing costs one
+ * step per elapsed tick plus the timers that expire or move down a level, no
+ * matter how many timers are scheduled.
+ *
+ * There are four levels of 64 slots each.  Deadlines further out than the top
+ * level covers are parked in it and rescheduled when it comes around.
+ */
+template<typename Key, typename Hash = std::hash<Key>>
+class TimerWheel {
+public:
+  using clock = std::chrono::steady_clock;
+
+  explicit TimerWheel(
+    const clock::duration tick = default_timer_wheel_tick, const clock::time_point start = clock::now()) noexcept
+    : tick_{tick}, start_{start}
+  {}
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  /** \brief Sets the deadline for a key, replacing any it already had
+   */
+  void schedule(const Key& key, const clock::time_point deadline) noexcept
+  {
+    const auto [iter, inserted] = timers_.try_emplace(key);
+    auto& timer = iter->second;
+    timer.expires = tick_at_or_after(deadline);
+    if (inserted) {
+      auto& slot = slot_for(timer.expires);
+      timer.slot = &slot;
+      timer.pos = slot.insert(slot.end(), key);
+    }
+    else {
+      move_to_slot(timer);
+    }
+  }
+
+  /** \brief Removes the deadline for a key, if it had one
+   */
+  void cancel(const Key& key) noexcept
+  {
+    const auto iter = timers_.find(key);
+    if (iter == timers_.end()) { return; }
+    iter->second.slot->erase(iter->second.pos);
+    timers_.erase(iter);
+  }
+
+  /** \brief Returns true if the key has a deadline
+   */
+  bool contains(const Key& key) const noexcept { return timers_.find(key) != timers_.cend(); }
+
+  /** \brief Returns the number of keys with a deadline
+   */
+  std::size_t size() const noexcept { return timers_.size(); }
+
+  /** \brief Returns true if no key has a deadline
+   */
+  bool empty() const noexcept { return timers_.empty(); }
+
+  /** \brief Returns a time no later than the earliest deadline, or nothing if
+   * there are none
+   *
+   * Deadlines within a level of the current time are reported to the tick.
+   * Ones further out are reported as the time the wheel has to move them
+   * closer, so advancing then may not expire anything.
+   */
+  std::optional<clock::time_point> next_expiry() const noexcept
+  {
+    if (timers_.empty()) { return {}; }
+    std::optional<std::uint64_t> next;
+    for (std::uint64_t i = 0; i < slots_per_level; ++i) {
+      if (!levels_[0][(next_tick_ + i) & slot_mask].empty()) {
+        next = next_tick_ + i;
+        break;
+      }
+    }
+    for (std::size_t level = 1; level < num_levels; ++level) {
+      // Nothing in a slot can expire before it's next brought down a level
+      const auto span = std::uint64_t{1} << (level * bits_per_level);
+      const auto next_wrap = (next_tick_ + span - 1) / span * span;
+      for (std::uint64_t i = 0; i < slots_per_level; ++i) {
+        const auto cascade_tick = next_wrap + i * span;
+        if (next && cascade_tick >= *next) { break; }
+        if (!levels_[level][level_index(cascade_tick, level)].empty()) {
+          next = cascade_tick;
+          break;
+        }
+      }
+    }
+    return start_ + tick_ * static_cast<clock::rep>(*next);
+  }
+
+  /** \brief Moves the wheel up to the given time, removing and returning the
+   * keys whose deadlines have passed
+   *
+   * The keys are no longer scheduled when returned, so they can be scheduled
+   * again right away.
+   */
+  std::vector<Key> advance(const clock::time_point now) noexcept
+  {
+    std::vector<Key> expired;
+    if (now < start_) { return expired; }
+    const auto now_tick = static_cast<std::uint64_t>((now - start_) / tick_);
+    if (timers_.empty()) {
+      // Nothing to walk past
+      next_tick_ = std::max(next_tick_, now_tick + 1);
+      return expired;
+    }
+    while (next_tick_ <= now_tick) {
+      const auto index = next_tick_ & slot_mask;
+      // Bring the next stretch of each higher level down as the one below wraps
+      for (std::size_t level = 1; level < num_levels; ++level) {
+        if (level_index(next_tick_, level - 1) != 0) { break; }
+        cascade(levels_[level][level_index(next_tick_, level)]);
+      }
+      auto& slot = levels_[0][index];
+      while (!slot.empty()) {
+        auto& timer = timers_.find(slot.front())->second;
+        if (timer.expires > next_tick_) {
+          // Was parked because it was too far out
+          move_to_slot(timer);
+          continue;
+        }
+        expired.push_back(std::move(slot.front()));
+        slot.pop_front();
+        timers_.erase(expired.back());
+      }
+      ++next_tick_;
+    }
+    return expired;
+  }
+
+private:
+  static constexpr std::size_t bits_per_level = 6;
+  static constexpr std::size_t slots_per_level = std::size_t{1} << bits_per_level;
+  static constexpr std::uint64_t slot_mask = slots_per_level - 1;
+  static constexpr std::size_t num_levels = 4;
+
+  using Slot = std::list<Key>;
+
+  struct Timer {
+    // The tick the timer expires on
+    std::uint64_t expires = 0;
+
+    // Where the key is
+    Slot* slot = nullptr;
+    typename Slot::iterator pos;
+  };
+
+  static std::uint64_t level_index(const std::uint64_t tick, const std::size_t level) noexcept
+  {
+    return (tick >> (level * bits_per_level)) & slot_mask;
+  }
+
+  std::uint64_t tick_at_or_after(const clock::time_point time) const noexcept
+  {
+    if (time <= start_) { return 0; }
+    const auto since_start = time - start_;
+    const auto ticks = static_cast<std::uint64_t>(since_start / tick_);
+    return since_start % tick_ == clock::duration::zero() ? ticks : ticks + 1;
+  }
+
+  Slot& slot_for(const std::uint64_t expires) noexcept
+  {
+    // Already due, so it goes out on the next tick
+    if (expires < next_tick_) { return levels_[0][next_tick_ & slot_mask]; }
+    const auto delta = expires - next_tick_;
+    for (std::size_t level = 0; level < num_levels; ++level) {
+      if (delta < (std::uint64_t{1} << ((level + 1) * bits_per_level))) {
+        return levels_[level][level_index(expires, level)];
+      }
+    }
+    // Too far out; park it as far as the top level goes
+    const auto parked = next_tick_ + (std::uint64_t{1} << (num_levels * bits_per_level)) - 1;
+    return levels_[num_levels - 1][level_index(parked, num_levels - 1)];
+  }
+
+  void move_to_slot(Timer& timer) noexcept
+  {
+    auto& slot = slot_for(timer.expires);
+    slot.splice(slot.end(), *timer.slot, timer.pos);
+    timer.slot = &slot;
+  }
+
+  void cascade(Slot& slot) noexcept
+  {
+    while (!slot.empty()) {
+      move_to_slot(timers_.find(slot.front())->second);
+    }
+  }
+
+  clock::duration tick_;
+  clock::time_point start_;
+
+  // The first tick that hasn't been walked past yet
+  std::uint64_t next_tick_ = 0;
+
+  std::array<std::array<Slot, slots_per_level>, num_levels> levels_;
+  std::unordered_map<Key, Timer, Hash> timers_;
+}; // class TimerWheel
+} // namespace skywing::internal
+
+#endif // SKYNET_INTERNAL_UTILITY_TIMER_WHEEL_HPP
@@ -0,0 +1,65 @@
+#include "skywing_core/internal/utility/worker_pool.hpp"
+
+#include <cassert>
+
+namespace skywing::internal {
+WorkerPool::WorkerPool(const std::size_t num_workers) noexcept
+{
+  assert(num_workers >= 1);
+  for (std::size_t worker = 1; worker < num_workers; ++worker) {
+    helpers_.emplace_back([this, worker]() { helper_loop(worker); });
+  }
+}
+
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard lock{mutex_};
+    stopping_ = true;
+  }
+  start_cv_.notify_all();
+  for (auto& helper : helpers_) {
+    helper.join();
+  }
+}
+
+void WorkerPool::run(const std::size_t num_items, void* const fn, const CallFn call) noexcept
+{
+  {
+    std::lock_guard lock{mutex_};
+    next_item_.store(0, std::memory_order_relaxed);
+    num_items_ = num_items;
+    fn_ = fn;
+    call_ = call;
+    helpers_running_ = helpers_.size();
+    ++generation_;
+  }
+  start_cv_.notify_all();
+  work(0);
+  std::unique_lock lock{mutex_};
+  done_cv_.wait(lock, [&]() { return helpers_running_ == 0; });
+}
+
+void WorkerPool::work(const std::size_t worker) noexcept
+{
+  for (auto item = next_item_.fetch_add(1, std::memory_order_relaxed); item < num_items_;
+       item = next_item_.fetch_add(1, std::memory_order_relaxed)) {
+    call_(fn_, item, worker);
+  }
+}
+
+void WorkerPool::helper_loop(const std::size_t worker) noexcept
+{
+  std::uint64_t last_generation = 0;
+  std::unique_lock lock{mutex_};
+  while (true) {
+    start_cv_.wait(lock, [&]() { return stopping_ || generation_ != last_generation; });
+    if (stopping_) { return; }
+    last_generation = generation_;
+    lock.unlock();
+    work(worker);
+    lock.lock();
+    if (--helpers_running_ == 0) { done_cv_.notify_one(); }
+  }
+}
+} // namespace skywing::internal
@@ -0,0 +1,88 @@
+#ifndef SKYNET_INTERNAL_UTILITY_WORKER_POOL_HPP
+#define SKYNET_INTERNAL_UTILITY_WORKER_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace skywing::internal {
+/** \brief A fixed set of threads for splitting a batch of independent work
+ *
+ * The thread calling for_each takes part in the work, so a pool with one
+ * worker has no extra threads and simply runs everything inline.
+ */
+class WorkerPool {
+public:
+  /** \brief Creates a pool that spreads work across num_workers threads,
+   * including the caller
+   */
+  explicit WorkerPool(std::size_t num_workers) noexcept;
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+  WorkerPool(WorkerPool&&) = delete;
+  WorkerPool& operator=(WorkerPool&&) = delete;
+
+  /** \brief Returns the number of threads work is spread across
+   */
+  std::size_t num_workers() const noexcept { return helpers_.size() + 1; }
+
+  /** \brief Calls f(item, worker) for every item in [0, num_items) and
+   * returns once all of the calls have finished
+   *
+   * worker is in [0, num_workers()) and no two calls with the same worker run
+   * at the same time, so it can index per-worker scratch space.  Only one
+   * thread may call this at a time.
+   */
+  template<typename F>
+  void for_each(const std::size_t num_items, F&& f) noexcept
+  {
+    using FnType = std::remove_reference_t<F>;
+    if (helpers_.empty() || num_items < 2) {
+      for (std::size_t i = 0; i < num_items; ++i) {
+        f(i, std::size_t{0});
+      }
+      return;
+    }
+    run(num_items, static_cast<void*>(&f), [](void* fn, const std::size_t item, const std::size_t worker) noexcept {
+      (*static_cast<FnType*>(fn))(item, worker);
+    });
+  }
+
+private:
+  using CallFn = void (*)(void*, std::size_t, std::size_t) noexcept;
+
+  // Hands the work to the helpers and works alongside them until it's all done
+  void run(std::size_t num_items, void* fn, CallFn call) noexcept;
+
+  // Claims items until there are none left
+  void work(std::size_t worker) noexcept;
+
+  void helper_loop(std::size_t worker) noexcept;
+
+  std::mutex mutex_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+
+  // Incremented for each batch of work; guarded by mutex_
+  std::uint64_t generation_ = 0;
+  std::size_t helpers_running_ = 0;
+  bool stopping_ = false;
+
+  // The current batch; only changed while no helpers are running
+  std::atomic<std::size_t> next_item_{0};
+  std::size_t num_items_ = 0;
+  void* fn_ = nullptr;
+  CallFn call_ = nullptr;
+
+  std::vector<std::thread> helpers_;
+}; // class WorkerPool
+} // namespace skywing::internal
+
+#endif // SKYNET_INTERNAL_UTILITY_WORKER_POOL_HPP
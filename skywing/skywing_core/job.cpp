@@ -3,6 +3,7 @@
 #include "skywing_core/internal/utility/logging.hpp"
 #include "skywing_core/manager.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 namespace skywing {
@@ -10,10 +11,14 @@ std::thread Job::Accessor::run(Job& j) noexcept
 {
   return std::thread{[&j]() {
     j.to_run_(j, ManagerHandle{*j.manager_});
-    // Re-use the buffer mutex here
-    std::lock_guard lock{j.bufs_.mutex()};
-    // Signify that the work is done
-    j.to_run_ = nullptr;
+    {
+      // Re-use the buffer mutex here
+      std::lock_guard lock{j.bufs_.mutex()};
+      // Signify that the work is done
+      j.to_run_ = nullptr;
+    }
+    // The manager sleeps until there's work, so let it know it can clean up
+    Manager::JobAccessor::job_finished(*j.manager_);
   }};
 }
 
@@ -34,45 +39,55 @@ const std::unordered_map<TagID, gsl::span<const std::uint8_t>>& Job::tags_produc
   return tags_produced_;
 }
 
-bool Job::process_data(const TagID& tag_id, gsl::span<const PublishValueVariant> data, const VersionID version) noexcept
+template<typename Add>
+bool Job::add_to_buffer(
+  const internal::TagNumber tag_number, const TagID& tag_id, const VersionID version, Add&& add) noexcept
 {
-  auto [buffers, lock] = bufs_.get();
-  (void)lock;
-  const auto loc = buffers.find(tag_id);
+  std::lock_guard lock{bufs_.mutex()};
+  const auto loc = bufs_by_number_.find(tag_number);
   // Not subscribed; don't do anything, but not an error
-  if (loc == buffers.cend()) {
+  if (loc == bufs_by_number_.cend()) {
     SKYNET_TRACE_LOG(
-      "\"{}\", job \"{}\" discarded tag \"{}\", version {}, data {}, due to not being subscribed",
+      "\"{}\", job \"{}\" discarded tag \"{}\", version {}, due to not being subscribed",
       manager_->id(),
       id_,
       tag_id,
-      version,
-      data);
+      version);
     return true;
   }
-  // If the types are wrong then something went wrong
-  const auto comparer = [](std::uint8_t lhs, const PublishValueVariant& rhs) { return lhs == rhs.index(); };
-  const auto& expected_types = loc->second.expected_types;
-  if (!std::equal(expected_types.cbegin(), expected_types.cend(), data.cbegin(), data.cend(), comparer)) {
+  auto& tag_info = *loc->second;
+  if (!add(*tag_info.buffer)) {
     SKYNET_WARN_LOG(
-      "\"{}\", job \"{}\" discarded tag \"{}\", version {}, data {}, due to it having the wrong type index",
+      "\"{}\", job \"{}\" discarded tag \"{}\", version {}, due to it having the wrong type index",
       manager_->id(),
       id_,
       tag_id,
-      version,
-      data);
-    loc->second.error_occurred = TagInfo::Error::incorrect_type;
+      version);
+    tag_info.error_occurred = TagInfo::Error::incorrect_type;
     data_buffer_modified_cv_.notify_all();
     return false;
   }
-  SKYNET_TRACE_LOG(
-    "\"{}\", job \"{}\" accepted tag \"{}\", version {}, data {}", manager_->id(), id_, tag_id, version, data);
-  // Otherwise just make it the current value
-  loc->second.buffer->add(data, version);
+  SKYNET_TRACE_LOG("\"{}\", job \"{}\" accepted tag \"{}\", version {}", manager_->id(), id_, tag_id, version);
   data_buffer_modified_cv_.notify_all();
   return true;
 }
 
+bool Job::process_data(
+  const internal::TagNumber tag_number, const TagID& tag_id, const internal::PublishData& data) noexcept
+{
+  const auto version = data.version();
+  return add_to_buffer(tag_number, tag_id, version, [&](auto& buffer) { return buffer.add(data, version); });
+}
+
+bool Job::process_local_data(
+  const internal::TagNumber tag_number,
+  const TagID& tag_id,
+  const gsl::span<const PublishValueVariant> values,
+  const VersionID version) noexcept
+{
+  return add_to_buffer(tag_number, tag_id, version, [&](auto& buffer) { return buffer.add(values, version); });
+}
+
 bool Job::tag_has_subscription(const internal::PublishTagBase& tag) const noexcept
 {
   auto [buffers, lock] = bufs_.get();
@@ -113,7 +128,7 @@ void Job::mark_tag_as_dead(const TagID& tag_id) noexcept
   data_buffer_modified_cv_.notify_all();
 }
 
-void Job::publish_impl(const internal::PublishTagBase& tag, const gsl::span<PublishValueVariant> to_send) noexcept
+bool Job::publish_impl(const internal::PublishTagBase& tag, const gsl::span<PublishValueVariant> to_send) noexcept
 {
   assert(
     tags_produced_.find(tag.id()) != tags_produced_.cend()
@@ -121,9 +136,68 @@ void Job::publish_impl(const internal::PublishTagBase& tag, const gsl::span<Publ
   // assert(tags_produced_.find(tag.id())->second == to_send.index()
   //   && "Attempted to publish the wrong type on a tag!");
   // Find / create the last version and obtain a reference to it
-  auto& last_version = last_published_version_.try_emplace(tag.id(), internal::tag_no_data).first->second;
-  last_version = last_version + 1;
-  Manager::JobAccessor::publish(*manager_, last_version, tag.id(), to_send);
+  auto& info = published_tags_[tag.id()];
+  // Only the first publish on a tag needs to ask the manager for its number
+  if (info.tag_number == internal::no_tag_number) {
+    info.tag_number = Manager::JobAccessor::tag_number(*manager_, tag.id());
+    std::lock_guard g{bufs_.mutex()};
+    if (latest_only_tags_.count(tag.id()) != 0) { info.policy = PublishPolicy::latest_only; }
+  }
+  info.last_version = info.last_version + 1;
+  // Work out when the rate limit lets this go out
+  std::chrono::steady_clock::time_point send_at;
+  if (info.min_interval != std::chrono::steady_clock::duration::zero()) {
+    const auto now = std::chrono::steady_clock::now();
+    // A held back value uses up the time it was sent at
+    if (info.holding && now >= info.next_send) {
+      info.next_send += info.min_interval;
+      info.holding = false;
+    }
+    if (now >= info.next_send) { info.next_send = now + info.min_interval; }
+    else {
+      // Replaces the value already held back, if there is one
+      if (info.holding) { ++info.suppressed; }
+      info.holding = true;
+      send_at = info.next_send;
+    }
+  }
+  // Serialize here so the manager thread only has to route the bytes
+  publish_queue_.push(QueuedPublish{
+    tag.id(),
+    info.tag_number,
+    std::make_shared<const std::vector<std::byte>>(
+      internal::make_publish(info.last_version, info.tag_number, to_send)),
+    info.policy,
+    send_at,
+    info.last_version,
+    // Serialized already, so the values can be handed over
+    std::vector<PublishValueVariant>(
+      std::make_move_iterator(to_send.begin()), std::make_move_iterator(to_send.end()))});
+  Manager::JobAccessor::publish_queued(*manager_);
+  return !publish_congested_.load(std::memory_order_relaxed);
+}
+
+void Job::limit_publish_interval(
+  const internal::PublishTagBase& tag, const std::chrono::steady_clock::duration min_interval) noexcept
+{
+  assert(
+    tags_produced_.find(tag.id()) != tags_produced_.cend()
+    && "Attempted to limit the rate of a tag that was not declared for publishing!");
+  auto& info = published_tags_[tag.id()];
+  info.min_interval = std::max(min_interval, std::chrono::steady_clock::duration::zero());
+}
+
+void Job::limit_publish_rate(const internal::PublishTagBase& tag, const double max_hz) noexcept
+{
+  assert(max_hz > 0);
+  limit_publish_interval(
+    tag, std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>{1.0 / max_hz}));
+}
+
+std::uint64_t Job::suppressed_publishes(const internal::PublishTagBase& tag) const noexcept
+{
+  const auto iter = published_tags_.find(tag.id());
+  return iter == published_tags_.cend() ? 0 : iter->second.suppressed;
 }
 
 // Private implementation of public functions
@@ -164,8 +238,11 @@ void Job::init_or_update_subscribe(
               tag.expected_types(),
               0,
               TagInfo::Error::no_error});
+    if (inserted) {
+      bufs_by_number_.emplace(Manager::JobAccessor::tag_number(*manager_, tag.id()), &iter->second);
+    }
     // Already exists - update the connection id and reset the buffer / error
-    if (!inserted) {
+    else {
       ++iter->second.connection_id;
       // Reset it to a default constructed buffer
       iter->second.buffer->reset();
@@ -178,7 +255,7 @@ Waiter<void> Job::get_subscribe_future(const gsl::span<const internal::PublishTa
 {
   std::vector<TagID> tag_ids(tags.size());
   std::transform(tags.cbegin(), tags.cend(), tag_ids.begin(), [](const internal::PublishTagBase& t) { return t.id(); });
-  return Manager::JobAccessor::subscribe(*manager_, tag_ids);
+  return Manager::JobAccessor::subscribe(*manager_, *this, tag_ids);
 }
 
 Waiter<bool> Job::get_ip_subscribe_future(
@@ -192,15 +269,17 @@ Waiter<bool> Job::get_ip_subscribe_future(
       "Invalid address \"{}\" for Job::ip_subscribe!  Note that a port must be specified.\n", address);
     std::exit(1);
   }
-  return Manager::JobAccessor::ip_subscribe(*manager_, addr_pair, tag_ids);
+  return Manager::JobAccessor::ip_subscribe(*manager_, *this, addr_pair, tag_ids);
 }
 
-void Job::declare_publication_intent_impl(gsl::span<const internal::PublishTagBase> tags) noexcept
+void Job::declare_publication_intent_impl(
+  gsl::span<const internal::PublishTagBase> tags, const PublishPolicy policy) noexcept
 {
   const std::vector<TagID> tag_ids = [&]() {
     std::lock_guard g{bufs_.mutex()};
     for (const auto& tag : tags) {
       tags_produced_.try_emplace(tag.id(), tag.expected_types());
+      if (policy == PublishPolicy::latest_only) { latest_only_tags_.insert(tag.id()); }
     }
     std::vector<TagID> tag_ids(tags.size());
     std::transform(
@@ -210,12 +289,14 @@ void Job::declare_publication_intent_impl(gsl::span<const internal::PublishTagBa
   Manager::JobAccessor::report_new_publish_tags(*manager_, tag_ids);
 }
 
-void Job::declare_publication_intent_impl(const gsl::span<const internal::PublishTagBase* const> tags) noexcept
+void Job::declare_publication_intent_impl(
+  const gsl::span<const internal::PublishTagBase* const> tags, const PublishPolicy policy) noexcept
 {
   const std::vector<TagID> tag_ids = [&]() {
     std::lock_guard g{bufs_.mutex()};
     for (const auto& tag : tags) {
       tags_produced_.try_emplace(tag->id(), tag->expected_types());
+      if (policy == PublishPolicy::latest_only) { latest_only_tags_.insert(tag->id()); }
     }
     std::vector<TagID> tag_ids(tags.size());
     std::transform(
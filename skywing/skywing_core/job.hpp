@@ -1,9 +1,12 @@
 #ifndef SKYNET_JOB_HPP
 #define SKYNET_JOB_HPP
 
+#include "skywing_core/internal/devices/send_queue.hpp"
 #include "skywing_core/internal/manager_waiter_callables.hpp"
 #include "skywing_core/internal/reduce_group.hpp"
 #include "skywing_core/internal/tag_buffer.hpp"
+#include "skywing_core/internal/tag_interner.hpp"
+#include "skywing_core/internal/utility/mpsc_queue.hpp"
 #include "skywing_core/internal/utility/mutex_guarded.hpp"
 #include "skywing_core/internal/utility/type_list.hpp"
 #include "skywing_core/types.hpp"
@@ -11,6 +14,7 @@
 
 #include "gsl/span"
 
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <cstdint>
@@ -20,6 +24,7 @@
 #include <optional>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace skywing {
@@ -104,20 +109,68 @@ public:
   using BufferType = internal::DiscardOldVersionTagBuffer<Ts...>;
 };
 
+/** \brief How the versions published on a tag are sent to subscribers
+ */
+enum class PublishPolicy {
+  /// Every version is sent
+  every_version,
+
+  /// A version still waiting to go out to a subscriber that isn't keeping up
+  /// is replaced by the next one, so slow subscribers get the newest value
+  /// without the backlog growing
+  latest_only
+}; // enum class PublishPolicy
+
 /** \brief Job with known tags
  */
 class Job {
 public:
+  /** \brief A publish that has been serialized by the job and is waiting for
+   * the manager to deliver it
+   */
+  struct QueuedPublish {
+    TagID tag_id;
+    internal::TagNumber tag_number;
+    internal::SharedMessage message;
+    PublishPolicy policy;
+
+    // When the tag's rate limit allows this to be sent; anything published
+    // for the tag before then replaces it
+    std::chrono::steady_clock::time_point send_at;
+
+    // The values that were serialized into message, so jobs on the same
+    // manager don't have to decode them again
+    VersionID version;
+    std::vector<PublishValueVariant> values;
+  };
+
   // Allow the manager to call process data and run
   struct Accessor {
   private:
     friend class Manager;
     friend class Job;
 
+    static internal::MpscQueue<QueuedPublish>& publish_queue(Job& j) noexcept { return j.publish_queue_; }
+
+    static void set_publish_congested(Job& j, const bool congested) noexcept
+    {
+      j.publish_congested_.store(congested, std::memory_order_relaxed);
+    }
+
     static bool process_data(
-      Job& j, const TagID& tag, gsl::span<const PublishValueVariant> data, const VersionID version) noexcept
+      Job& j, const internal::TagNumber tag_number, const TagID& tag, const internal::PublishData& data) noexcept
     {
-      return j.process_data(tag, data, version);
+      return j.process_data(tag_number, tag, data);
+    }
+
+    static bool process_local_data(
+      Job& j,
+      const internal::TagNumber tag_number,
+      const TagID& tag,
+      const gsl::span<const PublishValueVariant> values,
+      const VersionID version) noexcept
+    {
+      return j.process_local_data(tag_number, tag, values, version);
     }
 
     static std::thread run(Job& j) noexcept;
@@ -148,20 +201,31 @@ public:
   template<typename... Ts>
   //  requires (... && std::is_base_of_v<internal::PublishTagBase, Ts>)
   void declare_publication_intent(const Ts&... tags) noexcept
+  {
+    declare_publication_intent(PublishPolicy::every_version, tags...);
+  }
+
+  /** \brief Declare intent to publish on tags with the given policy for
+   * sending their versions
+   */
+  template<typename... Ts>
+  void declare_publication_intent(const PublishPolicy policy, const Ts&... tags) noexcept
   {
     const std::array<const internal::PublishTagBase*, sizeof...(Ts)> tag_ptrs{&tags...};
     declare_publication_intent_impl(
-      gsl::span<const internal::PublishTagBase* const>{tag_ptrs.data(), static_cast<gsl::index>(tag_ptrs.size())});
+      gsl::span<const internal::PublishTagBase* const>{tag_ptrs.data(), static_cast<gsl::index>(tag_ptrs.size())},
+      policy);
   }
 
   /** \brief Declare publication intent for a range
    */
   template<typename Range>
-  void declare_publication_intent_range(const Range& tags) noexcept
+  void declare_publication_intent_range(
+    const Range& tags, const PublishPolicy policy = PublishPolicy::every_version) noexcept
   // requires std::ranges::contiguous_range<Range>
   {
     declare_publication_intent_impl(
-      gsl::span<const internal::PublishTagBase>{tags.data(), static_cast<gsl::index>(tags.size())});
+      gsl::span<const internal::PublishTagBase>{tags.data(), static_cast<gsl::index>(tags.size())}, policy);
   }
 
   /** \brief Retrieves the specified version for the tag, or latest if no version
@@ -297,33 +361,62 @@ public:
   /** \brief Publish data on the passed tag
    *
    * Will abort in debug mode if the tag has not been declared for publication
+   *
+   * The value is serialized here and queued for the manager thread, so this
+   * never waits on the manager or the network.
+   *
+   * \return False if the outbound queue to any subscriber was congested when
+   * the manager last delivered this job's data.  The data is still sent, but
+   * the job should publish less often until this returns true again.
    */
   template<typename... PublishTagTypes, typename... ArgTypes>
-  void publish(const PublishTag<PublishTagTypes...>& tag, ArgTypes&&... values) noexcept
+  bool publish(const PublishTag<PublishTagTypes...>& tag, ArgTypes&&... values) noexcept
   {
     static_assert(
       sizeof...(PublishTagTypes) == sizeof...(ArgTypes) && (... && std::is_convertible_v<ArgTypes, PublishTagTypes>),
       "Argument values can not be converted to tag types!");
     std::array<PublishValueVariant, sizeof...(ArgTypes)> variants{
       static_cast<PublishTagTypes>(std::forward<ArgTypes>(values))...};
-    publish_impl(tag, gsl::span<PublishValueVariant>{variants});
+    return publish_impl(tag, gsl::span<PublishValueVariant>{variants});
   }
 
   template<typename... PublishTagTypes, typename... TupleTypes>
-  void publish(const PublishTag<PublishTagTypes...>& tag, const std::tuple<TupleTypes...>& value_tuple) noexcept
+  bool publish(const PublishTag<PublishTagTypes...>& tag, const std::tuple<TupleTypes...>& value_tuple) noexcept
   {
-    const auto apply_to = [&](const auto&... values) { publish(tag, values...); };
-    std::apply(apply_to, value_tuple);
+    const auto apply_to = [&](const auto&... values) { return publish(tag, values...); };
+    return std::apply(apply_to, value_tuple);
   }
 
   template<typename... PublishTagTypes, typename... TupleTypes>
-  void publish_tuple(const PublishTag<PublishTagTypes...>& tag,
+  bool publish_tuple(const PublishTag<PublishTagTypes...>& tag,
                      const std::tuple<TupleTypes...>& value_tuple) noexcept
   {
-    const auto apply_to = [&](const auto&... values) { publish(tag, values...); };
-    std::apply(apply_to, value_tuple);
+    const auto apply_to = [&](const auto&... values) { return publish(tag, values...); };
+    return std::apply(apply_to, value_tuple);
   }
 
+  /** \brief Limits how often values published on a tag are sent
+   *
+   * A value published less than min_interval after the last one sent is held
+   * back until the interval is up, and only the newest value held back is
+   * sent then; the ones it replaced are counted as suppressed.  An interval of
+   * zero, the default, sends every value right away.
+   */
+  void limit_publish_interval(
+    const internal::PublishTagBase& tag, std::chrono::steady_clock::duration min_interval) noexcept;
+
+  /** \brief Limits values published on a tag to being sent at most max_hz
+   * times a second
+   *
+   * \pre max_hz > 0
+   */
+  void limit_publish_rate(const internal::PublishTagBase& tag, double max_hz) noexcept;
+
+  /** \brief Returns the number of values published on a tag that were never
+   * sent because a newer one replaced them while held back by the rate limit
+   */
+  std::uint64_t suppressed_publishes(const internal::PublishTagBase& tag) const noexcept;
+
   /** \brief Returns true if the job is finished, false if it is not
    */
   bool is_finished() const noexcept;
@@ -425,14 +518,33 @@ private:
    */
   bool has_data_no_lock(const internal::PublishTagBase& tag) noexcept;
 
-  /** \brief Processes the raw information sent from a job on another instance
+  /** \brief Processes the information sent from a job, decoding it directly into the tag's buffer
    *
+   * \param tag_number The manager's number for the tag, which the buffer is looked up by
    * \param tag The id of the tag the data was sent with
-   * \param data The data sent on the tag
-   * \param version The version of the data
+   * \param data The message holding the data and version
    * \return True if processing went fine, false if there was an error
    */
-  bool process_data(const TagID& tag_id, gsl::span<const PublishValueVariant> data, VersionID version) noexcept;
+  bool process_data(internal::TagNumber tag_number, const TagID& tag_id, const internal::PublishData& data) noexcept;
+
+  /** \brief Processes a value published by a job on the same manager, copying
+   * it into the tag's buffer without going through the serialized message
+   *
+   * \param tag_number The manager's number for the tag, which the buffer is looked up by
+   * \param tag The id of the tag the data was published on
+   * \param values The published values
+   * \param version The version of the published values
+   * \return True if processing went fine, false if there was an error
+   */
+  bool process_local_data(
+    internal::TagNumber tag_number,
+    const TagID& tag_id,
+    gsl::span<const PublishValueVariant> values,
+    VersionID version) noexcept;
+
+  // Shared lookup and error handling for the above; add(buffer) does the actual insert
+  template<typename Add>
+  bool add_to_buffer(internal::TagNumber tag_number, const TagID& tag_id, VersionID version, Add&& add) noexcept;
 
   /** \brief Marks a tag as dead due to connection issues
    *
@@ -440,7 +552,7 @@ private:
    */
   void mark_tag_as_dead(const TagID& tag_id) noexcept;
 
-  void publish_impl(const internal::PublishTagBase& tag, gsl::span<PublishValueVariant> to_send) noexcept;
+  bool publish_impl(const internal::PublishTagBase& tag, gsl::span<PublishValueVariant> to_send) noexcept;
 
   void init_or_update_subscribe(
     gsl::span<const internal::PublishTagBase> tags,
@@ -451,8 +563,9 @@ private:
   Waiter<bool> get_ip_subscribe_future(
     const std::string& address, const gsl::span<const internal::PublishTagBase> tags) noexcept;
 
-  void declare_publication_intent_impl(gsl::span<const internal::PublishTagBase> tags) noexcept;
-  void declare_publication_intent_impl(gsl::span<const internal::PublishTagBase* const> tags) noexcept;
+  void declare_publication_intent_impl(gsl::span<const internal::PublishTagBase> tags, PublishPolicy policy) noexcept;
+  void declare_publication_intent_impl(
+    gsl::span<const internal::PublishTagBase* const> tags, PublishPolicy policy) noexcept;
 
   // void unsubscribe_impl(const TagID& tag_id) noexcept;
 
@@ -492,8 +605,34 @@ private:
   };
   MutexGuarded<std::unordered_map<std::string, TagInfo>> bufs_;
 
-  // The last version published on each tag
-  std::unordered_map<std::string, VersionID> last_published_version_;
+  // The same buffers by the manager's number for each tag, so that received
+  // data doesn't have to hash the tag's name; guarded by the same mutex as
+  // bufs_, and pointers are stable as bufs_ is node based
+  std::unordered_map<internal::TagNumber, TagInfo*> bufs_by_number_;
+
+  // The last version published on each tag, the number it's sent with, and
+  // its rate limit
+  struct PublishedTagInfo {
+    VersionID last_version = internal::tag_no_data;
+    internal::TagNumber tag_number = internal::no_tag_number;
+    PublishPolicy policy = PublishPolicy::every_version;
+
+    // The shortest time allowed between sends, and the earliest the next one can go
+    std::chrono::steady_clock::duration min_interval{0};
+    std::chrono::steady_clock::time_point next_send;
+
+    // If a value is held back to be sent at next_send
+    bool holding = false;
+
+    std::uint64_t suppressed = 0;
+  };
+  std::unordered_map<std::string, PublishedTagInfo> published_tags_;
+
+  // Serialized publishes waiting for the manager thread
+  internal::MpscQueue<QueuedPublish> publish_queue_;
+
+  // If the manager found a congested subscriber the last time it sent this job's data
+  std::atomic<bool> publish_congested_{false};
 
   // The manager that this job is working with
   Manager* manager_;
@@ -504,6 +643,9 @@ private:
   // The list of tags this job produces and the expected types
   std::unordered_map<TagID, gsl::span<const std::uint8_t>> tags_produced_;
 
+  // The tags declared with PublishPolicy::latest_only
+  std::unordered_set<TagID> latest_only_tags_;
+
   // Condition variable when data is added to buffers or an error occurs
   std::condition_variable data_buffer_modified_cv_;
 }; // Class Job
@@ -3,12 +3,33 @@
 #include "skywing_core/internal/utility/algorithms.hpp"
 #include "skywing_core/internal/utility/logging.hpp"
 
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <limits>
+#include <random>
+#include <utility>
 
 namespace skywing {
 namespace {
+// How long the event loop waits while there is time-driven work outstanding,
+// such as searching for publishers with backoff
+constexpr std::chrono::milliseconds pending_work_poll_interval{5};
+
+// Wait until something is ready
+constexpr std::chrono::milliseconds no_timeout{-1};
+
+// Picks a nonzero ID that another run is unlikely to have picked; zero is
+// reserved for having nothing
+std::uint64_t make_random_id() noexcept
+{
+  std::random_device device;
+  std::mt19937_64 rng{(std::uint64_t{device()} << 32) ^ device()
+                      ^ static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count())};
+  std::uniform_int_distribution<std::uint64_t> dist{1};
+  return dist(rng);
+}
+
 // This is more of a stop-gap than anything
 std::vector<std::uint8_t> make_need_one_pub(const std::vector<TagID>& tags) noexcept
 {
@@ -22,41 +43,263 @@ ExternalManager::ExternalManager(
   const MachineID& id,
   const std::vector<MachineID>& neighbors,
   Manager& manager,
-  const std::uint16_t port) noexcept
+  const std::uint16_t port,
+  ReceiveBuffer receive_buffer) noexcept
   : id_{id}
-  , last_heard_{std::chrono::steady_clock::now()}
-  , neighbors_{neighbors}
+  , failure_detector_{[&]() noexcept {
+    // Heartbeats can come up to half an interval late as that's how often the
+    // neighbor checks, and a neighbor that just went idle only sends its first
+    // heartbeat an interval after its last data
+    const auto interval = Manager::ExternalManagerAccessor::heartbeat_interval(manager);
+    return PhiAccrualFailureDetector{interval, 2 * interval, interval / 4, std::chrono::steady_clock::now()};
+  }()}
+  , last_sent_{std::chrono::steady_clock::now()}
+  , neighbors_{neighbors.cbegin(), neighbors.cend()}
+  , send_queue_{[&]() noexcept {
+    const auto [high, low] = Manager::ExternalManagerAccessor::send_queue_watermarks(manager);
+    return SendQueue{high, low};
+  }()}
   , manager_{&manager}
   , port_{port}
 {
   conns_.push_back(std::move(conn));
+  receive_buffers_.push_back(std::move(receive_buffer));
 }
 
 void ExternalManager::get_and_handle_messages() noexcept
 {
-  //  std::cout << "Agent " << manager_->id() << " handling neighbor messages from " << id() << " with dead status" << dead_ << std::endl;
+  receive_data_messages();
+  handle_received_messages();
+}
+
+void ExternalManager::receive_data_messages() noexcept
+{
   if (dead_) { return; }
-  for (auto& socket_comm : conns_)
-  {
-    //    std::cout << "Agent " << manager_->id() << " about to try to get a message from " << id() << std::endl;
-    while (auto handler = try_to_get_message(socket_comm)) {
-      // Update the last time something was heard
-      last_heard_ = std::chrono::steady_clock::now();
-      // Handle the message
-      //      std::cout << "Agent " << manager_->id() << " got a message from " << id() << ", about to handle it. " << std::endl;
-      handle_message(*handler);
-      //      std::cout << "Agent " << manager_->id() << " finished handling message from " << id() << std::endl;
+  for (std::size_t i = 0; i < conns_.size() && !dead_; ++i) {
+    const bool okay = wake_up_conn_ == i ? drain_wake_ups(conns_[i]) : receive_from(conns_[i], receive_buffers_[i]);
+    if (!okay) { dead_ = true; }
+  }
+  if (shared_memory_receive_buffer_ && !dead_) { receive_from_shared_memory(); }
+}
+
+void ExternalManager::handle_received_messages() noexcept
+{
+  // Indexed since handling a message can add connections
+  for (std::size_t i = 0; i < receive_buffers_.size() && !dead_; ++i) {
+    if (wake_up_conn_ == i) { continue; }
+    while (handle_next_message(receive_buffers_[i]) && !dead_) {
+      if (shared_memory_receive_buffer_ && !wake_up_conn_) {
+        // That was the neighbor's switch, so only wake-ups follow it here
+        wake_up_conn_ = i;
+        receive_buffers_[i].clear();
+        // The neighbor doesn't wait for the switch to arrive before using
+        // shared memory, so data may be waiting without a wake-up
+        receive_from_shared_memory();
+        break;
+      }
+    }
+  }
+  if (shared_memory_receive_buffer_) {
+    while (!dead_ && handle_next_message(*shared_memory_receive_buffer_)) {
+      // empty
     }
   }
-  //  std::cout << "Agent " << manager_->id() << " done handling messages from the live " << id() << std::endl;
 }
 
-void ExternalManager::send_message(const std::vector<std::byte>& c) noexcept
+void ExternalManager::handle_messages_received_early() noexcept
 {
   if (dead_) { return; }
+  handle_data_frames(receive_buffers_.back());
+  handle_received_messages();
+}
+
+bool ExternalManager::handle_next_message(ReceiveBuffer& receive_buffer) noexcept
+{
+  const auto frame = receive_buffer.next_frame();
+  if (!frame) { return false; }
+  auto handler = MessageHandler::try_to_create(*frame);
+  // The frame is consumed either way, so a message that can't be decoded is just skipped
+  if (!handler) { return true; }
+  handle_message(*handler);
+  return true;
+}
+
+void ExternalManager::receive_from_shared_memory() noexcept
+{
+  // Shared memory is only woken when it runs dry, so keep reading until it
+  // does, but not forever if the neighbor keeps up with this
+  std::size_t bytes_read = 0;
+  while (bytes_read < default_shared_memory_ring_size) {
+    const auto before = shared_memory_receive_buffer_->bytes_buffered();
+    if (shared_memory_receive_buffer_->fill(*shared_memory_) != ConnectionError::no_error) { break; }
+    bytes_read += shared_memory_receive_buffer_->bytes_buffered() - before;
+    handle_data_frames(*shared_memory_receive_buffer_);
+    if (dead_) { return; }
+  }
+  if (bytes_read != 0) { failure_detector_.heartbeat(std::chrono::steady_clock::now()); }
+  wake_shared_memory_peer();
+  // Come back for the rest on the next pass
+  if (shared_memory_->has_input()) { Manager::ExternalManagerAccessor::wake(*manager_); }
+}
+
+bool ExternalManager::drain_wake_ups(SocketCommunicator& conn) noexcept
+{
+  std::array<std::byte, 64> discarded;
+  while (true) {
+    const auto read_or_error = conn.read_some(discarded.data(), discarded.size());
+    if (const auto err = std::get_if<ConnectionError>(&read_or_error)) {
+      if (*err == ConnectionError::would_block) { return true; }
+      SKYNET_TRACE_LOG("\"{}\" setting {} to dead because connection has closed", manager_->id(), id_);
+      return false;
+    }
+  }
+}
+
+void ExternalManager::wake_shared_memory_peer() noexcept
+{
+  // A wake-up can't be mixed in with the rest of the messages on the socket,
+  // so it's held until they are all sent
+  if (socket_send_tail_ || !shared_memory_->take_wake_up_needed()) { return; }
+  const std::array<std::byte, 1> wake_up{};
+  // A full socket means there are wake-ups the neighbor hasn't seen yet anyway
+  (void)conns_[0].send_some(wake_up.data(), wake_up.size());
+}
+
+void ExternalManager::offer_shared_memory() noexcept
+{
+  assert(!shared_memory_);
+  shared_memory_ = SharedMemoryTransport::create();
+  if (!shared_memory_) { return; }
+  SKYNET_TRACE_LOG("\"{}\" offering shared memory \"{}\" to \"{}\"", manager_->id(), shared_memory_->name(), id_);
+  send_message(make_shared_memory_offer(shared_memory_->name()));
+}
+
+void ExternalManager::switch_to_shared_memory_sends() noexcept
+{
+  send_message(make_shared_memory_switch(true));
+  socket_send_tail_.emplace(std::move(send_queue_));
+  const auto [high, low] = Manager::ExternalManagerAccessor::send_queue_watermarks(*manager_);
+  send_queue_ = SendQueue{high, low};
+  shared_memory_->start_sending();
+}
+
+bool ExternalManager::handle_shared_memory_offer(const SharedMemoryOffer& msg) noexcept
+{
+  // Only one side offers, and only once
+  if (shared_memory_) {
+    SKYNET_WARN_LOG("\"{}\" received an unexpected shared memory offer from \"{}\"", manager_->id(), id_);
+    return false;
+  }
+  shared_memory_ = SharedMemoryTransport::open(msg.segment_name());
+  if (!shared_memory_) {
+    SKYNET_DEBUG_LOG("\"{}\" declining shared memory from \"{}\"", manager_->id(), id_);
+    send_message(make_shared_memory_switch(false));
+    return true;
+  }
+  switch_to_shared_memory_sends();
+  return true;
+}
+
+bool ExternalManager::handle_shared_memory_switch(const SharedMemorySwitch& msg) noexcept
+{
+  if (!shared_memory_ || shared_memory_->is_receiving() || (!msg.accepted() && shared_memory_->is_sending())) {
+    SKYNET_WARN_LOG("\"{}\" received an unexpected shared memory switch from \"{}\"", manager_->id(), id_);
+    return false;
+  }
+  if (!msg.accepted()) {
+    shared_memory_.reset();
+    return true;
+  }
+  SKYNET_TRACE_LOG("\"{}\" switched to shared memory with \"{}\"", manager_->id(), id_);
+  // The neighbor has it mapped, so the name isn't needed anymore
+  shared_memory_->unlink();
+  if (!shared_memory_->is_sending()) { switch_to_shared_memory_sends(); }
+  shared_memory_->start_receiving();
+  shared_memory_receive_buffer_.emplace();
+  return true;
+}
+
+void ExternalManager::send_message(const std::vector<std::byte>& c, const MessagePriority priority) noexcept
+{
+  if (dead_) { return; }
+  send_message(std::make_shared<const std::vector<std::byte>>(c), priority);
+}
+
+void ExternalManager::send_message(SharedMessage c, const MessagePriority priority) noexcept
+{
+  if (dead_) { return; }
+  send_queue_.push(std::move(c), priority);
+  last_sent_ = std::chrono::steady_clock::now();
+}
+
+void ExternalManager::send_publish(
+  const TagID& tag_id, const TagNumber tag_number, SharedMessage c, const PublishPolicy policy) noexcept
+{
+  if (dead_) { return; }
+  // The binding goes in the same queue, so it always arrives before the data
+  if (sent_tag_bindings_.insert(tag_number).second) { send_message(make_tag_binding(tag_number, tag_id)); }
+  if (policy == PublishPolicy::latest_only) {
+    if (send_queue_.push_latest(std::move(c), tag_number)) {
+      SKYNET_TRACE_LOG("\"{}\" replaced an unsent version of tag \"{}\" for {}", manager_->id(), tag_id, id_);
+    }
+    last_sent_ = std::chrono::steady_clock::now();
+    return;
+  }
+  send_message(std::move(c));
+}
+
+void ExternalManager::flush_send_queue() noexcept
+{
+  flush_send_queue(Manager::ExternalManagerAccessor::send_statistics(*manager_));
+}
+
+void ExternalManager::flush_send_queue(SendStatistics& stats) noexcept
+{
+  if (dead_) { return; }
+  const auto flush = [&](SendQueue& queue, Transport& conn) {
+    if (queue.empty()) { return true; }
+    const auto err = queue.flush(conn, stats);
+    if (err != ConnectionError::no_error && err != ConnectionError::would_block) {
+      SKYNET_TRACE_LOG("\"{}\" setting {} to dead due to an error while sending", manager_->id(), id_);
+      dead_ = true;
+      return false;
+    }
+    return true;
+  };
   // TODO: Maybe don't just use the first socket communicator if there are multiple
-  // TODO: Pretty sure this will incorrectly set to dead upon ConnectionError::would_block
-  if (conns_[0].send_message(c.data(), c.size()) != ConnectionError::no_error) { dead_ = true; }
+  if (socket_send_tail_) {
+    if (!flush(*socket_send_tail_, conns_[0])) { return; }
+    if (socket_send_tail_->empty()) { socket_send_tail_.reset(); }
+  }
+  // The neighbor only reads shared memory after the switch arrives on the
+  // socket, so this doesn't have to wait for the tail to go out
+  if (shared_memory_ && shared_memory_->is_sending()) {
+    if (!flush(send_queue_, *shared_memory_)) { return; }
+    wake_shared_memory_peer();
+  }
+  else if (!flush(send_queue_, conns_[0])) {
+    return;
+  }
+  update_write_interest();
+}
+
+bool ExternalManager::send_queue_congested() const noexcept { return send_queue_.is_congested(); }
+
+void ExternalManager::set_send_queue_watermarks(const std::size_t high_watermark, const std::size_t low_watermark) noexcept
+{
+  send_queue_.set_watermarks(high_watermark, low_watermark);
+}
+
+void ExternalManager::update_write_interest() noexcept
+{
+  // Shared memory sends are retried on every pass, and the neighbor wakes this
+  // side when it makes room
+  const bool sending_on_socket = !shared_memory_ || !shared_memory_->is_sending();
+  const bool want_write = socket_send_tail_ || (sending_on_socket && !send_queue_.empty());
+  if (want_write != want_write_) {
+    want_write_ = want_write;
+    Manager::ExternalManagerAccessor::set_want_write(*manager_, conns_[0].native_handle(), want_write);
+  }
 }
 
 MachineID ExternalManager::id() const noexcept { return id_; }
@@ -72,59 +315,75 @@ bool ExternalManager::is_subscribed_to(const TagID& tag) const noexcept
   return remote_subscriptions_.find(tag) != remote_subscriptions_.cend();
 }
 
-bool ExternalManager::should_ask_for_tags() const noexcept
-{
-  return !pending_tag_request_ && std::chrono::steady_clock::now() > request_tags_time_;
-}
-
-bool ExternalManager::has_pending_tag_request() const noexcept { return pending_tag_request_; }
+bool ExternalManager::has_pending_tag_request() const noexcept { return pending_query_id_ != 0; }
 
 void ExternalManager::reset_backoff_counter() noexcept
 {
   backoff_counter_ = 0;
-  request_tags_time_ = calc_next_request_time();
+  update_request_tags_time();
 }
 
 void ExternalManager::increase_backoff_counter() noexcept
 {
   ++backoff_counter_;
-  request_tags_time_ = calc_next_request_time();
+  update_request_tags_time();
 }
 
 bool ExternalManager::has_neighbor(const MachineID& id) const noexcept
 {
-  const auto loc = std::lower_bound(neighbors_.cbegin(), neighbors_.cend(), id);
-  return loc != neighbors_.cend() && *loc == id;
+  return neighbors_.find(id) != neighbors_.cend();
 }
 
-void ExternalManager::send_heartbeat_if_past_interval(std::chrono::milliseconds interval) noexcept
+std::chrono::steady_clock::time_point ExternalManager::send_heartbeat_if_idle(
+  const std::chrono::milliseconds interval, const std::chrono::steady_clock::time_point now) noexcept
 {
-  using namespace std::chrono;
-  const auto time_expired = steady_clock::now() - last_heard_;
-  if (time_expired >= interval) {
-    // Try to send a message
-    send_message(make_heartbeat());
-    // This count as hearing from the device
-    last_heard_ = steady_clock::now();
-  }
+  // A heartbeat would only queue up behind whatever was sent last, so it
+  // can't tell the neighbor anything that wasn't already on its way
+  if (now - last_sent_ >= interval) { send_message(make_heartbeat(), MessagePriority::control); }
+  return last_sent_ + interval;
+}
+
+bool ExternalManager::appears_failed(const std::chrono::steady_clock::time_point now) const noexcept
+{
+  return failure_detector_.is_suspected(now);
 }
 
 void ExternalManager::find_publishers_for_tags(
-  const std::vector<TagID>& tags, const std::vector<std::uint8_t>& publishers_needed) noexcept
+  const std::vector<TagID>& tags, const std::vector<std::uint8_t>& publishers_needed, std::uint64_t query_id) noexcept
 {
   SKYNET_TRACE_LOG(
     "\"{}\" asking \"{}\" for tags {}{}",
     manager_->id(),
     id_,
     tags,
-    pending_tag_request_ ? ", but ignored due to already pending request" : "");
-  if (!pending_tag_request_) {
-    send_message(make_get_publishers(tags, publishers_needed, ignore_cache_on_next_request_));
-    ignore_cache_on_next_request_ = false;
-    pending_tag_request_ = true;
+    has_pending_tag_request() ? ", but ignored due to already pending request" : "");
+  if (!has_pending_tag_request()) {
+    if (query_id == 0) { query_id = Manager::ExternalManagerAccessor::start_publisher_query(*manager_); }
+    forward_publisher_query(
+      tags, publishers_needed, query_id, Manager::ExternalManagerAccessor::discovery_ttl(*manager_));
+    pending_query_id_ = query_id;
   }
 }
 
+void ExternalManager::forward_publisher_query(
+  const std::vector<TagID>& tags,
+  const std::vector<std::uint8_t>& publishers_needed,
+  const std::uint64_t query_id,
+  const std::uint16_t ttl) noexcept
+{
+  send_message(
+    make_get_publishers(
+      tags,
+      publishers_needed,
+      ignore_cache_on_next_request_,
+      remote_publisher_epoch_,
+      remote_publisher_version_,
+      query_id,
+      ttl),
+    MessagePriority::control);
+  ignore_cache_on_next_request_ = false;
+}
+
 std::string ExternalManager::address() const noexcept
 {
   const auto [ip_address, dummy] = conns_[0].ip_address_and_port();
@@ -139,6 +398,15 @@ AddrPortPair ExternalManager::address_pair() const noexcept
   return {ip_address, port_};
 }
 
+std::vector<int> ExternalManager::native_handles() const noexcept
+{
+  std::vector<int> to_ret(conns_.size());
+  std::transform(conns_.cbegin(), conns_.cend(), to_ret.begin(), [](const SocketCommunicator& conn) {
+    return conn.native_handle();
+  });
+  return to_ret;
+}
+
 // // Read some bytes from the connection, returning false if the read failed
 // bool ExternalManager::read_from_conn(std::byte* const buffer, const std::size_t count) noexcept
 // {
@@ -159,45 +427,56 @@ AddrPortPair ExternalManager::address_pair() const noexcept
 //   return true;
 // }
 
-std::optional<MessageHandler> ExternalManager::try_to_get_message(SocketCommunicator& socket_comm) noexcept
-{
-  //std::cout << "Agent " << manager_->id() << " trying to get messages from " << id() << std::endl;
-  const auto bytes_to_read_or_error = read_network_size(socket_comm);
-  //std::cout << "Agent " << manager_->id() << " got bytes to read from " << id() << std::endl;
-  if (std::holds_alternative<NetworkSizeType>(bytes_to_read_or_error)) {
-    //std::cout << "Agent " << manager_->id() << " about to read message size from " << id() << std::endl;
-    const auto bytes_to_read = *std::get_if<NetworkSizeType>(&bytes_to_read_or_error);
-    //std::cout << "Agent " << manager_->id() << " successfully read message size from " << id() << std::endl;
-    // Then read the actual message and parse it
-    if (const auto message_buffer = read_chunked(socket_comm, bytes_to_read); !message_buffer.empty()) {
-      //std::cout << "Agent " << manager_->id() << " read the actual message from " << id() << std::endl;
-      return MessageHandler::try_to_create(message_buffer);
-    }
-    else {
-      // Couldn't read the size bytes - bad message
-      SKYNET_TRACE_LOG("\"{}\" setting {} to dead due to bad message", manager_->id(), id_);
-      dead_ = true;
-      return {};
-    }
+bool ExternalManager::receive_from(SocketCommunicator& conn, ReceiveBuffer& receive_buffer) noexcept
+{
+  // Only one read per wake-up; if more is available the event loop will report
+  // the socket as readable again
+  const auto err = receive_buffer.fill(conn);
+  if (err == ConnectionError::closed) {
+    SKYNET_TRACE_LOG("\"{}\" setting {} to dead because connection has closed", manager_->id(), id_);
+    return false;
   }
-  else {
-    const auto err = *std::get_if<ConnectionError>(&bytes_to_read_or_error);
-    if (err == ConnectionError::closed)
-    {
-      SKYNET_TRACE_LOG("\"{}\" setting {} to dead because connection has closed", manager_->id(), id_);
-      dead_ = true;
+  if (err != ConnectionError::no_error && err != ConnectionError::would_block) {
+    SKYNET_TRACE_LOG(
+      "\"{}\" setting {} to dead because connection has some unknwon error, perhaps received an RST packer",
+      manager_->id(),
+      id_);
+    return false;
+  }
+  // Arrivals are only timed per read, which is plenty for spotting silence
+  if (err == ConnectionError::no_error) { failure_detector_.heartbeat(std::chrono::steady_clock::now()); }
+  handle_data_frames(receive_buffer);
+  return true;
+}
+
+void ExternalManager::handle_data_frames(ReceiveBuffer& receive_buffer) noexcept
+{
+  while (const auto frame = receive_buffer.peek_frame()) {
+    const auto handler = MessageHandler::try_to_create(*frame);
+    // A message that can't be decoded is just skipped
+    if (!handler) {
+      receive_buffer.pop_frame();
+      continue;
     }
-    else if (err != ConnectionError::would_block)
-    {
-      SKYNET_TRACE_LOG("\"{}\" setting {} to dead because connection has some unknwon error, perhaps received an RST packer", manager_->id(), id_);
+    bool is_data = false;
+    const auto okay = handler->do_callback(
+      [&](const PublishData& msg) {
+        is_data = true;
+        return handle_publish_data(msg);
+      },
+      [&](const TagBinding& msg) {
+        is_data = true;
+        return handle_tag_binding(msg);
+      },
+      [](...) { return true; });
+    // Stop at the first other message so that everything stays in order
+    if (!is_data) { return; }
+    receive_buffer.pop_frame();
+    if (!okay) {
+      SKYNET_TRACE_LOG("\"{}\" setting {} to dead because of an invalid data message", manager_->id(), id_);
       dead_ = true;
+      return;
     }
-    // we get here if attempting to read_network_size returned
-    // ConnectionError::would_block, which indicates there's the
-    // connection is fine and there's just nothing currently on the
-    // wire
-    //std::cout << "Agent " << manager_->id() << " didn't receive anything from " << id() << std::endl;
-    return {};
   }
 }
 
@@ -215,28 +494,17 @@ void ExternalManager::handle_message(MessageHandler& handle) noexcept
       dead_ = true;
       return true;
     },
-    [&](const NewNeighbor& msg) {
-      // Don't error if the neighbor is already present (as was previously
-      // done) as if a machine disconnects and then re-connects it can send a
-      // NewNeighbor message with a repeated ID
-      const auto loc = std::lower_bound(neighbors_.cbegin(), neighbors_.cend(), msg.neighbor_id());
-      SKYNET_TRACE_LOG(
-        "\"{}\" received new neighbor from \"{}\" with id \"{}\"", manager_->id(), id_, msg.neighbor_id());
-      // Insert it if it isn't already present
-      if (loc == neighbors_.cend() || *loc != msg.neighbor_id()) { neighbors_.insert(loc, msg.neighbor_id()); }
-      return true;
-    },
-    [&](const RemoveNeighbor& msg) {
+    [&](const NeighborUpdate& msg) {
+      const auto added = msg.added();
+      const auto removed = msg.removed();
       SKYNET_TRACE_LOG(
-        "\"{}\" received remove neighbor from \"{}\" with id \"{}\"", manager_->id(), id_, msg.neighbor_id());
-      const auto loc = std::lower_bound(neighbors_.begin(), neighbors_.end(), msg.neighbor_id());
-      // Neighbors that don't exist will often be reported if it's a shared neighbor and
-      // it has already been removed due to the goodbye message
-      if (loc != neighbors_.end()) {
-        // otherwise just remove it
-        using std::swap;
-        swap(*loc, neighbors_.back());
-        neighbors_.pop_back();
+        "\"{}\" received neighbor update from \"{}\" adding {} and removing {}", manager_->id(), id_, added, removed);
+      for (const auto& id : removed) {
+        neighbors_.erase(id);
+      }
+      for (const auto& id : added) {
+        // The update goes to every neighbor, including the one that was added
+        if (id != manager_->id()) { neighbors_.insert(id); }
       }
       return true;
     },
@@ -269,10 +537,28 @@ void ExternalManager::handle_message(MessageHandler& handle) noexcept
           }
         }
       }
+      // Reports only add publishers, so even one that doesn't follow on from
+      // what was applied before is used, but the whole table is asked for next
+      if (msg.base_version() == 0) {
+        remote_publisher_epoch_ = msg.epoch();
+        remote_publisher_version_ = msg.version();
+      }
+      else if (msg.epoch() == remote_publisher_epoch_ && msg.base_version() <= remote_publisher_version_) {
+        remote_publisher_version_ = std::max(remote_publisher_version_, msg.version());
+      }
+      else {
+        SKYNET_DEBUG_LOG(
+          "\"{}\" missed changes to the publishers known by \"{}\", asking for all of them", manager_->id(), id_);
+        remote_publisher_epoch_ = 0;
+        remote_publisher_version_ = 0;
+      }
+      // Mark there as not being a request out there and update the time to
+      // send out, before the manager looks at whether to ask again
+      if (msg.query_id() != 0 && msg.query_id() == pending_query_id_) {
+        pending_query_id_ = 0;
+        update_request_tags_time();
+      }
       Manager::ExternalManagerAccessor::add_publishers_and_propagate(*manager_, msg, *this);
-      // Mark there as not being a request out there and update the time to send out
-      pending_tag_request_ = false;
-      request_tags_time_ = calc_next_request_time();
       return true;
     },
     [&](const GetPublishers& msg) {
@@ -284,6 +570,13 @@ void ExternalManager::handle_message(MessageHandler& handle) noexcept
           return false;
         }
       }
+      // The remote may not have everything it was sent, such as after
+      // noticing it missed something, so start over with the whole table
+      if (
+        msg.known_version() == 0
+        || msg.known_epoch() != Manager::ExternalManagerAccessor::publisher_table_epoch(*manager_)) {
+        publisher_version_sent_ = 0;
+      }
       Manager::ExternalManagerAccessor::handle_get_publishers(*manager_, msg, *this);
       return true;
     },
@@ -312,10 +605,10 @@ void ExternalManager::handle_message(MessageHandler& handle) noexcept
       if (!tag_name_okay(msg.reduce_tag())) { return false; }
       return Manager::ExternalManagerAccessor::handle_report_reduce_disconnection(*manager_, msg, *this);
     },
-    [&](const PublishData& msg) {
-      if (!tag_name_okay(msg.tag_id())) { return false; }
-      return Manager::ExternalManagerAccessor::handle_publish_data(*manager_, msg, *this);
-    },
+    [&](const PublishData& msg) { return handle_publish_data(msg); },
+    [&](const TagBinding& msg) { return handle_tag_binding(msg); },
+    [&](const SharedMemoryOffer& msg) { return handle_shared_memory_offer(msg); },
+    [&](const SharedMemorySwitch& msg) { return handle_shared_memory_switch(msg); },
     [&](const SubscriptionNotice& msg) {
       SKYNET_TRACE_LOG(
         "\"{}\" received subscription notice from \"{}\" for tags {}, is unsubscribe: {}",
@@ -326,7 +619,8 @@ void ExternalManager::handle_message(MessageHandler& handle) noexcept
       const auto reject_notice = [&]([[maybe_unused]] const std::string& why) {
         SKYNET_TRACE_LOG("\"{}\" rejected subscription notice from \"{}\" as {}", manager_->id(), id_, why);
       };
-      for (const auto& tag : msg.tags()) {
+      const auto tags = msg.tags();
+      for (const auto& tag : tags) {
         if (!tag_name_okay(tag)) {
           reject_notice(fmt::format("invalid tag name \"{}\" given", tag));
           return false;
@@ -342,9 +636,10 @@ void ExternalManager::handle_message(MessageHandler& handle) noexcept
       if (!Manager::ExternalManagerAccessor::subscription_tags_are_produced(*manager_, msg)) {
         // TODO: Send a cancellation notice instead for the tags that aren't there
         // when this happens
-        reject_notice(fmt::format("machine does not produce asked for tags {}", msg.tags()));
+        reject_notice(fmt::format("machine does not produce asked for tags {}", tags));
         return false;
       }
+      Manager::ExternalManagerAccessor::add_remote_subscriber(*manager_, tags, *this);
       Manager::ExternalManagerAccessor::notify_subscriptions(*manager_);
       SKYNET_TRACE_LOG("\"{}\" accepted subscription notice from \"{}\"", manager_->id(), id_);
       return true;
@@ -362,6 +657,45 @@ void ExternalManager::handle_message(MessageHandler& handle) noexcept
   }
 }
 
+bool ExternalManager::handle_publish_data(const PublishData& msg) noexcept
+{
+  const auto tag_number = msg.tag_number();
+  if (tag_number == no_tag_number) {
+    const auto tag_id = msg.tag_id();
+    if (!tag_name_okay(tag_id)) { return false; }
+    const auto local_number = Manager::ExternalManagerAccessor::known_tag_number(*manager_, tag_id);
+    return Manager::ExternalManagerAccessor::handle_publish_data(*manager_, local_number, tag_id, msg, *this);
+  }
+  // Bound tags were checked when the binding arrived
+  const auto binding = received_tag_bindings_.find(tag_number);
+  if (binding == received_tag_bindings_.cend()) {
+    SKYNET_WARN_LOG("\"{}\" received data from \"{}\" for unbound tag number {}", manager_->id(), id_, tag_number);
+    return false;
+  }
+  return Manager::ExternalManagerAccessor::handle_publish_data(
+    *manager_, binding->second.local_number, binding->second.tag_id, msg, *this);
+}
+
+bool ExternalManager::handle_tag_binding(const TagBinding& msg) noexcept
+{
+  const auto tag_number = msg.tag_number();
+  auto tag_id = msg.tag_id();
+  if (tag_number == no_tag_number || !tag_name_okay(tag_id)) {
+    SKYNET_WARN_LOG(
+      "\"{}\" received invalid binding of tag \"{}\" to number {} from \"{}\"",
+      manager_->id(),
+      tag_id,
+      tag_number,
+      id_);
+    return false;
+  }
+  SKYNET_TRACE_LOG("\"{}\" bound tag \"{}\" to number {} for \"{}\"", manager_->id(), tag_id, tag_number, id_);
+  // Numbered once here so data on the tag is routed without hashing its name
+  const auto local_number = Manager::ExternalManagerAccessor::tag_number(*manager_, tag_id);
+  received_tag_bindings_.insert_or_assign(tag_number, ReceivedTagBinding{std::move(tag_id), local_number});
+  return true;
+}
+
 std::chrono::steady_clock::time_point ExternalManager::calc_next_request_time() const noexcept
 {
   using namespace std::chrono_literals;
@@ -371,6 +705,11 @@ std::chrono::steady_clock::time_point ExternalManager::calc_next_request_time()
     = backoff_counter_ >= backoff_times.size() ? backoff_times.back() : backoff_times[backoff_counter_];
   return std::chrono::steady_clock::now() + add_time;
 }
+
+void ExternalManager::update_request_tags_time() noexcept
+{
+  Manager::ExternalManagerAccessor::schedule_tag_request(*manager_, id_, calc_next_request_time());
+}
 } // namespace internal
 
 ////////////////////////////////////////////////
@@ -379,69 +718,155 @@ std::chrono::steady_clock::time_point ExternalManager::calc_next_request_time()
 
 Manager::Manager(
   const std::uint16_t port, const MachineID& id, const std::chrono::milliseconds heartbeat_interval) noexcept
-  : id_{id}, heartbeat_interval_{heartbeat_interval}, port_{port}
+  : publisher_table_epoch_{make_random_id()},
+    id_{id},
+    heartbeat_interval_{heartbeat_interval},
+    next_query_id_{make_random_id()},
+    port_{port}
 {
   if (server_socket_.set_to_listen(port) != internal::ConnectionError::no_error) { std::exit(1); }
+  if (!event_loop_.add(server_socket_.native_handle())) { std::exit(1); }
+  // Timers are only checked when the loop wakes, so make sure it does at
+  // least twice per heartbeat interval
+  event_loop_.set_periodic_timer(std::max(heartbeat_interval_ / 2, std::chrono::milliseconds{1}));
 }
 
-// Manager::Manager(const BuildManagerInfo& info) noexcept
-//   : Manager{info.port, info.name, std::chrono::milliseconds{info.heartbeat_interval_in_ms}}
-// {
-//   // TODO: This blocks until it is ready.  I guess that's fine though?
-//   // Connect to the other machines now
-//   auto connections_left = info.to_connect_to;
-//   while (!connections_left.empty())
-//   {
-//     for (auto iter = connections_left.begin(); iter != connections_left.end(); /* nothing */)
-//     {
-//       const bool already_has_connection = [&]() {
-//         for (const auto& neighbor : neighbors_)
-//         {
-//           if (neighbor.second.address() == *iter)
-//           {
-//             return true;
-//           }
-//         }
-//         return false;
-//       }();
-//       if (already_has_connection || connect_to_server(*iter))
-//       {
-//         iter = connections_left.erase(iter);
-//       }
-//       else
-//       {
-//         ++iter;
-//       }
-//     }
-//     std::this_thread::sleep_for(std::chrono::milliseconds(10));
-//   }
-// }
+Manager::Manager(const BuildManagerInfo& info) noexcept
+  : Manager{info.port, info.name, std::chrono::milliseconds{info.heartbeat_interval_in_ms}}
+{}
 
-Manager::~Manager() { send_to_neighbors(internal::make_goodbye()); }
+Manager::~Manager()
+{
+  send_to_neighbors(internal::make_goodbye());
+  // There won't be another pass of the loop to send it
+  flush_send_queues();
+  if (in_process_listener_) {
+    internal::InProcessRegistry::instance().stop_listening(port_);
+    in_process_waker_->disable();
+  }
+}
 
 Waiter<bool> Manager::connect_to_server(const char* const address, const std::uint16_t port) noexcept
 {
   std::lock_guard<std::mutex> lock{job_mut_};
-  const auto canonical = internal::to_canonical(AddrPortPair{address, port});
-  // Only actually try the connection if it doesn't already exist
-  if (addr_to_machine_.find(canonical) == addr_to_machine_.cend()) {
-    const auto [iter, inserted] = pending_conns_.try_emplace(
-      canonical,
-      PendingInfo{internal::SocketCommunicator{}, ConnStatus::waiting_for_conn, ConnType::user_requested, ""});
-    if (inserted) {
-      const auto status = iter->second.conn.connect_non_blocking(canonical.first.c_str(), canonical.second);
-      // Ignore status - if this initially fails it will be handled later
-      (void)status;
-      SKYNET_TRACE_LOG("\"{}\" making connection from {} to {}",
-                       id_, iter->second.conn.host_ip_address_and_port(),
-                       iter->second.conn.ip_address_and_port());
-    }
+  // Names are looked up off of this thread, so the connection may have to wait
+  awaiting_resolution_.push_back(AwaitingResolution{AddrPortPair{address, port}, ConnType::user_requested, {}});
+  start_resolved_connections();
+  return make_waiter<bool>(
+    job_mut_,
+    connection_cv_,
+    internal::ManagerConnectionIsComplete{*this, address, port},
+    internal::ManagerGetConnectionSuccess{*this, address, port});
+}
+
+Waiter<bool> Manager::connect_to_servers(
+  const std::vector<AddrPortPair>& addresses, const std::chrono::milliseconds timeout) noexcept
+{
+  std::lock_guard<std::mutex> lock{job_mut_};
+  const auto now = std::chrono::steady_clock::now();
+  auto group = std::make_shared<internal::ConnectionGroup>();
+  group->deadline = now + timeout;
+  for (const auto& address : addresses) {
+    group->waiting.push_back(internal::ConnectionGroup::Link{
+      address, internal::connect_retry_initial_backoff, now + internal::connect_retry_initial_backoff});
+    awaiting_resolution_.push_back(AwaitingResolution{address, ConnType::user_requested, {}});
   }
+  // Every connection is started before any of them is waited on
+  start_resolved_connections();
+  connection_groups_.push_back(group);
   return make_waiter<bool>(
     job_mut_,
     connection_cv_,
-    internal::ManagerConnectionIsComplete{*this, canonical.first, canonical.second},
-    internal::ManagerGetConnectionSuccess{*this, canonical.first, canonical.second});
+    internal::ManagerConnectionGroupIsDone{group},
+    internal::ManagerConnectionGroupSuccess{group});
+}
+
+void Manager::retry_connection_groups() noexcept
+{
+  const auto now = std::chrono::steady_clock::now();
+  for (auto iter = connection_groups_.begin(); iter != connection_groups_.end();) {
+    auto& group = **iter;
+    auto& waiting = group.waiting;
+    waiting.erase(
+      std::remove_if(
+        waiting.begin(),
+        waiting.end(),
+        [&](const internal::ConnectionGroup::Link& link) { return addr_is_connected(link.address); }),
+      waiting.end());
+    for (auto& link : waiting) {
+      // Only retry once the last attempt has failed and the wait is over
+      if (now < link.next_attempt || !conn_is_complete(link.address)) { continue; }
+      SKYNET_DEBUG_LOG("\"{}\" retrying connection to {}", id_, link.address);
+      awaiting_resolution_.push_back(AwaitingResolution{link.address, ConnType::user_requested, {}});
+      link.next_attempt = now + link.backoff;
+      link.backoff = std::min(link.backoff * 2, internal::connect_retry_max_backoff);
+    }
+    if (waiting.empty()) { group.status = internal::ConnectionGroup::Status::connected; }
+    else if (now >= group.deadline) {
+      SKYNET_WARN_LOG("\"{}\" timed out connecting to {} of the requested servers", id_, waiting.size());
+      group.status = internal::ConnectionGroup::Status::timed_out;
+    }
+    if (group.status == internal::ConnectionGroup::Status::connecting) {
+      ++iter;
+      continue;
+    }
+    notify_connection_ = true;
+    iter = connection_groups_.erase(iter);
+  }
+}
+
+void Manager::connect_to_canonical(const AddrPortPair& canonical) noexcept
+{
+  // Only actually try the connection if it doesn't already exist
+  if (
+    addr_to_machine_.find(canonical) != addr_to_machine_.cend()
+    || pending_conns_.find(canonical) != pending_conns_.cend()) {
+    return;
+  }
+  auto [conn, status] = start_connection(canonical);
+  // Ignore status - if this initially fails it will be handled later
+  (void)status;
+  const auto [iter, inserted] = pending_conns_.try_emplace(
+    canonical, PendingInfo{std::move(conn), ConnStatus::waiting_for_conn, ConnType::user_requested, ""});
+  (void)inserted;
+  watch_pending_conn(iter);
+  SKYNET_TRACE_LOG("\"{}\" making connection from {} to {}",
+                   id_, iter->second.conn.host_ip_address_and_port(),
+                   iter->second.conn.ip_address_and_port());
+}
+
+void Manager::start_resolved_connections() noexcept
+{
+  for (auto iter = awaiting_resolution_.begin(); iter != awaiting_resolution_.end();) {
+    const auto result = resolver_.resolve(iter->address.first);
+    if (result.status == internal::AddressResolver::Status::pending) {
+      ++iter;
+      continue;
+    }
+    if (result.status == internal::AddressResolver::Status::resolved) {
+      const AddrPortPair canonical{result.address, iter->address.second};
+      if (iter->type == ConnType::specific_ip) { ip_subscribe_to_canonical(canonical, iter->tags); }
+      else {
+        connect_to_canonical(canonical);
+      }
+    }
+    // Waiters see a failed lookup as a failed connection
+    notify_connection_ = true;
+    notify_subscriptions_ = true;
+    iter = awaiting_resolution_.erase(iter);
+  }
+}
+
+std::optional<AddrPortPair> Manager::known_canonical(const AddrPortPair& address) const noexcept
+{
+  const auto result = resolver_.find(address.first);
+  if (result.status != internal::AddressResolver::Status::resolved) { return {}; }
+  return AddrPortPair{result.address, address.second};
+}
+
+bool Manager::is_own_address(const AddrPortPair& address) const noexcept
+{
+  return known_canonical(address) == AddrPortPair{"127.0.0.1", port_};
 }
 
 Waiter<bool> Manager::connect_to_server(std::string_view address) noexcept
@@ -453,26 +878,51 @@ Waiter<bool> Manager::connect_to_server(std::string_view address) noexcept
 void Manager::accept_pending_connections() noexcept
 {
   while (auto conn = server_socket_.accept()) {
-    // This feels gross since it's basically the same thing as above, but I'm not
-    // sure how to condense them as they are slightly different
-    const auto& [address, port] = conn->ip_address_and_port();
-    auto info = PendingInfo{std::move(*conn), ConnStatus::waiting_for_conn, ConnType::user_requested, ""};
-    SKYNET_DEBUG_LOG("\"{}\" accepted connection from {}:{}", id_, address, port);
-    // Accept seems to re-use ports, and the actual address doesn't matter, so keep shuffling
-    // until it manages to get in
-    auto inc_port = port;
-    while (true) {
-      const auto [iter, inserted] = pending_conns_.try_emplace(AddrPortPair{address, inc_port}, std::move(info));
-      (void)iter;
-      ++inc_port;
-      if (inserted) {
-        SKYNET_DEBUG_LOG("\"{}\" inserted accepted connection from {} into pending_conns_",
-                         id_, iter->second.conn.ip_address_and_port());
-        break;
-      }
+    add_accepted_connection(std::move(*conn));
+  }
+  if (in_process_listener_) {
+    while (auto pipe = in_process_listener_->accept()) {
+      add_accepted_connection(internal::SocketCommunicator{std::move(pipe)});
+    }
+  }
+}
+
+void Manager::add_accepted_connection(internal::SocketCommunicator conn) noexcept
+{
+  // This feels gross since it's basically the same thing as above, but I'm not
+  // sure how to condense them as they are slightly different
+  const auto [address, port] = conn.ip_address_and_port();
+  auto info = PendingInfo{std::move(conn), ConnStatus::waiting_for_conn, ConnType::user_requested, ""};
+  SKYNET_DEBUG_LOG("\"{}\" accepted connection from {}:{}", id_, address, port);
+  // Accept seems to re-use ports, and the actual address doesn't matter, so keep shuffling
+  // until it manages to get in
+  auto inc_port = port;
+  while (true) {
+    const auto [iter, inserted] = pending_conns_.try_emplace(AddrPortPair{address, inc_port}, std::move(info));
+    (void)iter;
+    ++inc_port;
+    if (inserted) {
+      SKYNET_DEBUG_LOG("\"{}\" inserted accepted connection from {} into pending_conns_",
+                       id_, iter->second.conn.ip_address_and_port());
+      watch_pending_conn(iter);
+      break;
     }
-    // No need for waiters or anything
   }
+  // No need for waiters or anything
+}
+
+std::pair<internal::SocketCommunicator, internal::ConnectionError>
+  Manager::start_connection(const AddrPortPair& address) noexcept
+{
+  if (in_process_waker_) {
+    if (auto pipe = internal::InProcessRegistry::instance().connect(address, in_process_waker_)) {
+      return {internal::SocketCommunicator{std::move(pipe)}, internal::ConnectionError::no_error};
+    }
+  }
+  internal::SocketCommunicator conn;
+  if (address.first.empty()) { return {std::move(conn), internal::ConnectionError::unrecoverable}; }
+  const auto status = conn.connect_non_blocking(address.first.c_str(), address.second);
+  return {std::move(conn), status};
 }
 
 size_t Manager::number_of_neighbors() const noexcept
@@ -497,40 +947,54 @@ void Manager::run() noexcept
     threads.push_back(Job::Accessor::run(job));
   }
   // Do processing while there are still jobs
+  // Start with a zero timeout so anything queued before run() is handled right away
+  auto wait_timeout = std::chrono::milliseconds{0};
   while (!jobs_.empty()) {
-    const auto end_sleep_time = std::chrono::steady_clock::now() + 100us;
+    // Sleep until a socket is ready, a job needs something, or the heartbeat timer fires
+    const auto& ready = event_loop_.wait(wait_timeout);
     {
       // Ensure there's no data race with jobs
-      //std::cout << "Agent " << id() << " at top of loop." << std::endl;
       std::lock_guard lock{job_mut_};
-      //std::cout << "Agent " << id() << " acquired mutex." << std::endl;
+      // Deliver what jobs have published since the last pass
+      for (auto& [name, job] : jobs_) {
+        (void)name;
+        publish_queued_data(job);
+      }
+      send_deferred_publishes();
       // Remove any finished jobs
+      bool job_lock_failed = false;
       for (auto iter = jobs_.begin(); iter != jobs_.end();) {
         std::unique_lock lock{Job::Accessor::get_mutex(iter->second), std::try_to_lock};
         if (lock.owns_lock() && iter->second.is_finished()) {
           // Need to unlock before deallocation
           lock.unlock();
+          // The job may have published more since the pass above, and what it
+          // held back doesn't have to wait any more
+          publish_queued_data(iter->second);
+          for (const auto& [tag, types] : iter->second.tags_produced()) {
+            (void)types;
+            send_deferred_publish_now(tag);
+          }
+          remove_local_subscriber(iter->second);
           iter = jobs_.erase(iter);
         }
         else {
+          job_lock_failed |= !lock.owns_lock();
           ++iter;
         }
       }
-      //std::cout << "Agent " << id() << " about to process pending conns. " << std::endl;
+      retry_connection_groups();
+      start_resolved_connections();
       process_pending_conns();
-      //std::cout << "Agent " << id() << " about to accept pending connections. " << std::endl;
-      accept_pending_connections();
-      //std::cout << "Agent " << id() << " about to handle neighbor messages. " << std::endl;
-      handle_neighbor_messages();
-      //std::cout << "Agent " << id() << " about to remove dead neighbors " << std::endl;
+      handle_neighbor_messages(ready);
+      send_queued_reduce_messages();
       remove_dead_neighbors();
-      //std::cout << "Agent " << id() << " about to find publishers for pending tags. " << std::endl;
       find_publishers_for_pending_tags();
-      //std::cout << "Agent " << id() << " about to send heartbeats. " << std::endl;
-      for (auto&& neighbor : neighbors_) {
-        neighbor.second.send_heartbeat_if_past_interval(heartbeat_interval_);
-      }
-      //std::cout << "Agent " << id() << " about to announce notifications. " << std::endl;
+      expire_publisher_queries();
+      send_due_heartbeats();
+      send_neighbor_updates();
+      // Everything queued during this pass goes out together
+      flush_send_queues();
       using cv_ref_pair = std::pair<bool&, std::condition_variable&>;
       std::array<cv_ref_pair, 3> cv_array{
         cv_ref_pair{notify_subscriptions_, subscription_cv_},
@@ -542,9 +1006,15 @@ void Manager::run() noexcept
           notify = false;
         }
       }
+      // Searching for publishers is driven by backoff times rather than socket
+      // events, and a job that couldn't be checked may have finished, so only
+      // wait for the next timer if neither is the case
+      wait_timeout = time_until_next_timer();
+      const bool poll = job_lock_failed || !pending_tags_.empty() || !connection_groups_.empty();
+      if (poll && (wait_timeout < 0ms || wait_timeout > pending_work_poll_interval)) {
+        wait_timeout = pending_work_poll_interval;
+      }
     }
-    // Wait a bit for other messages
-    std::this_thread::sleep_until(end_sleep_time);
   }
   //std::cout << "Agent " << id() << " has no running jobs, waiting for threads to complete." << std::endl;
   // Join all of the threads now
@@ -556,54 +1026,307 @@ void Manager::run() noexcept
 
 const std::string& Manager::id() const noexcept { return id_; }
 
+void Manager::set_send_queue_watermarks(const std::size_t high_watermark, const std::size_t low_watermark) noexcept
+{
+  assert(low_watermark <= high_watermark);
+  std::lock_guard lock{job_mut_};
+  send_queue_high_watermark_ = high_watermark;
+  send_queue_low_watermark_ = low_watermark;
+  for (auto& [id, neighbor] : neighbors_) {
+    (void)id;
+    neighbor.set_send_queue_watermarks(high_watermark, low_watermark);
+  }
+}
+
+void Manager::set_discovery_ttl(const std::uint16_t ttl) noexcept
+{
+  assert(ttl > 0);
+  std::lock_guard lock{job_mut_};
+  discovery_ttl_ = ttl;
+}
+
+void Manager::add_known_publishers(const std::vector<PublisherDirectoryEntry>& entries) noexcept
+{
+  std::lock_guard lock{job_mut_};
+  const auto now = std::chrono::steady_clock::now();
+  for (const auto& entry : entries) {
+    const auto canonical = known_canonical(internal::split_address(entry.address));
+    if (!canonical || canonical->first.empty()) {
+      SKYNET_WARN_LOG("\"{}\" skipping known publisher for tag \"{}\" with address \"{}\"", id_, entry.tag, entry.address);
+      continue;
+    }
+    internal::PublisherInfo info{canonical->first + ':' + std::to_string(canonical->second), entry.machine_id};
+    directory_publishers_[entry.tag][info]
+      = internal::DirectoryRetry{now + internal::directory_publisher_grace, internal::connect_retry_initial_backoff, now};
+    if (publishers_for_tag_[entry.tag].insert(std::move(info)).second) { publishers_changed(entry.tag); }
+  }
+  // Subscriptions already waiting may be able to go ahead now
+  init_connections_for_pending_tags();
+}
+
+bool Manager::load_publisher_directory(const std::string& filename) noexcept
+{
+  std::ifstream in{filename};
+  if (!in) {
+    SKYNET_WARN_LOG("\"{}\" couldn't open publisher directory \"{}\"", id_, filename);
+    return false;
+  }
+  const auto entries = read_publisher_directory(in);
+  if (!entries) { return false; }
+  add_known_publishers(*entries);
+  return true;
+}
+
+internal::SendStatistics Manager::send_statistics() const noexcept
+{
+  std::lock_guard lock{job_mut_};
+  return send_statistics_;
+}
+
 size_t Manager::number_of_subscribers(const internal::PublishTagBase& tag) const noexcept
 {
   std::lock_guard<std::mutex> lock{job_mut_};
   const auto self_iter = self_sub_count_.find(tag.id());
   const auto self_subs = self_iter == self_sub_count_.cend() ? 0 : self_iter->second;
-  return std::accumulate(
-    neighbors_.cbegin(), neighbors_.cend(), self_subs, [&](const size_t sum, const auto& neighbor_pair) noexcept {
-      return sum + neighbor_pair.second.is_subscribed_to(tag.id());
-    });
+  const auto remote_iter = remote_subscribers_.find(tag.id());
+  return self_subs + (remote_iter == remote_subscribers_.cend() ? 0 : remote_iter->second.neighbors.size());
 }
 
 std::uint16_t Manager::port() const noexcept { return port_; }
 
-void Manager::handle_neighbor_messages() noexcept
+void Manager::handle_neighbor_messages(const std::vector<internal::ReadyHandle>& ready) noexcept
 {
-  //std::cout << "Agent " << id() << " handling neighbor messages." << std::endl;
-  for (auto&& neighbor : neighbors_) {
-    neighbor.second.get_and_handle_messages();
+  io_batch_.clear();
+  for (const auto& handle : ready) {
+    if (
+      handle.handle == server_socket_.native_handle()
+      || (in_process_listener_ && handle.handle == in_process_listener_->handle())) {
+      accept_pending_connections();
+      continue;
+    }
+    // Pending connections are checked separately in process_pending_conns
+    const auto iter = handle_to_neighbor_.find(handle.handle);
+    if (iter == handle_to_neighbor_.cend()) { continue; }
+    io_batch_.push_back(IoTask{iter->second, handle.writable, handle.readable || handle.error});
+  }
+  // A neighbor with several connections can be reported more than once, but
+  // must only be worked on by one thread
+  std::sort(io_batch_.begin(), io_batch_.end(), [](const IoTask& lhs, const IoTask& rhs) {
+    return std::less<>{}(lhs.neighbor, rhs.neighbor);
+  });
+  auto out = io_batch_.begin();
+  for (auto iter = io_batch_.begin(); iter != io_batch_.end(); ++iter) {
+    if (out != io_batch_.begin() && std::prev(out)->neighbor == iter->neighbor) {
+      std::prev(out)->flush |= iter->flush;
+      std::prev(out)->receive |= iter->receive;
+    }
+    else {
+      *out++ = *iter;
+    }
+  }
+  io_batch_.erase(out, io_batch_.end());
+  run_io_batch();
+  // Everything other than data has to be handled here
+  for (const auto& task : io_batch_) {
+    if (task.receive) { task.neighbor->handle_received_messages(); }
   }
 }
 
-void Manager::publish(const VersionID version, const TagID& tag_id, gsl::span<PublishValueVariant> value) noexcept
+void Manager::flush_send_queues() noexcept
 {
-  const auto msg = internal::make_publish(version, tag_id, value);
-  (void)msg;
-  SKYNET_TRACE_LOG("\"{}\" publishing on tag \"{}\", version \"{}\", data {}", id_, tag_id, version, value);
-  for (auto& [name, job] : jobs_) {
-    (void)name;
-    Job::Accessor::process_data(job, tag_id, value, version);
+  io_batch_.clear();
+  for (auto& [id, neighbor] : neighbors_) {
+    (void)id;
+    // The rest will be sent when the socket is writable again
+    if (!neighbor.waiting_for_writable()) { io_batch_.push_back(IoTask{&neighbor, true, false}); }
   }
-  send_to_neighbors_if(msg, [&](const auto& neighbor) { return neighbor.is_subscribed_to(tag_id); });
+  run_io_batch();
 }
 
-bool Manager::add_data_to_queue(const internal::PublishData& msg) noexcept
+void Manager::run_io_batch() noexcept
 {
-  for (auto& [name, job] : jobs_) {
-    (void)name;
-    auto msg_var = msg.value();
-    if (!msg_var) { return false; }
-    if (!Job::Accessor::process_data(job, msg.tag_id(), *msg_var, msg.version())) { return false; }
+  io_workers_->for_each(io_batch_.size(), [&](const std::size_t item, const std::size_t worker) noexcept {
+    const auto& task = io_batch_[item];
+    if (task.flush) { task.neighbor->flush_send_queue(worker_send_statistics_[worker]); }
+    if (task.receive) { task.neighbor->receive_data_messages(); }
+  });
+  for (auto& stats : worker_send_statistics_) {
+    send_statistics_ += stats;
+    stats = internal::SendStatistics{};
+  }
+}
+
+void Manager::set_io_thread_count(const std::size_t count) noexcept
+{
+  assert(count >= 1);
+  std::lock_guard lock{job_mut_};
+  io_workers_ = std::make_unique<internal::WorkerPool>(count);
+  worker_send_statistics_.assign(count, internal::SendStatistics{});
+}
+
+void Manager::use_in_process_connections() noexcept
+{
+  std::lock_guard lock{job_mut_};
+  if (in_process_listener_) { return; }
+  in_process_waker_ = std::make_shared<internal::InProcessWaker>(event_loop_);
+  in_process_listener_ = internal::InProcessRegistry::instance().listen(port_, in_process_waker_);
+  if (!in_process_listener_) {
+    SKYNET_WARN_LOG("\"{}\" couldn't use in-process connections as port {} is taken", id_, port_);
+    in_process_waker_.reset();
+    return;
+  }
+  event_loop_.add(in_process_listener_->handle());
+}
+
+void Manager::watch_neighbor_socket(const int handle, internal::ExternalManager& neighbor) noexcept
+{
+  // Already registered while pending; only reads are of interest now
+  event_loop_.set_want_write(handle, false);
+  handle_to_neighbor_[handle] = &neighbor;
+}
+
+bool Manager::publish(const Job::QueuedPublish& to_publish) noexcept
+{
+  const auto& tag_id = to_publish.tag_id;
+  SKYNET_TRACE_LOG("\"{}\" publishing on tag \"{}\"", id_, tag_id);
+  if (const auto subscribers = local_subscribers_.find(to_publish.tag_number);
+      subscribers != local_subscribers_.cend()) {
+    // Local jobs take the values directly instead of decoding the message
+    for (Job* job : subscribers->second) {
+      Job::Accessor::process_local_data(*job, to_publish.tag_number, tag_id, to_publish.values, to_publish.version);
+    }
+  }
+  const auto subscribers = remote_subscribers_.find(tag_id);
+  if (subscribers == remote_subscribers_.cend()) { return true; }
+  bool congested = false;
+  for (internal::ExternalManager* neighbor : subscribers->second.neighbors) {
+    neighbor->send_publish(tag_id, to_publish.tag_number, to_publish.message, to_publish.policy);
+    congested |= neighbor->send_queue_congested();
+  }
+  return !congested;
+}
+
+void Manager::publish_queued_data(Job& job) noexcept
+{
+  auto& queue = Job::Accessor::publish_queue(job);
+  auto to_publish = queue.pop();
+  if (!to_publish) { return; }
+  const auto now = std::chrono::steady_clock::now();
+  bool congested = false;
+  for (; to_publish; to_publish = queue.pop()) {
+    const auto& tag_id = to_publish->tag_id;
+    // The job counts a value held back for an earlier slot as sent once its
+    // slot has passed, so it has to go out before anything newer even if its
+    // timer hasn't fired yet
+    if (const auto held = deferred_publishes_.find(tag_id);
+        held != deferred_publishes_.end() && held->second.send_at != to_publish->send_at) {
+      deferred_publish_timers_.cancel(tag_id);
+      congested |= !publish(held->second);
+      deferred_publishes_.erase(held);
+    }
+    if (to_publish->send_at > now) {
+      // Replaces anything already held back for the same slot
+      deferred_publish_timers_.schedule(tag_id, to_publish->send_at);
+      deferred_publishes_.insert_or_assign(tag_id, std::move(*to_publish));
+      continue;
+    }
+    congested |= !publish(*to_publish);
+  }
+  Job::Accessor::set_publish_congested(job, congested);
+}
+
+void Manager::send_deferred_publishes() noexcept
+{
+  for (const auto& tag_id : deferred_publish_timers_.advance(std::chrono::steady_clock::now())) {
+    const auto iter = deferred_publishes_.find(tag_id);
+    if (iter == deferred_publishes_.end()) { continue; }
+    (void)publish(iter->second);
+    deferred_publishes_.erase(iter);
+  }
+}
+
+void Manager::send_deferred_publish_now(const TagID& tag_id) noexcept
+{
+  const auto iter = deferred_publishes_.find(tag_id);
+  if (iter == deferred_publishes_.end()) { return; }
+  deferred_publish_timers_.cancel(tag_id);
+  (void)publish(iter->second);
+  deferred_publishes_.erase(iter);
+}
+
+bool Manager::add_data_to_queue(
+  const internal::TagNumber tag_number, const TagID& tag_id, const internal::PublishData& msg) noexcept
+{
+  const auto subscribers = local_subscribers_.find(tag_number);
+  if (subscribers == local_subscribers_.cend()) {
+    SKYNET_TRACE_LOG("\"{}\" dropped data on tag \"{}\" as no local job is subscribed", id_, tag_id);
+    return true;
+  }
+  // Each job decodes straight into its own buffer
+  bool okay = true;
+  for (Job* job : subscribers->second) {
+    okay &= Job::Accessor::process_data(*job, tag_number, tag_id, msg);
+  }
+  return okay;
+}
+
+void Manager::add_remote_subscriber(const std::vector<TagID>& tags, internal::ExternalManager& neighbor) noexcept
+{
+  for (const auto& tag : tags) {
+    const auto [iter, inserted] = remote_subscribers_.try_emplace(tag);
+    if (inserted) { iter->second.tag_number = tag_numbers_.intern(tag); }
+    iter->second.neighbors.push_back(&neighbor);
+  }
+}
+
+void Manager::remove_remote_subscriber(const internal::ExternalManager& neighbor) noexcept
+{
+  for (const auto& tag : neighbor.remote_subscriptions()) {
+    const auto iter = remote_subscribers_.find(tag);
+    if (iter == remote_subscribers_.end()) { continue; }
+    auto& neighbors = iter->second.neighbors;
+    neighbors.erase(std::remove(neighbors.begin(), neighbors.end(), &neighbor), neighbors.end());
+    if (neighbors.empty()) { remote_subscribers_.erase(iter); }
+  }
+}
+
+void Manager::add_local_subscriber(Job& job, const std::vector<TagID>& tag_ids) noexcept
+{
+  for (const auto& tag_id : tag_ids) {
+    auto& subscribers = local_subscribers_[tag_numbers_.intern(tag_id)];
+    if (std::find(subscribers.cbegin(), subscribers.cend(), &job) == subscribers.cend()) {
+      subscribers.push_back(&job);
+    }
+  }
+}
+
+void Manager::remove_local_subscriber(const Job& job) noexcept
+{
+  for (auto iter = local_subscribers_.begin(); iter != local_subscribers_.end();) {
+    auto& subscribers = iter->second;
+    subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), &job), subscribers.end());
+    if (subscribers.empty()) { iter = local_subscribers_.erase(iter); }
+    else {
+      ++iter;
+    }
   }
-  return true;
 }
 
 void Manager::notify_of_new_neighbor(const MachineID& id) noexcept
 {
-  send_to_neighbors_if(
-    internal::make_new_neighbor(id), [&](const internal::ExternalManager& neighbor) { return neighbor.id() != id; });
+  neighbor_changes_[id] = true;
+}
+
+void Manager::send_neighbor_updates() noexcept
+{
+  if (neighbor_changes_.empty()) { return; }
+  std::vector<MachineID> added;
+  std::vector<MachineID> removed;
+  for (const auto& [id, is_added] : neighbor_changes_) {
+    (is_added ? added : removed).push_back(id);
+  }
+  neighbor_changes_.clear();
+  send_to_neighbors(internal::make_neighbor_update(added, removed), internal::MessagePriority::control);
 }
 
 void Manager::remove_dead_neighbors() noexcept
@@ -614,7 +1337,7 @@ void Manager::remove_dead_neighbors() noexcept
       // This could affect subscriptions, so notify anything waiting on them
       notify_subscriptions_ = true;
       SKYNET_TRACE_LOG("\"{}\" removing dead neighbor \"{}\"", id_, it->first);
-      send_to_neighbors(internal::make_remove_neighbor(it->first));
+      neighbor_changes_[it->first] = false;
       // Find any reduce groups that this machine is a part of and
       // notify them of the disconnection
       // TODO: Probably want to cache this at some point so everything
@@ -653,7 +1376,23 @@ void Manager::remove_dead_neighbors() noexcept
         }
         pending_tags_.emplace_back(tag_pair.first);
         });
+      for (const int handle : it->second.native_handles()) {
+        event_loop_.remove(handle);
+        handle_to_neighbor_.erase(handle);
+      }
+      remove_remote_subscriber(it->second);
+      heartbeat_timers_.cancel(it->first);
+      tag_request_timers_.cancel(it->first);
+      tag_request_due_.erase(it->first);
+      // Don't wait on answers to forwarded queries that won't come
+      std::vector<std::uint64_t> to_answer;
+      for (auto& [query_id, query] : forwarded_queries_) {
+        if (query.waiting_on.erase(it->first) != 0 && query.waiting_on.empty()) { to_answer.push_back(query_id); }
+      }
       it = neighbors_.erase(it);
+      for (const auto query_id : to_answer) {
+        answer_publisher_query(query_id);
+      }
     }
     else {
       ++it;
@@ -673,9 +1412,9 @@ std::vector<MachineID> Manager::make_neighbor_vector() const noexcept
   return to_ret;
 }
 
-void Manager::send_to_neighbors(const std::vector<std::byte>& to_send) noexcept
+void Manager::send_to_neighbors(std::vector<std::byte> to_send, const internal::MessagePriority priority) noexcept
 {
-  send_to_neighbors_if(to_send, [](const internal::ExternalManager&) { return true; });
+  send_to_neighbors_if(std::move(to_send), [](const internal::ExternalManager&) { return true; }, priority);
 }
 
 bool Manager::subscribe_is_done(const std::vector<TagID>& required_tags) const noexcept
@@ -699,12 +1438,24 @@ Waiter<void> Manager::subscribe(const std::vector<TagID>& tag_ids) noexcept
     if (to_find[0] == internal::private_tag_marker) { return false; }
     return true;
     });
-  if (!pending_tags_.empty()) {
+  // Tags with a known publisher are connected to directly; only the rest are asked about
+  std::vector<TagID> to_ask_for;
+  bool publisher_known = false;
+  for (const auto& tag : tag_ids) {
+    if (std::find(pending_tags_.cbegin(), pending_tags_.cend(), tag) == pending_tags_.cend()) { continue; }
+    if (has_enough_publishers(tag, 1)) { publisher_known = true; }
+    else {
+      to_ask_for.push_back(tag);
+    }
+  }
+  if (!to_ask_for.empty()) {
+    const auto query_id = start_publisher_query();
     for (auto& [name, neighbor] : neighbors_) {
       neighbor.reset_backoff_counter();
-      neighbor.find_publishers_for_tags(tag_ids, make_need_one_pub(tag_ids));
+      neighbor.find_publishers_for_tags(to_ask_for, make_need_one_pub(to_ask_for), query_id);
     }
   }
+  if (publisher_known) { init_connections_for_pending_tags(); }
   // Can potentially finish subscribing right away, so notify things
   notify_subscriptions_ = true;
   return make_waiter(job_mut_, subscription_cv_, internal::ManagerSubscribeIsDone{*this, tag_ids});
@@ -712,13 +1463,21 @@ Waiter<void> Manager::subscribe(const std::vector<TagID>& tag_ids) noexcept
 
 Waiter<bool> Manager::ip_subscribe(const AddrPortPair& addr, const std::vector<TagID>& tag_ids) noexcept
 {
-  const auto canonical_addr = internal::to_canonical(addr);
+  awaiting_resolution_.push_back(AwaitingResolution{addr, ConnType::specific_ip, tag_ids});
+  start_resolved_connections();
+  return make_waiter<bool>(
+    job_mut_,
+    subscription_cv_,
+    internal::ManagerIPSubscribeComplete{*this, addr, tag_ids},
+    internal::ManagerIPSubscribeSuccess{*this, addr, tag_ids});
+}
+
+void Manager::ip_subscribe_to_canonical(const AddrPortPair& canonical_addr, const std::vector<TagID>& tag_ids) noexcept
+{
   const auto iter = addr_to_machine_.find(canonical_addr);
   // Handle self-subscription
-  bool is_self_sub = false;
-  if (internal::to_ip_port(canonical_addr) == internal::to_ip_port({"localhost", port_})) {
+  if (canonical_addr == AddrPortPair{"127.0.0.1", port_}) {
     for (const auto& tag : tag_ids) {
-      is_self_sub = true;
       const auto iter = self_sub_count_.find(tag);
       if (iter == self_sub_count_.cend()) {
         std::cerr << "Tag \"" << tag << "\" was attempted to be self-subscribed but it isn't produced!\n";
@@ -729,7 +1488,8 @@ Waiter<bool> Manager::ip_subscribe(const AddrPortPair& addr, const std::vector<T
     notify_subscriptions_ = true;
   }
   else if (iter != addr_to_machine_.cend()) {
-    iter->second->send_message(internal::make_subscription_notice(tag_ids, false));
+    iter->second->send_message(
+      internal::make_subscription_notice(tag_ids, false), internal::MessagePriority::control);
     notify_subscriptions_ = true;
   }
   else {
@@ -739,84 +1499,58 @@ Waiter<bool> Manager::ip_subscribe(const AddrPortPair& addr, const std::vector<T
       tag_ids.cend(),
       canonical_addr.first + ':' + std::to_string(canonical_addr.second),
       [](const std::string& so_far, const std::string& next) { return so_far + '\0' + next; });
+    auto [conn, status] = start_connection(canonical_addr);
+    // Ignore the status - it is handeled later
+    (void)status;
     const auto [iter, inserted] = pending_conns_.try_emplace(
-      canonical_addr,
-      PendingInfo{internal::SocketCommunicator{}, ConnStatus::waiting_for_conn, ConnType::specific_ip, tag_list});
+      canonical_addr, PendingInfo{std::move(conn), ConnStatus::waiting_for_conn, ConnType::specific_ip, tag_list});
     assert(inserted);
-    // Ignore the status - it is handeled later
-    (void)iter->second.conn.connect_non_blocking(canonical_addr.first.c_str(), canonical_addr.second);
+    watch_pending_conn(iter);
   }
-  return make_waiter<bool>(
-    job_mut_,
-    subscription_cv_,
-    internal::ManagerIPSubscribeComplete{*this, canonical_addr, tag_ids, is_self_sub},
-    internal::ManagerIPSubscribeSuccess{*this, canonical_addr, tag_ids, is_self_sub});
 }
 
 void Manager::handle_get_publishers(const internal::GetPublishers& msg, internal::ExternalManager& from) noexcept
 {
-  // If all of the tag requirements are fulfilled then
+  const auto query_id = msg.query_id();
+  const auto now = std::chrono::steady_clock::now();
+  // A copy of a query that arrived by another path has already been passed
+  // on from here, so just say what's known so the sender isn't left waiting
+  const bool duplicate = seen_queries_.contains(query_id);
+  seen_queries_.schedule(query_id, now + internal::publisher_query_memory);
   const auto [remaining_tags, num_left] = remove_tags_with_enough_publishers(msg);
-  if (remaining_tags.empty()) {
+  if (remaining_tags.empty() || duplicate || msg.ttl() <= 1 || neighbors_.size() == 1) {
     SKYNET_TRACE_LOG(
-      "\"{}\" sending \"{}\" publisher information for {}, all tags have been fulfilled", id_, from.id(), msg.tags());
-    // Send the information back now
-    from.send_message(make_known_tag_publisher_message());
+      "\"{}\" sending \"{}\" publisher information for {}{}",
+      id_,
+      from.id(),
+      msg.tags(),
+      remaining_tags.empty() ? ", all tags have been fulfilled"
+      : duplicate            ? ", already passed on the query"
+                             : ", no one else to ask");
+    from.send_message(make_known_tag_publisher_message(from, query_id), internal::MessagePriority::control);
+    return;
   }
-  else {
-    // Mark all tags from the message in the cache so that they will be
-    // sent back so that the receiving end no longer thinks they are pending
-    // Also clear them if the cache is being ignored, as it is assumed that
-    // they are now invalid
-    for (const auto& tag : remaining_tags) {
-      const auto& [iter, inserted] = publishers_for_tag_.try_emplace(tag);
-      (void)inserted;
-      if (msg.ignore_cache()) { iter->second.clear(); }
-    }
-    // If there are no other neighbors, just answer right away so
-    // it doesn't stall
-    if (neighbors_.size() == 1) {
-      SKYNET_TRACE_LOG(
-        "\"{}\" sending \"{}\" publisher information for {}, no neighbors to ask", id_, from.id(), [&]() {
-          std::vector<TagID> known_tags;
-          for (const auto& [tag, publishers] : publishers_for_tag_) {
-            if (!publishers.empty()) { known_tags.push_back(tag); }
-          }
-          return known_tags;
-        }());
-      from.send_message(make_known_tag_publisher_message());
-      return;
-    }
-    // Mark the information as needing to be propagated
+  // If the cache is being ignored, clear the tags as it is assumed that
+  // what is known about them is now invalid
+  if (msg.ignore_cache()) {
     for (const auto& tag : remaining_tags) {
-      auto [iter, dummy] = send_publisher_information_to_.try_emplace(tag);
-      iter->second.emplace(from.id());
-      (void)dummy;
-    }
-    // If there's already a pending request another one can't be sent, so
-    // just return now
-    if (from.has_pending_tag_request()) {
-      SKYNET_TRACE_LOG(
-        "\"{}\" returning early for request for tags {} from \"{}\" to avoid potential deadlock",
-        id_,
-        msg.tags(),
-        from.id());
-      from.send_message(make_known_tag_publisher_message());
-      // No longer need to propagate information to this neighbor, as it
-      // is being sent now
-      send_publisher_information_to_.erase(from.id());
-    }
-    else {
-      SKYNET_TRACE_LOG(
-        "\"{}\" asking neighbors {} for tags {} for \"{}\"", id_, make_neighbor_vector(), msg.tags(), from.id());
-      for (auto& neighbor : neighbors_) {
-        if (&neighbor.second != &from) {
-          neighbor.second.reset_backoff_counter();
-          neighbor.second.find_publishers_for_tags(remaining_tags, num_left);
-        }
-      }
+      publishers_for_tag_[tag].clear();
     }
   }
+  SKYNET_TRACE_LOG(
+    "\"{}\" asking neighbors {} for tags {} for \"{}\"", id_, make_neighbor_vector(), remaining_tags, from.id());
+  // Replies come back the way the query went out, so only answer once every
+  // neighbor it was passed to has
+  auto& query = forwarded_queries_[query_id];
+  query.from = from.id();
+  query.tags = remaining_tags;
+  query.publishers_needed = num_left;
+  for (auto& [id, neighbor] : neighbors_) {
+    if (&neighbor == &from) { continue; }
+    neighbor.forward_publisher_query(remaining_tags, num_left, query_id, static_cast<std::uint16_t>(msg.ttl() - 1));
+    query.waiting_on.insert(id);
+  }
+  forwarded_query_timers_.schedule(query_id, now + internal::publisher_query_timeout);
 }
 
 auto Manager::remove_tags_with_enough_publishers(const internal::GetPublishers& msg) noexcept
@@ -831,14 +1565,7 @@ auto Manager::remove_tags_with_enough_publishers(const internal::GetPublishers&
         internal::zip_iter_equal_len(tags_left.end(), publishers_needed.end()),
         [&](const auto& id_left) {
           const auto& [tag, num_left] = id_left;
-          // TODO: How to handle self-subscription with this?
-          // Just count it as an additional source for now, but presumably just having it
-          // be valid no matter what is the best option going forward (why would you not
-          // trust yourself?)
-          const auto self_subscribed = self_sub_count_.find(tag) != self_sub_count_.cend();
-          const auto loc = publishers_for_tag_.find(tag);
-          const auto num_external_pubs = loc == publishers_for_tag_.cend() ? 0 : loc->second.size();
-          return num_external_pubs + self_subscribed >= num_left;
+          return has_enough_publishers(tag, num_left);
         })
         .underlying_iters();
   tags_left.erase(tag_iter, tags_left.end());
@@ -846,18 +1573,67 @@ auto Manager::remove_tags_with_enough_publishers(const internal::GetPublishers&
   return {tags_left, publishers_needed};
 }
 
+bool Manager::has_enough_publishers(const TagID& tag, const std::uint8_t publishers_needed) const noexcept
+{
+  // TODO: How to handle self-subscription with this?
+  // Just count it as an additional source for now, but presumably just having it
+  // be valid no matter what is the best option going forward (why would you not
+  // trust yourself?)
+  const auto self_subscribed = self_sub_count_.find(tag) != self_sub_count_.cend();
+  const auto loc = publishers_for_tag_.find(tag);
+  const auto num_external_pubs = loc == publishers_for_tag_.cend() ? 0 : loc->second.size();
+  return num_external_pubs + self_subscribed >= publishers_needed;
+}
+
+std::uint64_t Manager::start_publisher_query() noexcept
+{
+  // Zero means no query
+  if (next_query_id_ == 0) { ++next_query_id_; }
+  const auto query_id = next_query_id_++;
+  // Copies that come back here through other neighbors don't need passing on
+  seen_queries_.schedule(query_id, std::chrono::steady_clock::now() + internal::publisher_query_memory);
+  return query_id;
+}
+
+void Manager::answer_publisher_query(const std::uint64_t query_id) noexcept
+{
+  const auto iter = forwarded_queries_.find(query_id);
+  if (iter == forwarded_queries_.end()) { return; }
+  const auto neighbor_iter = neighbors_.find(iter->second.from);
+  if (neighbor_iter != neighbors_.end()) {
+    SKYNET_TRACE_LOG(
+      "\"{}\" answering \"{}\" with publisher information for {}", id_, iter->first, iter->second.tags);
+    neighbor_iter->second.send_message(
+      make_known_tag_publisher_message(neighbor_iter->second, query_id), internal::MessagePriority::control);
+  }
+  forwarded_query_timers_.cancel(query_id);
+  forwarded_queries_.erase(iter);
+}
+
+void Manager::expire_publisher_queries() noexcept
+{
+  const auto now = std::chrono::steady_clock::now();
+  for (const auto query_id : forwarded_query_timers_.advance(now)) {
+    SKYNET_TRACE_LOG("\"{}\" timed out waiting for answers to query {}", id_, query_id);
+    answer_publisher_query(query_id);
+  }
+  (void)seen_queries_.advance(now);
+}
+
 void Manager::add_publishers_and_propagate(
   const internal::ReportPublishers& msg, const internal::ExternalManager& from) noexcept
 {
-  const auto insert_publisher_infos = [](
+  const auto insert_publisher_infos = [&](
                                         decltype(publishers_for_tag_)::iterator iter,
                                         const std::vector<std::string>& addresses,
                                         const std::vector<MachineID>& machines) noexcept {
     assert(addresses.size() == machines.size());
     const auto num_iters = addresses.size();
+    bool changed = false;
     for (std::size_t i = 0; i < num_iters; ++i) {
-      iter->second.emplace(internal::PublisherInfo{addresses[i], machines[i]});
+      changed |= iter->second.emplace(internal::PublisherInfo{addresses[i], machines[i]}).second;
     }
+    if (changed) { publishers_changed(iter->first); }
   };
   const auto tags = msg.tags();
   const auto publishers_list = msg.addresses();
@@ -898,42 +1674,46 @@ void Manager::add_publishers_and_propagate(
       }
       return loc;
     }();
-    iter->second.insert(internal::PublisherInfo{from.address(), from.id()});
-  }
-  // Propagate to any machines that need this information, marking them
-  // as no longer needing propagation as well
-  std::unordered_set<MachineID> machines_to_send_to;
-  for (const auto& [tag, data] : publishers_for_tag_) {
-    (void)data;
-    const auto loc = send_publisher_information_to_.find(tag);
-    if (loc != send_publisher_information_to_.cend()) {
-      internal::merge_associative_containers(machines_to_send_to, loc->second);
-      send_publisher_information_to_.erase(loc);
-    }
+    if (iter->second.insert(internal::PublisherInfo{from.address(), from.id()}).second) { publishers_changed(tag); }
   }
-  if (!machines_to_send_to.empty()) {
-    const auto to_send = make_known_tag_publisher_message();
-    // Send to the machines if they are present
-    for (const auto& send_to : machines_to_send_to) {
-      const auto loc = neighbors_.find(send_to);
-      if (loc != neighbors_.end()) {
-        SKYNET_TRACE_LOG("\"{}\" propagating back to \"{}\" with local tags {}", id_, send_to, local_tags());
-        loc->second.send_message(to_send);
+  // Pass the answers back along the way the queries came once every neighbor
+  // asked has answered or enough publishers are known
+  if (const auto iter = forwarded_queries_.find(msg.query_id()); iter != forwarded_queries_.end()) {
+    iter->second.waiting_on.erase(from.id());
+  }
+  std::vector<std::uint64_t> to_answer;
+  for (const auto& [query_id, query] : forwarded_queries_) {
+    const bool satisfied = [&]() {
+      for (std::size_t i = 0; i < query.tags.size(); ++i) {
+        if (!has_enough_publishers(query.tags[i], query.publishers_needed[i])) { return false; }
       }
-    }
+      return true;
+    }();
+    if (query.waiting_on.empty() || satisfied) { to_answer.push_back(query_id); }
+  }
+  for (const auto query_id : to_answer) {
+    answer_publisher_query(query_id);
   }
   init_connections_for_pending_tags();
 }
 
-std::vector<std::byte> Manager::make_known_tag_publisher_message() const noexcept
+std::vector<std::byte>
+  Manager::make_known_tag_publisher_message(internal::ExternalManager& to, const std::uint64_t query_id) noexcept
 {
+  const auto base_version = to.publisher_version_sent();
+  const auto changed_since_base = [&](const TagID& tag) {
+    if (base_version == 0) { return true; }
+    const auto iter = publisher_tag_versions_.find(tag);
+    return iter != publisher_tag_versions_.cend() && iter->second > base_version;
+  };
   // Produce vectors for the machines and tags
   std::vector<TagID> tags_to_send;
   std::vector<std::vector<std::string>> addresses_to_send;
   std::vector<std::vector<MachineID>> machines_to_send;
   for (const auto& [tag, infos] : publishers_for_tag_) {
-    // Don't send data for tags that don't have any known publishers
-    if (!infos.empty()) {
+    // Don't send data for tags that don't have any known publishers or that
+    // the neighbor already has
+    if (!infos.empty() && changed_since_base(tag)) {
       auto& new_addrs = addresses_to_send.emplace_back();
       auto& new_machines = machines_to_send.emplace_back();
       new_addrs.reserve(infos.size());
@@ -945,7 +1725,20 @@ std::vector<std::byte> Manager::make_known_tag_publisher_message() const noexcep
       tags_to_send.push_back(tag);
     }
   }
-  return internal::make_report_publishers(tags_to_send, addresses_to_send, machines_to_send, local_tags());
+  const bool send_local_tags = base_version == 0 || local_tags_version_ > base_version;
+  to.set_publisher_version_sent(publisher_table_version_);
+  return internal::make_report_publishers(
+    tags_to_send,
+    addresses_to_send,
+    machines_to_send,
+    send_local_tags ? local_tags() : std::vector<TagID>{},
+    internal::PublisherTableVersion{publisher_table_epoch_, base_version, publisher_table_version_},
+    query_id);
+}
+
+void Manager::publishers_changed(const TagID& tag) noexcept
+{
+  publisher_tag_versions_[tag] = ++publisher_table_version_;
 }
 
 void Manager::report_new_publish_tags(const std::vector<TagID>& tags) noexcept
@@ -961,6 +1754,7 @@ void Manager::report_new_publish_tags(const std::vector<TagID>& tags) noexcept
       std::exit(1);
     }
   }
+  local_tags_version_ = ++publisher_table_version_;
   // Notify publish groups for self-subscribing
   notify_subscriptions_ = true;
 }
@@ -989,9 +1783,10 @@ Waiter<internal::ReduceGroupBase&> Manager::create_reduce_group(std::unique_ptr<
   const auto& parent_tag = internal::ReduceGroupBase::Accessor::tag_neighbors(*iter->second.group).parent();
   if (!parent_tag.empty()) {
     pending_tags_.push_back(parent_tag);
+    const auto query_id = start_publisher_query();
     for (auto& neighbor : neighbors_) {
       neighbor.second.reset_backoff_counter();
-      neighbor.second.find_publishers_for_tags({parent_tag}, std::vector<std::uint8_t>{1});
+      neighbor.second.find_publishers_for_tags({parent_tag}, std::vector<std::uint8_t>{1}, query_id);
     }
   }
   // Notify reduce groups for when new tags are produced
@@ -1013,9 +1808,10 @@ Waiter<void> Manager::rebuild_reduce_group(const TagID& group_id) noexcept
     // Don't bother searching for machines that already have connections
     if (iter->second.parent_machines.empty()) {
       pending_tags_.push_back(parent_tag);
+      const auto query_id = start_publisher_query();
       for (auto& neighbor : neighbors_) {
         neighbor.second.reset_backoff_counter();
-        neighbor.second.find_publishers_for_tags({parent_tag}, std::vector<std::uint8_t>{1});
+        neighbor.second.find_publishers_for_tags({parent_tag}, std::vector<std::uint8_t>{1}, query_id);
       }
     }
   }
@@ -1109,7 +1905,7 @@ internal::ReduceGroupBase& Manager::get_reduce_group(const TagID& group_id) noex
 }
 
 void Manager::reduce_send_data_and_remove_missing(
-  std::vector<MachineID>& machines, const std::vector<std::byte>& message) noexcept
+  std::vector<MachineID>& machines, const internal::SharedMessage& message) noexcept
 {
   for (auto iter = machines.begin(); iter != machines.end();) {
     const auto parent_loc = neighbors_.find(*iter);
@@ -1121,18 +1917,47 @@ void Manager::reduce_send_data_and_remove_missing(
   }
 }
 
+void Manager::queue_reduce_message(
+  const TagID& group_id, std::vector<std::byte> message, const ReduceTarget target) noexcept
+{
+  {
+    auto [outbox, lock] = reduce_outbox_.get();
+    (void)lock;
+    outbox.push_back(
+      QueuedReduceMessage{group_id, std::make_shared<const std::vector<std::byte>>(std::move(message)), target});
+  }
+  event_loop_.wake();
+}
+
+void Manager::send_queued_reduce_messages() noexcept
+{
+  const auto to_send = [&]() {
+    auto [outbox, lock] = reduce_outbox_.get();
+    (void)lock;
+    return std::exchange(outbox, {});
+  }();
+  for (const auto& queued : to_send) {
+    const auto loc = reduce_tag_data_.find(queued.group_id);
+    assert(loc != reduce_tag_data_.cend());
+    if (queued.target != ReduceTarget::children) {
+      reduce_send_data_and_remove_missing(loc->second.parent_machines, queued.message);
+    }
+    if (queued.target != ReduceTarget::parent) {
+      for (auto& children : loc->second.child_machines) {
+        reduce_send_data_and_remove_missing(children, queued.message);
+      }
+    }
+  }
+}
+
 void Manager::send_reduce_data_to_parent(
   const TagID& group_id,
   const VersionID version,
   const TagID& reduce_tag,
   gsl::span<const PublishValueVariant> value) noexcept
 {
-  const auto loc = reduce_tag_data_.find(group_id);
-  assert(loc != reduce_tag_data_.cend());
-  auto& parent_machines = loc->second.parent_machines;
-  const auto reduce_message = internal::make_submit_reduce_value(group_id, version, reduce_tag, value);
-  reduce_send_data_and_remove_missing(parent_machines, reduce_message);
-  // internal::ReduceGroupBase::Accessor::add_data(*loc->second.group, reduce_tag, value, version);
+  queue_reduce_message(
+    group_id, internal::make_submit_reduce_value(group_id, version, reduce_tag, value), ReduceTarget::parent);
 }
 
 void Manager::send_reduce_data_to_children(
@@ -1141,26 +1966,17 @@ void Manager::send_reduce_data_to_children(
   const TagID& reduce_tag,
   gsl::span<const PublishValueVariant> value) noexcept
 {
-  const auto loc = reduce_tag_data_.find(group_id);
-  assert(loc != reduce_tag_data_.cend());
-  auto& child_machines = loc->second.child_machines;
-  const auto reduce_message = internal::make_submit_reduce_value(group_id, version, reduce_tag, value);
-  for (auto& children : child_machines) {
-    reduce_send_data_and_remove_missing(children, reduce_message);
-  }
-  // internal::ReduceGroupBase::Accessor::add_data(*loc->second.group, reduce_tag, value, version);
+  queue_reduce_message(
+    group_id, internal::make_submit_reduce_value(group_id, version, reduce_tag, value), ReduceTarget::children);
 }
 
 void Manager::send_report_disconnection(
   const TagID& group_id, const MachineID& initiating_machine, const ReductionDisconnectID disconnect_id) noexcept
 {
-  const auto loc = reduce_tag_data_.find(group_id);
-  assert(loc != reduce_tag_data_.cend());
-  const auto msg = internal::make_report_reduce_disconnection(group_id, initiating_machine, disconnect_id);
-  reduce_send_data_and_remove_missing(loc->second.parent_machines, msg);
-  for (auto& children : loc->second.child_machines) {
-    reduce_send_data_and_remove_missing(children, msg);
-  }
+  queue_reduce_message(
+    group_id,
+    internal::make_report_reduce_disconnection(group_id, initiating_machine, disconnect_id),
+    ReduceTarget::parent_and_children);
 }
 
 bool Manager::handle_submit_reduce_value(
@@ -1237,6 +2053,14 @@ void Manager::init_connections_for_pending_tags() noexcept
   //   SKYNET_TRACE_LOG("\"{}\" knows {} publishers for tag {}", id_, publishers.size(), tag);
   // }
   
+  const auto now = std::chrono::steady_clock::now();
+  // Publishers from a directory that failed are skipped until their backoff is over
+  const auto waiting_to_retry = [&](const TagID& tag, const internal::PublisherInfo& publisher) noexcept {
+    const auto dir_iter = directory_publishers_.find(tag);
+    if (dir_iter == directory_publishers_.cend()) { return false; }
+    const auto retry_iter = dir_iter->second.find(publisher);
+    return retry_iter != dir_iter->second.cend() && now < retry_iter->second.next_attempt;
+  };
   for (auto tag_iter = pending_tags_.begin(); tag_iter != pending_tags_.end();) {
     const auto& tag = *tag_iter;
     const auto iter = publishers_for_tag_.find(tag);
@@ -1256,12 +2080,15 @@ void Manager::init_connections_for_pending_tags() noexcept
     }
     
     auto& publishers = iter->second; // a unordered_set<PublisherInfo>
-    if (publishers.empty()) {
-      SKYNET_TRACE_LOG("\"{}\" knows no publishers for tag \"{}\"", id_, tag);
+    const auto publisher_iter = std::find_if(publishers.cbegin(), publishers.cend(), [&](const auto& publisher) {
+      return !waiting_to_retry(tag, publisher);
+    });
+    if (publisher_iter == publishers.cend()) {
+      SKYNET_TRACE_LOG("\"{}\" knows no publishers to try now for tag \"{}\"", id_, tag);
       ++tag_iter;
     }
     else {
-      const auto& [addr, connect_to_id] = *publishers.begin(); // a PublisherInfo object
+      const auto& [addr, connect_to_id] = *publisher_iter; // a PublisherInfo object
       // Check if the machine is already a neighbor, and handle it if so
       const auto neighbor_iter = addr_to_machine_.find(internal::split_address(addr));
       if (neighbor_iter != addr_to_machine_.cend()) {
@@ -1307,9 +2134,8 @@ void Manager::init_connections_for_pending_tags() noexcept
     }
   }
   for (const auto& [addr, tag] : to_conn) {
-    internal::SocketCommunicator conn{};
     SKYNET_DEBUG_LOG("\"{}\" about to connect to \"{}\" for tag \"{}\"", id_, addr, tag);
-    const auto err = conn.connect_non_blocking(addr);
+    auto [conn, err] = start_connection(internal::split_address(addr));
     if (err == internal::ConnectionError::connection_in_progress || err == internal::ConnectionError::no_error) {
       // Port can be recycled, so have to iterate until it gets inserted
       // Ignore the address as the IP isn't initialized until the connection is complete
@@ -1328,6 +2154,7 @@ void Manager::init_connections_for_pending_tags() noexcept
         if (inserted)
         {
           SKYNET_DEBUG_LOG("\"{}\" connecting to \"{}\" for tag \"{}\"", id_, iter->first, tag);
+          watch_pending_conn(iter);
           break;
         }
         ++port;
@@ -1337,14 +2164,37 @@ void Manager::init_connections_for_pending_tags() noexcept
   std::for_each(to_delete.rbegin(), to_delete.rend(), [&](const auto& iter) { pending_tags_.erase(iter); });
 }
 
+void Manager::watch_pending_conn(decltype(pending_conns_)::iterator iter) noexcept
+{
+  event_loop_.add(iter->second.conn.native_handle(), true);
+  handshake_timers_.schedule(iter->first, std::chrono::steady_clock::now() + internal::handshake_timeout);
+}
+
+auto Manager::erase_pending_conn(decltype(pending_conns_)::iterator iter) noexcept -> decltype(pending_conns_)::iterator
+{
+  // Does nothing if the connection was moved into a neighbor
+  event_loop_.remove(iter->second.conn.native_handle());
+  handshake_timers_.cancel(iter->first);
+  return pending_conns_.erase(iter);
+}
+
 bool Manager::conn_is_complete(const AddrPortPair& address) noexcept
 {
-  return pending_conns_.find(address) == pending_conns_.cend();
+  const bool is_awaiting = std::any_of(
+    awaiting_resolution_.cbegin(), awaiting_resolution_.cend(), [&](const AwaitingResolution& awaiting) {
+      return awaiting.address == address;
+    });
+  if (is_awaiting) { return false; }
+  // Nothing was attempted if the lookup failed
+  const auto canonical = known_canonical(address);
+  return !canonical || pending_conns_.find(*canonical) == pending_conns_.cend();
 }
 
 bool Manager::addr_is_connected(const AddrPortPair& address) const noexcept
 {
-  const auto iter = addr_to_machine_.find(address);
+  const auto canonical = known_canonical(address);
+  if (!canonical) { return false; }
+  const auto iter = addr_to_machine_.find(*canonical);
   if (iter == addr_to_machine_.cend()) { return false; }
   return !iter->second->is_dead();
 }
@@ -1372,12 +2222,35 @@ void Manager::process_pending_conns() noexcept
 {
   bool new_pending_tags = false;
   // TODO: Move this into its own function?  It isn't used anywhere else...
-  const auto handle_error = [&](PendingInfo& info) {
+  const auto handle_error = [&](const AddrPortPair& address, PendingInfo& info) {
     const auto handle_tag = [&](const std::string& pub_tag, const std::string& base_tag) {
       new_pending_tags = true;
       const auto pub_iter = publishers_for_tag_.find(pub_tag);
       assert(pub_iter != publishers_for_tag_.cend());
       auto& publishers = pub_iter->second;
+      // A publisher from the directory that still can't be reached is left to discovery
+      if (const auto dir_iter = directory_publishers_.find(pub_tag); dir_iter != directory_publishers_.end()) {
+        const auto now = std::chrono::steady_clock::now();
+        auto& known = dir_iter->second;
+        for (auto known_iter = known.begin(); known_iter != known.end();) {
+          auto& [known_info, retry] = *known_iter;
+          if (internal::split_address(known_info.address) != address) {
+            ++known_iter;
+            continue;
+          }
+          // Back off instead of reconnecting straight away
+          if (now < retry.retry_until) {
+            retry.next_attempt = now + retry.backoff;
+            retry.backoff = std::min(retry.backoff * 2, internal::connect_retry_max_backoff);
+            ++known_iter;
+            continue;
+          }
+          SKYNET_WARN_LOG("\"{}\" couldn't reach {} from the directory for tag \"{}\"", id_, known_info.address, pub_tag);
+          if (publishers.erase(known_info) != 0) { publishers_changed(pub_tag); }
+          known_iter = known.erase(known_iter);
+        }
+        if (known.empty()) { directory_publishers_.erase(dir_iter); }
+      }
       // Set to ignore cache if there are no more publishers
       if (publishers.empty()) {
         SKYNET_TRACE_LOG("\"{}\" ran out of publishers for tag \"{}\", look for new ones.", id_, info.tag);
@@ -1418,6 +2291,21 @@ void Manager::process_pending_conns() noexcept
     } break;
     }
   };
+  for (const auto& address : handshake_timers_.advance(std::chrono::steady_clock::now())) {
+    const auto iter = pending_conns_.find(address);
+    if (iter == pending_conns_.end()) { continue; }
+    SKYNET_WARN_LOG(
+      "\"{}\" timed out connecting to {}, type {}, tag \"{}\"",
+      id_,
+      address,
+      to_c_str(iter->second.type),
+      iter->second.tag);
+    handle_error(address, iter->second);
+    notify_connection_ = true;
+    // IP subscriptions wait on the subscription CV
+    notify_subscriptions_ |= iter->second.type == ConnType::specific_ip;
+    erase_pending_conn(iter);
+  }
   for (auto iter = pending_conns_.begin(); iter != pending_conns_.end();) {
     // I don't like this okay variable, but I can't think of a better way
     bool okay = true;
@@ -1436,10 +2324,12 @@ void Manager::process_pending_conns() noexcept
         const auto message = make_handshake();
         if (info.conn.send_message(message.data(), message.size()) != internal::ConnectionError::no_error) {
           notify_connection_ = true;
-          iter = pending_conns_.erase(iter);
+          iter = erase_pending_conn(iter);
           continue;
         }
         info.status = ConnStatus::waiting_for_resp;
+        // Connected, so now only the response is of interest
+        event_loop_.set_want_write(info.conn.native_handle(), false);
       } break;
 
       // Anything else is an error
@@ -1451,108 +2341,124 @@ void Manager::process_pending_conns() noexcept
           SKYNET_WARN_LOG(
                           "\"{}\" errored trying to connect to {}, type {}", id_, iter->first, to_c_str(info.type));
           
-        handle_error(info);
+        handle_error(iter->first, info);
         notify_connection_ = true;
-        iter = pending_conns_.erase(iter);
+        iter = erase_pending_conn(iter);
         okay = false;
         break;
       }
     }
     else if (info.status == ConnStatus::waiting_for_resp) {
-      // TODO: Add timeout here?
       // Try to read message from the connection
-      const auto bytes_to_read_or_error = read_network_size(info.conn);
-      if (std::holds_alternative<internal::ConnectionError>(bytes_to_read_or_error)) {
-        const auto err = *std::get_if<internal::ConnectionError>(&bytes_to_read_or_error);
-        if (err != internal::ConnectionError::would_block) { okay = false; }
+      const auto err = info.receive_buffer.fill(info.conn);
+      if (err != internal::ConnectionError::no_error && err != internal::ConnectionError::would_block) {
+        okay = false;
       }
-      else {
-        const auto bytes_to_read = *std::get_if<NetworkSizeType>(&bytes_to_read_or_error);
-        if (const auto message_buffer = internal::read_chunked(info.conn, bytes_to_read); !message_buffer.empty()) {
-          if (const auto msg = internal::MessageHandler::try_to_create(message_buffer)) {
-            decltype(neighbors_)::iterator new_neighbor_iter;
-            okay &= msg->do_callback(
-              [&](const internal::Greeting& greeting) {
-                // add connection to active list / remove from pending list
-                auto [neighbor_iter, inserted] = neighbors_.try_emplace(
-                  greeting.from(), std::move(info.conn), greeting.from(), greeting.neighbors(), *this, greeting.port());
-                new_neighbor_iter = neighbor_iter;
-                if (!inserted) {
-                  SKYNET_TRACE_LOG(
-                    "\"{}\" already has a connection from \"{}\" so will simply add to communicators.",
-                    id_,
-                    neighbor_iter->first);
-                  new_neighbor_iter->second.add_communicator(std::move(info.conn));
-                  return true;
-                }
-                addr_to_machine_.try_emplace(new_neighbor_iter->second.address_pair(), &neighbor_iter->second);
-                SKYNET_TRACE_LOG("\"{}\" received greeting from \"{}\"", id_, neighbor_iter->first);
+      else if (const auto frame = info.receive_buffer.next_frame()) {
+        if (const auto msg = internal::MessageHandler::try_to_create(*frame)) {
+          decltype(neighbors_)::iterator new_neighbor_iter;
+          // Grab this now since the connection is moved into the neighbor
+          const int conn_handle = info.conn.native_handle();
+          const bool in_process = info.conn.is_in_process();
+          okay &= msg->do_callback(
+            [&](const internal::Greeting& greeting) {
+              // add connection to active list / remove from pending list
+              // Anything received after the greeting stays with the connection
+              auto [neighbor_iter, inserted] = neighbors_.try_emplace(
+                greeting.from(),
+                std::move(info.conn),
+                greeting.from(),
+                greeting.neighbors(),
+                *this,
+                greeting.port(),
+                std::move(info.receive_buffer));
+              new_neighbor_iter = neighbor_iter;
+              if (!inserted) {
+                SKYNET_TRACE_LOG(
+                  "\"{}\" already has a connection from \"{}\" so will simply add to communicators.",
+                  id_,
+                  neighbor_iter->first);
+                new_neighbor_iter->second.add_communicator(std::move(info.conn), std::move(info.receive_buffer));
+                watch_neighbor_socket(conn_handle, new_neighbor_iter->second);
                 return true;
-              },
-              [&](...) {
-                SKYNET_WARN_LOG("\"{}\" received unexpected message from \"{}\", expected greeting", id_, iter->first);
-                return false;
-              });
-            if (okay) {
-              SKYNET_TRACE_LOG("\"{}\" finalizing connection to \"{}\" for tag \"{}\"", id_, iter->first, info.tag);
-              switch (info.type) {
-              case ConnType::by_accept:
-              case ConnType::user_requested:
-                break;
-
-              case ConnType::reduce_group: {
-                const auto tag_str_view = internal::split(info.tag, '\0');
-                for (const auto& tag : tag_str_view) {
-                  finalize_reduce_group(new_neighbor_iter->first, group_from_parent_tag(TagID{tag}).first);
-                }
-              } break;
-
-              case ConnType::subscription:
-                finalize_subscription(info.tag, new_neighbor_iter->second);
-                break;
-
-              case ConnType::specific_ip: {
-                auto& new_neighbor = new_neighbor_iter->second;
-                // Erroring is different here because the tag shouldn't be marked as being wanted
-                // Furthermore, specific IP uses the subscription CV, not the connection one
-                const auto on_error = [&]() {
-                  new_neighbor.mark_as_dead();
-                  iter = pending_conns_.erase(iter);
-                  notify_subscriptions_ = true;
-                };
-                const auto ip_and_tag = internal::split(info.tag, '\0', 2);
-                assert(ip_and_tag.size() == 2);
-                const auto expected_ip = ip_and_tag[0];
-                const auto tags = ip_and_tag[1];
-                if (new_neighbor.address() != expected_ip) {
-                  SKYNET_ERROR_LOG(
-                    "Neighbor IP \"{}\" didn't match with expected IP \"{}\"!", new_neighbor.address(), expected_ip);
-                  on_error();
-                  continue;
-                }
-                finalize_subscription(std::string{tags}, new_neighbor);
-              } break;
               }
-              // These will always happen at the end
-              notify_of_new_neighbor(new_neighbor_iter->first);
-              find_publishers_for_pending_tags();
-              // Finally, remove the pending connection and re-loop
-              notify_connection_ = true;
-              iter = pending_conns_.erase(iter);
-              continue;
+              watch_neighbor_socket(conn_handle, neighbor_iter->second);
+              addr_to_machine_.try_emplace(new_neighbor_iter->second.address_pair(), &neighbor_iter->second);
+              heartbeat_timers_.schedule(greeting.from(), std::chrono::steady_clock::now() + heartbeat_interval_);
+              // Nothing has been asked of a new neighbor yet
+              tag_request_due_.insert(greeting.from());
+              // Both sides know whether they share a host, so only one of them offers
+              const auto& host_id = internal::host_identity();
+              if (!in_process && !host_id.empty() && greeting.host_id() == host_id && id_ < greeting.from()) {
+                neighbor_iter->second.offer_shared_memory();
+              }
+              SKYNET_TRACE_LOG("\"{}\" received greeting from \"{}\"", id_, neighbor_iter->first);
+              return true;
+            },
+            [&](...) {
+              SKYNET_WARN_LOG("\"{}\" received unexpected message from \"{}\", expected greeting", id_, iter->first);
+              return false;
+            });
+          if (okay) {
+            SKYNET_TRACE_LOG("\"{}\" finalizing connection to \"{}\" for tag \"{}\"", id_, iter->first, info.tag);
+            switch (info.type) {
+            case ConnType::by_accept:
+            case ConnType::user_requested:
+              break;
+
+            case ConnType::reduce_group: {
+              const auto tag_str_view = internal::split(info.tag, '\0');
+              for (const auto& tag : tag_str_view) {
+                finalize_reduce_group(new_neighbor_iter->first, group_from_parent_tag(TagID{tag}).first);
+              }
+            } break;
+
+            case ConnType::subscription:
+              finalize_subscription(info.tag, new_neighbor_iter->second);
+              break;
+
+            case ConnType::specific_ip: {
+              auto& new_neighbor = new_neighbor_iter->second;
+              // Erroring is different here because the tag shouldn't be marked as being wanted
+              // Furthermore, specific IP uses the subscription CV, not the connection one
+              const auto on_error = [&]() {
+                new_neighbor.mark_as_dead();
+                iter = erase_pending_conn(iter);
+                notify_subscriptions_ = true;
+              };
+              const auto ip_and_tag = internal::split(info.tag, '\0', 2);
+              assert(ip_and_tag.size() == 2);
+              const auto expected_ip = ip_and_tag[0];
+              const auto tags = ip_and_tag[1];
+              if (new_neighbor.address() != expected_ip) {
+                SKYNET_ERROR_LOG(
+                  "Neighbor IP \"{}\" didn't match with expected IP \"{}\"!", new_neighbor.address(), expected_ip);
+                on_error();
+                continue;
+              }
+              finalize_subscription(std::string{tags}, new_neighbor);
+            } break;
             }
+            // These will always happen at the end
+            new_neighbor_iter->second.handle_messages_received_early();
+            notify_of_new_neighbor(new_neighbor_iter->first);
+            find_publishers_for_pending_tags();
+            // Finally, remove the pending connection and re-loop
+            notify_connection_ = true;
+            iter = erase_pending_conn(iter);
+            continue;
           }
-          else {
-            okay = false;
-          }
+        }
+        else {
+          okay = false;
         }
       }
       if (!okay) {
         SKYNET_WARN_LOG(
           "\"{}\" failed connecting to {} for tag \"{}\"", id_, info.conn.ip_address_and_port(), info.tag);
         notify_connection_ = true;
-        handle_error(info);
-        iter = pending_conns_.erase(iter);
+        handle_error(iter->first, info);
+        iter = erase_pending_conn(iter);
       }
     }
     if (okay) { ++iter; }
@@ -1566,7 +2472,7 @@ void Manager::process_pending_conns() noexcept
 
 std::vector<std::byte> Manager::make_handshake() const noexcept
 {
-  return internal::make_greeting(id_, make_neighbor_vector(), port_);
+  return internal::make_greeting(id_, make_neighbor_vector(), port_, internal::host_identity());
 }
 
 void Manager::finalize_reduce_group(const MachineID& parent_machine_id, const TagID& group_tag) noexcept
@@ -1591,27 +2497,17 @@ bool Manager::subscription_tags_are_produced(const internal::SubscriptionNotice&
   return true;
 }
 
-bool Manager::handle_publish_data(const internal::PublishData& msg, const internal::ExternalManager& from) noexcept
+bool Manager::handle_publish_data(
+  const internal::TagNumber tag_number,
+  const TagID& tag_id,
+  const internal::PublishData& msg,
+  const internal::ExternalManager& from) noexcept
 {
   (void)from;
-  if (const auto value = msg.value()) {
-    SKYNET_TRACE_LOG(
-      "\"{}\" received data on tag \"{}\" from \"{}\", version {}, data: {}",
-      id_,
-      msg.tag_id(),
-      from.id(),
-      msg.version(),
-      *value);
-    bool okay = true;
-    for (auto& [job_id, job] : jobs_) {
-      (void)job_id;
-      okay &= Job::Accessor::process_data(job, msg.tag_id(), *value, msg.version());
-    }
-    return okay;
-  }
-  else {
-    return false;
-  }
+  SKYNET_TRACE_LOG(
+    "\"{}\" received data on tag \"{}\" from \"{}\", version {}", id_, tag_id, from.id(), msg.version());
+  // The value is left encoded until a subscriber decodes it
+  return add_data_to_queue(tag_number, tag_id, msg);
 }
 
 void Manager::finalize_subscription(const std::string& tags, internal::ExternalManager& source) noexcept
@@ -1627,7 +2523,7 @@ void Manager::finalize_subscription(const std::string& tags, internal::ExternalM
     tag_to_machine_[tag] = &source;
   }
   const auto msg = internal::make_subscription_notice(tags_to_sub_to, false);
-  source.send_message(msg);
+  source.send_message(msg, internal::MessagePriority::control);
   notify_subscriptions_ = true;
 }
 
@@ -1635,9 +2531,10 @@ void Manager::find_publishers_for_pending_tags(const bool force_ask) noexcept
 {
   if (force_ask) {
     SKYNET_TRACE_LOG("\"{}\" forcefully asking for {}", id_, pending_tags_);
+    const auto query_id = start_publisher_query();
     for (auto& neighbor : neighbors_) {
       neighbor.second.reset_backoff_counter();
-      neighbor.second.find_publishers_for_tags(pending_tags_, make_need_one_pub(pending_tags_));
+      neighbor.second.find_publishers_for_tags(pending_tags_, make_need_one_pub(pending_tags_), query_id);
     }
   }
   else {
@@ -1648,18 +2545,69 @@ void Manager::find_publishers_for_pending_tags(const bool force_ask) noexcept
       return iter->second.empty();
     };
     std::vector<TagID> to_ask_for;
+    for (const auto& id : tag_request_timers_.advance(std::chrono::steady_clock::now())) {
+      tag_request_due_.insert(id);
+    }
     std::copy_if(pending_tags_.cbegin(), pending_tags_.cend(), std::back_inserter(to_ask_for), no_known_publishers);
-    if (!to_ask_for.empty()) {
-      for (auto& neighbor : neighbors_) {
-        if (neighbor.second.should_ask_for_tags()) {
-          neighbor.second.increase_backoff_counter();
-          neighbor.second.find_publishers_for_tags(to_ask_for, make_need_one_pub(to_ask_for));
+    if (!to_ask_for.empty() && !tag_request_due_.empty()) {
+      const auto query_id = start_publisher_query();
+      // Only the neighbors whose backoff has run out are looked at
+      for (auto iter = tag_request_due_.begin(); iter != tag_request_due_.end();) {
+        const auto neighbor_iter = neighbors_.find(*iter);
+        // The neighbor's reply will schedule the next request
+        if (neighbor_iter == neighbors_.end() || neighbor_iter->second.has_pending_tag_request()) {
+          iter = tag_request_due_.erase(iter);
+          continue;
         }
+        // Reschedules the neighbor, so move on first
+        ++iter;
+        neighbor_iter->second.increase_backoff_counter();
+        neighbor_iter->second.find_publishers_for_tags(to_ask_for, make_need_one_pub(to_ask_for), query_id);
       }
     }
   }
 }
 
+void Manager::schedule_tag_request(const MachineID& id, const std::chrono::steady_clock::time_point when) noexcept
+{
+  tag_request_due_.erase(id);
+  tag_request_timers_.schedule(id, when);
+}
+
+void Manager::send_due_heartbeats() noexcept
+{
+  const auto now = std::chrono::steady_clock::now();
+  for (const auto& id : heartbeat_timers_.advance(now)) {
+    const auto iter = neighbors_.find(id);
+    if (iter == neighbors_.end()) { continue; }
+    auto& neighbor = iter->second;
+    if (neighbor.appears_failed(now)) {
+      SKYNET_WARN_LOG("\"{}\" hasn't heard from \"{}\" in too long, marking it as dead", id_, id);
+      neighbor.mark_as_dead();
+      continue;
+    }
+    // Anything sent since it was scheduled pushes the next heartbeat back
+    heartbeat_timers_.schedule(id, neighbor.send_heartbeat_if_idle(heartbeat_interval_, now));
+  }
+}
+
+std::chrono::milliseconds Manager::time_until_next_timer() const noexcept
+{
+  std::optional<std::chrono::steady_clock::time_point> next;
+  const auto consider = [&](const auto& wheel) {
+    const auto expiry = wheel.next_expiry();
+    if (expiry && (!next || *expiry < *next)) { next = expiry; }
+  };
+  consider(heartbeat_timers_);
+  consider(tag_request_timers_);
+  consider(handshake_timers_);
+  consider(deferred_publish_timers_);
+  consider(forwarded_query_timers_);
+  if (!next) { return no_timeout; }
+  const auto until = std::chrono::ceil<std::chrono::milliseconds>(*next - std::chrono::steady_clock::now());
+  return std::max(until, std::chrono::milliseconds{0});
+}
+
 std::vector<TagID> Manager::local_tags() const noexcept
 {
   std::vector<TagID> to_ret(self_sub_count_.size());
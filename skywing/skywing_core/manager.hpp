@@ -1,13 +1,24 @@
 #ifndef SKYNET_MANAGER_HPP
 #define SKYNET_MANAGER_HPP
 
+#include "skywing_core/basic_manager_config.hpp"
 #include "skywing_core/internal/capn_proto_wrapper.hpp"
+#include "skywing_core/internal/devices/address_resolver.hpp"
+#include "skywing_core/internal/devices/event_loop.hpp"
+#include "skywing_core/internal/devices/receive_buffer.hpp"
+#include "skywing_core/internal/devices/send_queue.hpp"
+#include "skywing_core/internal/devices/shared_memory_transport.hpp"
 #include "skywing_core/internal/devices/socket_communicator.hpp"
+#include "skywing_core/internal/failure_detector.hpp"
 #include "skywing_core/internal/manager_waiter_callables.hpp"
 #include "skywing_core/internal/message_creators.hpp"
 #include "skywing_core/internal/reduce_group.hpp"
-// #include "skywing_core/basic_manager_config.hpp"
+#include "skywing_core/internal/tag_interner.hpp"
+#include "skywing_core/internal/utility/mutex_guarded.hpp"
+#include "skywing_core/internal/utility/timer_wheel.hpp"
+#include "skywing_core/internal/utility/worker_pool.hpp"
 #include "skywing_core/job.hpp"
+#include "skywing_core/publisher_directory.hpp"
 #include "skywing_core/types.hpp"
 
 #include "gsl/span"
@@ -60,6 +71,67 @@ namespace internal {
 // The default hearbeat interval
 inline static constexpr std::chrono::milliseconds default_heartbeat_interval{5000};
 
+// How long a connection has to finish connecting and greeting before it's dropped
+inline static constexpr std::chrono::milliseconds handshake_timeout{10000};
+
+// The default number of unsent bytes at which a neighbor is considered congested,
+// and the number it has to drain to before it stops being congested
+inline static constexpr std::size_t default_send_queue_high_watermark = 4 * 1024 * 1024;
+inline static constexpr std::size_t default_send_queue_low_watermark = 1024 * 1024;
+
+// The default number of hops a request for publishers may take
+inline static constexpr std::uint16_t default_discovery_ttl = 32;
+
+// How long a forwarded request for publishers waits for the neighbors it was
+// forwarded to before answering with what is known
+inline static constexpr std::chrono::milliseconds publisher_query_timeout{2000};
+
+// How long a request for publishers is remembered, so that copies of it
+// arriving by other paths are answered right away instead of forwarded
+inline static constexpr std::chrono::milliseconds publisher_query_memory{30000};
+
+// How long after being added a publisher from a directory keeps being retried
+// when it can't be reached, so that agents starting at different times can
+// still find each other
+inline static constexpr std::chrono::milliseconds directory_publisher_grace{10000};
+
+// How long a connection started by connect_to_servers waits to be retried
+// after failing; the wait doubles with each failure up to the maximum
+inline static constexpr std::chrono::milliseconds connect_retry_initial_backoff{10};
+inline static constexpr std::chrono::milliseconds connect_retry_max_backoff{1000};
+
+/** \brief How a publisher from a directory is retried while it can't be reached
+ */
+struct DirectoryRetry {
+  // Once this passes the publisher is dropped and left to discovery
+  std::chrono::steady_clock::time_point retry_until;
+
+  // How long to wait before the next attempt, and when it may happen; uses
+  // the same backoff as connect_to_servers
+  std::chrono::milliseconds backoff;
+  std::chrono::steady_clock::time_point next_attempt;
+}; // struct DirectoryRetry
+
+/** \brief Connections started together by connect_to_servers, which are done
+ * once all of them are up or time runs out
+ */
+struct ConnectionGroup {
+  enum class Status { connecting, connected, timed_out };
+
+  struct Link {
+    AddrPortPair address;
+
+    // How long to wait before the next retry, and when it may happen
+    std::chrono::milliseconds backoff;
+    std::chrono::steady_clock::time_point next_attempt;
+  };
+
+  // The links that aren't up yet
+  std::vector<Link> waiting;
+  std::chrono::steady_clock::time_point deadline;
+  Status status = Status::connecting;
+}; // struct ConnectionGroup
+
 /** \brief Tag to indicate that this connection was made by accepting a connection
  */
 struct ByAccept {};
@@ -77,18 +149,92 @@ public:
     const MachineID& id,
     const std::vector<MachineID>& neighbors,
     Manager& manager,
-    std::uint16_t port) noexcept;
+    std::uint16_t port,
+    ReceiveBuffer receive_buffer = ReceiveBuffer{}) noexcept;
 
-  /** \brief Handles any messages sent from the connection
+  /** \brief Reads what is available from the connections and handles every
+   * complete message received
+   *
+   * Equivalent to receive_data_messages followed by handle_received_messages.
    */
   void get_and_handle_messages() noexcept;
 
-  /** \brief Sends a raw message to the other manager
+  /** \brief Reads what is available from the connections and handles the
+   * published data and tag bindings at the front of what was received
+   *
+   * This only touches the connection's own state, the jobs' buffers and the
+   * manager's local subscriber index, so it may run on several neighbors at
+   * once from I/O workers while the manager thread waits.  Anything else is
+   * left for handle_received_messages so that message order is kept.
+   */
+  void receive_data_messages() noexcept;
+
+  /** \brief Handles every complete message left after receive_data_messages
+   */
+  void handle_received_messages() noexcept;
+
+  /** \brief Handles whatever arrived on the newest connection along with its
+   * greeting
+   *
+   * Those bytes were read before the connection was handed over, so the event
+   * loop won't report it as readable for them.
+   */
+  void handle_messages_received_early() noexcept;
+
+  /** \brief Queues a raw message for the other manager
+   *
+   * Nothing is sent until flush_send_queue is called, which the Manager does
+   * once per pass of its loop so that everything queued during the pass goes
+   * out together.  Control messages are sent ahead of queued data, so only
+   * messages that don't need to stay in order with data should use it.  Does
+   * nothing if the connection is marked as dead.
+   */
+  void send_message(const std::vector<std::byte>& c, MessagePriority priority = MessagePriority::data) noexcept;
+  void send_message(SharedMessage c, MessagePriority priority = MessagePriority::data) noexcept;
+
+  /** \brief Queues a publish that refers to its tag by number, sending the
+   * binding for the number first if this connection hasn't seen it yet
+   *
+   * With PublishPolicy::latest_only a version of the tag that is still
+   * waiting to be sent is replaced instead of queueing another.
+   */
+  void send_publish(
+    const TagID& tag_id,
+    TagNumber tag_number,
+    SharedMessage c,
+    PublishPolicy policy = PublishPolicy::every_version) noexcept;
+
+  /** \brief Sends as much queued data as the socket will accept
+   *
+   * Anything left over is sent when the socket becomes writable.  Marks the
+   * connection as dead if any errors other than a full socket buffer occur.
+   */
+  void flush_send_queue() noexcept;
+
+  /** \brief Same as above, but adds what was sent to the given totals instead
+   * of the manager's so that it can run on an I/O worker
+   */
+  void flush_send_queue(SendStatistics& stats) noexcept;
+
+  /** \brief Offers to switch to shared memory, for a neighbor on the same host
    *
-   * Also marks the connection as dead if any errors occur.  Does nothing
-   * if the connection is marked as dead.
+   * The neighbor maps the segment and answers with a SharedMemorySwitch; each
+   * side's switch is the last thing it sends on the socket, after which the
+   * socket only carries wake-ups.  Nothing changes if the neighbor declines.
+   */
+  void offer_shared_memory() noexcept;
+
+  /** \brief Returns true if queued data is waiting for the socket to become writable
+   */
+  bool waiting_for_writable() const noexcept { return want_write_; }
+
+  /** \brief Returns true if the outbound queue is above its high watermark
    */
-  void send_message(const std::vector<std::byte>& c) noexcept;
+  bool send_queue_congested() const noexcept;
+
+  /** \brief Changes the outbound queue watermarks
+   */
+  void set_send_queue_watermarks(std::size_t high_watermark, std::size_t low_watermark) noexcept;
 
   /** \brief Returns the id of the computer this is connected to
    */
@@ -106,14 +252,39 @@ public:
    */
   bool has_neighbor(const MachineID& id) const noexcept;
 
-  /** \brief Sends a heartbeat if enough time has passed
+  /** \brief Sends a heartbeat if nothing has been sent for the interval,
+   * returning when to check again
+   *
+   * Anything sent lets the neighbor know this side is alive, so links that
+   * carry data never need heartbeats.
    */
-  void send_heartbeat_if_past_interval(std::chrono::milliseconds interval) noexcept;
+  std::chrono::steady_clock::time_point send_heartbeat_if_idle(
+    std::chrono::milliseconds interval, std::chrono::steady_clock::time_point now) noexcept;
+
+  /** \brief Returns true if the neighbor has been quiet for long enough,
+   * judging by how often it has been heard from, that it's probably gone
+   */
+  bool appears_failed(std::chrono::steady_clock::time_point now) const noexcept;
 
   /** \brief Begins the search process for the specified tags
+   *
+   * Does nothing if the remote hasn't answered the last request yet.  The
+   * neighbors asked in the same round should be given the same query_id so
+   * that copies of the request meeting elsewhere are recognized; zero starts
+   * a new query.
    */
   void find_publishers_for_tags(
-    const std::vector<TagID>& tags, const std::vector<std::uint8_t>& publishers_needed) noexcept;
+    const std::vector<TagID>& tags,
+    const std::vector<std::uint8_t>& publishers_needed,
+    std::uint64_t query_id = 0) noexcept;
+
+  /** \brief Passes on another machine's request for publishers
+   */
+  void forward_publisher_query(
+    const std::vector<TagID>& tags,
+    const std::vector<std::uint8_t>& publishers_needed,
+    std::uint64_t query_id,
+    std::uint16_t ttl) noexcept;
 
   /** \brief The address for communication with the external manager
    */
@@ -133,14 +304,24 @@ public:
    */
   bool is_subscribed_to(const TagID& tag) const noexcept;
 
-  /** \brief Returns true if tags should be asked for
+  /** \brief Returns the tags that the external manager is subscribed to
    */
-  bool should_ask_for_tags() const noexcept;
+  const std::unordered_set<TagID>& remote_subscriptions() const noexcept { return remote_subscriptions_; }
 
   /** \brief Returns true if there are pending tags
    */
   bool has_pending_tag_request() const noexcept;
 
+  /** \brief Returns the version of the manager's publisher table that the
+   * remote has been sent, zero if it needs all of it
+   */
+  std::uint64_t publisher_version_sent() const noexcept { return publisher_version_sent_; }
+
+  /** \brief Records that the remote has been sent the manager's publisher
+   * table up to a version
+   */
+  void set_publisher_version_sent(const std::uint64_t version) noexcept { publisher_version_sent_ = version; }
+
   /** \brief Resets the backoff counter
    */
   void reset_backoff_counter() noexcept;
@@ -149,11 +330,18 @@ public:
    */
   void increase_backoff_counter() noexcept;
 
-  const std::vector<MachineID>& neighbors()
+  const std::unordered_set<MachineID>& neighbors()
   { return neighbors_; }
 
-  void add_communicator(SocketCommunicator&& comm)
-  { conns_.push_back(std::move(comm)); }
+  void add_communicator(SocketCommunicator&& comm, ReceiveBuffer&& receive_buffer)
+  {
+    conns_.push_back(std::move(comm));
+    receive_buffers_.push_back(std::move(receive_buffer));
+  }
+
+  /** \brief Returns the OS handles of all of the connections
+   */
+  std::vector<int> native_handles() const noexcept;
 
 private:
   // // Read some bytes from the connection, returning false if the read failed
@@ -163,8 +351,34 @@ private:
   // // the number of bytes couldn't be read
   // std::vector<std::byte> read_from_conn(std::size_t count) noexcept;
 
-  // Attempts to get a message
-  std::optional<MessageHandler> try_to_get_message(SocketCommunicator& socket_comm) noexcept;
+  // Reads from a connection and handles the messages it completes, returning
+  // false if the connection failed
+  bool receive_from(SocketCommunicator& conn, ReceiveBuffer& receive_buffer) noexcept;
+
+  // Handles frames at the front of the buffer for as long as they are data
+  void handle_data_frames(ReceiveBuffer& receive_buffer) noexcept;
+
+  // Handles the next complete message in the buffer, returning false if there isn't one
+  bool handle_next_message(ReceiveBuffer& receive_buffer) noexcept;
+
+  // Reads from shared memory and handles the data frames at the front
+  void receive_from_shared_memory() noexcept;
+
+  // Discards the wake-ups sent on a connection, returning false if it failed
+  bool drain_wake_ups(SocketCommunicator& conn) noexcept;
+
+  // Wakes the neighbor if a send or read through shared memory found it waiting
+  void wake_shared_memory_peer() noexcept;
+
+  // Sends the switch and moves everything queued before it aside for the socket
+  void switch_to_shared_memory_sends() noexcept;
+
+  bool handle_shared_memory_offer(const SharedMemoryOffer& msg) noexcept;
+  bool handle_shared_memory_switch(const SharedMemorySwitch& msg) noexcept;
+
+  // Handlers shared by the I/O worker and manager thread paths
+  bool handle_publish_data(const PublishData& msg) noexcept;
+  bool handle_tag_binding(const TagBinding& msg) noexcept;
 
   // Handle status messages
   void handle_message(MessageHandler& handle) noexcept;
@@ -172,6 +386,12 @@ private:
   // Calculate the next time tags should be requested
   std::chrono::steady_clock::time_point calc_next_request_time() const noexcept;
 
+  // Has the manager wait until the next time tags should be requested
+  void update_request_tags_time() noexcept;
+
+  // Only ask for writability notifications while there's something queued
+  void update_write_interest() noexcept;
+
   // For talking with the external manager.  
   // See you'd think there would only be one SocketCommunicator for
   // talking to another agent, so why the vector? It's because
@@ -182,25 +402,56 @@ private:
   // to both.
   std::vector<SocketCommunicator> conns_;
 
+  // Partially received messages; receive_buffers_[i] belongs to conns_[i]
+  std::vector<ReceiveBuffer> receive_buffers_;
+
   // The id of the external manager
   MachineID id_;
 
-  // The last time the machine was heard from
-  std::chrono::steady_clock::time_point last_heard_;
+  // Judges from when the machine has been heard from whether it's still there
+  PhiAccrualFailureDetector failure_detector_;
+
+  // The last time something was queued for the machine
+  std::chrono::steady_clock::time_point last_sent_;
 
   // The neighbors that the external machine has
-  std::vector<MachineID> neighbors_;
+  std::unordered_set<MachineID> neighbors_;
+
+  // Data waiting to be sent on conns_[0], or through shared memory once
+  // switched
+  SendQueue send_queue_;
+
+  // Talks to a neighbor on the same host once negotiated; null otherwise
+  std::unique_ptr<SharedMemoryTransport> shared_memory_;
+
+  // What was queued up to and including the switch to shared memory, which
+  // still has to go out on conns_[0]
+  std::optional<SendQueue> socket_send_tail_;
+
+  // Partially received messages from shared memory, once the neighbor has switched
+  std::optional<ReceiveBuffer> shared_memory_receive_buffer_;
+
+  // The connection the neighbor switched on, which only carries wake-ups now
+  std::optional<std::size_t> wake_up_conn_;
 
   // The owning manager
   Manager* manager_;
 
-  // The time that will be waited until requesting tags again
-  std::chrono::steady_clock::time_point request_tags_time_;
-
   // Tags that the remote is subscribed for
   // std::unordered_set for fast look-up
   std::unordered_set<TagID> remote_subscriptions_;
 
+  // Tag numbers whose binding has been queued to the remote
+  std::unordered_set<TagNumber> sent_tag_bindings_;
+
+  // Tags the remote has bound to numbers for the data it sends, along with
+  // the owning manager's own number for each
+  struct ReceivedTagBinding {
+    TagID tag_id;
+    TagNumber local_number;
+  };
+  std::unordered_map<TagNumber, ReceivedTagBinding> received_tag_bindings_;
+
   // The port to use to connect to the remote machine
   std::uint16_t port_;
 
@@ -213,8 +464,19 @@ private:
   // If the connection is dead or not
   bool dead_ = false;
 
-  // If there is a request out for tags or not
-  bool pending_tag_request_ = false;
+  // The query ID of the request for tags that is out, zero if none
+  std::uint64_t pending_query_id_ = 0;
+
+  // How much of the remote's publisher table has been applied here, zero if
+  // none, so requests only get back what changed
+  std::uint64_t remote_publisher_epoch_ = 0;
+  std::uint64_t remote_publisher_version_ = 0;
+
+  // How much of the manager's publisher table has been sent to the remote
+  std::uint64_t publisher_version_sent_ = 0;
+
+  // If the event loop is watching for conns_[0] to become writable
+  bool want_write_ = false;
 }; // class ExternalManager
 } // namespace internal
 
@@ -244,12 +506,14 @@ public:
    */
   Manager(const std::uint16_t port, const MachineID& id, const std::chrono::milliseconds heartbeat_interval) noexcept;
 
-  // /** \brief Constructor for building from a file format specified in
-  //  * basic_manager_config.hpp
-  //  *
-  //  * This will block until all of the specified connections have been made
-  //  */
-  // Manager(const BuildManagerInfo& info) noexcept;
+  /** \brief Constructor for building from a file format specified in
+   * basic_manager_config.hpp
+   *
+   * This doesn't connect to anything; pass info.to_connect_to to
+   * ManagerHandle::connect_to_servers from a job to bring all of the links up
+   * at once.
+   */
+  explicit Manager(const BuildManagerInfo& info) noexcept;
 
   /** \brief Destructor; tells all neighbors that the device is dead
    */
@@ -270,41 +534,115 @@ public:
    */
   const std::string& id() const noexcept;
 
+  /** \brief Sets the number of unsent bytes to a neighbor at which it is
+   * considered congested, and the number it must drain to before it isn't
+   *
+   * Publishing to a congested neighbor still queues the data, but
+   * Job::publish returns false so that jobs can slow down.
+   *
+   * \pre low_watermark <= high_watermark
+   */
+  void set_send_queue_watermarks(std::size_t high_watermark, std::size_t low_watermark) noexcept;
+
+  /** \brief Sets how many hops requests for publishers started here may take
+   *
+   * Tags published further away than this aren't found.
+   *
+   * \pre ttl > 0
+   */
+  void set_discovery_ttl(std::uint16_t ttl) noexcept;
+
+  /** \brief Adds publishers that are known ahead of time
+   *
+   * Subscribing to a tag with a known publisher connects to it directly
+   * without asking neighbors; only tags without one are looked for.  An entry
+   * whose publisher still can't be reached once directory_publisher_grace has
+   * passed is dropped, and the tag is then looked for like any other.  Entries
+   * whose address isn't numeric are skipped.
+   */
+  void add_known_publishers(const std::vector<PublisherDirectoryEntry>& entries) noexcept;
+
+  /** \brief Reads a publisher directory file and adds its entries
+   *
+   * See read_publisher_directory for the format.
+   *
+   * \returns False if the file couldn't be read, in which case nothing is added
+   */
+  bool load_publisher_directory(const std::string& filename) noexcept;
+
+  /** \brief Returns totals for the data sent to neighbors so far
+   *
+   * Comparing messages_sent to send_calls shows how well messages are being
+   * batched together.
+   */
+  internal::SendStatistics send_statistics() const noexcept;
+
+  /** \brief Decodes received published data and flushes send queues in
+   * parallel on the given number of threads, including the one calling run
+   *
+   * Only the data path is spread out: there is still a single event loop,
+   * the manager's lock is held for the whole pass, and every other message
+   * (discovery, subscriptions, reduce groups) is handled by the thread
+   * calling run.  The default of 1 does everything on that thread.  Must be
+   * called before run.
+   */
+  void set_io_thread_count(std::size_t count) noexcept;
+
+  /** \brief Connects to other Managers in this process without sockets
+   *
+   * Registers this Manager's port in a process-wide registry.  Connections
+   * between two registered Managers, made through a loopback address, then
+   * pass already-built messages through in-memory queues instead of a socket.
+   * Must be called before run and before any connections are made.
+   */
+  void use_in_process_connections() noexcept;
+
   // Access for the Job class
   struct JobAccessor {
   private:
     friend class Job;
 
-    static void
-      publish(Manager& m, const VersionID version, const TagID& tag_id, gsl::span<PublishValueVariant> value) noexcept
+    // Doesn't use job_mut_; the interner has its own lock
+    static internal::TagNumber tag_number(Manager& m, const TagID& tag_id) noexcept
     {
-      std::lock_guard lock{m.job_mut_};
-      m.publish(version, tag_id, value);
+      return m.tag_numbers_.intern(tag_id);
     }
 
+    // Publishes are picked up from the job's queue on the manager thread
+    static void publish_queued(Manager& m) noexcept { m.event_loop_.wake(); }
+
     static void report_new_publish_tags(Manager& m, const std::vector<TagID>& tags) noexcept
     {
       std::lock_guard lock{m.job_mut_};
       m.report_new_publish_tags(tags);
+      m.event_loop_.wake();
     }
 
-    static auto subscribe(Manager& m, const std::vector<TagID>& tag_ids) noexcept
+    static auto subscribe(Manager& m, Job& job, const std::vector<TagID>& tag_ids) noexcept
     {
       std::lock_guard lock{m.job_mut_};
+      m.event_loop_.wake();
+      m.add_local_subscriber(job, tag_ids);
       return m.subscribe(tag_ids);
     }
 
     static auto create_reduce_group(Manager& m, std::unique_ptr<internal::ReduceGroupBase> group_ptr) noexcept
     {
       std::lock_guard lock{m.job_mut_};
+      m.event_loop_.wake();
       return m.create_reduce_group(std::move(group_ptr));
     }
 
-    static auto ip_subscribe(Manager& m, const AddrPortPair& addr, const std::vector<TagID>& tag_ids) noexcept
+    static auto
+      ip_subscribe(Manager& m, Job& job, const AddrPortPair& addr, const std::vector<TagID>& tag_ids) noexcept
     {
       std::lock_guard lock{m.job_mut_};
+      m.event_loop_.wake();
+      m.add_local_subscriber(job, tag_ids);
       return m.ip_subscribe(addr, tag_ids);
     }
+
+    static void job_finished(Manager& m) noexcept { m.event_loop_.wake(); }
   }; // struct JobAccessor
 
   // Accessor for the ExternalManager class
@@ -347,13 +685,62 @@ public:
       return m.subscription_tags_are_produced(msg);
     }
 
-    static bool
-      handle_publish_data(Manager& m, const internal::PublishData& msg, const internal::ExternalManager& from) noexcept
+    static bool handle_publish_data(
+      Manager& m,
+      const internal::TagNumber tag_number,
+      const TagID& tag_id,
+      const internal::PublishData& msg,
+      const internal::ExternalManager& from) noexcept
+    {
+      return m.handle_publish_data(tag_number, tag_id, msg, from);
+    }
+
+    static internal::TagNumber tag_number(Manager& m, const TagID& tag_id) noexcept
     {
-      return m.handle_publish_data(msg, from);
+      return m.tag_numbers_.intern(tag_id);
+    }
+
+    // Doesn't number the tag if it's new, as nothing here is subscribed to it
+    static internal::TagNumber known_tag_number(const Manager& m, const TagID& tag_id) noexcept
+    {
+      return m.tag_numbers_.find(tag_id);
     }
 
     static void notify_subscriptions(Manager& m) noexcept { m.notify_subscriptions_ = true; }
+
+    static void
+      add_remote_subscriber(Manager& m, const std::vector<TagID>& tags, internal::ExternalManager& from) noexcept
+    {
+      m.add_remote_subscriber(tags, from);
+    }
+
+    static void set_want_write(Manager& m, const int handle, const bool want_write) noexcept
+    {
+      m.event_loop_.set_want_write(handle, want_write);
+    }
+
+    static std::pair<std::size_t, std::size_t> send_queue_watermarks(const Manager& m) noexcept
+    {
+      return {m.send_queue_high_watermark_, m.send_queue_low_watermark_};
+    }
+
+    static std::chrono::milliseconds heartbeat_interval(const Manager& m) noexcept { return m.heartbeat_interval_; }
+
+    static std::uint64_t publisher_table_epoch(const Manager& m) noexcept { return m.publisher_table_epoch_; }
+
+    static std::uint64_t start_publisher_query(Manager& m) noexcept { return m.start_publisher_query(); }
+
+    static std::uint16_t discovery_ttl(const Manager& m) noexcept { return m.discovery_ttl_; }
+
+    static internal::SendStatistics& send_statistics(Manager& m) noexcept { return m.send_statistics_; }
+
+    static void wake(Manager& m) noexcept { m.event_loop_.wake(); }
+
+    static void schedule_tag_request(
+      Manager& m, const MachineID& id, const std::chrono::steady_clock::time_point when) noexcept
+    {
+      m.schedule_tag_request(id, when);
+    }
   }; // struct ExternalManagerAccessor
 
   struct ReduceGroupAccessor {
@@ -392,6 +779,7 @@ public:
     static auto rebuild_reduce_group(Manager& m, const TagID& group_id) noexcept
     {
       std::lock_guard<std::mutex> lock{m.job_mut_};
+      m.event_loop_.wake();
       return m.rebuild_reduce_group(group_id);
     }
   }; // struct ReduceGroupAccessor
@@ -430,6 +818,8 @@ public:
     {
       return m.addr_is_connected(address);
     }
+
+    static bool is_own_address(Manager& m, const AddrPortPair& address) noexcept { return m.is_own_address(address); }
   }; // struct WaiterAccessor
 
 private:
@@ -439,6 +829,7 @@ private:
 
   Waiter<bool> connect_to_server(const char* const address, const std::uint16_t port) noexcept;
   Waiter<bool> connect_to_server(std::string_view address) noexcept;
+  Waiter<bool> connect_to_servers(const std::vector<AddrPortPair>& addresses, std::chrono::milliseconds timeout) noexcept;
   size_t number_of_neighbors() const noexcept;
   size_t number_of_subscribers(const internal::PublishTagBase& tag) const noexcept;
   std::uint16_t port() const noexcept;
@@ -465,27 +856,61 @@ private:
    */
   void accept_pending_connections() noexcept;
 
-  /** \brief Listens for messages from neighbors and handles them if there
-   * are any.
+  /** \brief Adds an accepted connection to the pending connections
    */
-  void handle_neighbor_messages() noexcept;
+  void add_accepted_connection(internal::SocketCommunicator conn) noexcept;
 
-  /** \brief Broadcast a message to the entire network
+  /** \brief Starts connecting to an address, in-process if possible
    *
-   * \param version The message's version
-   * \param tag_id The id of the tag the message is for
-   * \param value The value to send
+   * Returns the connection and the status of the attempt.
    */
-  void publish(const VersionID version, const TagID& tag_id, gsl::span<PublishValueVariant> value) noexcept;
+  std::pair<internal::SocketCommunicator, internal::ConnectionError>
+    start_connection(const AddrPortPair& address) noexcept;
+
+  /** \brief Handles messages from the neighbors whose sockets are ready and
+   * accepts connections if a listening socket is ready.
+   */
+  void handle_neighbor_messages(const std::vector<internal::ReadyHandle>& ready) noexcept;
+
+  /** \brief Registers a connection to a neighbor with the event loop
+   */
+  void watch_neighbor_socket(int handle, internal::ExternalManager& neighbor) noexcept;
+
+  /** \brief Delivers a job's serialized publish to local jobs and subscribed neighbors
+   *
+   * \return False if any subscriber's outbound queue is congested
+   */
+  bool publish(const Job::QueuedPublish& to_publish) noexcept;
+
+  /** \brief Publishes everything in a job's queue, updating its congestion flag
+   *
+   * Publishes held back by a rate limit are kept until their send time.
+   */
+  void publish_queued_data(Job& job) noexcept;
+
+  /** \brief Sends the publishes held back by rate limits whose time has come
+   */
+  void send_deferred_publishes() noexcept;
+
+  /** \brief Sends the publish held back for a tag right away, if there is one
+   */
+  void send_deferred_publish_now(const TagID& tag_id) noexcept;
 
   // Adds data to the tag queue for a job from a message
   // Returns true if it was successful, false if something went wrong
-  bool add_data_to_queue(const internal::PublishData& msg) noexcept;
+  bool add_data_to_queue(
+    internal::TagNumber tag_number, const TagID& tag_id, const internal::PublishData& msg) noexcept;
 
-  /** \brief Notify neighbors of a new new neighbor
+  /** \brief Records a new neighbor to tell the others about in the next
+   * neighbor update
    */
   void notify_of_new_neighbor(const MachineID& id) noexcept;
 
+  /** \brief Tells all neighbors about the neighbors gained and lost since the
+   * last update in a single message
+   */
+  void send_neighbor_updates() noexcept;
+
   /** \brief Removes all dead neighbors
    */
   void remove_dead_neighbors() noexcept;
@@ -497,16 +922,37 @@ private:
   /** \brief Broadcasts a message to all neighbors that fit a criteria
    */
   template<typename Callable>
-  void send_to_neighbors_if(const std::vector<std::byte>& to_send, Callable condition) noexcept
+  void send_to_neighbors_if(
+    std::vector<std::byte> to_send,
+    Callable condition,
+    const internal::MessagePriority priority = internal::MessagePriority::data) noexcept
   {
+    const auto shared = std::make_shared<const std::vector<std::byte>>(std::move(to_send));
     for (auto&& neighbor : neighbors_) {
-      if (condition(neighbor.second)) { neighbor.second.send_message(to_send); }
+      if (condition(neighbor.second)) { neighbor.second.send_message(shared, priority); }
     }
   }
 
   /** \brief Broadcasts a message to all neighbors
    */
-  void send_to_neighbors(const std::vector<std::byte>& to_send) noexcept;
+  void send_to_neighbors(
+    std::vector<std::byte> to_send, internal::MessagePriority priority = internal::MessagePriority::data) noexcept;
+
+  /** \brief Records that a neighbor has subscribed to each of the tags
+   */
+  void add_remote_subscriber(const std::vector<TagID>& tags, internal::ExternalManager& neighbor) noexcept;
+
+  /** \brief Removes a neighbor from the remote subscriber index; called before it's destroyed
+   */
+  void remove_remote_subscriber(const internal::ExternalManager& neighbor) noexcept;
+
+  /** \brief Records that a job has a buffer for each of the tags
+   */
+  void add_local_subscriber(Job& job, const std::vector<TagID>& tag_ids) noexcept;
+
+  /** \brief Removes a job from the local subscriber index; called before it's destroyed
+   */
+  void remove_local_subscriber(const Job& job) noexcept;
 
   // Auxillary function to help with subscribe function
   bool subscribe_is_done(const std::vector<TagID>& required_tags) const noexcept;
@@ -519,6 +965,27 @@ private:
    */
   Waiter<bool> ip_subscribe(const AddrPortPair& addr, const std::vector<TagID>& tag_ids) noexcept;
 
+  /** \brief Does the work of ip_subscribe once the address is known
+   */
+  void ip_subscribe_to_canonical(const AddrPortPair& canonical_addr, const std::vector<TagID>& tag_ids) noexcept;
+
+  /** \brief Does the work of connect_to_server once the address is known
+   */
+  void connect_to_canonical(const AddrPortPair& canonical) noexcept;
+
+  /** \brief Starts the connections and IP subscriptions whose addresses have
+   * been resolved, dropping the ones that couldn't be
+   */
+  void start_resolved_connections() noexcept;
+
+  /** \brief Returns the canonical form of an address if it has been resolved
+   */
+  std::optional<AddrPortPair> known_canonical(const AddrPortPair& address) const noexcept;
+
+  /** \brief Returns true if the address is known to be this Manager's
+   */
+  bool is_own_address(const AddrPortPair& address) const noexcept;
+
   /** \brief Handles the get_publishers message
    */
   void handle_get_publishers(const internal::GetPublishers& msg, internal::ExternalManager& from) noexcept;
@@ -529,6 +996,24 @@ private:
   auto remove_tags_with_enough_publishers(const internal::GetPublishers& msg) noexcept
     -> std::pair<std::vector<TagID>, std::vector<std::uint8_t>>;
 
+  /** \brief Returns true if enough publishers are known for a tag
+   */
+  bool has_enough_publishers(const TagID& tag, std::uint8_t publishers_needed) const noexcept;
+
+  /** \brief Returns a new query ID for a request for publishers started here
+   */
+  std::uint64_t start_publisher_query() noexcept;
+
+  /** \brief Answers a forwarded request for publishers with what is known and
+   * forgets it
+   */
+  void answer_publisher_query(std::uint64_t query_id) noexcept;
+
+  /** \brief Answers forwarded requests for publishers that have waited too
+   * long and forgets old query IDs
+   */
+  void expire_publisher_queries() noexcept;
+
   /** \brief Adds the publishers and propagate the information is required
    *
    * Returns a bool indicating if the next request for publishers should ignore the cache
@@ -536,9 +1021,18 @@ private:
   void
     add_publishers_and_propagate(const internal::ReportPublishers& msg, const internal::ExternalManager& from) noexcept;
 
-  /** \brief Produce a message containing the known publishers and tags
+  /** \brief Produce a message containing the known publishers and tags that
+   * a neighbor hasn't been sent yet, and record that it has been
+   *
+   * Everything is sent if the neighbor hasn't been sent anything or asked for
+   * the whole table.
+   */
+  std::vector<std::byte>
+    make_known_tag_publisher_message(internal::ExternalManager& to, std::uint64_t query_id = 0) noexcept;
+
+  /** \brief Records that the known publishers for a tag changed
    */
-  std::vector<std::byte> make_known_tag_publisher_message() const noexcept;
+  void publishers_changed(const TagID& tag) noexcept;
 
   /** \brief Reports when new tags are being produced
    */
@@ -572,8 +1066,38 @@ private:
   /** \brief Sends a raw message to the specified ID's, removing the ID's from
    * the array if not present
    */
-  void reduce_send_data_and_remove_missing(
-    std::vector<MachineID>& machines, const std::vector<std::byte>& message) noexcept;
+  void reduce_send_data_and_remove_missing(std::vector<MachineID>& machines, const internal::SharedMessage& message) noexcept;
+
+  /** \brief Which members of a reduce group a queued reduce message is for
+   */
+  enum class ReduceTarget
+  {
+    parent,
+    children,
+    parent_and_children
+  };
+
+  /** \brief Queues a reduce message to be sent by the manager thread
+   *
+   * Reduce groups send from job threads while holding their own lock, and the
+   * manager thread takes that lock while holding job_mut_, so they can't touch
+   * the neighbors directly.
+   */
+  void queue_reduce_message(const TagID& group_id, std::vector<std::byte> message, ReduceTarget target) noexcept;
+
+  /** \brief Sends all queued reduce messages
+   */
+  void send_queued_reduce_messages() noexcept;
+
+  /** \brief Sends everything queued for neighbors that aren't already waiting
+   * for their socket to become writable
+   */
+  void flush_send_queues() noexcept;
+
+  /** \brief Flushes and reads the neighbors in io_batch_, spread across the
+   * I/O workers, then adds up what they sent
+   */
+  void run_io_batch() noexcept;
 
   /** \brief Sends a value for a reduce to the corresponding parents
    */
@@ -622,6 +1146,12 @@ private:
    */
   bool addr_is_connected(const AddrPortPair& address) const noexcept;
 
+  /** \brief Drops the links of each connection group that are up, retries
+   * the ones whose last attempt failed once their backoff has passed, and
+   * finishes the groups that are done
+   */
+  void retry_connection_groups() noexcept;
+
   /** \brief Process pending user requested connections
    */
   void process_pending_conns() noexcept;
@@ -655,8 +1185,14 @@ private:
   bool subscription_tags_are_produced(const internal::SubscriptionNotice& msg) const noexcept;
 
   /** \brief Handles published information
+   *
+   * \param tag_number This manager's number for tag_id
    */
-  bool handle_publish_data(const internal::PublishData& msg, const internal::ExternalManager& from) noexcept;
+  bool handle_publish_data(
+    internal::TagNumber tag_number,
+    const TagID& tag_id,
+    const internal::PublishData& msg,
+    const internal::ExternalManager& from) noexcept;
 
   /** \brief Finalizes a subscription connection.
    *
@@ -668,22 +1204,100 @@ private:
    */
   void find_publishers_for_pending_tags(bool force_ask = false) noexcept;
 
+  /** \brief Sets when a neighbor may next be asked for publishers
+   */
+  void schedule_tag_request(const MachineID& id, std::chrono::steady_clock::time_point when) noexcept;
+
+  /** \brief Sends heartbeats to the neighbors that haven't been sent anything
+   * within the heartbeat interval and marks the ones that appear to have
+   * failed as dead
+   */
+  void send_due_heartbeats() noexcept;
+
+  /** \brief Returns how long the event loop can wait before a timer is due,
+   * or a negative time if no timers are set
+   */
+  std::chrono::milliseconds time_until_next_timer() const noexcept;
+
   /** \brief Returns all locally produced tags as a vector
    */
   std::vector<TagID> local_tags() const noexcept;
 
+  // Readiness notifications for every socket, plus wake-ups from jobs and
+  // the heartbeat timer
+  internal::EventLoop event_loop_;
+
   // For listening to connection requests
   internal::SocketCommunicator server_socket_;
 
+  // Set by use_in_process_connections; the waker is disabled on destruction
+  // as peers may still hold it
+  std::shared_ptr<internal::InProcessWaker> in_process_waker_;
+  std::shared_ptr<internal::InProcessListener> in_process_listener_;
+
+  // Looks up the names given to connect_to_server and ip_subscribe off of this
+  // thread, waking the loop when each is done
+  internal::AddressResolver resolver_{[this]() { event_loop_.wake(); }};
+
   // List of the jobs that are present
   std::unordered_map<JobID, Job> jobs_;
 
+  // The jobs that are subscribed to each tag, by the tag's number in
+  // tag_numbers_, so that incoming data is only decoded for jobs that want it;
+  // pointers are stable as jobs_ is node based
+  std::unordered_map<internal::TagNumber, std::vector<Job*>> local_subscribers_;
+
   // List of neighboring connections
   std::unordered_map<MachineID, internal::ExternalManager> neighbors_;
 
+  // Neighbors gained (true) or lost (false) since the last neighbor update;
+  // only the latest change to each matters
+  std::unordered_map<MachineID, bool> neighbor_changes_;
+
+  // When each neighbor next needs checking for whether it's owed a heartbeat
+  // or has failed, so that only the neighbors that are due are looked at
+  internal::TimerWheel<MachineID> heartbeat_timers_;
+
+  // When each neighbor's request backoff runs out; once it has, the neighbor
+  // moves to tag_request_due_ until it's asked for publishers
+  internal::TimerWheel<MachineID> tag_request_timers_;
+  std::unordered_set<MachineID> tag_request_due_;
+
+  // Numbers for the tags published from or subscribed to here; the published
+  // ones are shared by every connection
+  internal::TagInterner tag_numbers_;
+
+  // The neighbors subscribed to each tag produced here, so that publishing
+  // and counting subscribers don't have to check every neighbor; pointers are
+  // stable as neighbors_ is node based
+  struct RemoteSubscribers {
+    internal::TagNumber tag_number = internal::no_tag_number;
+    std::vector<internal::ExternalManager*> neighbors;
+  };
+  std::unordered_map<TagID, RemoteSubscribers> remote_subscribers_;
+
+  // The newest publish on each tag held back by the job's rate limit, and
+  // when each is due to go out
+  std::unordered_map<TagID, Job::QueuedPublish> deferred_publishes_;
+  internal::TimerWheel<TagID> deferred_publish_timers_;
+
   // List of publishers that are known for each tag
   std::unordered_map<TagID, std::unordered_set<internal::PublisherInfo>> publishers_for_tag_;
 
+  // The entries of publishers_for_tag_ that came from a directory rather than
+  // discovery, and how they're being retried if they can't be reached
+  std::unordered_map<TagID, std::unordered_map<internal::PublisherInfo, internal::DirectoryRetry>>
+    directory_publishers_;
+
+  // So that only changes to publishers_for_tag_ have to be sent, the table
+  // has a version that goes up with each change, and each tag and the set of
+  // locally produced tags remember the version they last changed in.  The
+  // epoch tells this run's versions apart from any other's
+  std::uint64_t publisher_table_epoch_;
+  std::uint64_t publisher_table_version_ = 0;
+  std::unordered_map<TagID, std::uint64_t> publisher_tag_versions_;
+  std::uint64_t local_tags_version_ = 0;
+
   // A list of tags that still need to have publishers found
   std::vector<std::string> pending_tags_;
 
@@ -707,19 +1321,61 @@ private:
   // The time to send a heartbeat if nothing has been heard in the time
   std::chrono::milliseconds heartbeat_interval_;
 
+  // Outbound queue limits for new neighbors
+  std::size_t send_queue_high_watermark_ = internal::default_send_queue_high_watermark;
+  std::size_t send_queue_low_watermark_ = internal::default_send_queue_low_watermark;
+
+  // Totals for everything sent to neighbors
+  internal::SendStatistics send_statistics_;
+
+  // Threads for the per-neighbor part of reading and sending; see set_io_thread_count
+  std::unique_ptr<internal::WorkerPool> io_workers_ = std::make_unique<internal::WorkerPool>(1);
+
+  // What each I/O worker sent during the current batch
+  std::vector<internal::SendStatistics> worker_send_statistics_ = std::vector<internal::SendStatistics>(1);
+
+  // Neighbors to be worked on by the I/O workers, each appearing at most once
+  struct IoTask {
+    internal::ExternalManager* neighbor;
+    bool flush;
+    bool receive;
+  };
+  std::vector<IoTask> io_batch_;
+
+  // Reduce messages waiting for the manager thread; see queue_reduce_message
+  struct QueuedReduceMessage {
+    TagID group_id;
+    internal::SharedMessage message;
+    ReduceTarget target;
+  };
+  MutexGuarded<std::vector<QueuedReduceMessage>> reduce_outbox_;
+
   // Only allow one job access to the manager at a time
   mutable std::mutex job_mut_;
 
   // Dummy mutex - only used for custom waiters created by users
   mutable std::mutex dummy_mutex_;
 
-  // List of machines that are waiting for information for producers of a certain tag
-  // Uses MachineID's instead of pointers in case the remote machine disconnects and
-  // the ExternalManager is deleted between the time a request is started and a response
-  // is received
-  // TODO: Maybe move to pointers and just make sure to remove them when the neighbor is removed?
-  // Also potentially combine with tag_to_machine_ since they are tags into the same thing
-  std::unordered_map<TagID, std::unordered_set<MachineID>> send_publisher_information_to_;
+  // Requests for publishers that were forwarded to other neighbors, by query
+  // ID, with the machine that asked and the neighbors that haven't answered.
+  // The asker is answered once they all have, the tags have enough
+  // publishers, or the request times out.  Uses MachineID's instead of
+  // pointers in case a machine disconnects while the request is out
+  struct ForwardedQuery {
+    MachineID from;
+    std::vector<TagID> tags;
+    std::vector<std::uint8_t> publishers_needed;
+    std::unordered_set<MachineID> waiting_on;
+  };
+  std::unordered_map<std::uint64_t, ForwardedQuery> forwarded_queries_;
+  internal::TimerWheel<std::uint64_t> forwarded_query_timers_;
+
+  // Query IDs seen recently, each until it's forgotten
+  internal::TimerWheel<std::uint64_t> seen_queries_;
+
+  // The next query ID for requests started here, and how far they may go
+  std::uint64_t next_query_id_;
+  std::uint16_t discovery_ttl_ = internal::default_discovery_ttl;
 
   // The tags that this machine produces and the self-subscription count
   std::unordered_map<TagID, int> self_sub_count_;
@@ -762,9 +1418,39 @@ private:
     ConnStatus status;
     ConnType type;
     std::string tag;
+    // Holds the greeting, and anything sent right after it, until it's complete
+    internal::ReceiveBuffer receive_buffer = internal::ReceiveBuffer{};
   };
   std::unordered_map<AddrPortPair, PendingInfo> pending_conns_;
 
+  // Connections and IP subscriptions asked for by a name that is being looked up
+  struct AwaitingResolution {
+    AddrPortPair address;
+    ConnType type;
+    std::vector<TagID> tags;
+  };
+  std::vector<AwaitingResolution> awaiting_resolution_;
+
+  // Groups of connections started by connect_to_servers that aren't done yet;
+  // shared with their waiters so the result outlives them here
+  std::vector<std::shared_ptr<internal::ConnectionGroup>> connection_groups_;
+
+  // Pending connections by when their handshake has to be done by
+  internal::TimerWheel<AddrPortPair> handshake_timers_;
+
+  /** \brief Registers a new pending connection with the event loop and starts
+   * its handshake timeout
+   */
+  void watch_pending_conn(decltype(pending_conns_)::iterator iter) noexcept;
+
+  /** \brief Removes a pending connection, unregistering it from the event loop
+   */
+  decltype(pending_conns_)::iterator erase_pending_conn(decltype(pending_conns_)::iterator iter) noexcept;
+
+  // Mapping from a socket handle to the neighbor that owns it, for dispatching
+  // readiness events
+  std::unordered_map<int, internal::ExternalManager*> handle_to_neighbor_;
+
   // Notification for when new subscriptions are created
   std::condition_variable subscription_cv_;
 
@@ -801,6 +1487,21 @@ public:
     return handle_->connect_to_server(address);
   }
 
+  /** \brief Connects to several instances at once
+   *
+   * All of the connections are started right away, and each one that fails is
+   * retried with exponential backoff until the timeout, so bringing the links
+   * up takes about as long as the slowest one.
+   *
+   * \returns A waiter that finishes with true once every link is up, or with
+   * false if the timeout passes first
+   */
+  Waiter<bool>
+    connect_to_servers(const std::vector<AddrPortPair>& addresses, const std::chrono::milliseconds timeout) noexcept
+  {
+    return handle_->connect_to_servers(addresses, timeout);
+  }
+
   /** \brief Returns the number of machines connected
    */
   int number_of_neighbors() const noexcept { return handle_->number_of_neighbors(); }
@@ -838,6 +1539,10 @@ public:
    */
   std::uint16_t port() const noexcept { return handle_->port(); }
 
+  /** \brief Returns totals for the data sent to neighbors so far
+   */
+  internal::SendStatistics send_statistics() const noexcept { return handle_->send_statistics(); }
+
 private:
   friend class Job;
 
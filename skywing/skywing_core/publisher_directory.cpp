@@ -0,0 +1,36 @@
+#include "skywing_core/publisher_directory.hpp"
+
+#include "skywing_core/internal/devices/socket_communicator.hpp"
+#include "skywing_core/internal/utility/logging.hpp"
+
+#include <istream>
+#include <utility>
+
+namespace skywing {
+std::optional<std::vector<PublisherDirectoryEntry>> read_publisher_directory(std::istream& in) noexcept
+{
+  std::vector<PublisherDirectoryEntry> to_ret;
+  std::string line;
+  std::size_t line_number = 0;
+  while (std::getline(in, line)) {
+    ++line_number;
+    if (line.empty() || line[0] == '#') { continue; }
+    const auto first_tab = line.find('\t');
+    const auto second_tab = first_tab == std::string::npos ? first_tab : line.find('\t', first_tab + 1);
+    if (second_tab == std::string::npos || first_tab == 0 || second_tab + 1 == line.size()) {
+      SKYNET_WARN_LOG("Publisher directory line {} doesn't have a tag, address and machine ID", line_number);
+      return {};
+    }
+    PublisherDirectoryEntry entry{
+      internal::publish_tag_marker + line.substr(0, first_tab),
+      line.substr(first_tab + 1, second_tab - first_tab - 1),
+      line.substr(second_tab + 1)};
+    if (internal::split_address(entry.address).first.empty()) {
+      SKYNET_WARN_LOG("Publisher directory line {} has a bad address \"{}\"", line_number, entry.address);
+      return {};
+    }
+    to_ret.push_back(std::move(entry));
+  }
+  return to_ret;
+}
+} // namespace skywing
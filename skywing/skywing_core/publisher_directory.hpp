@@ -0,0 +1,39 @@
+#ifndef SKYNET_PUBLISHER_DIRECTORY_HPP
+#define SKYNET_PUBLISHER_DIRECTORY_HPP
+
+#include "skywing_core/types.hpp"
+
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace skywing {
+/** \brief A publisher known ahead of time
+ */
+struct PublisherDirectoryEntry {
+  // The full tag ID, as returned by id() on the tag
+  TagID tag;
+
+  // Numeric IPv4 address (or "localhost") and port of the publishing Manager
+  std::string address;
+
+  // ID of the publishing Manager
+  MachineID machine_id;
+}; // struct PublisherDirectoryEntry
+
+/** \brief Reads a directory of publishers that are known ahead of time
+ *
+ * Each line has three fields separated by tabs:
+ * ```
+ * publish tag name	address:port	machine ID
+ * ```
+ * The tag name is the one the PublishTag is constructed with.  Empty lines
+ * and lines starting with '#' are ignored.
+ *
+ * \returns The entries, or nothing if any line is malformed.
+ */
+std::optional<std::vector<PublisherDirectoryEntry>> read_publisher_directory(std::istream& in) noexcept;
+} // namespace skywing
+
+#endif // SKYNET_PUBLISHER_DIRECTORY_HPP
@@ -13,16 +13,14 @@ namespace skywing::helper
     const std::vector<std::tuple<std::string, uint16_t>>& neighbor_addresses, 
     std::chrono::seconds timeout)
   {
-    std::chrono::time_point<std::chrono::steady_clock> time_limit = 
-      std::chrono::steady_clock::now() + timeout;
+    // All of the links are brought up at once, each retrying on its own
+    std::vector<skywing::AddrPortPair> addresses;
     for (const auto& [ip, port] : neighbor_addresses) {
-      while (!manager_handle.connect_to_server(ip.data(), port).get()) {
-        if (std::chrono::steady_clock::now() > time_limit) {
-          std::cerr << "Took too long to connect to " << port << std::endl;
-          std::exit(-1);
-        }
-        std::this_thread::sleep_for(LOOP_DELAY);
-      }
+      addresses.emplace_back(ip, port);
+    }
+    if (!manager_handle.connect_to_servers(addresses, timeout).get()) {
+      std::cerr << "Took too long to connect to neighbors" << std::endl;
+      std::exit(-1);
     }
   }
 
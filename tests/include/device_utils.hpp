@@ -0,0 +1,90 @@
+#ifndef SKYNET_TEST_DEVICE_UTILS_HPP
+#define SKYNET_TEST_DEVICE_UTILS_HPP
+
+#include <catch2/catch.hpp>
+
+#include "skywing_core/internal/devices/event_loop.hpp"
+#include "skywing_core/internal/devices/receive_buffer.hpp"
+#include "skywing_core/internal/devices/socket_communicator.hpp"
+#include "skywing_core/internal/devices/transport.hpp"
+#include "skywing_core/internal/utility/network_conv.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace skywing {
+// Makes size bytes counting up from start, so what arrives can be checked
+// against what was sent
+std::vector<std::byte> make_bytes(const std::size_t size, const std::uint8_t start)
+{
+  std::vector<std::byte> bytes(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    bytes[i] = static_cast<std::byte>(static_cast<std::uint8_t>(start + i));
+  }
+  return bytes;
+}
+
+// Same as above, but in the form that is queued for sending
+internal::SharedMessage make_message(const std::size_t size, const std::uint8_t start)
+{
+  return std::make_shared<const std::vector<std::byte>>(make_bytes(size, start));
+}
+
+// Makes a length-prefixed frame whose body is size bytes counting up from start
+internal::SharedMessage make_frame(const std::size_t size, const std::uint8_t start)
+{
+  const auto size_bytes = internal::to_network_bytes(static_cast<NetworkSizeType>(size));
+  std::vector<std::byte> bytes{size_bytes.cbegin(), size_bytes.cend()};
+  const auto body = make_bytes(size, start);
+  bytes.insert(bytes.end(), body.cbegin(), body.cend());
+  return std::make_shared<const std::vector<std::byte>>(std::move(bytes));
+}
+
+// Returns how much a read or write moved, which must not have failed
+std::size_t sent_amount(const std::variant<std::size_t, internal::ConnectionError>& result)
+{
+  REQUIRE(std::holds_alternative<std::size_t>(result));
+  return std::get<std::size_t>(result);
+}
+
+// Returns true if the handle was reported ready, and readable if want_readable is set
+bool contains_handle(const std::vector<internal::ReadyHandle>& ready, const int handle, const bool want_readable = false)
+{
+  return std::any_of(ready.cbegin(), ready.cend(), [&](const internal::ReadyHandle& h) {
+    return h.handle == handle && (!want_readable || h.readable);
+  });
+}
+
+// Connects a pair of sockets through a listening socket, returning the
+// connecting end first
+std::pair<internal::SocketCommunicator, internal::SocketCommunicator> make_connected_pair(const std::uint16_t listen_port)
+{
+  internal::SocketCommunicator server;
+  REQUIRE(server.set_to_listen(listen_port) == internal::ConnectionError::no_error);
+  internal::SocketCommunicator client;
+  REQUIRE(client.connect_to_server("127.0.0.1", listen_port) == internal::ConnectionError::no_error);
+  while (true) {
+    if (auto accepted = server.accept()) { return {std::move(client), std::move(*accepted)}; }
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+}
+
+// Fills until something is read, giving up after a while
+internal::ConnectionError fill_when_ready(internal::ReceiveBuffer& buffer, internal::SocketCommunicator& conn)
+{
+  for (int i = 0; i < 1000; ++i) {
+    const auto err = buffer.fill(conn);
+    if (err != internal::ConnectionError::would_block) { return err; }
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+  return internal::ConnectionError::would_block;
+}
+} // namespace skywing
+
+#endif // SKYNET_TEST_DEVICE_UTILS_HPP
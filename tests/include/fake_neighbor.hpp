@@ -0,0 +1,68 @@
+#ifndef SKYNET_TEST_FAKE_NEIGHBOR_HPP
+#define SKYNET_TEST_FAKE_NEIGHBOR_HPP
+
+#include <catch2/catch.hpp>
+
+#include "skywing_core/internal/capn_proto_wrapper.hpp"
+#include "skywing_core/internal/devices/receive_buffer.hpp"
+#include "skywing_core/internal/devices/socket_communicator.hpp"
+#include "skywing_core/internal/message_creators.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace skywing {
+// Stands in for a Manager on the other end of a connection, so a test can see
+// exactly what a real Manager sends and send it things a real one wouldn't
+class FakeNeighbor {
+public:
+  // Connects to the Manager listening on port and greets it, sending
+  // sent_with_greeting in the same write.  The Manager greets back once it
+  // runs; that and anything else not waited for is skipped by wait_for
+  FakeNeighbor(
+    const std::uint16_t port,
+    const MachineID& id,
+    const std::vector<MachineID>& neighbors = {},
+    const std::vector<std::byte>& sent_with_greeting = {})
+  {
+    REQUIRE(conn_.connect_to_server("127.0.0.1", port) == internal::ConnectionError::no_error);
+    auto greeting = internal::make_greeting(id, neighbors, 0, "");
+    greeting.insert(greeting.end(), sent_with_greeting.cbegin(), sent_with_greeting.cend());
+    send(greeting);
+  }
+
+  void send(const std::vector<std::byte>& message)
+  {
+    REQUIRE(conn_.send_message(message.data(), message.size()) == internal::ConnectionError::no_error);
+  }
+
+  // Passes each message received to on_message until it accepts one by
+  // returning true, discarding any it can't take; false if none is accepted
+  // before the timeout
+  template<typename Callable>
+  bool wait_for(Callable on_message, const std::chrono::milliseconds timeout = std::chrono::seconds{5})
+  {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (std::chrono::steady_clock::now() < deadline) {
+      while (const auto frame = buffer_.next_frame()) {
+        const auto handler = internal::MessageHandler::try_to_create(*frame);
+        REQUIRE(handler);
+        if (handler->do_callback(Callable{on_message}, [](...) { return false; })) { return true; }
+      }
+      const auto err = buffer_.fill(conn_);
+      REQUIRE((err == internal::ConnectionError::no_error || err == internal::ConnectionError::would_block));
+      if (err == internal::ConnectionError::would_block) { std::this_thread::sleep_for(std::chrono::milliseconds{1}); }
+    }
+    return false;
+  }
+
+private:
+  internal::SocketCommunicator conn_;
+  internal::ReceiveBuffer buffer_;
+}; // class FakeNeighbor
+} // namespace skywing
+
+#endif // SKYNET_TEST_FAKE_NEIGHBOR_HPP
@@ -0,0 +1,80 @@
+#include <catch2/catch.hpp>
+
+#include "skywing_core/skywing.hpp"
+
+#include "utils.hpp"
+
+#include <sstream>
+#include <thread>
+
+using namespace skywing;
+
+const std::uint16_t center_port = get_starting_port();
+constexpr std::uint16_t num_outer = 3;
+
+TEST_CASE("Manager config files are read", "[Skywing_Bootstrap]")
+{
+  std::istringstream in{"center\n"
+                        "40000\n"
+                        "500\n"
+                        "127.0.0.1:40001\n"
+                        "\n"
+                        "localhost:40002\n"};
+  const auto info = read_manager_config(in);
+  REQUIRE(info);
+  REQUIRE(info->name == "center");
+  REQUIRE(info->port == 40000);
+  REQUIRE(info->heartbeat_interval_in_ms == 500);
+  REQUIRE(info->to_connect_to == std::vector<AddrPortPair>{{"127.0.0.1", 40001}, {"localhost", 40002}});
+
+  std::istringstream no_port{"center\n40000\n500\n127.0.0.1\n"};
+  REQUIRE(!read_manager_config(no_port));
+}
+
+TEST_CASE("Connecting to several servers retries until all are up", "[Skywing_Bootstrap]")
+{
+  std::atomic<bool> done = false;
+  std::vector<AddrPortPair> outer_addresses;
+  for (std::uint16_t i = 1; i <= num_outer; ++i) {
+    outer_addresses.emplace_back("127.0.0.1", center_port + i);
+  }
+  std::ostringstream config;
+  config << "center\n" << center_port << "\n1000\n";
+  for (const auto& [address, port] : outer_addresses) {
+    config << address << ':' << port << '\n';
+  }
+  std::istringstream config_in{config.str()};
+  const auto info = read_manager_config(config_in);
+  REQUIRE(info);
+
+  // The other side isn't listening yet, so the first attempts fail
+  std::thread outer{[&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds{200});
+    std::vector<std::unique_ptr<Manager>> managers;
+    std::vector<std::thread> threads;
+    for (std::uint16_t i = 1; i <= num_outer; ++i) {
+      managers.push_back(std::make_unique<Manager>(center_port + i, "outer " + std::to_string(i)));
+      managers.back()->submit_job("job", [&](Job&, ManagerHandle) {
+        while (!done) {
+          std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+      });
+    }
+    for (auto& manager : managers) {
+      threads.emplace_back([&manager]() { manager->run(); });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }};
+
+  Manager manager{*info};
+  manager.submit_job("job", [&](Job&, ManagerHandle handle) {
+    REQUIRE(handle.connect_to_servers(info->to_connect_to, std::chrono::seconds{5}).get());
+    REQUIRE(handle.number_of_neighbors() == num_outer);
+    REQUIRE(!handle.connect_to_servers({{"127.0.0.1", center_port + num_outer + 1}}, std::chrono::milliseconds{300}).get());
+    done = true;
+  });
+  manager.run();
+  outer.join();
+}
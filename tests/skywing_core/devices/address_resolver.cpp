@@ -0,0 +1,45 @@
+#include <catch2/catch.hpp>
+
+#include "skywing_core/internal/devices/address_resolver.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace skywing::internal;
+using namespace std::chrono_literals;
+
+using Status = AddressResolver::Status;
+
+TEST_CASE("Numeric addresses resolve without a lookup", "[Skywing_AddressResolver]")
+{
+  std::atomic<int> num_done{0};
+  AddressResolver resolver{[&]() { ++num_done; }};
+  const auto numeric = resolver.resolve("127.0.0.1");
+  REQUIRE(numeric.status == Status::resolved);
+  REQUIRE(numeric.address == "127.0.0.1");
+  const auto local = resolver.find("localhost");
+  REQUIRE(local.status == Status::resolved);
+  REQUIRE(local.address == "127.0.0.1");
+  REQUIRE(num_done == 0);
+}
+
+TEST_CASE("Unresolvable names fail and are remembered", "[Skywing_AddressResolver]")
+{
+  std::atomic<int> num_done{0};
+  AddressResolver resolver{[&]() { ++num_done; }};
+  // The .invalid top level domain is reserved and never resolves
+  const std::string host = "skywing-test.invalid";
+  REQUIRE(resolver.find(host).status == Status::pending);
+  REQUIRE(resolver.resolve(host).status == Status::pending);
+  const auto give_up_at = std::chrono::steady_clock::now() + 30s;
+  while (num_done == 0 && std::chrono::steady_clock::now() < give_up_at) {
+    std::this_thread::sleep_for(10ms);
+  }
+  REQUIRE(num_done == 1);
+  REQUIRE(resolver.find(host).status == Status::failed);
+  // Not retried right away
+  REQUIRE(resolver.resolve(host).status == Status::failed);
+  std::this_thread::sleep_for(50ms);
+  REQUIRE(num_done == 1);
+}
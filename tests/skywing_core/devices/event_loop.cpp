@@ -0,0 +1,154 @@
+#include <catch2/catch.hpp>
+
+#include "skywing_core/internal/devices/event_loop.hpp"
+#include "skywing_core/internal/devices/receive_buffer.hpp"
+#include "skywing_core/internal/devices/send_queue.hpp"
+#include "skywing_core/internal/devices/socket_communicator.hpp"
+
+#include "device_utils.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace skywing;
+using namespace skywing::internal;
+using namespace std::chrono_literals;
+
+constexpr std::uint16_t port = 40010;
+
+namespace {
+std::vector<std::byte> body_of(const SharedMessage& frame)
+{
+  return std::vector<std::byte>(frame->cbegin() + sizeof(NetworkSizeType), frame->cend());
+}
+} // namespace
+
+TEST_CASE("Event loop times out when nothing happens", "[Skywing_EventLoop]")
+{
+  EventLoop loop;
+  const auto start = std::chrono::steady_clock::now();
+  const auto& ready = loop.wait(20ms);
+  REQUIRE(ready.empty());
+  REQUIRE(!loop.was_woken());
+  REQUIRE(!loop.timer_fired());
+  REQUIRE(std::chrono::steady_clock::now() - start >= 15ms);
+}
+
+TEST_CASE("Event loop can be woken from another thread", "[Skywing_EventLoop]")
+{
+  EventLoop loop;
+  std::thread waker{[&]() {
+    std::this_thread::sleep_for(10ms);
+    loop.wake();
+    loop.wake();
+  }};
+  loop.wait(std::chrono::milliseconds{-1});
+  waker.join();
+  REQUIRE(loop.was_woken());
+  // Repeated wakes are coalesced, so the next wait shouldn't return right away
+  loop.wait(0ms);
+  REQUIRE(!loop.was_woken());
+}
+
+TEST_CASE("Event loop periodic timer fires", "[Skywing_EventLoop]")
+{
+  EventLoop loop;
+  loop.set_periodic_timer(5ms);
+  int times_fired = 0;
+  const auto end = std::chrono::steady_clock::now() + 100ms;
+  while (std::chrono::steady_clock::now() < end) {
+    loop.wait(std::chrono::milliseconds{-1});
+    times_fired += loop.timer_fired();
+  }
+  REQUIRE(times_fired >= 5);
+}
+
+TEST_CASE("Event loop reports socket readiness", "[Skywing_EventLoop]")
+{
+  EventLoop loop;
+  SocketCommunicator server;
+  REQUIRE(server.set_to_listen(port) == ConnectionError::no_error);
+  REQUIRE(loop.add(server.native_handle()));
+  SocketCommunicator client;
+  REQUIRE(client.connect_non_blocking("127.0.0.1", port) == ConnectionError::connection_in_progress);
+  // The client becomes writable once connected
+  REQUIRE(loop.add(client.native_handle(), true));
+  bool client_connected = false;
+  bool server_has_conn = false;
+  while (!client_connected || !server_has_conn) {
+    const auto& ready = loop.wait(1000ms);
+    REQUIRE(!ready.empty());
+    client_connected |= contains_handle(ready, client.native_handle(), false);
+    server_has_conn |= contains_handle(ready, server.native_handle(), true);
+  }
+  REQUIRE(loop.set_want_write(client.native_handle(), false));
+  auto accepted = server.accept();
+  REQUIRE(accepted);
+  REQUIRE(loop.add(accepted->native_handle()));
+  // Nothing has been sent, so nothing should be ready
+  REQUIRE(loop.wait(10ms).empty());
+  std::array<std::byte, 4> buffer{};
+  REQUIRE(client.send_message(buffer.data(), buffer.size()) == ConnectionError::no_error);
+  REQUIRE(contains_handle(loop.wait(1000ms), accepted->native_handle(), true));
+  REQUIRE(accepted->read_message(buffer.data(), buffer.size()) == ConnectionError::no_error);
+  loop.remove(accepted->native_handle());
+  REQUIRE(client.send_message(buffer.data(), buffer.size()) == ConnectionError::no_error);
+  REQUIRE(loop.wait(10ms).empty());
+}
+
+TEST_CASE("Event loop carries data between registered sockets", "[Skywing_EventLoop]")
+{
+  EventLoop loop;
+  auto [sender, receiver] = make_connected_pair(port + 1);
+  REQUIRE(loop.add(sender.native_handle()));
+  REQUIRE(loop.add(receiver.native_handle()));
+  // Much more than either side's buffers, so sends have to wait for room
+  const auto large = make_frame(std::size_t{8} << 20, 3);
+  const auto small = make_frame(16, 7);
+  SendQueue queue{1 << 24, 0};
+  SendStatistics stats;
+  queue.push(large);
+  queue.push(small, MessagePriority::control);
+  ReceiveBuffer received;
+  std::vector<std::vector<std::byte>> frames;
+  bool want_write = false;
+  const auto deadline = std::chrono::steady_clock::now() + 5s;
+  while (frames.size() < 2 && std::chrono::steady_clock::now() < deadline) {
+    const auto err = queue.flush(sender, stats);
+    REQUIRE((err == ConnectionError::no_error || err == ConnectionError::would_block));
+    if ((err == ConnectionError::would_block) != want_write) {
+      want_write = !want_write;
+      REQUIRE(loop.set_want_write(sender.native_handle(), want_write));
+    }
+    for (const auto& ready : loop.wait(1000ms)) {
+      if (ready.handle != receiver.native_handle()) { continue; }
+      REQUIRE(ready.readable);
+      const auto fill_err = received.fill(receiver);
+      REQUIRE((fill_err == ConnectionError::no_error || fill_err == ConnectionError::would_block));
+      while (const auto frame = received.next_frame()) {
+        frames.emplace_back(frame->begin(), frame->end());
+      }
+    }
+  }
+  REQUIRE(frames.size() == 2);
+  // Control messages go ahead of data
+  REQUIRE(frames[0] == body_of(small));
+  REQUIRE(frames[1] == body_of(large));
+  // The receiver finds out when the sender goes away
+  loop.remove(sender.native_handle());
+  {
+    const auto closed = std::move(sender);
+  }
+  ConnectionError err = ConnectionError::would_block;
+  while (err == ConnectionError::would_block && std::chrono::steady_clock::now() < deadline) {
+    if (contains_handle(loop.wait(1000ms), receiver.native_handle(), true)) {
+      err = received.fill(receiver);
+      REQUIRE(!received.next_frame());
+    }
+  }
+  REQUIRE(err == ConnectionError::closed);
+  loop.remove(receiver.native_handle());
+}
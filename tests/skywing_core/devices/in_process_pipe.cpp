@@ -0,0 +1,148 @@
+#include <catch2/catch.hpp>
+
+#include "skywing_core/internal/devices/event_loop.hpp"
+#include "skywing_core/internal/devices/in_process_pipe.hpp"
+#include "skywing_core/internal/devices/receive_buffer.hpp"
+#include "skywing_core/internal/devices/send_queue.hpp"
+
+#include "device_utils.hpp"
+
+#include <chrono>
+#include <thread>
+
+using namespace skywing;
+using namespace skywing::internal;
+using namespace std::chrono_literals;
+
+// Never bound; in-process connections don't use real ports
+constexpr std::uint16_t port = 40040;
+
+TEST_CASE("In-process connections only reach registered ports", "[Skywing_InProcessPipe]")
+{
+  EventLoop loop;
+  auto waker = std::make_shared<InProcessWaker>(loop);
+  auto& registry = InProcessRegistry::instance();
+  REQUIRE(!registry.connect(AddrPortPair{"127.0.0.1", port}, waker));
+  const auto listener = registry.listen(port, waker);
+  REQUIRE(listener);
+  REQUIRE(!registry.listen(port, waker));
+  // Another host could be listening on the same port
+  REQUIRE(!registry.connect(AddrPortPair{"10.0.0.1", port}, waker));
+  registry.stop_listening(port);
+  REQUIRE(!registry.connect(AddrPortPair{"127.0.0.1", port}, waker));
+  waker->disable();
+}
+
+TEST_CASE("In-process connections move messages and report readiness", "[Skywing_InProcessPipe]")
+{
+  EventLoop server_loop;
+  EventLoop client_loop;
+  auto server_waker = std::make_shared<InProcessWaker>(server_loop);
+  auto client_waker = std::make_shared<InProcessWaker>(client_loop);
+  auto& registry = InProcessRegistry::instance();
+  const auto listener = registry.listen(port, server_waker);
+  REQUIRE(listener);
+  REQUIRE(server_loop.add(listener->handle()));
+  // Reported once when added in case something was already waiting
+  REQUIRE(contains_handle(server_loop.wait(0ms), listener->handle()));
+  REQUIRE(!listener->accept());
+
+  auto client = registry.connect(AddrPortPair{"127.0.0.1", port}, client_waker);
+  REQUIRE(client);
+  REQUIRE(client->handle() < -1);
+  REQUIRE(client->peer_address() == AddrPortPair{"127.0.0.1", port});
+  REQUIRE(contains_handle(server_loop.wait(1000ms), listener->handle()));
+  auto server = listener->accept();
+  REQUIRE(server);
+  REQUIRE(server->handle() != client->handle());
+  REQUIRE(server->peer_address() == client->host_address());
+  REQUIRE(server_loop.add(server->handle()));
+  REQUIRE(client_loop.add(client->handle()));
+  (void)server_loop.wait(0ms);
+  (void)client_loop.wait(0ms);
+
+  std::array<std::byte, 64> buffer{};
+  REQUIRE(std::get<ConnectionError>(server->read_some(buffer.data(), buffer.size())) == ConnectionError::would_block);
+  REQUIRE(server_loop.wait(0ms).empty());
+
+  // Whole messages are handed over as they are
+  const auto message = make_frame(10, 0);
+  REQUIRE(client->send_shared(message));
+  REQUIRE(message.use_count() == 2);
+  REQUIRE(contains_handle(server_loop.wait(1000ms), server->handle()));
+  REQUIRE(sent_amount(server->read_some(buffer.data(), 4)) == 4);
+  // There was more than fit, so the handle is reported again
+  REQUIRE(contains_handle(server_loop.wait(0ms), server->handle()));
+  REQUIRE(sent_amount(server->read_some(buffer.data() + 4, buffer.size() - 4)) == message->size() - 4);
+  REQUIRE(std::equal(message->begin(), message->end(), buffer.begin()));
+  REQUIRE(message.use_count() == 1);
+
+  const auto reply = make_frame(5, 100);
+  const SendBuffer reply_buffer{reply->data(), reply->size()};
+  REQUIRE(sent_amount(server->send_gathered(&reply_buffer, 1)) == reply->size());
+  REQUIRE(contains_handle(client_loop.wait(1000ms), client->handle()));
+  REQUIRE(sent_amount(client->read_some(buffer.data(), buffer.size())) == reply->size());
+  REQUIRE(std::equal(reply->begin(), reply->end(), buffer.begin()));
+
+  // Anything sent before closing is still read first
+  REQUIRE(client->send_shared(message));
+  client.reset();
+  REQUIRE(contains_handle(server_loop.wait(1000ms), server->handle()));
+  REQUIRE(sent_amount(server->read_some(buffer.data(), buffer.size())) == message->size());
+  REQUIRE(std::get<ConnectionError>(server->read_some(buffer.data(), buffer.size())) == ConnectionError::closed);
+  REQUIRE(!server->send_shared(message));
+
+  registry.stop_listening(port);
+  server_waker->disable();
+  client_waker->disable();
+}
+
+TEST_CASE("In-process connections carry queued messages between threads", "[Skywing_InProcessPipe]")
+{
+  EventLoop server_loop;
+  EventLoop client_loop;
+  auto server_waker = std::make_shared<InProcessWaker>(server_loop);
+  auto client_waker = std::make_shared<InProcessWaker>(client_loop);
+  auto& registry = InProcessRegistry::instance();
+  const auto listener = registry.listen(port, server_waker);
+  REQUIRE(listener);
+  auto client = registry.connect(AddrPortPair{"localhost", port}, client_waker);
+  REQUIRE(client);
+  auto server = listener->accept();
+  REQUIRE(server);
+  REQUIRE(server_loop.add(server->handle()));
+
+  constexpr std::size_t num_messages = 200;
+  constexpr std::size_t message_size = 10000;
+  SendStatistics stats;
+  auto flush_result = ConnectionError::unrecoverable;
+  std::thread sender{[&]() {
+    SendQueue queue{message_size * num_messages, 0};
+    for (std::size_t i = 0; i < num_messages; ++i) {
+      queue.push(make_frame(message_size, static_cast<std::uint8_t>(i)));
+    }
+    flush_result = queue.flush(*client, stats);
+  }};
+  // Only wait when told there's something to read, as the Manager does
+  ReceiveBuffer receive_buffer;
+  std::size_t num_received = 0;
+  while (num_received < num_messages) {
+    if (!contains_handle(server_loop.wait(1000ms), server->handle())) { continue; }
+    const auto err = receive_buffer.fill(*server);
+    REQUIRE((err == ConnectionError::no_error || err == ConnectionError::would_block));
+    while (const auto frame = receive_buffer.next_frame()) {
+      REQUIRE(frame->size() == message_size);
+      REQUIRE((*frame)[0] == static_cast<std::byte>(static_cast<std::uint8_t>(num_received)));
+      ++num_received;
+    }
+  }
+  sender.join();
+  REQUIRE(flush_result == ConnectionError::no_error);
+  // Every message was handed over whole
+  REQUIRE(stats.messages_sent == num_messages);
+  REQUIRE(stats.send_calls == num_messages);
+
+  registry.stop_listening(port);
+  server_waker->disable();
+  client_waker->disable();
+}
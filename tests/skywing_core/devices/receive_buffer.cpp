@@ -0,0 +1,139 @@
+#include <catch2/catch.hpp>
+
+#include "skywing_core/internal/devices/receive_buffer.hpp"
+#include "skywing_core/internal/devices/socket_communicator.hpp"
+
+#include "device_utils.hpp"
+
+#include <cstdint>
+
+using namespace skywing;
+using namespace skywing::internal;
+
+constexpr std::uint16_t port = 40030;
+
+namespace {
+bool body_matches(const gsl::span<const std::byte> body, const std::size_t size, const std::uint8_t start)
+{
+  const auto expected = make_bytes(size, start);
+  return static_cast<std::size_t>(body.size()) == size && std::equal(body.cbegin(), body.cend(), expected.cbegin());
+}
+} // namespace
+
+TEST_CASE("Receive buffer splits frames and keeps partial ones", "[Skywing_ReceiveBuffer]")
+{
+  auto [sender, receiver] = make_connected_pair(port);
+  ReceiveBuffer buffer;
+  REQUIRE(buffer.fill(receiver) == ConnectionError::would_block);
+  REQUIRE(!buffer.next_frame());
+
+  // Several small frames arriving together are all handed out from one read
+  std::vector<std::byte> to_send;
+  for (std::uint8_t i = 0; i < 10; ++i) {
+    const auto frame = make_frame(i * 3 + 1, i);
+    to_send.insert(to_send.end(), frame->cbegin(), frame->cend());
+  }
+  // Follow them with half of another frame
+  const auto split_frame = make_frame(100, 42);
+  to_send.insert(to_send.end(), split_frame->cbegin(), split_frame->cbegin() + 50);
+  REQUIRE(sender.send_message(to_send.data(), to_send.size()) == ConnectionError::no_error);
+  REQUIRE(fill_when_ready(buffer, receiver) == ConnectionError::no_error);
+  // The whole send may not have arrived in one read on a busy machine
+  while (buffer.bytes_buffered() < to_send.size()) {
+    REQUIRE(fill_when_ready(buffer, receiver) == ConnectionError::no_error);
+  }
+  for (std::uint8_t i = 0; i < 10; ++i) {
+    // Peeking leaves the frame to be handed out again
+    const auto peeked = buffer.peek_frame();
+    REQUIRE(peeked);
+    const auto frame = buffer.next_frame();
+    REQUIRE(frame);
+    REQUIRE(frame->data() == peeked->data());
+    REQUIRE(body_matches(*frame, i * 3 + 1, i));
+  }
+  REQUIRE(!buffer.peek_frame());
+  REQUIRE(!buffer.next_frame());
+  REQUIRE(buffer.bytes_buffered() == 50);
+
+  // The rest of the frame completes it
+  REQUIRE(sender.send_message(split_frame->data() + 50, split_frame->size() - 50) == ConnectionError::no_error);
+  std::optional<gsl::span<const std::byte>> frame;
+  while (!(frame = buffer.next_frame())) {
+    REQUIRE(fill_when_ready(buffer, receiver) == ConnectionError::no_error);
+  }
+  REQUIRE(body_matches(*frame, 100, 42));
+  REQUIRE(reinterpret_cast<std::uintptr_t>(frame->data()) % frame_body_alignment == 0);
+  REQUIRE(buffer.bytes_buffered() == 0);
+}
+
+TEST_CASE("Receive buffer grows for frames larger than its capacity", "[Skywing_ReceiveBuffer]")
+{
+  // Separate port since the last one may still be in TIME_WAIT
+  auto [sender, receiver] = make_connected_pair(port + 1);
+  ReceiveBuffer buffer{1024};
+  constexpr std::size_t frame_size = 1 << 20;
+  const auto frame_bytes = make_frame(frame_size, 7);
+  std::size_t sent = 0;
+  std::optional<gsl::span<const std::byte>> frame;
+  while (!frame) {
+    if (sent < frame_bytes->size()) {
+      const auto sent_or_error = sender.send_some(frame_bytes->data() + sent, frame_bytes->size() - sent);
+      if (const auto amount = std::get_if<std::size_t>(&sent_or_error)) { sent += *amount; }
+    }
+    const auto err = buffer.fill(receiver);
+    REQUIRE((err == ConnectionError::no_error || err == ConnectionError::would_block));
+    frame = buffer.next_frame();
+  }
+  REQUIRE(body_matches(*frame, frame_size, 7));
+  // Frames that span reads are aligned so they can be decoded in place
+  REQUIRE(reinterpret_cast<std::uintptr_t>(frame->data()) % frame_body_alignment == 0);
+}
+
+TEST_CASE("Receive buffer puts split messages back together in place", "[Skywing_ReceiveBuffer]")
+{
+  auto [sender, receiver] = make_connected_pair(port + 3);
+  ReceiveBuffer buffer;
+  const auto body = make_bytes(3000, 11);
+  std::vector<std::byte> to_send;
+  const auto add_frame = [&](const SharedMessage& frame) {
+    to_send.insert(to_send.end(), frame->cbegin(), frame->cend());
+  };
+  const auto add_piece = [&](const std::size_t begin, const std::size_t end, const bool last) {
+    const auto prefix = to_network_bytes(static_cast<NetworkSizeType>(
+      (end - begin) | frame_fragment_flag | (last ? frame_last_fragment_flag : 0)));
+    to_send.insert(to_send.end(), prefix.cbegin(), prefix.cend());
+    to_send.insert(to_send.end(), body.cbegin() + begin, body.cbegin() + end);
+  };
+  // The odd sized frame in front leaves the first piece's body unaligned,
+  // and the one in the middle is sent between the pieces
+  add_frame(make_frame(5, 1));
+  add_piece(0, 1000, false);
+  add_frame(make_frame(7, 2));
+  add_piece(1000, 2001, false);
+  add_piece(2001, 3000, true);
+  REQUIRE(sender.send_message(to_send.data(), to_send.size()) == ConnectionError::no_error);
+  std::vector<std::vector<std::byte>> received;
+  while (received.size() < 3) {
+    REQUIRE(fill_when_ready(buffer, receiver) == ConnectionError::no_error);
+    while (const auto frame = buffer.next_frame()) {
+      received.emplace_back(frame->begin(), frame->end());
+      if (received.size() == 3) {
+        REQUIRE(reinterpret_cast<std::uintptr_t>(frame->data()) % frame_body_alignment == 0);
+      }
+    }
+  }
+  REQUIRE(received[0] == make_bytes(5, 1));
+  REQUIRE(received[1] == make_bytes(7, 2));
+  REQUIRE(received[2] == body);
+  REQUIRE(buffer.bytes_buffered() == 0);
+}
+
+TEST_CASE("Receive buffer reports a closed connection", "[Skywing_ReceiveBuffer]")
+{
+  auto [sender, receiver] = make_connected_pair(port + 2);
+  ReceiveBuffer buffer;
+  {
+    auto to_close = std::move(sender);
+  }
+  REQUIRE(fill_when_ready(buffer, receiver) == ConnectionError::closed);
+}
@@ -0,0 +1,187 @@
+#include <catch2/catch.hpp>
+
+#include "skywing_core/internal/devices/receive_buffer.hpp"
+#include "skywing_core/internal/devices/send_queue.hpp"
+#include "skywing_core/internal/devices/socket_communicator.hpp"
+
+#include "device_utils.hpp"
+
+#include <numeric>
+
+using namespace skywing;
+using namespace skywing::internal;
+
+constexpr std::uint16_t port = 40020;
+
+namespace {
+std::vector<std::byte> body_of(const SharedMessage& frame)
+{
+  return std::vector<std::byte>(frame->cbegin() + sizeof(NetworkSizeType), frame->cend());
+}
+} // namespace
+
+TEST_CASE("Send queue tracks congestion with hysteresis", "[Skywing_SendQueue]")
+{
+  SendQueue queue{100, 50};
+  REQUIRE(queue.empty());
+  REQUIRE(!queue.is_congested());
+  queue.push(make_message(60, 0));
+  REQUIRE(!queue.is_congested());
+  queue.push(make_message(60, 0));
+  REQUIRE(queue.bytes_queued() == 120);
+  REQUIRE(queue.is_congested());
+  // Raising the high watermark above the queued amount isn't enough to clear it
+  queue.set_watermarks(200, 100);
+  REQUIRE(queue.is_congested());
+  queue.set_watermarks(200, 150);
+  REQUIRE(!queue.is_congested());
+}
+
+TEST_CASE("Send queue survives a full socket buffer and keeps order", "[Skywing_SendQueue]")
+{
+  auto [sender, receiver] = make_connected_pair(port);
+  SendQueue queue{1 << 20, 1 << 16};
+  SendStatistics stats;
+  // Push more than the kernel will buffer so that some sends are short or would block
+  constexpr std::size_t message_size = 1 << 16;
+  constexpr int num_messages = 128;
+  for (int i = 0; i < num_messages; ++i) {
+    queue.push(make_message(message_size, static_cast<std::uint8_t>(i)));
+  }
+  REQUIRE(queue.is_congested());
+  REQUIRE(queue.flush(sender, stats) == ConnectionError::would_block);
+  REQUIRE(!queue.empty());
+  // Drain the receiving side, flushing whenever there's room, and check every byte
+  // read_message doesn't report short reads, so read a byte at a time
+  std::vector<std::byte> buffer(message_size);
+  for (int i = 0; i < num_messages; ++i) {
+    std::size_t have = 0;
+    while (have < message_size) {
+      const auto read_err = receiver.read_message(buffer.data() + have, 1);
+      if (read_err == ConnectionError::no_error) {
+        ++have;
+        continue;
+      }
+      REQUIRE(read_err == ConnectionError::would_block);
+      // Out of data, so there should be room to send more
+      const auto err = queue.flush(sender, stats);
+      REQUIRE((err == ConnectionError::no_error || err == ConnectionError::would_block));
+    }
+    REQUIRE(buffer == *make_message(message_size, static_cast<std::uint8_t>(i)));
+  }
+  REQUIRE(queue.empty());
+  REQUIRE(queue.bytes_queued() == 0);
+  REQUIRE(!queue.is_congested());
+  REQUIRE(stats.messages_sent == num_messages);
+  REQUIRE(stats.bytes_sent == num_messages * message_size);
+}
+
+TEST_CASE("Send queue gathers small messages into one send", "[Skywing_SendQueue]")
+{
+  // Separate port since the last one may still be in TIME_WAIT
+  auto [sender, receiver] = make_connected_pair(port + 1);
+  SendQueue queue{1 << 20, 1 << 16};
+  SendStatistics stats;
+  constexpr std::size_t message_size = 16;
+  constexpr std::size_t num_messages = max_gathered_send_buffers * 2 + 3;
+  for (std::size_t i = 0; i < num_messages; ++i) {
+    queue.push(make_message(message_size, static_cast<std::uint8_t>(i)));
+  }
+  REQUIRE(queue.flush(sender, stats) == ConnectionError::no_error);
+  REQUIRE(queue.empty());
+  REQUIRE(stats.messages_sent == num_messages);
+  REQUIRE(stats.bytes_sent == num_messages * message_size);
+  // Everything fits in the socket buffer, so each send should be full
+  REQUIRE(stats.send_calls == 3);
+  REQUIRE(stats.messages_per_send_call() > max_gathered_send_buffers / 2);
+  // Flushing an empty queue doesn't touch the socket
+  REQUIRE(queue.flush(sender, stats) == ConnectionError::no_error);
+  REQUIRE(stats.send_calls == 3);
+  std::vector<std::byte> buffer(message_size);
+  for (std::size_t i = 0; i < num_messages; ++i) {
+    std::size_t have = 0;
+    while (have < message_size) {
+      const auto read_err = receiver.read_message(buffer.data() + have, 1);
+      if (read_err == ConnectionError::no_error) {
+        ++have;
+        continue;
+      }
+      REQUIRE(read_err == ConnectionError::would_block);
+    }
+    REQUIRE(buffer == *make_message(message_size, static_cast<std::uint8_t>(i)));
+  }
+}
+
+TEST_CASE("Send queue sends control messages between pieces of large data", "[Skywing_SendQueue]")
+{
+  auto [sender, receiver] = make_connected_pair(port + 2);
+  SendQueue queue{std::size_t{1} << 26, std::size_t{1} << 20};
+  SendStatistics stats;
+  // Far more than the kernel will buffer, so the send stops partway through
+  const auto large = make_frame(std::size_t{32} << 20, 0);
+  const auto small = make_frame(100, 7);
+  queue.push(large);
+  queue.push(small);
+  REQUIRE(queue.flush(sender, stats) == ConnectionError::would_block);
+  const auto control = make_frame(10, 200);
+  queue.push(control, MessagePriority::control);
+  // The pieces carry their own prefixes instead of the message's
+  REQUIRE(queue.bytes_queued() > control->size() + small->size());
+  ReceiveBuffer receive_buffer;
+  std::vector<std::vector<std::byte>> received;
+  while (received.size() < 3) {
+    const auto flush_err = queue.flush(sender, stats);
+    REQUIRE((flush_err == ConnectionError::no_error || flush_err == ConnectionError::would_block));
+    const auto err = receive_buffer.fill(receiver);
+    REQUIRE((err == ConnectionError::no_error || err == ConnectionError::would_block));
+    while (const auto frame = receive_buffer.next_frame()) {
+      received.emplace_back(frame->begin(), frame->end());
+    }
+  }
+  // The control message only waited for the piece that was being sent
+  REQUIRE(received[0] == body_of(control));
+  REQUIRE(received[1] == body_of(large));
+  REQUIRE(received[2] == body_of(small));
+  REQUIRE(queue.empty());
+  REQUIRE(queue.bytes_queued() == 0);
+  REQUIRE(stats.messages_sent == 3);
+}
+
+TEST_CASE("Send queue replaces unsent versions pushed with the same key", "[Skywing_SendQueue]")
+{
+  auto [sender, receiver] = make_connected_pair(port + 3);
+  SendQueue queue{std::size_t{1} << 26, std::size_t{1} << 20};
+  SendStatistics stats;
+  // Back the connection up so nothing behind the large message goes out
+  const auto large = make_frame(std::size_t{32} << 20, 0);
+  REQUIRE(!queue.push_latest(large, 1));
+  REQUIRE(queue.flush(sender, stats) == ConnectionError::would_block);
+  const auto other = make_frame(20, 50);
+  const auto first = make_frame(10, 100);
+  const auto second = make_frame(30, 150);
+  // The large message has started going out, so it has to be sent whole
+  REQUIRE(!queue.push_latest(first, 1));
+  REQUIRE(!queue.push_latest(other, 2));
+  const auto bytes_before = queue.bytes_queued();
+  REQUIRE(queue.push_latest(second, 1));
+  REQUIRE(queue.bytes_queued() == bytes_before - first->size() + second->size());
+  ReceiveBuffer receive_buffer;
+  std::vector<std::vector<std::byte>> received;
+  while (received.size() < 3) {
+    const auto flush_err = queue.flush(sender, stats);
+    REQUIRE((flush_err == ConnectionError::no_error || flush_err == ConnectionError::would_block));
+    const auto err = receive_buffer.fill(receiver);
+    REQUIRE((err == ConnectionError::no_error || err == ConnectionError::would_block));
+    while (const auto frame = receive_buffer.next_frame()) {
+      received.emplace_back(frame->begin(), frame->end());
+    }
+  }
+  // The newer version took the older one's place in line
+  REQUIRE(received[0] == body_of(large));
+  REQUIRE(received[1] == body_of(second));
+  REQUIRE(received[2] == body_of(other));
+  REQUIRE(queue.empty());
+  // Versions that have gone out are never replaced
+  REQUIRE(!queue.push_latest(first, 1));
+  REQUIRE(queue.bytes_queued() == first->size());
+}
@@ -0,0 +1,106 @@
+#include <catch2/catch.hpp>
+
+#include "skywing_core/internal/devices/receive_buffer.hpp"
+#include "skywing_core/internal/devices/send_queue.hpp"
+#include "skywing_core/internal/devices/shared_memory_transport.hpp"
+
+#include "device_utils.hpp"
+
+#include <thread>
+
+using namespace skywing;
+using namespace skywing::internal;
+
+TEST_CASE("Shared memory transport moves bytes both ways", "[Skywing_SharedMemoryTransport]")
+{
+  auto creator = SharedMemoryTransport::create(4096);
+  REQUIRE(creator);
+  auto opener = SharedMemoryTransport::open(creator->name());
+  REQUIRE(opener);
+  // The name is only needed until the peer has opened it
+  REQUIRE(!SharedMemoryTransport::open(creator->name()));
+
+  std::array<std::byte, 64> buffer{};
+  REQUIRE(std::get<ConnectionError>(opener->read_some(buffer.data(), buffer.size())) == ConnectionError::would_block);
+
+  const auto first = make_bytes(10, 0);
+  const auto second = make_bytes(20, 10);
+  const std::array<SendBuffer, 2> to_send{SendBuffer{first.data(), first.size()}, {second.data(), second.size()}};
+  REQUIRE(sent_amount(creator->send_gathered(to_send.data(), to_send.size())) == 30);
+  // The opener went idle when it found nothing to read
+  REQUIRE(creator->take_wake_up_needed());
+  REQUIRE(!creator->take_wake_up_needed());
+  REQUIRE(opener->has_input());
+  REQUIRE(sent_amount(opener->read_some(buffer.data(), buffer.size())) == 30);
+  REQUIRE(std::equal(buffer.begin(), buffer.begin() + 30, make_bytes(30, 0).begin()));
+  REQUIRE(!opener->has_input());
+
+  const auto reply = make_bytes(5, 100);
+  const SendBuffer reply_buffer{reply.data(), reply.size()};
+  REQUIRE(sent_amount(opener->send_gathered(&reply_buffer, 1)) == 5);
+  REQUIRE(sent_amount(creator->read_some(buffer.data(), buffer.size())) == 5);
+  REQUIRE(std::equal(reply.begin(), reply.end(), buffer.begin()));
+}
+
+TEST_CASE("Shared memory transport reports a full ring and wraps around", "[Skywing_SharedMemoryTransport]")
+{
+  auto creator = SharedMemoryTransport::create(4096);
+  REQUIRE(creator);
+  auto opener = SharedMemoryTransport::open(creator->name());
+  REQUIRE(opener);
+
+  const auto data = make_bytes(3000, 0);
+  const SendBuffer buffer{data.data(), data.size()};
+  REQUIRE(sent_amount(creator->send_gathered(&buffer, 1)) == 3000);
+  // Only part of this fits, and the writer then waits for room
+  REQUIRE(sent_amount(creator->send_gathered(&buffer, 1)) == 4096 - 3000);
+  REQUIRE(std::get<ConnectionError>(creator->send_gathered(&buffer, 1)) == ConnectionError::would_block);
+  REQUIRE(!creator->take_wake_up_needed());
+
+  std::vector<std::byte> received(4096);
+  REQUIRE(sent_amount(opener->read_some(received.data(), 3000)) == 3000);
+  REQUIRE(received.front() == data.front());
+  REQUIRE(opener->take_wake_up_needed());
+
+  // This write crosses the end of the ring
+  const std::vector<std::byte> rest(data.begin() + (4096 - 3000), data.end());
+  const SendBuffer rest_buffer{rest.data(), rest.size()};
+  REQUIRE(sent_amount(creator->send_gathered(&rest_buffer, 1)) == rest.size());
+  REQUIRE(sent_amount(opener->read_some(received.data(), received.size())) == 4096 - 3000 + rest.size());
+  REQUIRE(std::equal(data.begin(), data.end(), received.begin()));
+}
+
+TEST_CASE("Shared memory transport carries framed messages between threads", "[Skywing_SharedMemoryTransport]")
+{
+  auto creator = SharedMemoryTransport::create(4096);
+  REQUIRE(creator);
+  auto opener = SharedMemoryTransport::open(creator->name());
+  REQUIRE(opener);
+
+  // Large messages have to be streamed through the ring in pieces
+  constexpr std::size_t num_messages = 50;
+  constexpr std::size_t message_size = 10000;
+  std::thread sender{[&]() {
+    SendQueue queue{message_size * num_messages, 0};
+    SendStatistics stats;
+    for (std::size_t i = 0; i < num_messages; ++i) {
+      queue.push(make_frame(message_size, static_cast<std::uint8_t>(i)));
+    }
+    while (queue.flush(*creator, stats) != ConnectionError::no_error) {
+      std::this_thread::yield();
+    }
+  }};
+  ReceiveBuffer receive_buffer;
+  std::size_t num_received = 0;
+  while (num_received < num_messages) {
+    const auto err = receive_buffer.fill(*opener);
+    REQUIRE((err == ConnectionError::no_error || err == ConnectionError::would_block));
+    while (const auto frame = receive_buffer.next_frame()) {
+      REQUIRE(frame->size() == message_size);
+      const auto expected = make_bytes(message_size, static_cast<std::uint8_t>(num_received));
+      REQUIRE(std::equal(frame->begin(), frame->end(), expected.begin()));
+      ++num_received;
+    }
+  }
+  sender.join();
+}
@@ -0,0 +1,145 @@
+#include <catch2/catch.hpp>
+
+#include "skywing_core/skywing.hpp"
+
+#include "fake_neighbor.hpp"
+#include "utils.hpp"
+
+#include <atomic>
+#include <thread>
+
+using namespace skywing;
+using namespace std::chrono_literals;
+
+using ValueTag = PublishTag<std::int32_t>;
+const ValueTag found_tag{"Found Tag"};
+const ValueTag unknown_tag{"Unknown Tag"};
+const std::int32_t tag_value = 15;
+const std::uint16_t middle_port = get_starting_port();
+constexpr std::size_t ring_size = 4;
+
+std::uint16_t ring_port(const std::size_t index) { return static_cast<std::uint16_t>(middle_port + 1 + index); }
+
+namespace {
+// Waits for a forwarded query, returning its TTL
+bool wait_for_query(
+  FakeNeighbor& neighbor, const std::uint64_t query_id, std::uint16_t& ttl, const std::chrono::milliseconds timeout = 5s)
+{
+  return neighbor.wait_for(
+    [&](const internal::GetPublishers& msg) {
+      if (msg.query_id() != query_id) { return false; }
+      ttl = msg.ttl();
+      return true;
+    },
+    timeout);
+}
+
+// Waits for the answer to a query, returning the tags it had publishers for
+bool wait_for_answer(
+  FakeNeighbor& neighbor,
+  const std::uint64_t query_id,
+  std::vector<TagID>& tags,
+  const std::chrono::milliseconds timeout = 5s)
+{
+  return neighbor.wait_for(
+    [&](const internal::ReportPublishers& msg) {
+      if (msg.query_id() != query_id) { return false; }
+      tags = msg.tags();
+      return true;
+    },
+    timeout);
+}
+
+std::vector<std::byte> make_query(const ValueTag& tag, const std::uint64_t query_id, const std::uint16_t ttl)
+{
+  return internal::make_get_publishers({tag.id()}, {1}, false, 0, 0, query_id, ttl);
+}
+} // namespace
+
+TEST_CASE("Publisher queries are forwarded once and answered back along their path", "[Skywing_Discovery]")
+{
+  Manager manager{middle_port, "middle"};
+  manager.submit_job("job", [&](Job&, ManagerHandle handle) {
+    // The two neighbors are also each other's neighbor, so queries can come
+    // back around
+    FakeNeighbor left{middle_port, "left", {"right"}};
+    FakeNeighbor right{middle_port, "right", {"left"}};
+    while (handle.number_of_neighbors() != 2) {
+      std::this_thread::sleep_for(1ms);
+    }
+    std::uint16_t ttl = 0;
+    std::vector<TagID> tags;
+
+    // Nothing is known here, so the query goes on with one hop less
+    left.send(make_query(found_tag, 101, 5));
+    REQUIRE(wait_for_query(right, 101, ttl));
+    REQUIRE(ttl == 4);
+
+    // The same query coming back around is answered straight away and not
+    // passed on again
+    right.send(make_query(found_tag, 101, 4));
+    REQUIRE(wait_for_answer(right, 101, tags));
+    REQUIRE(tags.empty());
+    REQUIRE(!wait_for_query(left, 101, ttl, 300ms));
+
+    // The answer from further along goes back to where the query came from
+    right.send(internal::make_report_publishers(
+      {found_tag.id()}, {{"127.0.0.1:1"}}, {{"found publisher"}}, {}, {3, 0, 1}, 101));
+    REQUIRE(wait_for_answer(left, 101, tags));
+    REQUIRE(tags == std::vector<TagID>{found_tag.id()});
+
+    // A query on its last hop isn't passed on
+    left.send(make_query(unknown_tag, 102, 1));
+    REQUIRE(wait_for_answer(left, 102, tags));
+    REQUIRE(!wait_for_query(right, 102, ttl, 300ms));
+
+    // Without an answer from further along, what's known is sent back once
+    // the query times out
+    left.send(make_query(unknown_tag, 103, 5));
+    REQUIRE(wait_for_query(right, 103, ttl));
+    REQUIRE(!wait_for_answer(left, 103, tags, internal::publisher_query_timeout / 2));
+    REQUIRE(wait_for_answer(left, 103, tags));
+    REQUIRE(tags.empty());
+  });
+  manager.run();
+}
+
+TEST_CASE("Subscribers find publishers across a ring within the TTL", "[Skywing_Discovery]")
+{
+  std::atomic<bool> done = false;
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < ring_size; ++i) {
+    threads.emplace_back([&, i]() {
+      Manager manager{ring_port(i), "ring " + std::to_string(i)};
+      // The publisher is two hops away either way around, so copies of the
+      // query arrive by both paths with just enough hops left
+      manager.set_discovery_ttl(2);
+      manager.submit_job("job", [&, i](Job& job, ManagerHandle handle) {
+        REQUIRE(handle.connect_to_servers({{"127.0.0.1", ring_port((i + 1) % ring_size)}}, 5s).get());
+        while (handle.number_of_neighbors() < 2) {
+          std::this_thread::sleep_for(1ms);
+        }
+        if (i == 0) {
+          REQUIRE(job.subscribe(found_tag).wait_for(5s));
+          const auto value = job.get_waiter(found_tag).get();
+          REQUIRE(value);
+          REQUIRE(*value == tag_value);
+          done = true;
+          return;
+        }
+        if (i == ring_size / 2) {
+          job.declare_publication_intent(found_tag);
+          handle.waiter_on_subscription_change([&]() { return handle.number_of_subscribers(found_tag) > 0; }).wait();
+          job.publish(found_tag, tag_value);
+        }
+        while (!done) {
+          std::this_thread::sleep_for(1ms);
+        }
+      });
+      manager.run();
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
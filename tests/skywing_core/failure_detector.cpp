@@ -0,0 +1,74 @@
+#include <catch2/catch.hpp>
+
+#include "skywing_core/internal/failure_detector.hpp"
+
+#include <chrono>
+
+using namespace skywing::internal;
+using namespace std::chrono_literals;
+
+using Clock = std::chrono::steady_clock;
+
+TEST_CASE("Phi grows with silence", "[Skywing_FailureDetector]")
+{
+  const auto start = Clock::now();
+  PhiAccrualFailureDetector detector{100ms, 0ms, 10ms, start};
+  auto now = start;
+  for (int i = 0; i < 50; ++i) {
+    now += 100ms;
+    detector.heartbeat(now);
+  }
+  REQUIRE(detector.last_heartbeat() == now);
+  REQUIRE(detector.phi(now) < 0.5);
+  REQUIRE(!detector.is_suspected(now + 100ms));
+  REQUIRE(detector.phi(now + 150ms) > detector.phi(now + 120ms));
+  REQUIRE(detector.is_suspected(now + 500ms));
+}
+
+TEST_CASE("Phi adapts to how often a neighbor is heard from", "[Skywing_FailureDetector]")
+{
+  const auto start = Clock::now();
+  PhiAccrualFailureDetector busy{1000ms, 0ms, 1ms, start};
+  PhiAccrualFailureDetector idle{1000ms, 0ms, 1ms, start};
+  auto now = start;
+  for (int i = 0; i < 200; ++i) {
+    now += 10ms;
+    busy.heartbeat(now);
+  }
+  const auto busy_last = now;
+  now = start;
+  for (int i = 0; i < 200; ++i) {
+    now += 1000ms;
+    idle.heartbeat(now);
+  }
+  // The same silence is only suspicious for the one that is usually busy
+  REQUIRE(busy.is_suspected(busy_last + 200ms));
+  REQUIRE(!idle.is_suspected(now + 200ms));
+  // Arrivals that vary a lot widen what counts as normal
+  PhiAccrualFailureDetector jittery{1000ms, 0ms, 1ms, start};
+  now = start;
+  for (int i = 0; i < 200; ++i) {
+    now += (i % 2 == 0) ? 50ms : 1950ms;
+    jittery.heartbeat(now);
+  }
+  REQUIRE(!jittery.is_suspected(now + 2000ms));
+  REQUIRE(idle.is_suspected(now + 2000ms));
+}
+
+TEST_CASE("The acceptable pause covers a neighbor going idle", "[Skywing_FailureDetector]")
+{
+  const auto start = Clock::now();
+  PhiAccrualFailureDetector detector{100ms, 200ms, 25ms, start};
+  auto now = start;
+  for (int i = 0; i < 100; ++i) {
+    now += 1ms;
+    detector.heartbeat(now);
+  }
+  // The first heartbeat after the data stops comes about an interval later
+  REQUIRE(!detector.is_suspected(now + 150ms));
+  REQUIRE(detector.is_suspected(now + 400ms));
+  // Nothing is suspicious before anything has been heard
+  PhiAccrualFailureDetector fresh{100ms, 200ms, 25ms, start};
+  REQUIRE(!fresh.is_suspected(start + 250ms));
+  REQUIRE(fresh.is_suspected(start + 1s));
+}
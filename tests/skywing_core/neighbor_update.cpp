@@ -0,0 +1,79 @@
+#include <catch2/catch.hpp>
+
+#include "skywing_core/skywing.hpp"
+
+#include "device_utils.hpp"
+#include "fake_neighbor.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+
+using namespace skywing;
+
+const std::uint16_t middle_port = get_starting_port();
+const std::uint16_t local_port = middle_port + 1;
+const std::uint16_t pair_port = middle_port + 2;
+
+TEST_CASE("Neighbor sets follow the greeting and every update", "[Skywing_NeighborUpdate]")
+{
+  Manager manager{local_port, "local"};
+  auto [remote_end, local_end] = make_connected_pair(pair_port);
+  // Greetings don't list neighbors in any particular order
+  internal::ExternalManager neighbor{std::move(local_end), "remote", {"d", "a", "c", "b"}, manager, 0};
+  for (const auto id : {"a", "b", "c", "d"}) {
+    REQUIRE(neighbor.has_neighbor(id));
+  }
+  REQUIRE(!neighbor.has_neighbor("e"));
+
+  // The update is sent to everyone, including the Manager it names
+  auto updates = internal::make_neighbor_update({"e", "local"}, {"b"});
+  const auto second_update = internal::make_neighbor_update({"b"}, {"a", "d"});
+  updates.insert(updates.end(), second_update.cbegin(), second_update.cend());
+  REQUIRE(remote_end.send_message(updates.data(), updates.size()) == internal::ConnectionError::no_error);
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+  while (neighbor.has_neighbor("d") && std::chrono::steady_clock::now() < deadline) {
+    neighbor.get_and_handle_messages();
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+  REQUIRE(!neighbor.has_neighbor("a"));
+  REQUIRE(neighbor.has_neighbor("b"));
+  REQUIRE(neighbor.has_neighbor("c"));
+  REQUIRE(!neighbor.has_neighbor("d"));
+  REQUIRE(neighbor.has_neighbor("e"));
+  REQUIRE(!neighbor.has_neighbor("local"));
+}
+
+TEST_CASE("Neighbor changes from the same pass go out as one update", "[Skywing_NeighborUpdate]")
+{
+  Manager manager{middle_port, "middle"};
+  // Everyone connects before the Manager runs, so it takes them all on in
+  // the same pass
+  FakeNeighbor observer{middle_port, "observer"};
+  FakeNeighbor first{middle_port, "first"};
+  FakeNeighbor second{middle_port, "second"};
+  // Leaves in the same pass it joins, so only the leaving is reported
+  FakeNeighbor fleeting{middle_port, "fleeting", {}, internal::make_goodbye()};
+  manager.submit_job("job", [&](Job&, ManagerHandle handle) {
+    std::vector<MachineID> added;
+    std::vector<MachineID> removed;
+    const auto next_update = [&]() {
+      return observer.wait_for([&](const internal::NeighborUpdate& msg) {
+        added = msg.added();
+        removed = msg.removed();
+        std::sort(added.begin(), added.end());
+        return true;
+      });
+    };
+    REQUIRE(next_update());
+    REQUIRE(added == std::vector<MachineID>{"first", "observer", "second"});
+    REQUIRE(removed == std::vector<MachineID>{"fleeting"});
+    REQUIRE(handle.number_of_neighbors() == 3);
+
+    // A change in a later pass gets its own update
+    second.send(internal::make_goodbye());
+    REQUIRE(next_update());
+    REQUIRE(added.empty());
+    REQUIRE(removed == std::vector<MachineID>{"second"});
+  });
+  manager.run();
+}
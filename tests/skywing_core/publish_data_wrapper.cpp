@@ -1,13 +1,75 @@
 #include <catch2/catch.hpp>
 
+#include <capnp/any.h>
 #include <capnp/message.h>
+#include <capnp/serialize.h>
 
 #include "skywing_core/internal/capn_proto_wrapper.hpp"
+#include "skywing_core/internal/message_creators.hpp"
 
 #include "skywing_core/include/publish_value_handler.hpp"
+#include "skywing_core/internal/tag_buffer.hpp"
+
+#include <tuple>
 
 using namespace skywing::internal;
 
+namespace {
+MessageHandler to_handler(const gsl::span<const std::byte> body)
+{
+  auto handler = MessageHandler::try_to_create(body);
+  REQUIRE(handler);
+  return std::move(*handler);
+}
+
+// Skips the size prefix that's put on for the network
+MessageHandler to_handler(const std::vector<std::byte>& raw)
+{
+  return to_handler(gsl::span<const std::byte>(raw.data() + sizeof(skywing::NetworkSizeType), raw.data() + raw.size()));
+}
+
+// Passes the PublishData in a message to check, returning what it does
+template<typename Callable>
+bool check_publish_data(const MessageHandler& handler, Callable check)
+{
+  return handler.do_callback(Callable{check}, [](...) { return false; });
+}
+
+// Sends value through a message and reads it back into out, which may already
+// hold something
+template<typename T>
+bool roundtrip_in_place(const T& value, T out = T{})
+{
+  const std::vector<skywing::PublishValueVariant> values{value};
+  return check_publish_data(to_handler(make_publish(1, skywing::TagID{"tag"}, values)), [&](const PublishData& msg) {
+    if (!msg.holds_types<T>()) { return false; }
+    msg.read_value_into<T>(out);
+    return out == value;
+  });
+}
+
+// Cap'n Proto lets a list be written with wider elements than its schema
+// says and readers have to take it; this puts a List(Int64) where a
+// List(Int32) goes.  Unlike make_publish there is no size prefix
+std::vector<std::byte> make_wide_publish(const std::vector<std::int64_t>& values)
+{
+  capnp::MallocMessageBuilder builder;
+  auto message = builder.initRoot<cpnpro::StatusMessage>().initPublishData();
+  message.setVersion(1);
+  message.setTagID("tag");
+  auto value = message.initValue(1)[0];
+  // Sets which kind of list the value is; the list itself is replaced below
+  value.initRI32(0);
+  auto wide = capnp::AnyStruct::Builder{value}.getPointerSection()[0].initAs<capnp::List<std::int64_t>>(values.size());
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    wide.set(i, values[i]);
+  }
+  const auto words = capnp::messageToFlatArray(builder);
+  const auto bytes = words.asBytes();
+  return {reinterpret_cast<const std::byte*>(bytes.begin()), reinterpret_cast<const std::byte*>(bytes.end())};
+}
+} // namespace
+
 template<typename T>
 bool roundtrip_value(const T& val)
 {
@@ -34,3 +96,107 @@ TEST_CASE("Cap'n Proto Wrappers Work", "[Skywing_CapnProto_Wrappers]")
   REQUIRE(roundtrip_value(std::vector<std::string>{"str1", "str2"}));
   REQUIRE(roundtrip_value(std::vector<std::byte>{std::byte{0x10}, std::byte{0x80}, std::byte{0x7F}}));
 }
+
+TEST_CASE("Publish data can refer to a bound tag number", "[Skywing_CapnProto_Wrappers]")
+{
+  using namespace skywing;
+  const auto binding = to_handler(make_tag_binding(5, "some tag"));
+  REQUIRE(binding.do_callback(
+    [](const TagBinding& msg) { return msg.tag_number() == 5 && msg.tag_id() == "some tag"; },
+    [](...) { return false; }));
+
+  const std::vector<PublishValueVariant> value{std::int32_t{42}};
+  const auto numbered = to_handler(make_publish(3, TagNumber{5}, value));
+  REQUIRE(numbered.do_callback(
+    [](const PublishData& msg) {
+      return msg.tag_number() == 5 && msg.tag_id().empty() && msg.version() == 3
+          && msg.holds_types<std::int32_t>();
+    },
+    [](...) { return false; }));
+
+  const auto named = to_handler(make_publish(3, TagID{"some tag"}, value));
+  REQUIRE(named.do_callback(
+    [](const PublishData& msg) { return msg.tag_number() == no_tag_number && msg.tag_id() == "some tag"; },
+    [](...) { return false; }));
+}
+
+TEST_CASE("Received values decode in place", "[Skywing_CapnProto_Wrappers]")
+{
+  using namespace std::string_literals;
+
+  REQUIRE(roundtrip_in_place(std::int32_t{-7}));
+  REQUIRE(roundtrip_in_place(2.5, 100.0));
+  REQUIRE(roundtrip_in_place("short"s, "a string longer than the one sent"s));
+  REQUIRE(roundtrip_in_place(std::vector<std::byte>{std::byte{0x01}, std::byte{0xFF}}));
+
+  // Lists of numbers take the bulk copy, whether out has to grow or shrink
+  REQUIRE(roundtrip_in_place(std::vector<std::int16_t>{-1, 2, 300}));
+  REQUIRE(roundtrip_in_place(std::vector<std::uint64_t>{1, 0xFFFF'FFFF'FFFF'FFFF}, std::vector<std::uint64_t>(10, 9)));
+  REQUIRE(roundtrip_in_place(std::vector<float>{0.5f, -1.25f}, std::vector<float>{3.0f}));
+  REQUIRE(roundtrip_in_place(std::vector<double>{}, std::vector<double>{1.0, 2.0}));
+  // Everything else is read one at a time
+  REQUIRE(roundtrip_in_place(std::vector<bool>{true, false, true}, std::vector<bool>{false}));
+  REQUIRE(roundtrip_in_place(std::vector<std::string>{"str1", "str2"}, std::vector<std::string>{"old", "old", "old"}));
+
+  // Several values go into a tuple
+  using Tuple = std::tuple<std::int32_t, std::string, std::vector<double>>;
+  const Tuple sent{3, "abc", {1.5, 2.5}};
+  const std::vector<skywing::PublishValueVariant> values{
+    std::get<0>(sent), std::get<1>(sent), std::get<2>(sent)};
+  Tuple out{0, "something else entirely", {9.0, 9.0, 9.0, 9.0}};
+  REQUIRE(check_publish_data(to_handler(make_publish(1, skywing::TagID{"tag"}, values)), [&](const PublishData& msg) {
+    if (!msg.holds_types<std::int32_t, std::string, std::vector<double>>()) { return false; }
+    msg.read_value_into<std::int32_t, std::string, std::vector<double>>(out);
+    return out == sent;
+  }));
+}
+
+TEST_CASE("Lists with wider elements than expected decode", "[Skywing_CapnProto_Wrappers]")
+{
+  const auto raw = make_wide_publish({-1, 2, 0x7FFF'FFFF});
+  REQUIRE(check_publish_data(to_handler(raw), [](const PublishData& msg) {
+    if (!msg.holds_types<std::vector<std::int32_t>>()) { return false; }
+    std::vector<std::int32_t> out{5, 5, 5, 5, 5};
+    msg.read_value_into<std::vector<std::int32_t>>(out);
+    // The copy that goes through PublishValueVariant has to agree
+    const auto value = msg.value();
+    return out == std::vector<std::int32_t>{-1, 2, 0x7FFF'FFFF} && value
+        && *value == std::vector<skywing::PublishValueVariant>{out};
+  }));
+}
+
+TEST_CASE("Tag buffers take received values directly", "[Skywing_CapnProto_Wrappers]")
+{
+  using skywing::PublishValueVariant;
+  using skywing::TagID;
+  using Tuple = std::tuple<std::int32_t, std::string, std::vector<double>>;
+  const auto publish = [](const std::uint32_t version, const Tuple& value) {
+    const std::vector<PublishValueVariant> values{std::get<0>(value), std::get<1>(value), std::get<2>(value)};
+    return to_handler(make_publish(version, TagID{"tag"}, values));
+  };
+  DiscardOldVersionTagBuffer<std::int32_t, std::string, std::vector<double>> buffer;
+  const auto add = [&](const MessageHandler& handler) {
+    return check_publish_data(handler, [&](const PublishData& msg) { return buffer.add(msg, msg.version()); });
+  };
+  const auto get = [&]() { return *static_cast<Tuple*>(buffer.get()); };
+
+  const Tuple first{1, "first", {1.0, 2.0, 3.0}};
+  REQUIRE(add(publish(2, first)));
+  REQUIRE(buffer.has_data());
+  REQUIRE(get() == first);
+
+  // Older versions are dropped
+  REQUIRE(add(publish(1, {0, "older", {}})));
+  REQUIRE(!buffer.has_data());
+
+  // Values of the wrong types are refused
+  const std::vector<PublishValueVariant> wrong_types{std::int32_t{4}};
+  REQUIRE(!add(to_handler(make_publish(3, TagID{"tag"}, wrong_types))));
+  REQUIRE(!buffer.has_data());
+
+  // Newer versions replace what's there, reusing its memory
+  const Tuple second{2, "second", {4.0}};
+  REQUIRE(add(publish(3, second)));
+  REQUIRE(buffer.has_data());
+  REQUIRE(get() == second);
+}
@@ -0,0 +1,96 @@
+#include <catch2/catch.hpp>
+
+#include "skywing_core/skywing.hpp"
+
+#include "utils.hpp"
+
+#include <atomic>
+#include <thread>
+
+using namespace skywing;
+
+using PubTag = PublishTag<std::int32_t>;
+
+constexpr std::chrono::milliseconds wait_time{1000};
+
+TEST_CASE("Rate limited publishes send the newest value once the interval is up", "[Skywing_PublishRateLimit]")
+{
+  Manager base_manager{get_starting_port(), "Limited"};
+
+  base_manager.submit_job("job", [&](Job& job, ManagerHandle) {
+    const PubTag pub_tag{"limited"};
+    job.declare_publication_intent(pub_tag);
+    job.limit_publish_interval(pub_tag, std::chrono::milliseconds{100});
+    REQUIRE(job.subscribe(pub_tag).wait_for(wait_time));
+    constexpr std::int32_t num_values = 100;
+    for (std::int32_t i = 1; i <= num_values; ++i) {
+      job.publish(pub_tag, i);
+    }
+    // The first value goes out right away and the rest wait for the interval
+    REQUIRE(job.suppressed_publishes(pub_tag) > 0);
+    int values_received = 0;
+    std::int32_t last_value = 0;
+    while (last_value != num_values) {
+      auto waiter = job.get_waiter(pub_tag);
+      REQUIRE(waiter.wait_for(wait_time));
+      const auto value = waiter.get();
+      REQUIRE(value);
+      REQUIRE(*value > last_value);
+      last_value = *value;
+      ++values_received;
+    }
+    REQUIRE(values_received < num_values);
+  });
+
+  base_manager.run();
+}
+
+TEST_CASE("Publishing faster than the rate limit keeps values coming", "[Skywing_PublishRateLimit]")
+{
+  Manager base_manager{get_starting_port(), "Limited"};
+  constexpr std::chrono::milliseconds interval{50};
+  constexpr std::chrono::milliseconds publish_for{600};
+  std::atomic<bool> subscribed = false;
+  std::atomic<std::int32_t> last_published = 0;
+
+  base_manager.submit_job("publisher", [&](Job& job, ManagerHandle) {
+    const PubTag pub_tag{"steady"};
+    job.declare_publication_intent(pub_tag);
+    job.limit_publish_interval(pub_tag, interval);
+    while (!subscribed) {
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    // Well over the limit, and for many intervals
+    const auto stop_at = std::chrono::steady_clock::now() + publish_for;
+    std::int32_t value = 0;
+    while (std::chrono::steady_clock::now() < stop_at) {
+      job.publish(pub_tag, ++value);
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    last_published = value;
+  });
+
+  base_manager.submit_job("subscriber", [&](Job& job, ManagerHandle) {
+    const PubTag pub_tag{"steady"};
+    REQUIRE(job.subscribe(pub_tag).wait_for(wait_time));
+    subscribed = true;
+    int values_received = 0;
+    std::int32_t last_value = 0;
+    const auto give_up_at = std::chrono::steady_clock::now() + publish_for + wait_time;
+    // The last value can arrive before the publisher says which it is
+    while (last_published == 0 || last_value != last_published) {
+      REQUIRE(std::chrono::steady_clock::now() < give_up_at);
+      auto waiter = job.get_waiter(pub_tag);
+      if (!waiter.wait_for(interval)) { continue; }
+      const auto value = waiter.get();
+      REQUIRE(value);
+      REQUIRE(*value > last_value);
+      last_value = *value;
+      ++values_received;
+    }
+    // About one value per interval, not just the first and the last
+    REQUIRE(values_received >= static_cast<int>(publish_for / interval) / 2);
+  });
+
+  base_manager.run();
+}
@@ -0,0 +1,103 @@
+#include <catch2/catch.hpp>
+
+#include "skywing_core/skywing.hpp"
+
+#include "utils.hpp"
+
+#include <sstream>
+#include <thread>
+
+using namespace skywing;
+
+using ValueTag = PublishTag<std::int32_t>;
+const ValueTag tag{"Directory Tag"};
+const std::int32_t tag_value = 10;
+const std::uint16_t subscriber_port = get_starting_port();
+const std::uint16_t publisher_port = subscriber_port + 1;
+const std::string publisher_id = "directory publisher";
+
+TEST_CASE("Publisher directories are read", "[Skywing_PublisherDirectory]")
+{
+  std::istringstream in{"# tag\taddress\tmachine\n"
+                        "\n"
+                        "Directory Tag\t127.0.0.1:1234\tagent 1\n"
+                        "other\tlocalhost:5678\tagent 2\n"};
+  const auto entries = read_publisher_directory(in);
+  REQUIRE(entries);
+  REQUIRE(entries->size() == 2);
+  REQUIRE((*entries)[0].tag == tag.id());
+  REQUIRE((*entries)[0].address == "127.0.0.1:1234");
+  REQUIRE((*entries)[0].machine_id == "agent 1");
+  REQUIRE((*entries)[1].address == "localhost:5678");
+
+  std::istringstream missing_field{"Directory Tag\t127.0.0.1:1234\n"};
+  REQUIRE(!read_publisher_directory(missing_field));
+  std::istringstream bad_port{"Directory Tag\t127.0.0.1\tagent 1\n"};
+  REQUIRE(!read_publisher_directory(bad_port));
+}
+
+TEST_CASE("Subscribing to a tag in the directory connects without discovery", "[Skywing_PublisherDirectory]")
+{
+  std::atomic<bool> subscribed = false;
+  std::thread publisher{[&]() {
+    Manager manager{publisher_port, publisher_id};
+    manager.submit_job("publisher", [&](Job& job, ManagerHandle handle) {
+      job.declare_publication_intent(tag);
+      handle.waiter_on_subscription_change([&]() { return handle.number_of_subscribers(tag) > 0; }).wait();
+      while (!subscribed) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+      }
+      job.publish(tag, tag_value);
+    });
+    manager.run();
+  }};
+
+  // The subscriber has no neighbors to ask, so only the directory can find the publisher
+  Manager manager{subscriber_port, "directory subscriber"};
+  manager.add_known_publishers({PublisherDirectoryEntry{tag.id(), "127.0.0.1:" + std::to_string(publisher_port), publisher_id}});
+  manager.submit_job("subscriber", [&](Job& job, ManagerHandle handle) {
+    REQUIRE(job.subscribe(tag).wait_for(std::chrono::seconds{5}));
+    REQUIRE(handle.number_of_neighbors() == 1);
+    subscribed = true;
+    const auto value = job.get_waiter(tag).get();
+    REQUIRE(value);
+    REQUIRE(*value == tag_value);
+  });
+  manager.run();
+  publisher.join();
+}
+
+TEST_CASE("A directory publisher that starts late is retried until it is up", "[Skywing_PublisherDirectory]")
+{
+  const std::uint16_t late_subscriber_port = subscriber_port + 2;
+  const std::uint16_t late_publisher_port = subscriber_port + 3;
+  std::atomic<bool> subscribed = false;
+  // Connecting fails several times first, each one backing off further
+  std::thread publisher{[&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds{300});
+    Manager manager{late_publisher_port, publisher_id};
+    manager.submit_job("publisher", [&](Job& job, ManagerHandle handle) {
+      job.declare_publication_intent(tag);
+      handle.waiter_on_subscription_change([&]() { return handle.number_of_subscribers(tag) > 0; }).wait();
+      while (!subscribed) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+      }
+      job.publish(tag, tag_value);
+    });
+    manager.run();
+  }};
+
+  Manager manager{late_subscriber_port, "late directory subscriber"};
+  manager.add_known_publishers(
+    {PublisherDirectoryEntry{tag.id(), "127.0.0.1:" + std::to_string(late_publisher_port), publisher_id}});
+  manager.submit_job("subscriber", [&](Job& job, ManagerHandle handle) {
+    REQUIRE(job.subscribe(tag).wait_for(std::chrono::seconds{5}));
+    REQUIRE(handle.number_of_neighbors() == 1);
+    subscribed = true;
+    const auto value = job.get_waiter(tag).get();
+    REQUIRE(value);
+    REQUIRE(*value == tag_value);
+  });
+  manager.run();
+  publisher.join();
+}
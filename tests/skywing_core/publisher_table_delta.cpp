@@ -0,0 +1,153 @@
+#include <catch2/catch.hpp>
+
+#include "skywing_core/skywing.hpp"
+
+#include "fake_neighbor.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+
+using namespace skywing;
+
+using ValueTag = PublishTag<std::int32_t>;
+const ValueTag local_tag{"Local Tag"};
+const ValueTag later_local_tag{"Later Local Tag"};
+const ValueTag remote_tag{"Remote Tag"};
+const ValueTag missing_tag{"Missing Tag"};
+const std::uint16_t reporter_port = get_starting_port();
+const std::uint16_t requester_port = reporter_port + 1;
+
+namespace {
+// What a ReportPublishers said
+struct Report {
+  std::vector<TagID> tags;
+  std::vector<TagID> local_tags;
+  internal::PublisherTableVersion table_version;
+};
+
+bool contains(const std::vector<TagID>& tags, const TagID& tag)
+{
+  return std::find(tags.cbegin(), tags.cend(), tag) != tags.cend();
+}
+
+// Asks the Manager for its publisher table, saying how much of it is already known
+Report ask_for_publishers(
+  FakeNeighbor& neighbor, const std::uint64_t known_epoch, const std::uint64_t known_version, const std::uint64_t query_id)
+{
+  neighbor.send(internal::make_get_publishers({}, {}, false, known_epoch, known_version, query_id, 1));
+  Report report;
+  REQUIRE(neighbor.wait_for([&](const internal::ReportPublishers& msg) {
+    if (msg.query_id() != query_id) { return false; }
+    report = Report{msg.tags(), msg.locally_produced_tags(), {msg.epoch(), msg.base_version(), msg.version()}};
+    return true;
+  }));
+  return report;
+}
+
+// Waits for the Manager to ask for publishers, returning the query and how
+// much of the table it says it has
+std::tuple<std::uint64_t, std::uint64_t, std::uint64_t> next_request(FakeNeighbor& neighbor)
+{
+  std::tuple<std::uint64_t, std::uint64_t, std::uint64_t> request;
+  REQUIRE(neighbor.wait_for([&](const internal::GetPublishers& msg) {
+    request = {msg.query_id(), msg.known_epoch(), msg.known_version()};
+    return true;
+  }));
+  return request;
+}
+} // namespace
+
+TEST_CASE("Publisher reports only carry what the neighbor hasn't been sent", "[Skywing_PublisherTableDelta]")
+{
+  Manager manager{reporter_port, "reporter"};
+  manager.submit_job("job", [&](Job& job, ManagerHandle) {
+    job.declare_publication_intent(local_tag);
+    FakeNeighbor neighbor{reporter_port, "requester"};
+
+    // The whole table goes out on first contact
+    const auto full = ask_for_publishers(neighbor, 0, 0, 1);
+    REQUIRE(full.table_version.epoch != 0);
+    REQUIRE(full.table_version.base_version == 0);
+    REQUIRE(full.tags.empty());
+    REQUIRE(contains(full.local_tags, local_tag.id()));
+
+    // Only the tag that changed since then is sent next time
+    neighbor.send(internal::make_report_publishers(
+      {remote_tag.id()}, {{"127.0.0.1:1"}}, {{"remote publisher"}}, {}, {7, 0, 1}, 0));
+    const auto delta = ask_for_publishers(neighbor, full.table_version.epoch, full.table_version.version, 2);
+    REQUIRE(delta.table_version.epoch == full.table_version.epoch);
+    REQUIRE(delta.table_version.base_version == full.table_version.version);
+    REQUIRE(delta.table_version.version > full.table_version.version);
+    REQUIRE(delta.tags == std::vector<TagID>{remote_tag.id()});
+    REQUIRE(delta.local_tags.empty());
+
+    // Nothing changed, so nothing is sent
+    const auto unchanged = ask_for_publishers(neighbor, delta.table_version.epoch, delta.table_version.version, 3);
+    REQUIRE(unchanged.table_version.base_version == delta.table_version.version);
+    REQUIRE(unchanged.table_version.version == delta.table_version.version);
+    REQUIRE(unchanged.tags.empty());
+    REQUIRE(unchanged.local_tags.empty());
+
+    // A new local tag sends the local tags again, but not the remote one
+    job.declare_publication_intent(later_local_tag);
+    const auto new_local
+      = ask_for_publishers(neighbor, unchanged.table_version.epoch, unchanged.table_version.version, 4);
+    REQUIRE(new_local.tags.empty());
+    REQUIRE(contains(new_local.local_tags, local_tag.id()));
+    REQUIRE(contains(new_local.local_tags, later_local_tag.id()));
+
+    // Knowing a different epoch means knowing nothing of this table
+    const auto resync
+      = ask_for_publishers(neighbor, new_local.table_version.epoch + 1, new_local.table_version.version, 5);
+    REQUIRE(resync.table_version.base_version == 0);
+    REQUIRE(resync.table_version.version == new_local.table_version.version);
+    REQUIRE(resync.tags == std::vector<TagID>{remote_tag.id()});
+    REQUIRE(contains(resync.local_tags, local_tag.id()));
+    REQUIRE(contains(resync.local_tags, later_local_tag.id()));
+  });
+  manager.run();
+}
+
+TEST_CASE("Publisher requests ask for everything after missing changes", "[Skywing_PublisherTableDelta]")
+{
+  Manager manager{requester_port, "requester"};
+  manager.submit_job("job", [&](Job& job, ManagerHandle) {
+    // Nothing publishes this, so the Manager keeps asking
+    (void)job.subscribe(missing_tag);
+    FakeNeighbor neighbor{requester_port, "reporter"};
+    const auto reply = [&](const std::uint64_t query_id, const internal::PublisherTableVersion& table_version) {
+      neighbor.send(internal::make_report_publishers({}, {}, {}, {}, table_version, query_id));
+    };
+
+    auto [query_id, known_epoch, known_version] = next_request(neighbor);
+    REQUIRE(known_epoch == 0);
+    REQUIRE(known_version == 0);
+    reply(query_id, {7, 0, 5});
+
+    // Reports that follow on from each other are built on
+    std::tie(query_id, known_epoch, known_version) = next_request(neighbor);
+    REQUIRE(known_epoch == 7);
+    REQUIRE(known_version == 5);
+    reply(query_id, {7, 5, 6});
+    std::tie(query_id, known_epoch, known_version) = next_request(neighbor);
+    REQUIRE(known_epoch == 7);
+    REQUIRE(known_version == 6);
+
+    // Versions 7 through 9 were never seen
+    reply(query_id, {7, 9, 10});
+    std::tie(query_id, known_epoch, known_version) = next_request(neighbor);
+    REQUIRE(known_epoch == 0);
+    REQUIRE(known_version == 0);
+    reply(query_id, {7, 0, 10});
+    std::tie(query_id, known_epoch, known_version) = next_request(neighbor);
+    REQUIRE(known_epoch == 7);
+    REQUIRE(known_version == 10);
+
+    // The reporter restarted, so its versions start over
+    reply(query_id, {8, 10, 11});
+    std::tie(query_id, known_epoch, known_version) = next_request(neighbor);
+    REQUIRE(known_epoch == 0);
+    REQUIRE(known_version == 0);
+  });
+  manager.run();
+}
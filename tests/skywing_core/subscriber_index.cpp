@@ -0,0 +1,96 @@
+#include <catch2/catch.hpp>
+
+#include "skywing_core/skywing.hpp"
+
+#include "fake_neighbor.hpp"
+#include "utils.hpp"
+
+#include <atomic>
+#include <optional>
+#include <thread>
+
+using namespace skywing;
+using namespace std::chrono_literals;
+
+using ValueTag = PublishTag<std::int32_t>;
+const ValueTag counted_tag{"Counted Tag"};
+const ValueTag shared_tag{"Shared Tag"};
+const std::int32_t last_value = 10;
+const std::uint16_t counted_port = get_starting_port();
+const std::uint16_t shared_port = counted_port + 1;
+
+namespace {
+// Waits for the number of subscribers to reach count, giving up after a while
+bool subscribers_become(ManagerHandle& handle, const ValueTag& tag, const int count)
+{
+  const auto deadline = std::chrono::steady_clock::now() + 5s;
+  while (handle.number_of_subscribers(tag) != count) {
+    if (std::chrono::steady_clock::now() > deadline) { return false; }
+    std::this_thread::sleep_for(1ms);
+  }
+  return true;
+}
+} // namespace
+
+TEST_CASE("Subscriber counts follow subscriptions and departures", "[Skywing_SubscriberIndex]")
+{
+  Manager manager{counted_port, "publisher"};
+  manager.submit_job("job", [&](Job& job, ManagerHandle handle) {
+    job.declare_publication_intent(counted_tag);
+    std::optional<FakeNeighbor> first{std::in_place, counted_port, "first"};
+    FakeNeighbor second{counted_port, "second"};
+    REQUIRE(handle.number_of_subscribers(counted_tag) == 0);
+
+    first->send(internal::make_subscription_notice({counted_tag.id()}, false));
+    REQUIRE(subscribers_become(handle, counted_tag, 1));
+    second.send(internal::make_subscription_notice({counted_tag.id()}, false));
+    REQUIRE(subscribers_become(handle, counted_tag, 2));
+
+    // Neighbors that leave stop counting, whether they say so or not
+    second.send(internal::make_goodbye());
+    REQUIRE(subscribers_become(handle, counted_tag, 1));
+    first.reset();
+    REQUIRE(subscribers_become(handle, counted_tag, 0));
+
+    // Nobody is left to send to
+    job.publish(counted_tag, last_value);
+  });
+  manager.run();
+}
+
+TEST_CASE("Jobs stop receiving data once they finish", "[Skywing_SubscriberIndex]")
+{
+  Manager manager{shared_port, "shared"};
+  std::atomic<bool> leaving_done = false;
+  manager.submit_job("publisher", [&](Job& job, ManagerHandle handle) {
+    job.declare_publication_intent(shared_tag);
+    REQUIRE(subscribers_become(handle, shared_tag, 2));
+    job.publish(shared_tag, 1);
+    while (!leaving_done) {
+      std::this_thread::sleep_for(1ms);
+    }
+    // Spread out so that some of these go out after the finished job is gone
+    for (std::int32_t i = 2; i <= last_value; ++i) {
+      std::this_thread::sleep_for(10ms);
+      job.publish(shared_tag, i);
+    }
+  });
+  manager.submit_job("leaving", [&](Job& job, ManagerHandle) {
+    REQUIRE(job.subscribe(shared_tag).wait_for(5s));
+    auto waiter = job.get_waiter(shared_tag);
+    REQUIRE(waiter.wait_for(5s));
+    REQUIRE(waiter.get() == 1);
+    leaving_done = true;
+  });
+  manager.submit_job("staying", [&](Job& job, ManagerHandle) {
+    REQUIRE(job.subscribe(shared_tag).wait_for(5s));
+    // Only the latest value is kept, so some may be skipped
+    std::optional<std::int32_t> value;
+    while (value != last_value) {
+      auto waiter = job.get_waiter(shared_tag);
+      REQUIRE(waiter.wait_for(5s));
+      value = waiter.get();
+    }
+  });
+  manager.run();
+}
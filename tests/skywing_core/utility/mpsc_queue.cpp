@@ -0,0 +1,55 @@
+#include <catch2/catch.hpp>
+
+#include "skywing_core/internal/utility/mpsc_queue.hpp"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace skywing::internal;
+
+TEST_CASE("MPSC queue keeps values in order", "[Skywing_MpscQueue]")
+{
+  MpscQueue<std::unique_ptr<int>> queue;
+  REQUIRE(!queue.pop());
+  for (int i = 0; i < 10; ++i) {
+    queue.push(std::make_unique<int>(i));
+  }
+  for (int i = 0; i < 10; ++i) {
+    const auto value = queue.pop();
+    REQUIRE(value);
+    REQUIRE(**value == i);
+  }
+  REQUIRE(!queue.pop());
+  // Anything left over is freed by the destructor
+  queue.push(std::make_unique<int>(10));
+}
+
+TEST_CASE("MPSC queue receives everything from multiple producers", "[Skywing_MpscQueue]")
+{
+  constexpr int num_producers = 4;
+  constexpr int values_per_producer = 10000;
+  MpscQueue<std::pair<int, int>> queue;
+  std::vector<std::thread> producers;
+  for (int producer = 0; producer < num_producers; ++producer) {
+    producers.emplace_back([&queue, producer]() {
+      for (int i = 0; i < values_per_producer; ++i) {
+        queue.push({producer, i});
+      }
+    });
+  }
+  // Each producer's values have to come out in the order they were pushed
+  std::vector<int> next_expected(num_producers, 0);
+  int num_received = 0;
+  while (num_received < num_producers * values_per_producer) {
+    if (const auto value = queue.pop()) {
+      REQUIRE(value->second == next_expected[value->first]);
+      ++next_expected[value->first];
+      ++num_received;
+    }
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  REQUIRE(!queue.pop());
+}
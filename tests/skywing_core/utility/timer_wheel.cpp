@@ -0,0 +1,105 @@
+#include <catch2/catch.hpp>
+
+#include "skywing_core/internal/utility/timer_wheel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+using namespace skywing::internal;
+using namespace std::chrono_literals;
+
+using Clock = std::chrono::steady_clock;
+
+TEST_CASE("Timer wheel expires keys once their deadline passes", "[Skywing_TimerWheel]")
+{
+  const auto start = Clock::now();
+  TimerWheel<int> wheel{10ms, start};
+  wheel.schedule(1, start + 25ms);
+  wheel.schedule(2, start + 5ms);
+  wheel.schedule(3, start + 2s);
+  REQUIRE(wheel.size() == 3);
+  REQUIRE(wheel.advance(start).empty());
+  REQUIRE(wheel.advance(start + 9ms).empty());
+  REQUIRE(wheel.advance(start + 10ms) == std::vector<int>{2});
+  // Rounded up to the tick, never early
+  REQUIRE(wheel.advance(start + 29ms).empty());
+  REQUIRE(wheel.advance(start + 30ms) == std::vector<int>{1});
+  REQUIRE(wheel.contains(3));
+  REQUIRE(!wheel.contains(1));
+  REQUIRE(wheel.advance(start + 1990ms).empty());
+  REQUIRE(wheel.advance(start + 2s) == std::vector<int>{3});
+  REQUIRE(wheel.empty());
+}
+
+TEST_CASE("Timer wheel rescheduling and cancelling replace the deadline", "[Skywing_TimerWheel]")
+{
+  const auto start = Clock::now();
+  TimerWheel<int> wheel{10ms, start};
+  wheel.schedule(1, start + 50ms);
+  wheel.schedule(2, start + 50ms);
+  wheel.schedule(1, start + 5s);
+  wheel.cancel(2);
+  wheel.cancel(3);
+  REQUIRE(wheel.size() == 1);
+  REQUIRE(wheel.advance(start + 4s).empty());
+  // Expired keys can be scheduled again straight away
+  auto expired = wheel.advance(start + 5s);
+  REQUIRE(expired == std::vector<int>{1});
+  wheel.schedule(1, start);
+  REQUIRE(wheel.advance(start + 5s).empty());
+  REQUIRE(wheel.advance(start + 5s + 10ms) == std::vector<int>{1});
+}
+
+TEST_CASE("Timer wheel keeps long deadlines across levels", "[Skywing_TimerWheel]")
+{
+  const auto start = Clock::now();
+  TimerWheel<int> wheel{1ms, start};
+  std::mt19937 rng{42};
+  // Up to past what the top level covers at this tick size
+  std::uniform_int_distribution<long long> pick{0, 20'000'000};
+  std::vector<long long> deadlines(200);
+  for (std::size_t i = 0; i < deadlines.size(); ++i) {
+    deadlines[i] = pick(rng);
+    wheel.schedule(static_cast<int>(i), start + std::chrono::milliseconds{deadlines[i]});
+  }
+  std::vector<long long> sorted = deadlines;
+  std::sort(sorted.begin(), sorted.end());
+  // Step to each deadline so every expiry can be checked for being on time
+  for (const auto deadline : sorted) {
+    const auto just_before = start + std::chrono::milliseconds{deadline} - 1ms;
+    for (const int key : wheel.advance(just_before)) {
+      REQUIRE(deadlines[key] <= deadline - 1);
+    }
+    for (const int key : wheel.advance(start + std::chrono::milliseconds{deadline})) {
+      REQUIRE(deadlines[key] == deadline);
+    }
+  }
+  REQUIRE(wheel.empty());
+}
+
+TEST_CASE("Timer wheel reports when it next needs to be advanced", "[Skywing_TimerWheel]")
+{
+  const auto start = Clock::now();
+  TimerWheel<int> wheel{10ms, start};
+  REQUIRE(!wheel.next_expiry());
+  wheel.schedule(1, start + 2s);
+  // Too far out to know exactly, but never later than the deadline
+  const auto far = wheel.next_expiry();
+  REQUIRE(far);
+  REQUIRE(*far <= start + 2s);
+  wheel.schedule(2, start + 25ms);
+  REQUIRE(wheel.next_expiry() == start + 30ms);
+  REQUIRE(wheel.advance(start + 30ms) == std::vector<int>{2});
+  // Advancing to the reported times eventually reaches the deadline
+  auto expired = wheel.advance(*wheel.next_expiry());
+  while (expired.empty()) {
+    const auto next = wheel.next_expiry();
+    REQUIRE(next);
+    REQUIRE(*next <= start + 2s);
+    expired = wheel.advance(*next);
+  }
+  REQUIRE(expired == std::vector<int>{1});
+  REQUIRE(!wheel.next_expiry());
+}
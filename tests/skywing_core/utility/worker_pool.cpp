@@ -0,0 +1,46 @@
+#include <catch2/catch.hpp>
+
+#include "skywing_core/internal/utility/worker_pool.hpp"
+
+#include <atomic>
+#include <vector>
+
+using namespace skywing::internal;
+
+TEST_CASE("Worker pool with one worker runs inline", "[Skywing_WorkerPool]")
+{
+  WorkerPool pool{1};
+  REQUIRE(pool.num_workers() == 1);
+  std::vector<int> order;
+  pool.for_each(5, [&](const std::size_t item, const std::size_t worker) {
+    REQUIRE(worker == 0);
+    order.push_back(static_cast<int>(item));
+  });
+  REQUIRE(order == std::vector<int>{0, 1, 2, 3, 4});
+}
+
+TEST_CASE("Worker pool calls every item exactly once", "[Skywing_WorkerPool]")
+{
+  constexpr std::size_t num_workers = 4;
+  constexpr std::size_t num_items = 1000;
+  WorkerPool pool{num_workers};
+  REQUIRE(pool.num_workers() == num_workers);
+  // Repeat to make sure the helpers pick up each new batch
+  for (int batch = 0; batch < 50; ++batch) {
+    std::vector<std::atomic<int>> calls(num_items);
+    std::vector<std::size_t> per_worker(num_workers, 0);
+    pool.for_each(num_items, [&](const std::size_t item, const std::size_t worker) {
+      calls[item].fetch_add(1);
+      // No two calls share a worker index at once, so this doesn't race
+      ++per_worker[worker];
+    });
+    for (const auto& count : calls) {
+      REQUIRE(count.load() == 1);
+    }
+    std::size_t total = 0;
+    for (const auto count : per_worker) {
+      total += count;
+    }
+    REQUIRE(total == num_items);
+  }
+}